@@ -17,6 +17,7 @@
 #include <squirrel_attention/pcl_conversions.h>
 #include "v4r/AttentionModule/AttentionModule.hpp"
 #include "v4r/EPUtils/EPUtils.hpp"
+#include "v4r/ORUtils/organized_plane_extraction.hpp"
 
 #include <cv_bridge/cv_bridge.h>
 #include <sensor_msgs/image_encodings.h>
@@ -27,6 +28,8 @@ protected:
   typedef pcl::PointXYZRGB PointT;
   ros::ServiceServer attention_;
   ros::NodeHandle *n_;
+  faat_pcl::OrganizedPlaneExtraction<PointT>::Ptr plane_extraction_;
+  bool use_plane_extraction_;
   
   void getImageFromPointCloud(pcl::PointCloud<PointT>::Ptr scene, cv::Mat &RGB);
   int 
@@ -34,11 +37,15 @@ protected:
                     pcl::PointCloud<pcl::Normal>::Ptr normals, pcl::PointIndices::Ptr objects_indices);
   
 public:
-  AttentionBaseService () {};
+  AttentionBaseService () : use_plane_extraction_(false) { plane_extraction_.reset(new faat_pcl::OrganizedPlaneExtraction<PointT>); };
   virtual ~AttentionBaseService () { 
     if(n_)
       delete n_; 
   };
+  
+  // organized clouds: take plane and normals from the plane extraction instead of filter -> RANSAC plane -> normals
+  void setUsePlaneExtraction(bool use) { use_plane_extraction_ = use; };
+  void setPlaneExtraction(faat_pcl::OrganizedPlaneExtraction<PointT>::Ptr plane_extraction) { plane_extraction_ = plane_extraction; };
 };
 
 void AttentionBaseService::getImageFromPointCloud(pcl::PointCloud<PointT>::Ptr scene, cv::Mat &RGB)
@@ -57,6 +64,44 @@ AttentionBaseService::preparePointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr c
     return(pclAddOns::FILTER);
   }
   
+  // organized clouds: plane and normals from the plane extraction (computed once per cloud)
+  if(use_plane_extraction_ && cloud->isOrganized() && plane_extraction_->compute(cloud))
+  {
+    // largest plane within the filtered points
+    int plane = plane_extraction_->getDominantPlane(indices->indices);
+    
+    if(plane >= 0)
+    {
+      *coefficients = plane_extraction_->getPlanes().at(plane).coefficients_;
+      
+      std::vector<int> off_plane;
+      plane_extraction_->getOffPlaneIndices(plane,indices->indices,off_plane);
+      
+      // normals are given per object point, points without a normal are dropped
+      pcl::PointCloud<pcl::Normal>::Ptr all_normals = plane_extraction_->getNormals();
+      objects_indices->indices.clear();
+      normals->points.clear();
+      for(unsigned int idx = 0; idx < off_plane.size(); ++idx)
+      {
+        const pcl::Normal &n = all_normals->points.at(off_plane.at(idx));
+        if(!pcl_isfinite(n.normal_x) || !pcl_isfinite(n.normal_y) || !pcl_isfinite(n.normal_z))
+          continue;
+        
+        objects_indices->indices.push_back(off_plane.at(idx));
+        normals->points.push_back(n);
+      }
+      normals->width = normals->points.size();
+      normals->height = 1;
+      
+      if(!normals->size())
+      {
+        return(pclAddOns::NORMALS);
+      }
+      
+      return(0);
+    }
+  }
+  
   // segment plane
   pcl::PointIndices::Ptr plane_indices(new pcl::PointIndices());
   if(!pclAddOns::SegmentPlane<pcl::PointXYZRGB>(cloud,indices,plane_indices,objects_indices,coefficients))
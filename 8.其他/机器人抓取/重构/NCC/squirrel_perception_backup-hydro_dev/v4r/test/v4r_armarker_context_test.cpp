@@ -0,0 +1,194 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/armarker/AR/ar.h"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+
+class ARContextTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    int sizes[4][2] = { {320,240}, {640,480}, {1280,960}, {1600,1200} };
+    for(int i = 0; i < 4; ++i)
+    {
+      widths_.push_back(sizes[i][0]);
+      heights_.push_back(sizes[i][1]);
+      images_.push_back(markers(sizes[i][0],sizes[i][1],i+1));
+    }
+    frames_ = 3;
+    thresh_ = 100;
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+    for(size_t i = 0; i < images_.size(); ++i)
+    {
+      delete[] images_[i];
+    }
+    images_.clear();
+  }
+
+  //memebers
+  std::vector<int> widths_;
+  std::vector<int> heights_;
+  std::vector<ARUint8*> images_;
+  int frames_;
+  int thresh_;
+
+  // white image with three black squares, each with a white inner square and a black quarter in it
+  ARUint8* markers(int w, int h, unsigned int seed)
+  {
+    ARUint8 *img = new ARUint8[w*h*AR_PIX_SIZE_DEFAULT];
+    memset(img,255,w*h*AR_PIX_SIZE_DEFAULT);
+    srand(seed);
+    for(int m = 0; m < 3; ++m)
+    {
+      int s = w/8 + rand()%(w/10);
+      int x0 = 20 + m*(w/3);
+      int y0 = h/4 + rand()%(h/4);
+      for(int y = y0; (y < y0+s) && (y < h-2); ++y)
+      {
+        for(int x = x0; (x < x0+s) && (x < w-2); ++x)
+        {
+          bool inner = (x > x0+s/4) && (x < x0+3*s/4) && (y > y0+s/4) && (y < y0+3*s/4);
+          ARUint8 v = inner ? 255 : 0;
+          if(inner && (x < x0+s/2) && (y < y0+s/2))
+            v = 0;
+          for(int c = 0; c < AR_PIX_SIZE_DEFAULT; ++c)
+            img[(y*w+x)*AR_PIX_SIZE_DEFAULT+c] = v;
+        }
+      }
+    }
+    return(img);
+  }
+
+  ARContext* createContext(int w, int h)
+  {
+    ARParam param;
+    memset(&param,0,sizeof(ARParam));
+    param.dist_factor[3] = 1;
+    param.xsize = w;
+    param.ysize = h;
+    return(arCreateContext(&param,NULL));
+  }
+
+  // detects the markers of image i in a few frames (the tracking history is used from the second one on)
+  void detect(int i, std::vector<ARMarkerInfo> &result, int &ret)
+  {
+    ARContext *ctx = createContext(widths_[i],heights_[i]);
+    ARMarkerInfo *marker_info;
+    int marker_num = 0;
+    ret = 0;
+    for(int f = 0; (f < frames_) && (ret >= 0); ++f)
+    {
+      ret = arContextDetectMarker(ctx,images_[i],thresh_,&marker_info,&marker_num);
+    }
+    result.clear();
+    if(ret >= 0)
+    {
+      result.assign(marker_info,marker_info+marker_num);
+    }
+    arDeleteContext(ctx);
+  }
+
+  void compareMarkers(const std::vector<ARMarkerInfo> &expected, const std::vector<ARMarkerInfo> &result, int i)
+  {
+    ASSERT_EQ(expected.size(),result.size()) << widths_[i] << "x" << heights_[i];
+    for(size_t m = 0; m < expected.size(); ++m)
+    {
+      EXPECT_EQ(expected[m].area,result[m].area) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      EXPECT_EQ(expected[m].id,result[m].id) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      EXPECT_EQ(expected[m].dir,result[m].dir) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      EXPECT_EQ(expected[m].cf,result[m].cf) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      EXPECT_EQ(expected[m].pos[0],result[m].pos[0]) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      EXPECT_EQ(expected[m].pos[1],result[m].pos[1]) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      for(int k = 0; k < 4; ++k)
+      {
+        EXPECT_EQ(expected[m].vertex[k][0],result[m].vertex[k][0]) << widths_[i] << "x" << heights_[i] << " marker " << m;
+        EXPECT_EQ(expected[m].vertex[k][1],result[m].vertex[k][1]) << widths_[i] << "x" << heights_[i] << " marker " << m;
+      }
+    }
+  }
+};
+
+TEST_F(ARContextTest, detectsSyntheticMarkers)
+{
+  for(int i = 0; i < (int)images_.size(); ++i)
+  {
+    std::vector<ARMarkerInfo> result;
+    int ret;
+    detect(i,result,ret);
+    ASSERT_GE(ret,0) << widths_[i] << "x" << heights_[i];
+    EXPECT_EQ(3,(int)result.size()) << widths_[i] << "x" << heights_[i];
+  }
+}
+
+TEST_F(ARContextTest, parallelDetectionMatchesSerial)
+{
+  int n = (int)images_.size();
+  std::vector<std::vector<ARMarkerInfo> > serial(n), parallel(n);
+  std::vector<int> serial_ret(n), parallel_ret(n);
+
+  for(int i = 0; i < n; ++i)
+  {
+    detect(i,serial[i],serial_ret[i]);
+  }
+
+  // every resolution twice at the same time, one context per detection
+#pragma omp parallel for schedule(dynamic,1)
+  for(int j = 0; j < 2*n; ++j)
+  {
+    std::vector<ARMarkerInfo> result;
+    int ret;
+    detect(j%n,result,ret);
+    if(j < n)
+    {
+      parallel[j] = result;
+      parallel_ret[j] = ret;
+    }
+  }
+
+  for(int i = 0; i < n; ++i)
+  {
+    ASSERT_GE(serial_ret[i],0);
+    ASSERT_GE(parallel_ret[i],0);
+    compareMarkers(serial[i],parallel[i],i);
+  }
+}
+
+TEST_F(ARContextTest, globalApiMatchesContext)
+{
+  // the largest image does not fit into the former static 1024x1024 label image
+  int i = (int)images_.size() - 1;
+  std::vector<ARMarkerInfo> expected;
+  int ret;
+  detect(i,expected,ret);
+  ASSERT_GE(ret,0);
+
+  ARParam param;
+  memset(&param,0,sizeof(ARParam));
+  param.dist_factor[3] = 1;
+  param.xsize = widths_[i];
+  param.ysize = heights_[i];
+  arInitCparam(&param);
+
+  ARMarkerInfo *marker_info;
+  int marker_num = 0;
+  for(int f = 0; f < frames_; ++f)
+  {
+    ASSERT_GE(arDetectMarker(images_[i],thresh_,&marker_info,&marker_num),0);
+  }
+  compareMarkers(expected,std::vector<ARMarkerInfo>(marker_info,marker_info+marker_num),i);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/AttentionModule/WTA.hpp"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+class WTAEventsTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    AttentionModule::defaultParams(params_);
+    rows_ = 30;
+    cols_ = 40;
+    fixations_ = 12;
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+  }
+
+  //memebers
+  AttentionModule::Params params_;
+  int rows_;
+  int cols_;
+  int fixations_;
+
+  // a sum of gaussian blobs with random positions, amplitudes and widths
+  cv::Mat blobs(unsigned int seed, int number)
+  {
+    srand(seed);
+    cv::Mat salmap = cv::Mat_<float>::zeros(rows_,cols_);
+    for(int b = 0; b < number; ++b)
+    {
+      float cx = rand()%cols_;
+      float cy = rand()%rows_;
+      float a = (rand()%100)/100.0 + 0.1;
+      float s = 1 + rand()%4;
+      for(int i = 0; i < rows_; ++i)
+      {
+        for(int j = 0; j < cols_; ++j)
+        {
+          salmap.at<float>(i,j) += a*exp(-((i-cy)*(i-cy) + (j-cx)*(j-cx))/(2*s*s));
+        }
+      }
+    }
+    return(salmap);
+  }
+
+  // the matrices of a LIF are shared on copy, evolveWTA must not touch the ones of the event driven run
+  void cloneLIF(const AttentionModule::LIF& src, AttentionModule::LIF& dst)
+  {
+    dst = src;
+    dst.Ginh = src.Ginh.clone();
+    dst.V = src.V.clone();
+    dst.I = src.I.clone();
+  }
+
+  void cloneWTA(const AttentionModule::WTA& src, AttentionModule::WTA& dst)
+  {
+    cloneLIF(src.sm,dst.sm);
+    cloneLIF(src.exc,dst.exc);
+    cloneLIF(src.inhib,dst.inhib);
+  }
+
+  // fixations of the step by step simulation and of the event driven one, started from the same (noisy) input
+  void compareFixations(const cv::Mat& salmap)
+  {
+    AttentionModule::WTA wta;
+    AttentionModule::initializeWTA(wta,salmap,params_);
+
+    AttentionModule::WTA dense;
+    cloneWTA(wta,dense);
+
+    std::vector<cv::Point> expected;
+    for(int n = 0; n < fixations_; ++n)
+    {
+      cv::Point winner(-1,-1);
+      while(winner.x == -1)
+      {
+        AttentionModule::evolveWTA(dense,winner);
+      }
+      AttentionModule::applyIOR(dense,winner,params_);
+      expected.push_back(winner);
+    }
+
+    AttentionModule::WTAEvents events;
+    AttentionModule::initializeWTAEvents(events,wta);
+    for(int n = 0; n < fixations_; ++n)
+    {
+      cv::Point winner;
+      ASSERT_TRUE(AttentionModule::evolveWTAEvents(events,wta,winner,params_));
+      EXPECT_EQ(expected[n].x,winner.x) << "fixation " << n;
+      EXPECT_EQ(expected[n].y,winner.y) << "fixation " << n;
+    }
+  }
+};
+
+TEST_F(WTAEventsTest, sameFixationsOnBlobs)
+{
+  for(unsigned int seed = 100; seed < 105; ++seed)
+  {
+    compareFixations(blobs(seed,8));
+  }
+}
+
+TEST_F(WTAEventsTest, sameFixationsOnSingleBlob)
+{
+  compareFixations(blobs(7,1));
+}
+
+TEST_F(WTAEventsTest, sameFixationsOnRamp)
+{
+  cv::Mat salmap = cv::Mat_<float>::zeros(rows_,cols_);
+  for(int i = 0; i < rows_; ++i)
+  {
+    for(int j = 0; j < cols_; ++j)
+    {
+      salmap.at<float>(i,j) = (float)(i + j)/(rows_ + cols_);
+    }
+  }
+  compareFixations(salmap);
+}
+
+TEST_F(WTAEventsTest, sameFixationsOnConstantMap)
+{
+  // only the noise of initializeWTA and the column major order of evolveWTA decide the ties
+  cv::Mat salmap = cv::Mat_<float>::zeros(rows_,cols_);
+  salmap = 0.5;
+  compareFixations(salmap);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
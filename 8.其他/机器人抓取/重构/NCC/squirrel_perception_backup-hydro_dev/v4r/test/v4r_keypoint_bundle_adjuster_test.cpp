@@ -0,0 +1,248 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/KeypointCameraTracker/BundleAdjusterRT.hh"
+#include "v4r/KeypointCameraTracker/PoseMarginalization.hh"
+#include "v4r/KeypointTools/invPose.hpp"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <math.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+class BundleAdjusterRTTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    srand(1);
+    nb_keyframes_ = 24;
+    nb_points_ = 300;
+    nb_links_ = 3;
+    noise_ = 0.001;
+
+    // landmarks in front of a camera moving sideways along a slight arc
+    for(int i = 0; i < nb_points_; ++i)
+    {
+      points_.push_back(Eigen::Vector3f(uniform(-1.5,2.5), uniform(-1.,1.), uniform(1.5,3.5)));
+    }
+    for(int i = 0; i < nb_keyframes_; ++i)
+    {
+      Eigen::Matrix4f cam = Eigen::Matrix4f::Identity();
+      cam.topLeftCorner<3,3>() = Eigen::AngleAxisf(0.01f*i, Eigen::Vector3f::UnitY()).toRotationMatrix();
+      cam.block<3,1>(0,3) = Eigen::Vector3f(0.04f*i, 0.005f*sin(0.5f*i), 0.002f*i);
+      Eigen::Matrix4f pose;
+      kp::invPose(cam,pose);
+      gt_poses_.push_back(pose);
+    }
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+  }
+
+  //memebers
+  int nb_keyframes_;
+  int nb_points_;
+  int nb_links_;
+  double noise_;
+  std::vector<Eigen::Vector3f> points_;
+  std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > gt_poses_;
+
+  double uniform(double min, double max)
+  {
+    return(min + (max-min)*rand()/(double)RAND_MAX);
+  }
+
+  double gauss(double sigma)
+  {
+    double u1 = uniform(1e-12,1.);
+    double u2 = uniform(0.,1.);
+    return(sigma*sqrt(-2.*log(u1))*cos(2.*M_PI*u2));
+  }
+
+  // keyframe i: noisy local points, linked to the same landmark in the last nb_links_ keyframes, perturbed pose
+  kp::View::Ptr createKeyframe(int i)
+  {
+    kp::View::Ptr view(new kp::View(i,1,true));
+    view->keys.resize(nb_points_);
+    for(int j = 0; j < nb_points_; ++j)
+    {
+      kp::LinkedKeypoint &key = view->keys[j];
+      key.pt3 = (gt_poses_[i]*points_[j].homogeneous()).head<3>();
+      for(int k = 0; k < 3; ++k)
+      {
+        key.pt3[k] += gauss(noise_);
+      }
+      for(int l = i-1; (l >= 0) && (l >= i-nb_links_); --l)
+      {
+        key.links.push_back(std::make_pair(l,j));
+      }
+    }
+
+    view->pose = gt_poses_[i];
+    if(i > 0)
+    {
+      Eigen::Matrix4f delta = Eigen::Matrix4f::Identity();
+      Eigen::Vector3f axis(uniform(-1.,1.), uniform(-1.,1.), uniform(-1.,1.));
+      delta.topLeftCorner<3,3>() = Eigen::AngleAxisf(0.01f, axis.normalized()).toRotationMatrix();
+      delta.block<3,1>(0,3) = Eigen::Vector3f(uniform(-0.02,0.02), uniform(-0.02,0.02), uniform(-0.02,0.02));
+      view->pose = delta*gt_poses_[i];
+    }
+    return(view);
+  }
+
+  void poseError(const Eigen::Matrix4f &pose, const Eigen::Matrix4f &gt, double &trans, double &rot)
+  {
+    Eigen::Matrix4f inv_gt;
+    kp::invPose(gt,inv_gt);
+    Eigen::Matrix4f delta = pose*inv_gt;
+    trans = delta.block<3,1>(0,3).norm();
+    Eigen::AngleAxisf aa(Eigen::Matrix3f(delta.topLeftCorner<3,3>()));
+    rot = fabs(aa.angle());
+  }
+
+  // adds the keyframes one by one and optimizes after each, as the camera tracker does
+  void run(const kp::BundleAdjusterRT::Parameter &param, double &max_trans, double &max_rot, double &max_time)
+  {
+    kp::Scene::Ptr scene(new kp::Scene());
+    kp::BundleAdjusterRT ba(param);
+    ba.setSharedData(scene);
+
+    max_time = 0.;
+    for(int i = 0; i < nb_keyframes_; ++i)
+    {
+      scene->views.push_back(createKeyframe(i));
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+      ba.optimize();
+      boost::posix_time::ptime end = boost::posix_time::microsec_clock::local_time();
+      max_time = std::max(max_time, (double)(end - start).total_milliseconds());
+    }
+
+    max_trans = max_rot = 0.;
+    for(int i = 0; i < nb_keyframes_; ++i)
+    {
+      double trans, rot;
+      poseError(scene->views[i]->pose,gt_poses_[i],trans,rot);
+      max_trans = std::max(max_trans,trans);
+      max_rot = std::max(max_rot,rot);
+    }
+  }
+};
+
+TEST_F(BundleAdjusterRTTest, slidingWindowWithMarginalization)
+{
+  double trans, rot, time;
+  run(kp::BundleAdjusterRT::Parameter(5,true,"DENSE_SCHUR",1), trans, rot, time);
+  EXPECT_LT(trans,0.005) << "max. translation error [m]";
+  EXPECT_LT(rot,0.2*M_PI/180.) << "max. rotation error [rad]";
+  EXPECT_LT(time,1000.) << "max. time per optimize() [ms]";
+}
+
+TEST_F(BundleAdjusterRTTest, slidingWindowWithConstantKeyframes)
+{
+  double trans, rot, time;
+  run(kp::BundleAdjusterRT::Parameter(5,false,"DENSE_SCHUR",1), trans, rot, time);
+  EXPECT_LT(trans,0.01) << "max. translation error [m]";
+  EXPECT_LT(rot,0.5*M_PI/180.) << "max. rotation error [rad]";
+  EXPECT_LT(time,1000.) << "max. time per optimize() [ms]";
+}
+
+TEST_F(BundleAdjusterRTTest, fullBundleAdjustment)
+{
+  double trans, rot, time;
+  run(kp::BundleAdjusterRT::Parameter(INT_MAX,true,"DENSE_SCHUR",1), trans, rot, time);
+  EXPECT_LT(trans,0.005) << "max. translation error [m]";
+  EXPECT_LT(rot,0.2*M_PI/180.) << "max. rotation error [rad]";
+}
+
+class PoseMarginalizationTest : public testing::Test
+{
+
+protected:
+  virtual void SetUp()
+  {
+    srand(2);
+    nb_cameras_ = 6;
+    cameras_.resize(nb_cameras_);
+    for(int i = 0; i < nb_cameras_; ++i)
+    {
+      cameras_[i] = Eigen::Matrix<double, 6, 1>::Random();
+    }
+  }
+
+  virtual void TearDown()
+  {
+  }
+
+  int nb_cameras_;
+  std::vector<Eigen::Matrix<double, 6, 1> > cameras_;
+};
+
+TEST_F(PoseMarginalizationTest, priorMatchesFullSolution)
+{
+  // random linear residuals between neighbouring cameras, camera 0 is constant (-1)
+  kp::PoseMarginalization marg(0.);
+  Eigen::MatrixXd H = Eigen::MatrixXd::Zero(6*nb_cameras_,6*nb_cameras_);
+  Eigen::VectorXd b = Eigen::VectorXd::Zero(6*nb_cameras_);
+  std::vector<int> cams(2);
+  for(int i = 1; i < nb_cameras_; ++i)
+  {
+    for(int k = 0; k < 4; ++k)
+    {
+      Eigen::MatrixXd J = Eigen::MatrixXd::Random(6,12);
+      Eigen::VectorXd r = Eigen::VectorXd::Random(6);
+      cams[0] = (i-1==0 ? -1 : i-1);
+      cams[1] = i;
+      marg.addResidual(cams,J,r);
+
+      Eigen::MatrixXd Jfull = Eigen::MatrixXd::Zero(6,6*nb_cameras_);
+      if(cams[0] >= 0)
+        Jfull.block(0,6*cams[0],6,6) = J.leftCols(6);
+      Jfull.block(0,6*cams[1],6,6) = J.rightCols(6);
+      H += Jfull.transpose()*Jfull;
+      b += Jfull.transpose()*r;
+    }
+  }
+
+  // full Gauss-Newton step on cameras 1..n-1
+  int n = 6*(nb_cameras_-1);
+  Eigen::VectorXd dx_full = H.bottomRightCorner(n,n).ldlt().solve(-b.tail(n));
+
+  // marginalise cameras 1 and 2, the prior alone has to give the same step for the others
+  std::vector<int> m;
+  m.push_back(1);
+  m.push_back(2);
+  kp::PoseMarginalization::Prior prior;
+  ASSERT_TRUE(marg.marginalize(m,cameras_,prior));
+  ASSERT_EQ(nb_cameras_-3,(int)prior.idx.size());
+
+  Eigen::VectorXd dx_prior = prior.R.triangularView<Eigen::Upper>().solve(-prior.e0);
+  for(unsigned i = 0; i < prior.idx.size(); ++i)
+  {
+    int c = prior.idx[i];
+    EXPECT_LT((dx_prior.segment<6>(6*i) - dx_full.segment<6>(6*(c-1))).norm(), 1e-8) << "camera " << c;
+    EXPECT_EQ(0.,(prior.x0.segment<6>(6*i) - cameras_[c]).norm()) << "camera " << c;
+  }
+
+  // the prior of a second marginalisation evaluated at the linearisation point keeps the solution
+  kp::PoseMarginalization marg2(0.);
+  marg2.addPrior(prior,cameras_);
+  std::vector<int> m2(1,3);
+  kp::PoseMarginalization::Prior prior2;
+  ASSERT_TRUE(marg2.marginalize(m2,cameras_,prior2));
+  Eigen::VectorXd dx_prior2 = prior2.R.triangularView<Eigen::Upper>().solve(-prior2.e0);
+  for(unsigned i = 0; i < prior2.idx.size(); ++i)
+  {
+    int c = prior2.idx[i];
+    EXPECT_LT((dx_prior2.segment<6>(6*i) - dx_full.segment<6>(6*(c-1))).norm(), 1e-8) << "camera " << c;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
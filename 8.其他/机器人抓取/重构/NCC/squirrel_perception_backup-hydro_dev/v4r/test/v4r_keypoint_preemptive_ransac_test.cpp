@@ -0,0 +1,159 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/KeypointTools/PreemptiveRANSAC.hpp"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <math.h>
+
+// 2d line y = a*x + b
+class LineProblem
+{
+public:
+  struct Hypothesis
+  {
+    float a, b;
+  };
+
+  std::vector<Eigen::Vector2f, Eigen::aligned_allocator<Eigen::Vector2f> > points;
+
+  int getSampleSize() const { return 2; }
+  int getNumberOfData() const { return (int)points.size(); }
+
+  bool estimate(const std::vector<int> &sample, Hypothesis &h) const
+  {
+    const Eigen::Vector2f &p0 = points[sample[0]];
+    const Eigen::Vector2f &p1 = points[sample[1]];
+    if (fabs(p1[0]-p0[0]) < 1e-6)
+      return false;
+    h.a = (p1[1]-p0[1]) / (p1[0]-p0[0]);
+    h.b = p0[1] - h.a*p0[0];
+    return true;
+  }
+
+  bool isInlier(const Hypothesis &h, int idx) const
+  {
+    return fabs(points[idx][1] - (h.a*points[idx][0] + h.b)) < 0.01;
+  }
+};
+
+class PreemptiveRANSACTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    // 200 points of y = 2x + 1 and 300 outliers
+    srand(42);
+    for (int i=0; i<500; i++)
+    {
+      float x = rand() / (float)RAND_MAX;
+      if (i%5 < 2)
+        problem_.points.push_back(Eigen::Vector2f(x, 2.f*x + 1.f + 0.001f*(rand()/(float)RAND_MAX-0.5f)));
+      else
+        problem_.points.push_back(Eigen::Vector2f(x, 3.f*rand()/(float)RAND_MAX));
+    }
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+  }
+
+  //memebers
+  LineProblem problem_;
+
+  int
+  run (kp::PreemptiveRANSAC<LineProblem>::Parameter param, LineProblem::Hypothesis &best, int &nb_trials)
+  {
+    kp::PreemptiveRANSAC<LineProblem> ransac(param);
+    best.a = best.b = 0.f;
+    return ransac.compute(problem_, best, nb_trials);
+  }
+};
+
+TEST_F(PreemptiveRANSACTest, sequentialIndependentOfThreads)
+{
+  kp::PreemptiveRANSAC<LineProblem>::Parameter param;
+  param.seed = 7;
+
+  LineProblem::Hypothesis h1, h4, h1_again;
+  int trials1, trials4, trials1_again;
+  param.nb_threads = 1;
+  int inl1 = run(param, h1, trials1);
+  int inl1_again = run(param, h1_again, trials1_again);
+  param.nb_threads = 4;
+  int inl4 = run(param, h4, trials4);
+
+  EXPECT_GE(inl1, 200);
+  EXPECT_NEAR(2.f, h1.a, 0.01);
+  EXPECT_NEAR(1.f, h1.b, 0.01);
+
+  EXPECT_EQ(inl1, inl1_again);
+  EXPECT_EQ(trials1, trials1_again);
+  EXPECT_EQ(h1.a, h1_again.a);
+  EXPECT_EQ(h1.b, h1_again.b);
+
+  EXPECT_EQ(inl1, inl4);
+  EXPECT_EQ(trials1, trials4);
+  EXPECT_EQ(h1.a, h4.a);
+  EXPECT_EQ(h1.b, h4.b);
+}
+
+TEST_F(PreemptiveRANSACTest, preemptiveIndependentOfThreads)
+{
+  kp::PreemptiveRANSAC<LineProblem>::Parameter param;
+  param.seed = 3;
+  param.nb_hypotheses_batch = 64;
+  param.nb_points_block = 20;
+
+  LineProblem::Hypothesis h1, h3, h8;
+  int trials1, trials3, trials8;
+  param.nb_threads = 1;
+  int inl1 = run(param, h1, trials1);
+  param.nb_threads = 3;
+  int inl3 = run(param, h3, trials3);
+  param.nb_threads = 8;
+  int inl8 = run(param, h8, trials8);
+
+  EXPECT_GE(inl1, 200);
+  EXPECT_NEAR(2.f, h1.a, 0.01);
+  EXPECT_NEAR(1.f, h1.b, 0.01);
+
+  EXPECT_EQ(inl1, inl3);
+  EXPECT_EQ(trials1, trials3);
+  EXPECT_EQ(h1.a, h3.a);
+  EXPECT_EQ(h1.b, h3.b);
+
+  EXPECT_EQ(inl1, inl8);
+  EXPECT_EQ(trials1, trials8);
+  EXPECT_EQ(h1.a, h8.a);
+  EXPECT_EQ(h1.b, h8.b);
+}
+
+TEST_F(PreemptiveRANSACTest, seedChangesSamples)
+{
+  kp::PreemptiveRANSAC<LineProblem>::Parameter param;
+  param.nb_hypotheses_batch = 64;
+  param.nb_points_block = 20;
+  param.eta_ransac = 0.;
+  param.max_rand_trials = 64;
+
+  LineProblem::Hypothesis h1, h2;
+  int trials1, trials2;
+  param.seed = 1;
+  run(param, h1, trials1);
+  param.seed = 2;
+  run(param, h2, trials2);
+
+  EXPECT_EQ(64, trials1);
+  EXPECT_EQ(64, trials2);
+  EXPECT_TRUE(h1.a != h2.a || h1.b != h2.b);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/ORFramework/linemod3d_recognizer.h"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <pcl/point_types.h>
+#include <pcl/recognition/quantizable_modality.h>
+
+using namespace faat_pcl::rec_3d_framework;
+
+// gives access to the templates and the sharded detection
+class LineMod3DPipelineTestable : public LineMod3DPipeline<pcl::PointXYZRGBA>
+{
+public:
+  pcl::LINEMOD &
+  getLineMod ()
+  {
+    return linemod_;
+  }
+
+  using LineMod3DPipeline<pcl::PointXYZRGBA>::createTemplateShards;
+  using LineMod3DPipeline<pcl::PointXYZRGBA>::detectTemplates;
+};
+
+// modality with a given (already spreaded) quantized map
+class FixedModality : public pcl::QuantizableModality
+{
+public:
+  pcl::QuantizedMap map_;
+
+  pcl::QuantizedMap &
+  getQuantizedMap ()
+  {
+    return map_;
+  }
+
+  pcl::QuantizedMap &
+  getSpreadedQuantizedMap ()
+  {
+    return map_;
+  }
+
+  void
+  extractFeatures (const pcl::MaskMap &, size_t, size_t, std::vector<pcl::QuantizedMultiModFeature> &) const
+  {
+  }
+
+  void
+  extractAllFeatures (const pcl::MaskMap &, size_t, size_t, std::vector<pcl::QuantizedMultiModFeature> &) const
+  {
+  }
+};
+
+class LineModTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    srand (42);
+
+    // 8 bins per pixel, a random subset of them set as after spreading
+    for (size_t m = 0; m < 2; m++)
+    {
+      modalities_[m].map_.resize (160, 120);
+      for (size_t y = 0; y < 120; y++)
+        for (size_t x = 0; x < 160; x++)
+          modalities_[m].map_ (x, y) = static_cast<unsigned char> (rand () % 256);
+    }
+
+    // one bin per feature as LINEMOD extracts them, the offsets stay inside the first 8x8 cell for all scales
+    for (int t = 0; t < 37; t++)
+    {
+      pcl::SparseQuantizedMultiModTemplate templ;
+      int n_features = 1 + rand () % 100;
+      for (int f = 0; f < n_features; f++)
+      {
+        pcl::QuantizedMultiModFeature feature;
+        feature.x = rand () % 5;
+        feature.y = rand () % 5;
+        feature.modality_index = rand () % 2;
+        feature.quantized_value = static_cast<unsigned char> (0x1 << (rand () % 8));
+        templ.features.push_back (feature);
+      }
+      templ.region.x = templ.region.y = 0;
+      templ.region.width = templ.region.height = 5;
+      pipeline_.getLineMod ().addTemplate (templ);
+    }
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+  }
+
+  //memebers
+  LineMod3DPipelineTestable pipeline_;
+  FixedModality modalities_[2];
+
+  std::vector<pcl::QuantizableModality*>
+  getModalities ()
+  {
+    std::vector<pcl::QuantizableModality*> modalities (2);
+    modalities[0] = &modalities_[0];
+    modalities[1] = &modalities_[1];
+    return modalities;
+  }
+};
+
+TEST_F(LineModTest, detectTemplatesEqualsLineMod)
+{
+  std::vector<pcl::QuantizableModality*> modalities = getModalities ();
+
+  std::vector<pcl::LINEMODDetection> expected, detections;
+  pipeline_.getLineMod ().detectTemplatesSemiScaleInvariant (modalities, expected);
+  pipeline_.createTemplateShards ();
+  pipeline_.detectTemplates (modalities, detections);
+
+  ASSERT_EQ (expected.size (), detections.size ());
+  for (size_t i = 0; i < detections.size (); i++)
+  {
+    EXPECT_EQ (expected[i].x, detections[i].x);
+    EXPECT_EQ (expected[i].y, detections[i].y);
+    EXPECT_EQ (expected[i].template_id, detections[i].template_id);
+    EXPECT_EQ (expected[i].score, detections[i].score);
+    EXPECT_EQ (expected[i].scale, detections[i].scale);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/ORFramework/model_database.h"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <pcl/point_types.h>
+#include <pcl/io/pcd_io.h>
+#include <boost/filesystem.hpp>
+
+using faat_pcl::rec_3d_framework::ModelDatabase;
+
+class ModelDatabaseTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    dir_ = boost::filesystem::temp_directory_path () / boost::filesystem::unique_path ("v4r_model_database_%%%%-%%%%-%%%%");
+    boost::filesystem::create_directories (dir_);
+
+    // a descriptor directory as written by the training: view 0 is complete, view 3 has a descriptor only,
+    // view 5 was interrupted while writing and the manifest is no view file
+    writeText ("pose_0.txt", "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16");
+    writeText ("entropy_0.txt", "0.25");
+    writeCloud ("descriptor_0.pcd", 3, 7.f);
+    writeCloud ("descriptor_3.pcd", 2, 1.5f);
+    writeCloud ("keypoint_indices_0.pcd", 1, 4.f);
+    writeText ("descriptor_5.pcd.tmp", "1");
+    writeText ("training_manifest.txt", "x");
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+    boost::filesystem::remove_all (dir_);
+  }
+
+  //memebers
+  boost::filesystem::path dir_;
+
+  std::string
+  file () const
+  {
+    return ModelDatabase::getFilename (dir_.string ());
+  }
+
+  void
+  writeText (const std::string & name, const std::string & content)
+  {
+    std::ofstream out ((dir_ / name).string ().c_str ());
+    out << content;
+  }
+
+  // n points (first, first+1, ...) in x
+  void
+  writeCloud (const std::string & name, int n, float first)
+  {
+    pcl::PointCloud<pcl::PointXYZ> cloud;
+    for (int i = 0; i < n; i++)
+    {
+      pcl::PointXYZ p;
+      p.x = first + i;
+      p.y = p.z = 0.f;
+      cloud.points.push_back (p);
+    }
+    cloud.width = n;
+    cloud.height = 1;
+    pcl::io::savePCDFileBinary ((dir_ / name).string (), cloud);
+  }
+
+  void
+  overwriteByte (std::streamoff offset, char value)
+  {
+    std::fstream f (file ().c_str (), std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp (offset);
+    f.write (&value, 1);
+  }
+};
+
+TEST_F(ModelDatabaseTest, convertsDirectory)
+{
+  ASSERT_TRUE (ModelDatabase::convert (dir_.string ()));
+  ModelDatabase db;
+  ASSERT_TRUE (db.load (file ()));
+  ASSERT_EQ (2u, db.size ());
+
+  const ModelDatabase::View * view = db.getView (0);
+  ASSERT_TRUE (view != 0);
+  EXPECT_TRUE (view->has_pose_);
+  EXPECT_TRUE (view->has_entropy_);
+  EXPECT_FALSE (view->has_centroid_);
+  EXPECT_EQ (2.f, view->pose_ (0, 1));
+  EXPECT_EQ (5.f, view->pose_ (1, 0));
+  EXPECT_EQ (0.25f, view->entropy_);
+
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  ASSERT_TRUE (db.getCloud (*view, "descriptor", cloud));
+  ASSERT_EQ (3u, cloud.points.size ());
+  EXPECT_EQ (9.f, cloud.points[2].x);
+  ASSERT_TRUE (db.getCloud (*view, "keypoint_indices", cloud));
+  EXPECT_EQ (1u, cloud.points.size ());
+
+  ASSERT_TRUE (db.getView (3) != 0);
+  EXPECT_FALSE (db.getView (3)->has_pose_);
+  EXPECT_FALSE (db.getCloud (*db.getView (3), "keypoint_indices", cloud));
+  EXPECT_TRUE (db.getView (5) == 0);
+}
+
+TEST_F(ModelDatabaseTest, saveLoadRoundTrip)
+{
+  ModelDatabase db;
+  for (int id = 0; id < 4; id++)
+  {
+    ModelDatabase::View & view = db.addView (3 * id);
+    view.has_pose_ = true;
+    view.pose_ = Eigen::Matrix4f::Random ();
+    view.has_entropy_ = (id % 2 == 0);
+    view.entropy_ = 0.1f * id;
+    view.has_centroid_ = true;
+    view.centroid_ = Eigen::Vector3f::Random ();
+
+    pcl::PointCloud<pcl::PointXYZ> cloud;
+    cloud.points.resize (10 + id);
+    for (size_t i = 0; i < cloud.points.size (); i++)
+      cloud.points[i].getVector3fMap () = Eigen::Vector3f::Random ();
+    cloud.width = cloud.points.size ();
+    cloud.height = 1;
+    db.setCloud (view, "view", cloud);
+  }
+
+  ASSERT_TRUE (db.save (file ()));
+  EXPECT_FALSE (boost::filesystem::exists (file () + ".tmp"));
+
+  ModelDatabase loaded;
+  ASSERT_TRUE (loaded.load (file ()));
+  ASSERT_EQ (db.size (), loaded.size ());
+  for (size_t i = 0; i < db.size (); i++)
+  {
+    const ModelDatabase::View & expected = db.getViewAt (i);
+    const ModelDatabase::View & view = loaded.getViewAt (i);
+    EXPECT_EQ (expected.id_, view.id_);
+    EXPECT_EQ (expected.has_pose_, view.has_pose_);
+    EXPECT_EQ (expected.pose_, view.pose_);
+    EXPECT_EQ (expected.has_entropy_, view.has_entropy_);
+    EXPECT_EQ (expected.entropy_, view.entropy_);
+    EXPECT_EQ (expected.has_centroid_, view.has_centroid_);
+    EXPECT_EQ (expected.centroid_, view.centroid_);
+    EXPECT_EQ (&view, loaded.getView (expected.id_));
+
+    pcl::PointCloud<pcl::PointXYZ> expected_cloud, cloud;
+    ASSERT_TRUE (db.getCloud (expected, "view", expected_cloud));
+    ASSERT_TRUE (loaded.getCloud (view, "view", cloud));
+    ASSERT_EQ (expected_cloud.points.size (), cloud.points.size ());
+    for (size_t k = 0; k < cloud.points.size (); k++)
+      EXPECT_EQ (expected_cloud.points[k].getVector3fMap (), cloud.points[k].getVector3fMap ());
+  }
+}
+
+TEST_F(ModelDatabaseTest, rejectsCorruptedFile)
+{
+  ASSERT_TRUE (ModelDatabase::convert (dir_.string ()));
+
+  // a byte of the payload, after the magic number, version, size and checksum
+  overwriteByte (40, 'Z');
+  ModelDatabase db;
+  EXPECT_FALSE (db.load (file ()));
+  EXPECT_TRUE (db.empty ());
+}
+
+TEST_F(ModelDatabaseTest, rejectsTruncatedFile)
+{
+  ASSERT_TRUE (ModelDatabase::convert (dir_.string ()));
+
+  boost::filesystem::resize_file (file (), boost::filesystem::file_size (file ()) - 3);
+  ModelDatabase db;
+  EXPECT_FALSE (db.load (file ()));
+  EXPECT_TRUE (db.empty ());
+}
+
+TEST_F(ModelDatabaseTest, rejectsOtherVersion)
+{
+  ASSERT_TRUE (ModelDatabase::convert (dir_.string ()));
+
+  // the version follows the 8 byte magic number
+  overwriteByte (8, static_cast<char> (ModelDatabase::VERSION + 1));
+  ModelDatabase db;
+  EXPECT_FALSE (db.load (file ()));
+  EXPECT_TRUE (db.empty ());
+}
+
+TEST_F(ModelDatabaseTest, rejectsMissingDirectory)
+{
+  EXPECT_FALSE (ModelDatabase::convert ((dir_ / "missing").string ()));
+  EXPECT_FALSE (boost::filesystem::exists (ModelDatabase::getFilename ((dir_ / "missing").string ())));
+
+  ModelDatabase db;
+  EXPECT_FALSE (db.load (ModelDatabase::getFilename ((dir_ / "missing").string ())));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
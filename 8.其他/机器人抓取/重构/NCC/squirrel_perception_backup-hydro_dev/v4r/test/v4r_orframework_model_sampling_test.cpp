@@ -0,0 +1,152 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/ORFramework/vtk_model_sampling.h"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <string.h>
+#include <limits>
+#include <vtkPoints.h>
+#include <pcl/point_types.h>
+
+using namespace faat_pcl::rec_3d_framework;
+
+class ModelSamplingTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    // 200x200 grid on the unit square with a bump in z, plus a degenerate triangle
+    int n = 200;
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New ();
+    for (int i = 0; i <= n; i++)
+    {
+      for (int j = 0; j <= n; j++)
+      {
+        double x = i / (double)n;
+        double y = j / (double)n;
+        points->InsertNextPoint (x, y, 0.1 * sin (6 * x) * cos (6 * y));
+      }
+    }
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New ();
+    for (int i = 0; i < n; i++)
+    {
+      for (int j = 0; j < n; j++)
+      {
+        vtkIdType a = i * (n + 1) + j;
+        vtkIdType b = a + n + 1;
+        vtkIdType t1[3] = { a, b, a + 1 };
+        vtkIdType t2[3] = { a + 1, b, b + 1 };
+        polys->InsertNextCell (3, t1);
+        polys->InsertNextCell (3, t2);
+      }
+    }
+    vtkIdType degenerate[3] = { 0, 0, 0 };
+    polys->InsertNextCell (3, degenerate);
+
+    mesh_ = vtkSmartPointer<vtkPolyData>::New ();
+    mesh_->SetPoints (points);
+    mesh_->SetPolys (polys);
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+  }
+
+  //memebers
+  vtkSmartPointer<vtkPolyData> mesh_;
+
+  bool
+  samePoints (const pcl::PointCloud<pcl::PointXYZ> & a, const pcl::PointCloud<pcl::PointXYZ> & b)
+  {
+    if (a.points.size () != b.points.size ())
+      return false;
+
+    for (size_t i = 0; i < a.points.size (); i++)
+    {
+      if ((a.points[i].x != b.points[i].x) || (a.points[i].y != b.points[i].y) || (a.points[i].z != b.points[i].z))
+        return false;
+    }
+    return true;
+  }
+};
+
+TEST_F(ModelSamplingTest, uniformSamplingIndependentOfThreads)
+{
+  pcl::PointCloud<pcl::PointXYZ> c1, c4, c7, other_seed;
+  uniform_sampling (mesh_, 100000, c1, 42, 1);
+  uniform_sampling (mesh_, 100000, c4, 42, 4);
+  uniform_sampling (mesh_, 100000, c7, 42, 7);
+  uniform_sampling (mesh_, 100000, other_seed, 43, 4);
+
+  ASSERT_EQ (100000u, c1.points.size ());
+  EXPECT_TRUE (samePoints (c1, c4));
+  EXPECT_TRUE (samePoints (c1, c7));
+  EXPECT_FALSE (samePoints (c1, other_seed));
+
+  // uniform on the square (the bump hardly changes the area distribution)
+  double mean_x = 0, mean_y = 0;
+  for (size_t i = 0; i < c1.points.size (); i++)
+  {
+    mean_x += c1.points[i].x;
+    mean_y += c1.points[i].y;
+  }
+  EXPECT_NEAR (0.5, mean_x / c1.points.size (), 0.01);
+  EXPECT_NEAR (0.5, mean_y / c1.points.size (), 0.01);
+}
+
+TEST_F(ModelSamplingTest, poissonDiskSamplingIndependentOfThreads)
+{
+  float radius = 0.02f;
+  pcl::PointCloud<pcl::PointXYZ> p1, p5;
+  poisson_disk_sampling (mesh_, radius, p1, 7, 10, 1);
+  poisson_disk_sampling (mesh_, radius, p5, 7, 10, 5);
+
+  ASSERT_GT (p1.points.size (), 0u);
+  EXPECT_TRUE (samePoints (p1, p5));
+
+  float min_dist_sqr = std::numeric_limits<float>::max ();
+  for (size_t i = 0; i < p1.points.size (); i++)
+  {
+    for (size_t j = i + 1; j < p1.points.size (); j++)
+    {
+      float dx = p1.points[i].x - p1.points[j].x;
+      float dy = p1.points[i].y - p1.points[j].y;
+      float dz = p1.points[i].z - p1.points[j].z;
+      min_dist_sqr = std::min (min_dist_sqr, dx * dx + dy * dy + dz * dz);
+    }
+  }
+  EXPECT_GE (sqrt (min_dist_sqr), radius * 0.9999f);
+}
+
+TEST_F(ModelSamplingTest, poissonDiskSamplingRejectsTinyRadius)
+{
+  // 10 * area / radius^2 does not fit into an int
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  poisson_disk_sampling (mesh_, 1e-5f, cloud, 7, 10, 1);
+  EXPECT_TRUE (cloud.points.empty ());
+  EXPECT_EQ (0u, cloud.width);
+}
+
+TEST_F(ModelSamplingTest, emptyMesh)
+{
+  vtkSmartPointer<vtkPolyData> empty = vtkSmartPointer<vtkPolyData>::New ();
+  empty->SetPoints (vtkSmartPointer<vtkPoints>::New ());
+  empty->SetPolys (vtkSmartPointer<vtkCellArray>::New ());
+
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  uniform_sampling (empty, 10, cloud, 1);
+  EXPECT_TRUE (cloud.points.empty ());
+  poisson_disk_sampling (empty, 0.01f, cloud, 1);
+  EXPECT_TRUE (cloud.points.empty ());
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
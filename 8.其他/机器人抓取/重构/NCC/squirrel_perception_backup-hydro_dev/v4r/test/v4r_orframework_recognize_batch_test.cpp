@@ -0,0 +1,350 @@
+// Bring in my package's API, which is what I'm testing
+#include "v4r/ORFramework/local_recognizer.h"
+#include "v4r/ORFramework/shot_local_estimator_omp.h"
+#include "v4r/ORRecognition/geometric_consistency.h"
+#include "v4r/ORRecognition/hypotheses_verification.h"
+// Bring in gtest
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <limits>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+typedef pcl::PointXYZ PointT;
+typedef pcl::Histogram<352> FeatureT;
+typedef faat_pcl::rec_3d_framework::Model<PointT> ModelT;
+typedef boost::shared_ptr<ModelT> ModelTPtr;
+typedef faat_pcl::rec_3d_framework::LocalRecognitionPipeline<flann::L1, PointT, FeatureT> PipelineT;
+typedef std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > TransformVector;
+
+// object made of three spheres of different size (not symmetric), in object coordinates
+static const float sphere_centers[3][3] = { {0.f, 0.f, 0.f}, {0.07f, 0.02f, 0.f}, {-0.02f, 0.06f, 0.03f} };
+static const float sphere_radii[3] = { 0.05f, 0.03f, 0.025f };
+
+// 640x480 depth image (525px focal length) of the object at object_to_camera, optionally in front of a table patch
+static void
+render (const Eigen::Matrix4f & object_to_camera, bool with_plane, pcl::PointCloud<PointT> & cloud, pcl::PointIndices & object_indices)
+{
+  const float f = 525.f;
+  const float cx = 319.5f;
+  const float cy = 239.5f;
+  const float plane_z = 0.9f;
+
+  Eigen::Vector3f centers[3];
+  for (int s = 0; s < 3; s++)
+    centers[s] = (object_to_camera * Eigen::Vector4f (sphere_centers[s][0], sphere_centers[s][1], sphere_centers[s][2], 1.f)).head<3> ();
+
+  cloud.width = 640;
+  cloud.height = 480;
+  cloud.is_dense = false;
+  cloud.points.resize (cloud.width * cloud.height);
+  object_indices.indices.clear ();
+
+  for (int v = 0; v < (int)cloud.height; v++)
+  {
+    for (int u = 0; u < (int)cloud.width; u++)
+    {
+      Eigen::Vector3f ray ((u - cx) / f, (v - cy) / f, 1.f);
+      float t = std::numeric_limits<float>::infinity ();
+      bool object = false;
+
+      for (int s = 0; s < 3; s++)
+      {
+        // |t*ray - c|^2 = r^2
+        float a = ray.dot (ray);
+        float b = -2.f * ray.dot (centers[s]);
+        float c = centers[s].dot (centers[s]) - sphere_radii[s] * sphere_radii[s];
+        float disc = b * b - 4.f * a * c;
+        if (disc < 0.f)
+          continue;
+        float ts = (-b - sqrt (disc)) / (2.f * a);
+        if ((ts > 0.f) && (ts < t))
+        {
+          t = ts;
+          object = true;
+        }
+      }
+
+      if (with_plane && (plane_z < t) && (fabs (ray[0] * plane_z) < 0.2f) && (fabs (ray[1] * plane_z) < 0.15f))
+      {
+        t = plane_z;
+        object = false;
+      }
+
+      PointT & p = cloud.at (u, v);
+      if (!pcl_isfinite (t))
+      {
+        p.x = p.y = p.z = std::numeric_limits<float>::quiet_NaN ();
+        continue;
+      }
+
+      p.getVector3fMap () = ray * t;
+      if (object)
+        object_indices.indices.push_back (v * cloud.width + u);
+    }
+  }
+}
+
+static Eigen::Matrix4f
+objectToCamera (float angle_y, float angle_x, const Eigen::Vector3f & translation)
+{
+  Eigen::Matrix4f m = Eigen::Matrix4f::Identity ();
+  m.topLeftCorner<3, 3> () = (Eigen::AngleAxisf (angle_x, Eigen::Vector3f::UnitX ()) * Eigen::AngleAxisf (angle_y, Eigen::Vector3f::UnitY ())).toRotationMatrix ();
+  m.block<3, 1> (0, 3) = translation;
+  return m;
+}
+
+/**
+ * \brief Keeps the views of the object in memory, the poses go from model to view
+ */
+class SyntheticSource : public faat_pcl::rec_3d_framework::Source<PointT>
+{
+public:
+  void
+  generate (std::string & training_dir)
+  {
+    createTrainingDir (training_dir);
+
+    ModelTPtr model (new ModelT ());
+    model->class_ = "synthetic";
+    model->id_ = "spheres";
+    model->views_.reset (new std::vector<pcl::PointCloud<PointT>::Ptr>);
+    model->indices_.reset (new std::vector<pcl::PointIndices>);
+    model->poses_.reset (new TransformVector);
+    model->self_occlusions_.reset (new std::vector<float>);
+    model->assembled_.reset (new pcl::PointCloud<PointT>);
+
+    for (int i = 0; i < 8; i++)
+    {
+      Eigen::Matrix4f pose = objectToCamera (i * M_PI / 4., 0.f, Eigen::Vector3f (0.f, 0.f, 0.6f));
+      pcl::PointCloud<PointT>::Ptr view (new pcl::PointCloud<PointT>);
+      pcl::PointIndices indices;
+      render (pose, false, *view, indices);
+
+      //the assembled model collects all views in object coordinates
+      Eigen::Matrix4f inv_pose = pose.inverse ();
+      for (size_t k = 0; k < indices.indices.size (); k++)
+      {
+        PointT p;
+        p.getVector4fMap () = inv_pose * view->points[indices.indices[k]].getVector4fMap ();
+        model->assembled_->points.push_back (p);
+      }
+
+      model->views_->push_back (view);
+      model->indices_->push_back (indices);
+      model->poses_->push_back (pose);
+    }
+    model->assembled_->width = model->assembled_->points.size ();
+    model->assembled_->height = 1;
+
+    createClassAndModelDirectories (training_dir, model->class_, model->id_);
+    models_.reset (new std::vector<ModelTPtr>);
+    models_->push_back (model);
+  }
+};
+
+/**
+ * \brief Accepts the hypotheses with enough visible points, deterministic replacement for the GO verification
+ */
+class VisiblePointsVerification : public faat_pcl::HypothesisVerification<PointT, PointT>
+{
+public:
+  void
+  verify ()
+  {
+    mask_.resize (visible_models_.size ());
+    for (size_t i = 0; i < visible_models_.size (); i++)
+      mask_[i] = (visible_models_[i]->points.size () >= 100);
+  }
+};
+
+static boost::shared_ptr<faat_pcl::rec_3d_framework::LocalEstimator<PointT, FeatureT> >
+createEstimator ()
+{
+  boost::shared_ptr<faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointT, pcl::Normal> > normal_estimator;
+  normal_estimator.reset (new faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointT, pcl::Normal>);
+  normal_estimator->setCMR (false);
+  normal_estimator->setDoVoxelGrid (true);
+  normal_estimator->setRemoveOutliers (false);
+  normal_estimator->setValuesForCMRFalse (0.003f, 0.02f);
+
+  boost::shared_ptr<faat_pcl::rec_3d_framework::UniformSamplingExtractor<PointT> > uniform_keypoint_extractor;
+  uniform_keypoint_extractor.reset (new faat_pcl::rec_3d_framework::UniformSamplingExtractor<PointT>);
+  uniform_keypoint_extractor->setSamplingDensity (0.01f);
+  uniform_keypoint_extractor->setFilterPlanar (false);
+
+  boost::shared_ptr<faat_pcl::rec_3d_framework::KeypointExtractor<PointT> > keypoint_extractor;
+  keypoint_extractor = boost::static_pointer_cast<faat_pcl::rec_3d_framework::KeypointExtractor<PointT> > (uniform_keypoint_extractor);
+
+  boost::shared_ptr<faat_pcl::rec_3d_framework::SHOTLocalEstimationOMP<PointT, FeatureT> > estimator;
+  estimator.reset (new faat_pcl::rec_3d_framework::SHOTLocalEstimationOMP<PointT, FeatureT>);
+  estimator->setNormalEstimator (normal_estimator);
+  estimator->addKeypointExtractor (keypoint_extractor);
+  estimator->setSupportRadius (0.04f);
+
+  return boost::static_pointer_cast<faat_pcl::rec_3d_framework::LocalEstimator<PointT, FeatureT> > (estimator);
+}
+
+static boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointT, PointT> >
+createCG ()
+{
+  boost::shared_ptr<faat_pcl::GeometricConsistencyGrouping<PointT, PointT> > gcg_alg (new faat_pcl::GeometricConsistencyGrouping<PointT, PointT>);
+  gcg_alg->setGCThreshold (5);
+  gcg_alg->setGCSize (0.01);
+  return boost::static_pointer_cast<faat_pcl::CorrespondenceGrouping<PointT, PointT> > (gcg_alg);
+}
+
+static boost::shared_ptr<faat_pcl::HypothesisVerification<PointT, PointT> >
+createHV ()
+{
+  return boost::shared_ptr<faat_pcl::HypothesisVerification<PointT, PointT> > (new VisiblePointsVerification);
+}
+
+class RecognizeBatchTest : public testing::Test
+{
+
+protected:
+  // Remember that SetUp() is run immediately before a test starts.
+  virtual void SetUp()
+  {
+    dir_ = boost::filesystem::temp_directory_path () / boost::filesystem::unique_path ("v4r_recognize_batch_%%%%-%%%%-%%%%");
+    boost::filesystem::create_directories (dir_);
+    training_dir_ = (dir_ / "training").string ();
+
+    source_.reset (new SyntheticSource);
+    source_->generate (training_dir_);
+
+    // the object in between the trained views, at different places on the table, the last one as in view 1
+    float angles_y[4] = { 0.3f, 1.2f, 2.7f, static_cast<float> (M_PI / 4.) };
+    float angles_x[4] = { 0.1f, -0.15f, 0.f, 0.f };
+    Eigen::Vector3f translations[4] = { Eigen::Vector3f (-0.05f, 0.f, 0.7f), Eigen::Vector3f (0.06f, 0.03f, 0.75f),
+                                        Eigen::Vector3f (0.f, -0.04f, 0.65f), Eigen::Vector3f (0.f, 0.f, 0.7f) };
+    for (int i = 0; i < 4; i++)
+    {
+      pcl::PointCloud<PointT>::Ptr scene (new pcl::PointCloud<PointT>);
+      pcl::PointIndices indices;
+      render (objectToCamera (angles_y[i], angles_x[i], translations[i]), true, *scene, indices);
+      scenes_.push_back (scene);
+    }
+  }
+
+  // TearDown() is invoked immediately after a test finishes.
+  virtual void TearDown()
+  {
+    boost::filesystem::remove_all (dir_);
+  }
+
+  //memebers
+  boost::filesystem::path dir_;
+  std::string training_dir_;
+  boost::shared_ptr<faat_pcl::rec_3d_framework::Source<PointT> > source_;
+  std::vector<pcl::PointCloud<PointT>::Ptr> scenes_;
+
+  boost::shared_ptr<PipelineT>
+  createPipeline (bool factories)
+  {
+    boost::shared_ptr<PipelineT> rec (new PipelineT ((dir_ / "index_flann.txt").string (), (dir_ / "index_codebook.txt").string ()));
+
+    std::string descr_name = "shot";
+    boost::shared_ptr<faat_pcl::rec_3d_framework::LocalEstimator<PointT, FeatureT> > estimator = createEstimator ();
+    boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointT, PointT> > cg_alg = createCG ();
+
+    rec->setDataSource (source_);
+    rec->setTrainingDir (training_dir_);
+    rec->setDescriptorName (descr_name);
+    rec->setFeatureEstimator (estimator);
+    rec->setCGAlgorithm (cg_alg);
+    rec->setHVAlgorithm (createHV ());
+    //the ICP of the pipeline uses a RANSAC rejector, the results would not be comparable
+    rec->setICPIterations (0);
+    rec->setKnn (1);
+    rec->setUseCache (true);
+
+    if (factories)
+    {
+      rec->setFeatureEstimatorFactory (boost::bind (&createEstimator));
+      rec->setCGAlgorithmFactory (boost::bind (&createCG));
+      rec->setHVAlgorithmFactory (boost::bind (&createHV));
+      rec->setMaxRecognitionThreads (4);
+    }
+
+    rec->initialize (false);
+    return rec;
+  }
+
+  void
+  compareHypotheses (const std::vector<ModelTPtr> & expected_models, const TransformVector & expected_transforms,
+                     const std::vector<ModelTPtr> & models, const TransformVector & transforms, const std::string & what)
+  {
+    ASSERT_EQ (expected_models.size (), models.size ()) << what;
+    ASSERT_EQ (expected_transforms.size (), transforms.size ()) << what;
+    for (size_t h = 0; h < models.size (); h++)
+    {
+      EXPECT_EQ (expected_models[h]->id_, models[h]->id_) << what << " hypothesis " << h;
+      for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+          EXPECT_NEAR (expected_transforms[h] (r, c), transforms[h] (r, c), 1e-5) << what << " hypothesis " << h;
+    }
+  }
+
+  // recognize() scene by scene with one pipeline, recognizeBatch() with another one, which has no state of the single scenes.
+  // The second pipeline loads the FLANN index saved by the first, both search the same trees.
+  void
+  run (bool factories)
+  {
+    boost::shared_ptr<PipelineT> single = createPipeline (false);
+    std::vector<boost::shared_ptr<std::vector<ModelTPtr> > > expected_models;
+    std::vector<boost::shared_ptr<TransformVector> > expected_transforms;
+    size_t nr_hypotheses = 0;
+    for (size_t i = 0; i < scenes_.size (); i++)
+    {
+      single->setInputCloud (scenes_[i]);
+      single->recognize ();
+      expected_models.push_back (single->getModels ());
+      expected_transforms.push_back (single->getTransforms ());
+      nr_hypotheses += single->getModels ()->size ();
+    }
+
+    //the object is placed as in a trained view in the last scene
+    ASSERT_TRUE (single->getModelsBeforeHV () != 0);
+    ASSERT_GT (single->getModelsBeforeHV ()->size (), 0u);
+    ASSERT_GT (nr_hypotheses, 0u);
+
+    boost::shared_ptr<PipelineT> batch = createPipeline (factories);
+    std::vector<boost::shared_ptr<std::vector<ModelTPtr> > > models;
+    std::vector<boost::shared_ptr<TransformVector> > transforms;
+    batch->recognizeBatch (scenes_, models, transforms);
+
+    ASSERT_EQ (scenes_.size (), models.size ());
+    ASSERT_EQ (scenes_.size (), transforms.size ());
+    for (size_t i = 0; i < scenes_.size (); i++)
+    {
+      std::stringstream what;
+      what << "scene " << i;
+      compareHypotheses (*expected_models[i], *expected_transforms[i], *models[i], *transforms[i], what.str ());
+    }
+
+    compareHypotheses (*single->getModels (), *single->getTransforms (), *batch->getModels (), *batch->getTransforms (), "getModels()");
+    ASSERT_TRUE (batch->getModelsBeforeHV () != 0);
+    ASSERT_TRUE (batch->getTransformsBeforeHV () != 0);
+    compareHypotheses (*single->getModelsBeforeHV (), *single->getTransformsBeforeHV (), *batch->getModelsBeforeHV (),
+                       *batch->getTransformsBeforeHV (), "getModelsBeforeHV()");
+  }
+};
+
+TEST_F(RecognizeBatchTest, batchMatchesRecognize)
+{
+  run (false);
+}
+
+TEST_F(RecognizeBatchTest, parallelBatchMatchesRecognize)
+{
+  run (true);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
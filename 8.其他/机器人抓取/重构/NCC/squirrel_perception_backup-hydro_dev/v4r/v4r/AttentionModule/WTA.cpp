@@ -26,6 +26,9 @@
  */
 
 #include "WTA.hpp"
+#include <queue>
+#include <climits>
+#include <cfloat>
 
 namespace AttentionModule
 {
@@ -60,6 +63,7 @@ void defaultParams(Params& params)
   params.mapLevel = 5;//
   params.useCentering = false;
   params.useMorphologyOpenning = false;
+  params.useEventDrivenWTA = false;
 }
 
 void initializeWTA(WTA& wta, const cv::Mat& salmap, Params& salParams)
@@ -487,32 +491,453 @@ void applyIOR(WTA& wta, cv::Point& winner, Params& params)
   diskIOR(wta,winner,params);
 }
 
+// amplitudes and widths of the difference of gaussians used as inhibition of return
+static void diskIORShape(float V, Params& params, float& pampl, float& mampl, float& psdev, float& msdev)
+{
+  pampl = 0.1 * V;
+  mampl = 0.0001 * pampl;
+
+  // foaSize is interpreted as radius here, not as diameter
+  psdev = 0.3 * params.foaSize / (pow(2.0,params.mapLevel));
+
+  msdev = 4.0 * psdev;
+}
+
+static inline float diskIORValue(int i, int j, int x, int y, float pampl, float mampl, float psdev, float msdev)
+{
+  float d = (i-y)*(i-y) + (j-x)*(j-x);
+  float g = pampl * exp(-0.5 * d / (psdev*psdev)) - mampl * exp(-0.5 * d / (msdev*msdev));
+  return(g);
+}
+
 void diskIOR(WTA& wta, cv::Point& winner, Params& params)
 {
   int x = winner.x;
   int y = winner.y;
-  float pampl = 0.1 * wta.sm.V.at<float>(y,x);
-  float mampl = 0.0001 * pampl;
-
-  // foaSize is interpreted as radius here, not as diameter
-  float psdev = 0.3 * params.foaSize / (pow(2.0,params.mapLevel));
+  float pampl, mampl, psdev, msdev;
+  diskIORShape(wta.sm.V.at<float>(y,x),params,pampl,mampl,psdev,msdev);
 
-  float msdev = 4.0 * psdev;
-  float d;
-  //cv::Mat g = cv::Mat_<float>::zeros(wta.sm.V.rows,wta.sm.V.cols);
-  float g;
   for(int i = 0; i < wta.sm.Ginh.rows; ++i)
   {
     for(int j = 0; j < wta.sm.Ginh.cols; ++j)
     {
-      d = (i-y)*(i-y) + (j-x)*(j-x);
-      //g.at<float>(i,j) = pampl * exp(-0.5 * d / (psdev*psdev)) - mampl * exp(-0.5 * d / (msdev*msdev));
-      g = pampl * exp(-0.5 * d / (psdev*psdev)) - mampl * exp(-0.5 * d / (msdev*msdev));
-      wta.sm.Ginh.at<float>(i,j) = wta.sm.Ginh.at<float>(i,j) + g;
+      wta.sm.Ginh.at<float>(i,j) = wta.sm.Ginh.at<float>(i,j) + diskIORValue(i,j,x,y,pampl,mampl,psdev,msdev);
+    }
+  }
+}
+
+// integrates the inhibitory interneuron like evolveWTA, given that the winner (if any) has already set Gexc
+static void evolveInhibition(const WTA& wta, WTAInhibitionState& state)
+{
+  const LIF& inhib = wta.inhib;
+  float time = state.time + wta.exc.timeStep;
+  float dt = time - state.time;
+  float ginh = state.Ginh;
+
+  state.V = state.V + dt/inhib.C * (inhib.I.at<float>(0,0) - inhib.Gleak*(state.V - inhib.Eleak) -
+                                    state.Gexc*(state.V - inhib.Eexc) -
+                                    ginh*(state.V - inhib.Einh));
+  if(state.V < inhib.Einh)
+  {
+    state.V = inhib.Einh;
+  }
+  state.Ginh = state.Ginh * inhib.GinhDecay;
+
+  // evolveWTA erases the inhibition of the excitatory neurons after every step
+  state.excGinh = 0;
+  if((state.V > inhib.Vthresh) && (inhib.DoesFire))
+  {
+    state.V = 0;
+    // trigger global inhibition
+    state.excGinh = 0.01;
+    // no need to be excited anymore
+    state.Gexc = 0;
+  }
+
+  state.time = time;
+}
+
+// appends the next step, assuming that no neuron fires after the last winner
+static void extendWTAEvents(WTAEvents& events, const WTA& wta)
+{
+  float time = events.extended.time + wta.exc.timeStep;
+  events.dt.push_back(time - events.extended.time);
+  events.excGinh.push_back(events.extended.excGinh);
+  evolveInhibition(wta,events.extended);
+}
+
+// integrates neuron k up to step last (inclusive), stops at the first spike in a step >= from
+static bool integrateWTANeuron(WTAEvents& events, const WTA& wta, int k, WTANeuronState& neuron, int last, int from, int& spikeStep)
+{
+  const LIF& sm = wta.sm;
+  const LIF& exc = wta.exc;
+  float I = events.Ism[k];
+
+  for(int step = neuron.step; step <= last; ++step)
+  {
+    if(step >= (int)events.dt.size())
+      extendWTAEvents(events,wta);
+
+    // inhibition of return triggered by winners before this step
+    while((neuron.event < (int)events.iorStep.size()) && (events.iorStep[neuron.event] < step))
+    {
+      neuron.Ginh = neuron.Ginh + events.iorGinh[neuron.event][k];
+      neuron.event++;
+    }
+
+    float dt = events.dt[step];
+
+    // saliency map neuron
+    float ginh = neuron.Ginh;
+    neuron.Vsm = neuron.Vsm + dt/sm.C * (I - sm.Gleak*(neuron.Vsm - sm.Eleak) -
+                                         sm.Gexc*(neuron.Vsm - sm.Eexc) -
+                                         ginh*(neuron.Vsm - sm.Einh));
+    if(neuron.Vsm < sm.Einh)
+    {
+      neuron.Vsm = sm.Einh;
+    }
+    neuron.Ginh = neuron.Ginh * sm.GinhDecay;
+    if((neuron.Vsm > sm.Vthresh) && (sm.DoesFire))
+    {
+      neuron.Vsm = 0;
+    }
+
+    // excitatory neuron, driven by the saliency map neuron
+    float Iexc = neuron.Vsm * exc.Ginput;
+    ginh = events.excGinh[step];
+    neuron.Vexc = neuron.Vexc + dt/exc.C * (Iexc - exc.Gleak*(neuron.Vexc - exc.Eleak) -
+                                            exc.Gexc*(neuron.Vexc - exc.Eexc) -
+                                            ginh*(neuron.Vexc - exc.Einh));
+    if(neuron.Vexc < exc.Einh)
+    {
+      neuron.Vexc = exc.Einh;
+    }
+    if((neuron.Vexc > exc.Vthresh) && (exc.DoesFire))
+    {
+      neuron.Vexc = 0;
+      if(step >= from)
+      {
+        neuron.step = step + 1;
+        spikeStep = step;
+        return(true);
+      }
+    }
+  }
+
+  neuron.step = last + 1;
+  return(false);
+}
+
+// U(x) = A + B*r^x + C*q^x
+static inline double spikeBoundPotential(double x, double A, double B, double C, double r, double q)
+{
+  return(A + B*std::pow(r,x) + C*std::pow(q,x));
+}
+
+/*
+ * Lower bound of the step in which neuron k fires next, for time steps in [dtMin,dtMax].
+ *
+ * With the parameters of initializeWTA one step of integrateWTANeuron is
+ *   Vsm'  = Vsm + dt/Csm*(I - (Gleak_sm + Ginh)*Vsm),                          clamped to Vsm' >= 0
+ *   Vexc' = Vexc + dt/Cexc*(Ginput*Vsm' - Gleak_exc*Vexc - Gglob*(Vexc - Einh)), clamped to Vexc' >= Einh
+ * Why the bound holds:
+ * - Ginh only decays (GinhDecay <= 1) or grows by the pending inhibition of return increments, so it never
+ *   drops below Gmin = min(0,Ginh) + the negative parts of the increments. With leak = Gleak_sm + Gmin and
+ *   a = dt/Csm*leak, Vsm' <= (1-a)*Vsm + a*Sinf, Sinf = I/leak. For Vsm <= Sinf and q = 1 - dtMax/Csm*leak >= 0
+ *   this gives Vsm <= S(n) = Sinf + (Vsm - Sinf)*q^n, otherwise Vsm stays below max(Vsm,Sinf,dtMax/Csm*I).
+ * - The global inhibition Gglob >= 0 only lowers Vexc (Vexc >= Einh), so Vexc <= U(n) with
+ *   U(n+1) = r*U(n) + b*S(n+1) + eps, r = 1 - dtMin/Cexc*Gleak_exc, b = dtMax/Cexc*Ginput and eps covering
+ *   the slower decay of negative potentials. U is a sum of two exponentials (closed form below).
+ * - The float arithmetic rounds every operation by at most u = FLT_EPSILON/2. One step of the saliency map
+ *   neuron errs by at most u*Vsm' + 6*u*dt/Csm*(I + (Gleak_sm + |Ginh|)*Vsm), which moves the fixed point
+ *   Sinf by at most that error over dtMin/Csm*leak. One step of the excitatory neuron errs by at most
+ *   2*u*max(Vthresh,-Einh) + 6*u*dt/Cexc*(Ginput*Vsm + Gleak_exc*max(Vthresh,-Einh)) as long as it does
+ *   not fire (the rounding of the Gglob term only keeps it negative), this is added to eps. The decays and
+ *   additions of Ginh scale every contribution by at most (1+u) each.
+ * - U(n) <= Vthresh for all n <= crossing, so the neuron cannot fire before step + floor(crossing). One step
+ *   is subtracted for the double precision evaluation of the closed form.
+ * Bounds that cannot be established (other parameters, no leak left) return the current step, i.e. the
+ * neuron is simply integrated.
+ */
+static int spikeLowerBound(const WTAEvents& events, const WTA& wta, int k, double dtMin, double dtMax)
+{
+  const LIF& sm = wta.sm;
+  const LIF& exc = wta.exc;
+  const WTANeuronState& neuron = events.neurons[k];
+
+  // the bound relies on the parameters set by initializeWTA
+  if((sm.Eleak != 0) || (sm.Einh != 0) || (sm.Gexc != 0) || (sm.DoesFire) || (sm.GinhDecay < 0) || (sm.GinhDecay > 1) ||
+     (exc.Eleak != 0) || (exc.Gexc != 0) || (exc.Einh > 0) || (dtMin <= 0))
+    return(neuron.step);
+
+  // unit roundoff of the float integration
+  const double u = FLT_EPSILON / 2;
+
+  double Gmin = std::min(0.0,(double)neuron.Ginh);
+  double Gabs = std::fabs((double)neuron.Ginh);
+  for(size_t e = neuron.event; e < events.iorGinh.size(); ++e)
+  {
+    Gmin += std::min(0.0f,events.iorGinh[e][k]);
+    Gabs += std::fabs(events.iorGinh[e][k]);
+  }
+  double roundG = 1 + 2*u*(events.iorGinh.size() - neuron.event + 2);
+  Gmin *= roundG;
+  Gabs *= roundG;
+
+  double leak = sm.Gleak + Gmin;
+  if(leak <= 0)
+    return(neuron.step);
+
+  // saliency map neuron
+  double I = std::max(0.0,(double)events.Ism[k]);
+  double V0 = std::max(0.0,(double)neuron.Vsm);
+  double h = dtMax/sm.C;
+  double aMin = dtMin/sm.C*leak;
+  double g = u*(1 + 6*h*(sm.Gleak + Gabs));
+  if((g >= aMin) || (g >= 1))
+    return(neuron.step);
+  double Sinf = (I/leak + 6*u*h*I/aMin) / (1 - g/aMin);
+  double q = 1.0 - h*leak;
+  double D = 0;
+  if((V0 <= Sinf) && (q >= 0))
+    D = V0 - Sinf;
+  else
+    Sinf = std::max(std::max(V0,Sinf),h*I*(1 + 6*u)/(1 - g));
+
+  // excitatory neuron
+  double rMin = 1.0 - dtMax/exc.C*exc.Gleak;
+  double r = 1.0 - dtMin/exc.C*exc.Gleak;
+  double b = dtMax/exc.C*exc.Ginput;
+  double thresh = exc.Vthresh;
+  if((rMin <= 0) || (r >= 1) || (thresh <= 0))
+    return(neuron.step);
+  double M = std::max(thresh,-(double)exc.Einh);
+  double eps = -exc.Einh * (r - rMin) + 2*u*M + 6*u*dtMax/exc.C*(exc.Ginput*Sinf + exc.Gleak*M);
+  if(std::fabs(q - r) < 1e-9)
+    D = 0;
+
+  double U0 = std::max((double)neuron.Vexc,(double)exc.Einh);
+  double A = (b*Sinf + eps) / (1 - r);
+  double C = (D != 0 ? b*D*q/(q - r) : 0);
+  double B = U0 - A - C;
+
+  // U has at most one extremum
+  std::vector<double> borders;
+  borders.push_back(0);
+  if((B != 0) && (C != 0))
+  {
+    double ratio = -(C*std::log(q)) / (B*std::log(r));
+    if(ratio > 0)
+    {
+      double xc = std::log(ratio) / std::log(r/q);
+      if(xc > 0)
+        borders.push_back(xc);
+    }
+  }
+
+  double crossing = -1;
+  for(unsigned int s = 0; (s < borders.size()) && (crossing < 0); ++s)
+  {
+    double lo = borders[s];
+    if(spikeBoundPotential(lo,A,B,C,r,q) > thresh)
+    {
+      crossing = lo;
+      break;
+    }
+
+    double hi;
+    if(s + 1 < borders.size())
+    {
+      hi = borders[s+1];
+      if(spikeBoundPotential(hi,A,B,C,r,q) <= thresh)
+        continue;
+    }
+    else
+    {
+      // U tends to A
+      if(A <= thresh)
+        break;
+      hi = lo + 1;
+      while(spikeBoundPotential(hi,A,B,C,r,q) <= thresh)
+      {
+        hi = lo + 2*(hi - lo);
+        if(hi > (double)(INT_MAX/2))
+          return(INT_MAX);
+      }
+    }
+
+    // increasing between lo and hi
+    for(int it = 0; (it < 60) && (hi - lo > 0.5); ++it)
+    {
+      double mid = 0.5*(lo + hi);
+      if(spikeBoundPotential(mid,A,B,C,r,q) > thresh)
+        hi = mid;
+      else
+        lo = mid;
     }
+    crossing = lo;
   }
 
-  //wta.sm.Ginh = wta.sm.Ginh + g;
+  if(crossing < 0)
+    return(INT_MAX);
+
+  // the n-th integrated step is step + n - 1
+  double steps = std::floor(crossing) - 1;
+  if(steps <= 0)
+    return(neuron.step);
+  if(steps >= (double)(INT_MAX/2))
+    return(INT_MAX);
+  return(neuron.step + (int)steps);
+}
+
+void initializeWTAEvents(WTAEvents& events, const WTA& wta)
+{
+  int rows = wta.sm.V.rows;
+  int cols = wta.sm.V.cols;
+
+  events.neurons.resize(rows*cols);
+  events.Ism.resize(rows*cols);
+  for(int i = 0; i < rows; ++i)
+  {
+    for(int j = 0; j < cols; ++j)
+    {
+      WTANeuronState& neuron = events.neurons[i*cols+j];
+      neuron.step = 0;
+      neuron.event = 0;
+      neuron.Vsm = wta.sm.V.at<float>(i,j);
+      neuron.Ginh = wta.sm.Ginh.at<float>(i,j);
+      neuron.Vexc = wta.exc.V.at<float>(i,j);
+      events.Ism[i*cols+j] = wta.sm.I.at<float>(i,j);
+    }
+  }
+
+  events.dt.clear();
+  events.excGinh.clear();
+  events.iorStep.clear();
+  events.iorGinh.clear();
+
+  events.committedSteps = 0;
+  events.committed.time = wta.exc.time;
+  events.committed.V = wta.inhib.V.at<float>(0,0);
+  events.committed.Gexc = wta.inhib.Gexc;
+  events.committed.Ginh = wta.inhib.Ginh.at<float>(0,0);
+  events.committed.excGinh = wta.exc.Ginh.at<float>(0,0);
+  events.extended = events.committed;
+}
+
+/*
+ * Finds the next winner as the repeated calls of evolveWTA would and applies the inhibition of return.
+ * Ties within a step are resolved in the same (column major) order as evolveWTA. Returns false if no
+ * neuron fires within WTA_EVENTS_MAX_STEPS steps.
+ * The heap of spike bounds is rebuilt on every call: the inhibition of return of the previous winner
+ * changes the inhibition of its neighbourhood (the difference of gaussians reaches the whole map), so the
+ * bounds of those neurons are recomputed from the pending increments instead of being kept.
+ */
+bool evolveWTAEvents(WTAEvents& events, const WTA& wta, cv::Point& winner, Params& params)
+{
+  const int WTA_EVENTS_MAX_STEPS = 1000000;
+
+  int rows = wta.sm.V.rows;
+  int cols = wta.sm.V.cols;
+  int first = events.committedSteps;
+  int last = first + WTA_EVENTS_MAX_STEPS;
+
+  winner.x = -1;
+  winner.y = -1;
+
+  // float time steps deviate from timeStep by at most half an ulp of the time, the bounds hold until tCap
+  double tNow = events.committed.time;
+  double tCap = std::max(1.0,2.0*tNow);
+  double dtErr = ldexp(tCap,-22);
+  double dtMin = wta.exc.timeStep - dtErr;
+  double dtMax = wta.exc.timeStep + dtErr;
+  int capStep = first + (int)std::floor((tCap - tNow) / dtMax);
+
+  // earliest possible spike first, column major index as in evolveWTA
+  typedef std::pair<int,int> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > candidates;
+  for(int i = 0; i < rows; ++i)
+  {
+    for(int j = 0; j < cols; ++j)
+    {
+      int bound = std::min(spikeLowerBound(events,wta,i*cols+j,dtMin,dtMax),capStep);
+      if(bound <= last)
+        candidates.push(Candidate(bound,j*rows+i));
+    }
+  }
+
+  int best = last + 1;
+  int bestIdx = -1;
+  std::vector<int> visited;
+  std::vector<WTANeuronState> visitedStates;
+  while((!candidates.empty()) && (candidates.top().first <= best))
+  {
+    int idx = candidates.top().second;
+    candidates.pop();
+
+    int k = (idx % rows) * cols + idx / rows;
+    WTANeuronState neuron = events.neurons[k];
+    int spikeStep;
+    if(integrateWTANeuron(events,wta,k,neuron,std::min(best,last),first,spikeStep))
+    {
+      if((spikeStep < best) || ((spikeStep == best) && (idx < bestIdx)))
+      {
+        best = spikeStep;
+        bestIdx = idx;
+      }
+    }
+    visited.push_back(k);
+    visitedStates.push_back(neuron);
+  }
+
+  if(bestIdx < 0)
+    return(false);
+
+  // keep the visited neurons integrated up to the winner step
+  for(unsigned int v = 0; v < visited.size(); ++v)
+  {
+    if(visitedStates[v].step == best + 1)
+    {
+      events.neurons[visited[v]] = visitedStates[v];
+    }
+    else
+    {
+      int spikeStep;
+      integrateWTANeuron(events,wta,visited[v],events.neurons[visited[v]],best,best,spikeStep);
+    }
+  }
+
+  // the inhibitory interneuron gets excited in the winner step
+  for(int step = first; step <= best; ++step)
+  {
+    if(step == best)
+      events.committed.Gexc = wta.inhib.Gleak * 10;
+    evolveInhibition(wta,events.committed);
+  }
+  events.committedSteps = best + 1;
+  events.extended = events.committed;
+  events.dt.resize(best + 1);
+  events.excGinh.resize(best + 1);
+
+  winner.x = bestIdx / rows;
+  winner.y = bestIdx % rows;
+
+  // trigger inhibition of return
+  float pampl, mampl, psdev, msdev;
+  diskIORShape(events.neurons[winner.y*cols+winner.x].Vsm,params,pampl,mampl,psdev,msdev);
+
+  events.iorStep.push_back(best);
+  events.iorGinh.push_back(std::vector<float>(rows*cols));
+  std::vector<float>& g = events.iorGinh.back();
+  for(int i = 0; i < rows; ++i)
+  {
+    for(int j = 0; j < cols; ++j)
+    {
+      g[i*cols+j] = diskIORValue(i,j,winner.x,winner.y,pampl,mampl,psdev,msdev);
+    }
+  }
+
+  return(true);
 }
 
 /*void shapeIOR(WTA& wta, cv::Point& winner, Params& params, cv::Mat& binaryMap, cv::Mat& binMap)
@@ -735,6 +1160,12 @@ int CalculateWTA(cv::Mat& img, cv::Mat& _salmap, std::vector<cv::Point>& attente
   WTA wta;
   initializeWTA(wta,salmap,params);
 
+  WTAEvents events;
+  if(params.useEventDrivenWTA)
+  {
+    initializeWTAEvents(events,wta);
+  }
+
   cv::Point lastWinner;
   lastWinner.x = -1;
   lastWinner.y = -1;
@@ -748,16 +1179,25 @@ int CalculateWTA(cv::Mat& img, cv::Mat& _salmap, std::vector<cv::Point>& attente
   {
     cv::Point winner(-1,-1);
 
-    int cur_time = 0;
-    while (winner.x == -1)
+    if(params.useEventDrivenWTA)
     {
-      cur_time += 1;
-      evolveWTA(wta,winner);
-      //if(cur_time > 2500)
-	//return(0);
+      // inhibition of return is applied by evolveWTAEvents
+      if(!evolveWTAEvents(events,wta,winner,params))
+        break;
+    }
+    else
+    {
+      int cur_time = 0;
+      while (winner.x == -1)
+      {
+        cur_time += 1;
+        evolveWTA(wta,winner);
+        //if(cur_time > 2500)
+	  //return(0);
+      }
+      // trigger inhibition of return
+      applyIOR(wta,winner,params);
     }
-    // trigger inhibition of return
-    applyIOR(wta,winner,params);
 
     // convert the winner's location to image coordinates
     winnerToImgCoords(win2,winner,params,img,_salmap);
@@ -69,6 +69,45 @@ struct Params
   int   mapLevel;
   bool  useCentering;
   bool  useMorphologyOpenning;
+  bool  useEventDrivenWTA;
+};
+
+// state of the inhibitory interneuron and of the global inhibition of the excitatory neurons
+struct WTAInhibitionState {
+  float time;    // time after the last integrated step (in sec).
+  float V;       // potential of the inhibitory interneuron (in V).
+  float Gexc;    // excitatory conductivity of the inhibitory interneuron (in S).
+  float Ginh;    // inhibitory conductivity of the inhibitory interneuron (in S).
+  float excGinh; // inhibitory conductivity of the excitatory neurons in the next step (in S).
+};
+
+// saliency map and excitatory neuron at one location, integrated up to step
+struct WTANeuronState {
+  int   step;  // next step to integrate.
+  int   event; // next inhibition of return event to apply.
+  float Vsm;   // potential of the saliency map neuron (in V).
+  float Ginh;  // inhibitory conductivity of the saliency map neuron (in S).
+  float Vexc;  // potential of the excitatory neuron (in V).
+};
+
+/**
+ * Event driven winner-take-all. Between two winners the neurons only interact through the global
+ * inhibition, so each neuron is integrated on its own: a closed form bound of the membrane potentials
+ * gives the earliest step a neuron can fire, the neurons are visited in the order of that bound
+ * (heap) and only the ones that may fire before the current winner are integrated. Inhibition of
+ * return events are recorded and applied when a neuron is integrated past them. Neurons are integrated
+ * with the same arithmetic as evolveWTA, so the winners are the same as the ones of the simulation.
+ */
+struct WTAEvents {
+  std::vector<WTANeuronState> neurons; // row major.
+  std::vector<float> Ism;              // input current of the saliency map neurons (in A).
+  std::vector<float> dt;               // integration time step of every step (in sec).
+  std::vector<float> excGinh;          // global inhibition of the excitatory neurons in every step (in S).
+  int committedSteps;                  // steps up to and including the last winner.
+  WTAInhibitionState committed;        // after committedSteps.
+  WTAInhibitionState extended;         // after dt.size() steps, assuming no winner after committedSteps.
+  std::vector<int> iorStep;            // step of the winner that triggered each inhibition of return.
+  std::vector<std::vector<float> > iorGinh; // row major increment of the inhibitory conductivity.
 };
 
 void defaultLeakyIntFire(LIF& lif);
@@ -78,6 +117,8 @@ void evolveLeakyIntFire(LIF& lif, float t, cv::Mat& spikes);
 void evolveWTA(WTA& wta, cv::Point& winner);
 bool fastSegmentMap(cv::Mat& resultMap, cv::Mat& map, cv::Point& seedPoint, int& Number);
 bool estimateShape(cv::Mat& binMap, cv::Mat& segmentedMap, cv::Mat& shapeMap, cv::Mat& salmap, cv::Point& winner, Params& params, cv::Mat &image);
+void initializeWTAEvents(WTAEvents& events, const WTA& wta);
+bool evolveWTAEvents(WTAEvents& events, const WTA& wta, cv::Point& winner, Params& params);
 void applyIOR(WTA& wta, cv::Point& winner, Params& params);
 void diskIOR(WTA& wta, cv::Point& winner, Params& params);
 //void shapeIOR(WTA& wta, cv::Point& winner, Params& params, cv::Mat& binaryMap, cv::Mat& binMap);
@@ -7,6 +7,10 @@
 
 #include "BundleAdjusterRT.hh"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 
 namespace kp
@@ -20,6 +24,7 @@ using namespace std;
  * Constructor/Destructor
  */
 BundleAdjusterRT::BundleAdjusterRT(const Parameter &p)
+ : param(p), first_kf(0)
 { 
 }
 
@@ -36,7 +41,8 @@ void BundleAdjusterRT::getDataToBundle(const std::vector<View::Ptr> &views, std:
   Eigen::Matrix3d R;
   Eigen::Vector3d t;
 
-  lt.resize(views.size(), UINT_MAX);
+  kfs.clear();
+  lt.assign(views.size(), UINT_MAX);
 
   for (unsigned i=0; i<views.size(); i++)
     if (views[i]->is_keyframe)
@@ -69,7 +75,7 @@ void BundleAdjusterRT::copyBackBundledData(const std::vector<Eigen::Matrix<doubl
   Eigen::Matrix3d R;
   Eigen::Vector3d t;
 
-  for (unsigned i=0; i<kfs.size(); i++)
+  for (unsigned i=first_kf; i<kfs.size(); i++)
   {
     View &kf = *kfs[i];
     
@@ -118,6 +124,121 @@ struct RigidTransformationError {
 };
 
 
+/**
+ * MarginalizationPriorError
+ * linear prior r = R (x - x0) + e0 of the marginalised keyframes
+ */
+class MarginalizationPriorError : public ceres::CostFunction
+{
+public:
+  MarginalizationPriorError(const PoseMarginalization::Prior &_prior)
+   : prior(_prior)
+  {
+    set_num_residuals(prior.R.rows());
+    for (unsigned i=0; i<prior.idx.size(); i++)
+      mutable_parameter_block_sizes()->push_back(6);
+  }
+
+  virtual bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const
+  {
+    int n = prior.R.rows();
+    Eigen::VectorXd dx(n);
+
+    for (unsigned i=0; i<prior.idx.size(); i++)
+      for (int j=0; j<6; j++)
+        dx[6*i+j] = parameters[i][j] - prior.x0[6*i+j];
+
+    Eigen::Map<Eigen::VectorXd>(residuals, n) = prior.R*dx + prior.e0;
+
+    if (jacobians!=NULL)
+    {
+      for (unsigned i=0; i<prior.idx.size(); i++)
+        if (jacobians[i]!=NULL)
+          Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> >(jacobians[i], n, 6) = prior.R.block(0,6*i,n,6);
+    }
+
+    return true;
+  }
+
+private:
+  const PoseMarginalization::Prior prior;
+};
+
+
+/**
+ * marginalizeKeyframes
+ * eliminates the keyframes [first_kf, new_first_kf) and updates the prior of the window
+ */
+void BundleAdjusterRT::marginalizeKeyframes(int new_first_kf)
+{
+  if (!param.marginalize)
+  {
+    first_kf = new_first_kf;
+    return;
+  }
+
+  PoseMarginalization marg;
+  std::vector<int> marg_kfs, cams(2);
+  Eigen::MatrixXd J(3,12);
+  Eigen::Vector3d r;
+  double jac1[18], jac2[18];
+  double *jacobians[2] = {jac1, jac2};
+
+  for (int i=first_kf; i<new_first_kf; i++)
+    if (!isConstant(i)) marg_kfs.push_back(i);
+
+  marg.addPrior(prior, cameras);
+
+  // linearise all links of the window with a marginalised keyframe
+  for (int i=kfs.size()-1; i>0; i--)
+  {
+    View &view = *kfs[i];
+
+    for (unsigned j=0; j<view.keys.size(); j++)
+    {
+      LinkedKeypoint &key = view.keys[j];
+      if (isnan(key.pt3[0]))
+        continue;
+
+      for (unsigned k=0; k<key.links.size(); k++)
+      {
+        int kf = lt_camera[key.links[k].first];
+        if (kf==(int)UINT_MAX || !isInWindow(i,kf))
+          continue;
+        if ((i<first_kf || i>=new_first_kf) && (kf<first_kf || kf>=new_first_kf))
+          continue;
+
+        LinkedKeypoint &kf_key = kfs[kf]->keys[key.links[k].second];
+        if (isnan(kf_key.pt3[0]))
+          continue;
+
+        Eigen::Vector3f &pt1 = kf_key.pt3;
+        Eigen::Vector3f &pt2 = key.pt3;
+        ceres::NumericDiffCostFunction< RigidTransformationError, ceres::CENTRAL, 3, 6, 6 > cost(
+          new RigidTransformationError( pt1[0],pt1[1],pt1[2], pt2[0],pt2[1],pt2[2]));
+        const double *parameters[2] = {&cameras[kf][0], &cameras[i][0]};
+
+        cost.Evaluate(parameters, &r[0], jacobians);
+
+        J.block<3,6>(0,0) = Eigen::Map<Eigen::Matrix<double, 3, 6, Eigen::RowMajor> >(jac1);
+        J.block<3,6>(0,6) = Eigen::Map<Eigen::Matrix<double, 3, 6, Eigen::RowMajor> >(jac2);
+        cams[0] = (isConstant(kf)?-1:kf);
+        cams[1] = (isConstant(i)?-1:i);
+
+        marg.addResidual(cams, J, r);
+      }
+    }
+  }
+
+  if (!marg.marginalize(marg_kfs, cameras, prior))
+    prior.clear();
+
+  for (int i=first_kf; i<new_first_kf; i++)
+    marg_stamp[i] = kfs.size();
+
+  first_kf = new_first_kf;
+}
+
 /**
  * bundle
  */
@@ -128,6 +249,7 @@ void BundleAdjusterRT::bundle(std::vector<View::Ptr> &kfs, std::vector<Eigen::Ma
 
   ceres::Problem::Options problem_options;
   ceres::Problem problem(problem_options);
+  std::vector<bool> used(cameras.size(), false);
 
   for (int i=kfs.size()-1; i>0; i--)
   {
@@ -139,7 +261,11 @@ void BundleAdjusterRT::bundle(std::vector<View::Ptr> &kfs, std::vector<Eigen::Ma
       LinkedKeypoint &key = view.keys[j];
       for (unsigned k=0; k<key.links.size(); k++)
       {
-        LinkedKeypoint &kf_key = kfs[lt[key.links[k].first]]->keys[key.links[k].second];
+        int kf = lt[key.links[k].first];
+        if (kf==(int)UINT_MAX || !isInWindow(i,kf))
+          continue;
+
+        LinkedKeypoint &kf_key = kfs[kf]->keys[key.links[k].second];
         if (!isnan(kf_key.pt3[0]))
         {
           Eigen::Vector3f &pt1 = kf_key.pt3;
@@ -148,29 +274,53 @@ void BundleAdjusterRT::bundle(std::vector<View::Ptr> &kfs, std::vector<Eigen::Ma
           if (isnan(pt2[0]))
             continue;
 
-          double *pose1 = &cameras[lt[key.links[k].first]][0];
+          double *pose1 = &cameras[kf][0];
 
           problem.AddResidualBlock(
             new ceres::NumericDiffCostFunction< RigidTransformationError, ceres::CENTRAL, 3, 6, 6 >( 
             new RigidTransformationError( pt1[0],pt1[1],pt1[2], pt2[0],pt2[1],pt2[2])), 
                                      NULL, pose1, pose2);
+          used[kf] = used[i] = true;
         }
       }
     }
   }
 
-  // first camera is static
-  problem.SetParameterBlockConstant(&cameras[0][0]);
+  // prior of the marginalised keyframes
+  if (!prior.empty())
+  {
+    std::vector<double*> parameter_blocks;
+    for (unsigned i=0; i<prior.idx.size(); i++)
+    {
+      parameter_blocks.push_back(&cameras[prior.idx[i]][0]);
+      used[prior.idx[i]] = true;
+    }
+    problem.AddResidualBlock(new MarginalizationPriorError(prior), NULL, parameter_blocks);
+  }
+
+  // first camera and cameras in front of the window are static
+  for (unsigned i=0; i<cameras.size(); i++)
+    if (used[i] && isConstant(i))
+      problem.SetParameterBlockConstant(&cameras[i][0]);
  
   // Configure the solver.
+  int nb_threads = param.nb_threads;
+  #ifdef _OPENMP
+  if (nb_threads<=0) nb_threads = omp_get_num_procs();
+  #endif
+  if (nb_threads<=0) nb_threads = 1;
+
   ceres::Solver::Options options;
   options.use_nonmonotonic_steps = true;
   options.preconditioner_type = ceres::SCHUR_JACOBI;
-  options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+  if (!ceres::StringToLinearSolverType(param.linear_solver, &options.linear_solver_type))
+    throw std::runtime_error("[BundleAdjusterRT::bundle] Unknown linear solver type!");
   options.use_inner_iterations = true;
-  options.max_num_iterations = 100;
-  //options.linear_solver_type = ceres::DENSE_SCHUR;
-  //options.linear_solver_type = ceres::DENSE_QR;
+  options.max_num_iterations = param.max_num_iterations;
+  options.num_threads = nb_threads;
+  #if !defined(CERES_VERSION_MAJOR) || CERES_VERSION_MAJOR<2
+  options.num_linear_solver_threads = nb_threads;
+  #endif
   #ifdef KT_DEBUG
   options.minimizer_progress_to_stdout = true;
   #else
@@ -195,6 +345,10 @@ void BundleAdjusterRT::setSharedData(const Scene::Ptr &_scene)
 {
   scene = _scene;
 
+  first_kf = 0;
+  marg_stamp.clear();
+  prior.clear();
+
   getDataToBundle(scene->views, kfs, cameras, lt_camera); 
 }
 
@@ -206,6 +360,12 @@ void BundleAdjusterRT::optimize()
   if (scene.get()==0)
     throw std::runtime_error("[BundleAdjusterRT::optimize] No data available!");
 
+  getDataToBundle(scene->views, kfs, cameras, lt_camera);
+  marg_stamp.resize(kfs.size(), -1);
+
+  // slide the window
+  if (param.window_size < (int)kfs.size() && (int)kfs.size()-param.window_size > first_kf)
+    marginalizeKeyframes(kfs.size()-param.window_size);
 
   bundle(kfs, cameras, lt_camera);
 
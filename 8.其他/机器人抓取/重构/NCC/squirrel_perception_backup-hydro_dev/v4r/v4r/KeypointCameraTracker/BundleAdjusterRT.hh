@@ -11,6 +11,8 @@
 #include <iostream>
 #include <fstream>
 #include <float.h>
+#include <limits.h>
+#include <string>
 #include <opencv2/core/core.hpp>
 #include <Eigen/Dense>
 #ifndef KP_NO_CERES_AVAILABLE
@@ -23,6 +25,7 @@
 #include "v4r/KeypointTools/SmartPtr.hpp"
 #include "View.hh"
 #include "Scene.hh"
+#include "PoseMarginalization.hh"
 
 namespace kp
 {
@@ -33,7 +36,15 @@ public:
   class Parameter
   {
   public:
-    Parameter() {}
+    int window_size;             // INT_MAX -> bundle all keyframes
+    bool marginalize;            // prior for keyframes leaving the window, else they are kept constant
+    std::string linear_solver;   // ceres linear solver (ITERATIVE_SCHUR, DENSE_SCHUR, SPARSE_SCHUR, ...)
+    int nb_threads;              // 0 uses all processors
+    int max_num_iterations;
+    Parameter(int _window_size=INT_MAX, bool _marginalize=true, 
+      const std::string &_linear_solver="ITERATIVE_SCHUR", int _nb_threads=0, int _max_num_iterations=100)
+    : window_size(_window_size), marginalize(_marginalize), linear_solver(_linear_solver),
+      nb_threads(_nb_threads), max_num_iterations(_max_num_iterations) {}
   };
 
 private:
@@ -44,6 +55,14 @@ private:
 
   Scene::Ptr scene;
 
+  // sliding window
+  int first_kf;                       // first keyframe of the window
+  std::vector<int> marg_stamp;        // number of keyframes when a keyframe has been marginalised
+  PoseMarginalization::Prior prior;
+
+  inline bool isInWindow(int kf1, int kf2);
+  inline bool isConstant(int kf);
+  void marginalizeKeyframes(int new_first_kf);
   void bundle(std::vector<View::Ptr> &kfs, std::vector<Eigen::Matrix<double, 6, 1> > &cameras, std::vector<unsigned> &lt);
   void getDataToBundle(const std::vector<View::Ptr> &views, std::vector<View::Ptr> &kfs,
         std::vector<Eigen::Matrix<double, 6, 1> > &cameras, std::vector<unsigned> &lt); 
@@ -63,6 +82,7 @@ public:
   BundleAdjusterRT(const Parameter &p=Parameter());
   ~BundleAdjusterRT();
 
+  /** bundle all keyframes or the sliding window (param.window_size), can be called for each new keyframe **/
   void optimize();
 
   void setSharedData(const Scene::Ptr &_scene);
@@ -75,6 +95,31 @@ public:
 
 /*************************** INLINE METHODES **************************/
 
+/**
+ * isInWindow
+ * true if the link between keyframe kf1 and kf2 is part of the window 
+ * (not older than the window and not already in the prior)
+ */
+inline bool BundleAdjusterRT::isInWindow(int kf1, int kf2)
+{
+  int kf_new = (kf1>kf2?kf1:kf2);
+  int kf_old = (kf1>kf2?kf2:kf1);
+
+  if (kf_new < first_kf)
+    return false;
+  if (marg_stamp[kf_old]>=0 && kf_new < marg_stamp[kf_old])
+    return false;
+  return true;
+}
+
+/**
+ * isConstant
+ */
+inline bool BundleAdjusterRT::isConstant(int kf)
+{
+  return (kf==0 || kf<first_kf);
+}
+
 inline void BundleAdjusterRT::getR(const Eigen::Matrix4f &pose, Eigen::Matrix3d &R)
 {
   R(0,0) = pose(0,0); R(0,1) = pose(0,1); R(0,2) = pose(0,2);
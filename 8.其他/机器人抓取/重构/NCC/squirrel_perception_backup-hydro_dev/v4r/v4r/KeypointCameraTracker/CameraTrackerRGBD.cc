@@ -199,7 +199,7 @@ bool CameraTrackerRGBD::isTrackOK(int num_tiles, const double &total_score, cons
 /**
  * lookupPoints3D
  */
-void CameraTrackerRGBD::lookupPoints3D(const DataMatrix2D<PointXYZRGB> &cloud, View &view)
+void CameraTrackerRGBD::lookupPoints3D(const DataMatrix2DView<const PointXYZRGB> &cloud, View &view)
 {
   for (unsigned i=0; i<view.keys.size(); i++)
   {
@@ -222,7 +222,7 @@ void CameraTrackerRGBD::lookupPoints3D(const DataMatrix2D<PointXYZRGB> &cloud, V
 /**
  * setKeyframe
  */
-void CameraTrackerRGBD::setKeyframe(const DataMatrix2D<PointXYZRGB> &cloud, Scene &scene)
+void CameraTrackerRGBD::setKeyframe(const DataMatrix2DView<const PointXYZRGB> &cloud, Scene &scene)
 {
   if (scene.views.size() > 0)// && scene.views.back()->pose != Eigen::Matrix4f::Identity())
   {
@@ -237,6 +237,15 @@ void CameraTrackerRGBD::setKeyframe(const DataMatrix2D<PointXYZRGB> &cloud, Scen
 /***************************************************************************************/
 
 bool CameraTrackerRGBD::track(const DataMatrix2D<PointXYZRGB> &cloud, Eigen::Matrix4f &pose, const cv::Mat_<unsigned char> &mask)
+{
+  return track(getView(cloud), pose, mask);
+}
+
+/**
+ * track
+ * the cloud is only read (and copied to the scene for keyframes if log_clouds is set)
+ */
+bool CameraTrackerRGBD::track(const DataMatrix2DView<const PointXYZRGB> &cloud, Eigen::Matrix4f &pose, const cv::Mat_<unsigned char> &mask)
 {
   if (cloud.rows<=1)
     throw std::runtime_error("[CameraTrackerRGBD::track] Need an organized point cloud!");
@@ -318,9 +327,12 @@ bool CameraTrackerRGBD::track(const DataMatrix2D<PointXYZRGB> &cloud, Eigen::Mat
 void CameraTrackerRGBD::doFullBundleAdjustment()
 {
   #ifndef KP_NO_CERES_AVAILABLE
-  bundler.reset( new BundleAdjusterRT());
+  if (bundler.get()==0)
+  {
+    bundler.reset( new BundleAdjusterRT(param.ba_param) );
+    bundler->setSharedData(scene);
+  }
   bundler->dbg = dbg;
-  bundler->setSharedData(scene);
   bundler->optimize();
   #else
   throw std::runtime_error("[CameraTrackerRGBD::doFullBundleAdjustment] Ceres not found!");
@@ -337,6 +349,9 @@ void CameraTrackerRGBD::setSharedData(Scene::Ptr &_scene)
 
   keytracker->setSharedData(scene);
   if (param.detect_loops) loopclosing->setSharedData(scene);
+  #ifndef KP_NO_CERES_AVAILABLE
+  if (bundler.get()!=0) bundler->setSharedData(scene);
+  #endif
 }
 
 
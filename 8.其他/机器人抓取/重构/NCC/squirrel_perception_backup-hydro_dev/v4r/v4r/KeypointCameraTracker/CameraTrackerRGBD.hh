@@ -16,11 +16,10 @@
 #include "v4r/KeypointTools/RigidTransformationRANSAC.hh"
 #include "v4r/KeypointTools/SmartPtr.hpp"
 #include "v4r/KeypointTools/PointTypes.hpp"
+#include "v4r/KeypointTools/DataMatrix2DView.hpp"
 #include "KeypointTracker.hh"
 #include "LoopClosingRT.hh"
-#ifndef KP_NO_CERES_AVAILABLE
 #include "BundleAdjusterRT.hh"
-#endif
 #include "Scene.hh"
 #include "View.hh"
 
@@ -42,16 +41,18 @@ public:
     KeypointTracker::Parameter kt_param;
     RigidTransformationRANSAC::Parameter rt_param;
     LoopClosingRT::Parameter lc_param;
+    BundleAdjusterRT::Parameter ba_param;
     Parameter(double _min_total_score=10, int _min_tiles_used=3, 
       double _angle_init_keyframe=7.5, bool _detect_loops=true,
       double _thr_image_motion=0.25, bool _log_clouds=false,
       const KeypointTracker::Parameter &_kt_param=KeypointTracker::Parameter(),
       const RigidTransformationRANSAC::Parameter &_rt_param=RigidTransformationRANSAC::Parameter(0.005),
-      const LoopClosingRT::Parameter &_lc_param=LoopClosingRT::Parameter())
+      const LoopClosingRT::Parameter &_lc_param=LoopClosingRT::Parameter(),
+      const BundleAdjusterRT::Parameter &_ba_param=BundleAdjusterRT::Parameter())
     : min_total_score(_min_total_score), min_tiles_used(_min_tiles_used),
       angle_init_keyframe(_angle_init_keyframe), detect_loops(_detect_loops),
       thr_image_motion(_thr_image_motion), log_clouds(_log_clouds),
-      kt_param(_kt_param), rt_param(_rt_param), lc_param(_lc_param) {}
+      kt_param(_kt_param), rt_param(_rt_param), lc_param(_lc_param), ba_param(_ba_param) {}
   };
 
 private:
@@ -74,8 +75,8 @@ private:
   BundleAdjusterRT::Ptr bundler;
   #endif
 
-  void lookupPoints3D(const DataMatrix2D<PointXYZRGB> &cloud, View &view);
-  void setKeyframe(const DataMatrix2D<PointXYZRGB> &cloud, Scene &scene);
+  void lookupPoints3D(const DataMatrix2DView<const PointXYZRGB> &cloud, View &view);
+  void setKeyframe(const DataMatrix2DView<const PointXYZRGB> &cloud, Scene &scene);
   void trackPose(View &keyframe, View &view);
   void getPoints(View &keyframe, View &view, 
         std::vector<Eigen::Vector3f> &src_pts, std::vector<Eigen::Vector3f> &tgt_pts);  
@@ -93,6 +94,11 @@ public:
 
   bool track(const DataMatrix2D<PointXYZRGB> &cloud, Eigen::Matrix4f &pose, 
         const cv::Mat_<unsigned char> &mask=cv::Mat());
+  /** track a cloud without copying it, e.g. kp::getKPView(pcl_cloud) (KeypointConversions/cloudViews.hpp) **/
+  bool track(const DataMatrix2DView<const PointXYZRGB> &cloud, Eigen::Matrix4f &pose, 
+        const cv::Mat_<unsigned char> &mask=cv::Mat());
+  /** bundle all keyframes or the sliding window (param.ba_param.window_size), the window and the prior
+   * of marginalised keyframes are kept between calls, i.e. it can be called for each new keyframe **/
   void doFullBundleAdjustment();
   /** isKeyframe returns true if the last tracked frame is a keyframe **/
   bool isKeyframe() {return scene->views.back()->is_keyframe;}
@@ -0,0 +1,186 @@
+/**
+ * $Id$
+ *
+ * Copyright (c) 2014, Johann Prankl
+ * @author Johann Prankl (prankl@acin.tuwien.ac.at)
+ */
+
+#include "PoseMarginalization.hh"
+#include <algorithm>
+
+
+
+namespace kp
+{
+
+
+using namespace std;
+
+
+/************************************************************************************
+ * Constructor/Destructor
+ */
+PoseMarginalization::PoseMarginalization(double _damping)
+ : damping(_damping)
+{ 
+}
+
+PoseMarginalization::~PoseMarginalization()
+{
+}
+
+/**
+ * getBlock
+ */
+int PoseMarginalization::getBlock(int cam)
+{
+  std::map<int,int>::iterator it = lt_block.find(cam);
+  if (it!=lt_block.end())
+    return it->second;
+
+  int idx = blocks.size();
+  int n = 6*idx;
+
+  lt_block[cam] = idx;
+  blocks.push_back(cam);
+
+  H.conservativeResize(n+6, n+6);
+  H.block(n,0,6,n+6).setZero();
+  H.block(0,n,n,6).setZero();
+  b.conservativeResize(n+6);
+  b.segment<6>(n).setZero();
+
+  return idx;
+}
+
+
+
+
+/***************************************************************************************/
+
+/**
+ * clear
+ */
+void PoseMarginalization::clear()
+{
+  lt_block.clear();
+  blocks.clear();
+  H.resize(0,0);
+  b.resize(0);
+}
+
+/**
+ * addResidual
+ */
+void PoseMarginalization::addResidual(const std::vector<int> &cams, const Eigen::MatrixXd &J, const Eigen::VectorXd &r)
+{
+  std::vector<int> idx(cams.size(), -1);
+
+  for (unsigned i=0; i<cams.size(); i++)
+    if (cams[i]>=0)
+      idx[i] = 6*getBlock(cams[i]);
+
+  for (unsigned i=0; i<cams.size(); i++)
+  {
+    if (idx[i]<0) continue;
+
+    b.segment<6>(idx[i]) += J.block(0,6*i,J.rows(),6).transpose() * r;
+
+    for (unsigned j=0; j<cams.size(); j++)
+    {
+      if (idx[j]<0) continue;
+      H.block<6,6>(idx[i],idx[j]) += J.block(0,6*i,J.rows(),6).transpose() * J.block(0,6*j,J.rows(),6);
+    }
+  }
+}
+
+/**
+ * addPrior
+ */
+void PoseMarginalization::addPrior(const Prior &prior, const std::vector<Eigen::Matrix<double, 6, 1> > &cameras)
+{
+  if (prior.empty())
+    return;
+
+  Eigen::VectorXd dx(prior.x0.rows());
+
+  for (unsigned i=0; i<prior.idx.size(); i++)
+    dx.segment<6>(6*i) = cameras[prior.idx[i]] - prior.x0.segment<6>(6*i);
+
+  Eigen::VectorXd r = prior.R*dx + prior.e0;
+
+  addResidual(prior.idx, prior.R, r);
+}
+
+/**
+ * marginalize
+ */
+bool PoseMarginalization::marginalize(const std::vector<int> &marg, const std::vector<Eigen::Matrix<double, 6, 1> > &cameras, Prior &prior)
+{
+  std::vector<int> m_idx, k_idx;
+
+  prior.clear();
+
+  for (unsigned i=0; i<blocks.size(); i++)
+  {
+    if (std::find(marg.begin(), marg.end(), blocks[i]) != marg.end())
+      m_idx.push_back(i);
+    else k_idx.push_back(i);
+  }
+
+  if (k_idx.size()==0)
+    return false;
+
+  int nm = 6*m_idx.size(), nk = 6*k_idx.size();
+  Eigen::MatrixXd Hmm(nm,nm), Hkm(nk,nm), Hkk(nk,nk);
+  Eigen::VectorXd bm(nm), bk(nk);
+
+  for (unsigned i=0; i<m_idx.size(); i++)
+  {
+    bm.segment<6>(6*i) = b.segment<6>(6*m_idx[i]);
+    for (unsigned j=0; j<m_idx.size(); j++)
+      Hmm.block<6,6>(6*i,6*j) = H.block<6,6>(6*m_idx[i],6*m_idx[j]);
+  }
+  for (unsigned i=0; i<k_idx.size(); i++)
+  {
+    bk.segment<6>(6*i) = b.segment<6>(6*k_idx[i]);
+    for (unsigned j=0; j<m_idx.size(); j++)
+      Hkm.block<6,6>(6*i,6*j) = H.block<6,6>(6*k_idx[i],6*m_idx[j]);
+    for (unsigned j=0; j<k_idx.size(); j++)
+      Hkk.block<6,6>(6*i,6*j) = H.block<6,6>(6*k_idx[i],6*k_idx[j]);
+  }
+
+  // Schur complement
+  if (nm>0)
+  {
+    Hmm.diagonal().array() += damping;
+    Eigen::LDLT<Eigen::MatrixXd> ldlt(Hmm);
+    Eigen::MatrixXd Hmm_inv_Hmk = ldlt.solve(Hkm.transpose());
+    Hkk -= Hkm*Hmm_inv_Hmk;
+    bk -= Hmm_inv_Hmk.transpose()*bm;
+  }
+
+  // square root form: H = R^T R, R^T e0 = b
+  Hkk = 0.5*(Hkk+Hkk.transpose());
+  Hkk.diagonal().array() += damping;
+  Eigen::LLT<Eigen::MatrixXd> llt(Hkk);
+  if (llt.info()!=Eigen::Success)
+    return false;
+
+  prior.R = llt.matrixU();
+  prior.e0 = llt.matrixL().solve(bk);
+  prior.x0.resize(nk);
+  prior.idx.resize(k_idx.size());
+
+  for (unsigned i=0; i<k_idx.size(); i++)
+  {
+    prior.idx[i] = blocks[k_idx[i]];
+    prior.x0.segment<6>(6*i) = cameras[prior.idx[i]];
+  }
+
+  return true;
+}
+
+
+}
+
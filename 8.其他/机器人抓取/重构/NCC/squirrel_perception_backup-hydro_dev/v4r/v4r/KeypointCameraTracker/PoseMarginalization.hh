@@ -0,0 +1,70 @@
+/**
+ * $Id$
+ *
+ * Copyright (c) 2014, Johann Prankl
+ * @author Johann Prankl (prankl@acin.tuwien.ac.at)
+ */
+
+#ifndef KP_POSE_MARGINALIZATION_HH
+#define KP_POSE_MARGINALIZATION_HH
+
+#include <vector>
+#include <map>
+#include <Eigen/Dense>
+
+namespace kp
+{
+
+/**
+ * PoseMarginalization
+ * Gauss-Newton marginalisation of 6-dof camera parameter blocks (angle axis, translation) for 
+ * sliding window bundle adjustment. The linearised residuals of the cameras leaving the window are 
+ * accumulated (H = J^T J, b = J^T r) and the cameras are eliminated with the Schur complement.
+ * The result is a linear prior r = R (x - x0) + e0 on the remaining cameras.
+ */
+class PoseMarginalization
+{
+public:
+  class Prior
+  {
+  public:
+    std::vector<int> idx;        // cameras of the prior
+    Eigen::VectorXd x0;          // linearisation point (6 per camera)
+    Eigen::MatrixXd R;           // square root information (upper triangular)
+    Eigen::VectorXd e0;          // residual at x0
+
+    inline void clear() { idx.clear(); x0.resize(0); R.resize(0,0); e0.resize(0); }
+    inline bool empty() const { return idx.size()==0; }
+  };
+
+private:
+  std::map<int,int> lt_block;
+  std::vector<int> blocks;
+  Eigen::MatrixXd H;
+  Eigen::VectorXd b;
+
+  int getBlock(int cam);
+
+public:
+  double damping;                // added to the diagonal (rank deficient systems)
+
+  PoseMarginalization(double _damping=1e-8);
+  ~PoseMarginalization();
+
+  void clear();
+
+  /** linearised residual r + J dx of the cameras cams (-1 marks constant cameras), J is r.rows() x 6*cams.size() **/
+  void addResidual(const std::vector<int> &cams, const Eigen::MatrixXd &J, const Eigen::VectorXd &r);
+  /** prior of a former marginalisation evaluated at the current cameras **/
+  void addPrior(const Prior &prior, const std::vector<Eigen::Matrix<double, 6, 1> > &cameras);
+  /** eliminate the cameras marg and return the prior on all other cameras of the system **/
+  bool marginalize(const std::vector<int> &marg, const std::vector<Eigen::Matrix<double, 6, 1> > &cameras, Prior &prior);
+};
+
+
+/*************************** INLINE METHODES **************************/
+
+} //--END--
+
+#endif
+
@@ -9,6 +9,10 @@
 #include "ProjBundleAdjuster.hh"
 #include "v4r/KeypointTools/invPose.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 namespace kp 
 {
@@ -460,12 +464,23 @@ void ProjBundleAdjuster::bundle(Scene &scene, std::vector<Camera> &cameras)
   }
  
   // Configure the solver.
+  int nb_threads = param.nb_threads;
+  #ifdef _OPENMP
+  if (nb_threads<=0) nb_threads = omp_get_num_procs();
+  #endif
+  if (nb_threads<=0) nb_threads = 1;
+
   ceres::Solver::Options options;
   options.use_nonmonotonic_steps = true;
   options.preconditioner_type = ceres::SCHUR_JACOBI;
-  options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+  if (!ceres::StringToLinearSolverType(param.linear_solver, &options.linear_solver_type))
+    throw std::runtime_error("[ProjBundleAdjuster::bundle] Unknown linear solver type!");
   options.use_inner_iterations = true;
-  options.max_num_iterations = 100;
+  options.max_num_iterations = param.max_num_iterations;
+  options.num_threads = nb_threads;
+  #if !defined(CERES_VERSION_MAJOR) || CERES_VERSION_MAJOR<2
+  options.num_linear_solver_threads = nb_threads;
+  #endif
 
   if (!dbg.empty()) 
     options.minimizer_progress_to_stdout = true;
@@ -12,6 +12,7 @@
 #include <fstream>
 #include <float.h>
 #include <math.h>
+#include <string>
 #include <opencv2/core/core.hpp>
 #include <Eigen/Dense>
 #ifndef KP_NO_CERES_AVAILABLE
@@ -35,10 +36,15 @@ public:
     int inc_bundle_frames;     // INT_MAX -> bundle all keyframe-cameras
     bool optimize_camera;
     bool optimize_struct_only;
+    std::string linear_solver; // ceres linear solver (ITERATIVE_SCHUR, DENSE_SCHUR, SPARSE_SCHUR, ...)
+    int nb_threads;            // 0 uses all processors
+    int max_num_iterations;
     Parameter(int _inc_bundle_frames=10, bool _optimize_camera=false, 
-       bool _optimize_struct_only=false) 
+       bool _optimize_struct_only=false, const std::string &_linear_solver="ITERATIVE_SCHUR",
+       int _nb_threads=0, int _max_num_iterations=100) 
      : inc_bundle_frames(_inc_bundle_frames), optimize_camera(_optimize_camera),
-       optimize_struct_only(_optimize_struct_only) {}
+       optimize_struct_only(_optimize_struct_only), linear_solver(_linear_solver),
+       nb_threads(_nb_threads), max_num_iterations(_max_num_iterations) {}
   };
   class Camera
   {
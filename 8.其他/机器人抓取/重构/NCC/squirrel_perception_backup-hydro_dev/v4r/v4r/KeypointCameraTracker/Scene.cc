@@ -73,6 +73,25 @@ bool Scene::setKeyframeLast(const DataMatrix2D<PointXYZRGB> &cloud)
   return true;
 }
 
+/**
+ * setKeyframeLast
+ * copies the viewed cloud (e.g. the points of a pcl::PointCloud) to the last view
+ */
+bool Scene::setKeyframeLast(const DataMatrix2DView<const PointXYZRGB> &cloud)
+{
+  if (views.size()==0)
+    return false;
+
+  idx_keyframe = views.size()-1;
+  views.back()->is_keyframe=true;
+
+  DataMatrix2D<PointXYZRGB>::Ptr tmp_cloud(new DataMatrix2D<PointXYZRGB>);
+  cloud.copyTo(*tmp_cloud);
+  views.back()->cloud = tmp_cloud;  
+
+  return true;
+}
+
 
 } //--END--
 
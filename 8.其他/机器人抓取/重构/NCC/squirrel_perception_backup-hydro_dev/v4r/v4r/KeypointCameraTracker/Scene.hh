@@ -16,6 +16,7 @@
 #include <Eigen/Dense>
 #include "v4r/KeypointTools/SmartPtr.hpp"
 #include "v4r/KeypointTools/DataMatrix2D.hpp"
+#include "v4r/KeypointTools/DataMatrix2DView.hpp"
 #include "v4r/KeypointTools/PointTypes.hpp"
 #include "View.hh"
 
@@ -40,6 +41,7 @@ public:
   bool setKeyframeLast();
   bool setKeyframeLast(const cv::Mat_<unsigned char> &image);
   bool setKeyframeLast(const DataMatrix2D<PointXYZRGB> &cloud);
+  bool setKeyframeLast(const DataMatrix2DView<const PointXYZRGB> &cloud);
   bool setKeyframe(const cv::Mat_<unsigned char> &image, int idx);
 
   inline int getKeyframe() { return idx_keyframe; }
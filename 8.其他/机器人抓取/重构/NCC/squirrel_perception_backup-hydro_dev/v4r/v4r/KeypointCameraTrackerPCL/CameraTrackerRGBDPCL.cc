@@ -8,7 +8,7 @@
 #include "CameraTrackerRGBDPCL.hh"
 //#include "v4r/KeypointTools/getImageKPtoCV.hpp"
 #include "v4r/KeypointConversions/convertImage.hpp"
-#include "v4r/KeypointConversions/convertCloud.hpp"
+#include "v4r/KeypointConversions/cloudViews.hpp"
 #include <opencv2/highgui/highgui.hpp>
 
 
@@ -35,12 +35,11 @@ CameraTrackerRGBDPCL::~CameraTrackerRGBDPCL()
 
 /**
  * track
+ * the points are read in place (no conversion to a kp::DataMatrix2D)
  */
 bool CameraTrackerRGBDPCL::trackPCL(pcl::PointCloud<pcl::PointXYZRGB> &cloud, Eigen::Matrix4f &pose, const cv::Mat_<unsigned char> &mask)
 {
-  kp::convertCloud(cloud, kp_cloud);
-
-  return track(kp_cloud, pose, mask);
+  return track(kp::getKPView(cloud), pose, mask);
 }
 
 /**
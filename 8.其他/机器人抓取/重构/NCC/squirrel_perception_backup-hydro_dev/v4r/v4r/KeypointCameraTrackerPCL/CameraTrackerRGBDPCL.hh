@@ -20,9 +20,6 @@ namespace kp
 
 class CameraTrackerRGBDPCL : public CameraTrackerRGBD 
 {
-private:
-  kp::DataMatrix2D<kp::PointXYZRGB> kp_cloud;
- 
 public:
 
   CameraTrackerRGBDPCL(const CameraTrackerRGBD::Parameter &p=Parameter());
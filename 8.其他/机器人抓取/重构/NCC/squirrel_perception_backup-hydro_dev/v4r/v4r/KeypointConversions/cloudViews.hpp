@@ -0,0 +1,103 @@
+/**
+ * $Id$
+ *
+ * Copyright (c) 2014, Johann Prankl
+ * @author Johann Prankl (prankl@acin.tuwien.ac.at)
+ */
+
+#ifndef KP_CLOUD_VIEWS_HPP
+#define KP_CLOUD_VIEWS_HPP
+
+#include <stdexcept>
+#include <opencv2/core/core.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include "v4r/KeypointTools/DataMatrix2DView.hpp"
+#include "v4r/KeypointTools/PointTypes.hpp"
+
+
+/**
+ * Zero-copy views to the points of an organized pcl::PointCloud<pcl::PointXYZRGB>.
+ * The views point into cloud.points and are only valid as long as the cloud is not resized.
+ * A cv::Mat can not describe an element stride different from the element size, hence a
+ * single channel depth or a BGR cv::Mat always needs a copy (see convertImage), the views
+ * below can be used instead wherever the data is only read.
+ */
+
+namespace kp 
+{
+
+/**
+ * getPointView
+ * x,y,z of the points as Eigen::Vector3f
+ */
+template <class PointT>
+inline DataMatrix2DView<const Eigen::Vector3f> getPointView(const pcl::PointCloud<PointT> &cloud)
+{
+  if (cloud.points.size()==0)
+    return DataMatrix2DView<const Eigen::Vector3f>();
+  return DataMatrix2DView<const Eigen::Vector3f>((const Eigen::Vector3f*)&cloud.points[0].x, 
+                                                  cloud.height, cloud.width, sizeof(PointT));
+}
+
+/**
+ * getDepthView
+ * z-coordinate of the points
+ */
+template <class PointT>
+inline DataMatrix2DView<const float> getDepthView(const pcl::PointCloud<PointT> &cloud)
+{
+  if (cloud.points.size()==0)
+    return DataMatrix2DView<const float>();
+  return DataMatrix2DView<const float>(&cloud.points[0].z, cloud.height, cloud.width, sizeof(PointT));
+}
+
+/**
+ * getBGRView
+ * colour of the points in the channel order of an opencv image (b,g,r)
+ */
+template <class PointT>
+inline DataMatrix2DView<const cv::Vec3b> getBGRView(const pcl::PointCloud<PointT> &cloud)
+{
+  if (cloud.points.size()==0)
+    return DataMatrix2DView<const cv::Vec3b>();
+  return DataMatrix2DView<const cv::Vec3b>((const cv::Vec3b*)&cloud.points[0].b, 
+                                            cloud.height, cloud.width, sizeof(PointT));
+}
+
+/**
+ * getKPView
+ * pcl::PointXYZRGB viewed as kp::PointXYZRGB (both store x,y,z,1 followed by b,g,r,a)
+ */
+inline DataMatrix2DView<const kp::PointXYZRGB> getKPView(const pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+{
+  typedef char check_layout[(sizeof(kp::PointXYZRGB)<=sizeof(pcl::PointXYZRGB))?1:-1];
+  (void)sizeof(check_layout);
+
+  if (cloud.points.size()==0)
+    return DataMatrix2DView<const kp::PointXYZRGB>();
+  return DataMatrix2DView<const kp::PointXYZRGB>((const kp::PointXYZRGB*)&cloud.points[0], 
+                                                  cloud.height, cloud.width, sizeof(pcl::PointXYZRGB));
+}
+
+/**
+ * getPointMat
+ * cv::Mat header to the raw points (one CV_32F channel per float of the point type), 
+ * e.g. cv::split or cv::mixChannels can be used to extract channels without an intermediate copy
+ */
+template <class PointT>
+inline cv::Mat getPointMat(const pcl::PointCloud<PointT> &cloud)
+{
+  if (sizeof(PointT)%sizeof(float)!=0)
+    throw std::runtime_error("[getPointMat] Unsupported point type!");
+  if (cloud.points.size()==0)
+    return cv::Mat();
+  return cv::Mat(cloud.height, cloud.width, CV_32FC(sizeof(PointT)/sizeof(float)), 
+                 (void*)&cloud.points[0], cloud.width*sizeof(PointT));
+}
+
+
+} //--END--
+
+#endif
+
@@ -7,6 +7,7 @@
 
 
 #include "ClusteringMeanShift.hh"
+#include <algorithm>
 
 
 namespace kp 
@@ -29,20 +30,20 @@ ClusteringMeanShift::~ClusteringMeanShift()
 }
 
 /**
- * Compute new sample mean
+ * Compute new sample mean from the samples nn (indices in ascending order)
  * return true if converged
  */
-int ClusteringMeanShift::updateMean(const Eigen::MatrixXf &data, Eigen::VectorXf &center)
+int ClusteringMeanShift::updateMean(const DataMap &data, const std::vector<int> &nn, Eigen::VectorXf &center)
 {
   Eigen::VectorXf mean = center;
   float weight, sum_weight = 0.;
 
   center = Eigen::VectorXf::Zero(mean.size());
 
-  for (unsigned i=0; i<data.rows(); i++)
+  for (unsigned i=0; i<nn.size(); i++)
   {
-    weight = truncatedGaussian( (mean-(data.row(i).transpose())).squaredNorm() );
-    center += weight*data.row(i);
+    weight = truncatedGaussian( (mean-(data.row(nn[i]).transpose())).squaredNorm() );
+    center += weight*data.row(nn[i]);
     sum_weight += weight;
   }
 
@@ -57,7 +58,7 @@ int ClusteringMeanShift::updateMean(const Eigen::MatrixXf &data, Eigen::VectorXf
   return 0;
 }
 
-void ClusteringMeanShift::initClusters(const Eigen::MatrixXf &data, std::vector< Cluster::Ptr > &clusters)
+void ClusteringMeanShift::initClusters(const DataMap &data, std::vector< Cluster::Ptr > &clusters)
 {
   if (fabs(init_pcent-1.) < 0.001)
   {
@@ -80,6 +81,103 @@ void ClusteringMeanShift::initClusters(const Eigen::MatrixXf &data, std::vector<
   }
 }
 
+/**
+ * Remove clusters closer than thr_prune to a preceding cluster
+ * (kd-tree over the centers instead of testing all pairs)
+ */
+void ClusteringMeanShift::pruneClusters(std::vector< Cluster::Ptr > &clusters, std::vector<unsigned char> &converged)
+{
+  if (clusters.size()<2)
+    return;
+
+  int cols = clusters[0]->data.size();
+  std::vector<float> centers(clusters.size()*cols);
+  for (unsigned i=0; i<clusters.size(); i++)
+    for (int j=0; j<cols; j++)
+      centers[i*cols+j] = clusters[i]->data[j];
+
+  FLANNIndex index(::flann::Matrix<float>(&centers[0], clusters.size(), cols), ::flann::KDTreeSingleIndexParams(15));
+  index.buildIndex();
+
+  ::flann::SearchParams params(-1, 0., false);
+  std::vector<std::vector<int> > nn(1);
+  std::vector<std::vector<float> > sqr_dists(1);
+  std::vector<unsigned char> pruned(clusters.size(), 0);
+
+  for (unsigned i=0; i<clusters.size(); i++)
+  {
+    if (pruned[i])
+      continue;
+
+    // the exact test below decides, the radius is only enlarged for rounding
+    index.radiusSearch(::flann::Matrix<float>(&centers[i*cols], 1, cols), nn, sqr_dists, sqr_thr_pruning*1.001, params);
+
+    for (unsigned k=0; k<nn[0].size(); k++)
+    {
+      unsigned j = nn[0][k];
+      if (j>i && !pruned[j] && (clusters[i]->data-clusters[j]->data).squaredNorm() < sqr_thr_pruning)
+        pruned[j] = 1;
+    }
+  }
+
+  unsigned z=0;
+  for (unsigned i=0; i<clusters.size(); i++)
+  {
+    if (!pruned[i])
+    {
+      if (z!=i) clusters[z] = clusters[i];   // SmartPtr does not handle self assignment
+      converged[z] = converged[i];
+      z++;
+    }
+  }
+
+  clusters.resize(z);
+  converged.resize(z);
+}
+
+/**
+ * Assign samples to nearest cluster
+ */
+void ClusteringMeanShift::assignSamples(const DataMap &data, std::vector< Cluster::Ptr > &clusters)
+{
+  int cols = clusters[0]->data.size();
+  std::vector<float> centers(clusters.size()*cols);
+  for (unsigned i=0; i<clusters.size(); i++)
+    for (int j=0; j<cols; j++)
+      centers[i*cols+j] = clusters[i]->data[j];
+
+  FLANNIndex index(::flann::Matrix<float>(&centers[0], clusters.size(), cols), ::flann::KDTreeSingleIndexParams(15));
+  index.buildIndex();
+
+  int rows = data.rows();
+  std::vector<int> nearest(rows, -1);
+
+  #pragma omp parallel
+  {
+    ::flann::SearchParams params(-1, 0.);
+    std::vector<float> query(cols);
+    int idx;
+    float dist;
+    ::flann::Matrix<int> idx_mat(&idx, 1, 1);
+    ::flann::Matrix<float> dist_mat(&dist, 1, 1);
+
+    #pragma omp for
+    for (int i=0; i<rows; i++)
+    {
+      for (int j=0; j<cols; j++)
+        query[j] = data(i,j);
+
+      if (index.knnSearch(::flann::Matrix<float>(&query[0], 1, cols), idx_mat, dist_mat, 1, params) > 0)
+        nearest[i] = idx;
+    }
+  }
+
+  for (int i=0; i<rows; i++)
+  {
+    if (nearest[i]>=0) clusters[nearest[i]]->indices.push_back(i);
+  }
+}
+
 
 
 
@@ -88,6 +186,7 @@ void ClusteringMeanShift::initClusters(const Eigen::MatrixXf &data, std::vector<
 /****************************** PUBLIC *************************/
 /**
  * Mean shift clustering
+ * The kernel support of a mean is queried from a kd-tree over the samples, means are updated in parallel
  */
 void ClusteringMeanShift::cluster(const DataMatrix2Df &samples)
 {
@@ -96,82 +195,77 @@ void ClusteringMeanShift::cluster(const DataMatrix2Df &samples)
   if (samples.rows==0)
     return;
 
-  Eigen::Map<const Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> > data(&samples(0,0), samples.rows, samples.cols);
+  DataMap data(&samples(0,0), samples.rows, samples.cols);
 
   initClusters(data, clusters);
 
-  std::vector<bool> converged(clusters.size(),false);
+  FLANNIndex index(::flann::Matrix<float>(const_cast<float*>(&samples(0,0)), samples.rows, samples.cols), 
+                   ::flann::KDTreeSingleIndexParams(15));
+  index.buildIndex();
+
+  // samples outside the kernel get zero weight, the radius is only enlarged for rounding
+  float sqr_radius = sqr_lambda*1.001;
+
+  std::vector<unsigned char> converged(clusters.size(),0);
+  std::vector<int> status;
 
   int it=0;
   bool  changed = true;
-  int status;
   while(changed && it<max_iter)
   {
     changed = false;
 
-    for (unsigned i=0; i<clusters.size(); i++)
+    int num = clusters.size();
+    status.assign(num, 1);
+
+    #pragma omp parallel
     {
-      if (!converged[i])
+      ::flann::SearchParams params(-1, 0., false);
+      std::vector<std::vector<int> > nn(1);
+      std::vector<std::vector<float> > sqr_dists(1);
+
+      #pragma omp for schedule(dynamic,16)
+      for (int i=0; i<num; i++)
       {
-        status = updateMean(data, clusters[i]->data);
-
-        if (status == 1)
-        {
-          converged[i]=true;
-        }
-        else
-        {
-          if (status == 0)
-          {
-            changed |= true;
-          }
-          else
-          {
-            clusters.erase(clusters.begin()+i);
-            converged.erase(converged.begin()+i);
-            i--;
-          }
-        }
+        if (converged[i])
+          continue;
+
+        Eigen::VectorXf &center = clusters[i]->data;
+        index.radiusSearch(::flann::Matrix<float>(center.data(), 1, center.size()), nn, sqr_dists, sqr_radius, params);
+
+        // same summation order as over the whole data matrix
+        std::sort(nn[0].begin(), nn[0].end());
+        status[i] = updateMean(data, nn[0], center);
       }
     }
 
-    //pruning of clusters
-    for (unsigned i=0; i<clusters.size(); i++)
+    // drop clusters without support (in place)
+    unsigned z=0;
+    for (int i=0; i<num; i++)
     {
-      for (unsigned j=i+1; j<clusters.size(); j++)
-      {
-        if ( (clusters[i]->data-clusters[j]->data).squaredNorm() < sqr_thr_pruning)
-        {
-          clusters.erase(clusters.begin()+j);
-          converged.erase(converged.begin()+j);
-          j--;
-        }
-      }
+      if (status[i] == -1)
+        continue;
+
+      if (status[i] == 0)
+        changed = true;
+
+      if (z!=(unsigned)i) clusters[z] = clusters[i];
+      converged[z] = (status[i] == 1);
+      z++;
     }
 
+    clusters.resize(z);
+    converged.resize(z);
+
+    //pruning of clusters
+    pruneClusters(clusters, converged);
+
     it++;
   }
 
   if (clusters.size()==0) return;
 
-  //Assign samples to nearest cluster
-  unsigned idx;
-  double dist, minDist;
-  for (unsigned i=0; i<data.rows(); i++)
-  {
-    idx=UINT_MAX, minDist=DBL_MAX;
-    for (unsigned j=0; j<clusters.size(); j++)
-    {
-      dist = (clusters[j]->data-data.row(i).transpose()).squaredNorm();
-      if (dist < minDist)
-      {
-        minDist = dist;
-        idx=j;
-      }
-    }
-
-    if (idx!=UINT_MAX) clusters[idx]->indices.push_back(i);
-  }
+  assignSamples(data, clusters);
 }
 
 /**
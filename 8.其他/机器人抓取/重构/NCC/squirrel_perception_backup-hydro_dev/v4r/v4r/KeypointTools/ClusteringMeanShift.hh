@@ -11,6 +11,7 @@
 #include <iostream>
 #include <vector>
 #include <float.h>
+#include <flann/flann.hpp>
 #include "Clustering.hh"
 
 
@@ -36,6 +37,9 @@ public:
       init_p(_init_p), max_iter(_max_iter), eps_converge(_eps_converge) {}
   };
 
+  typedef Eigen::Map<const Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> > DataMap;
+  typedef ::flann::Index< ::flann::L2_Simple<float> > FLANNIndex;
+
 private:
   float sqr_lambda;
   float inv_sqr_sigma;
@@ -46,8 +50,10 @@ private:
 
   std::vector< Cluster::Ptr > clusters;
 
-  void initClusters(const Eigen::MatrixXf &data, std::vector< Cluster::Ptr > &clusters);
-  int updateMean(const Eigen::MatrixXf &data, Eigen::VectorXf &center);
+  void initClusters(const DataMap &data, std::vector< Cluster::Ptr > &clusters);
+  int updateMean(const DataMap &data, const std::vector<int> &nn, Eigen::VectorXf &center);
+  void pruneClusters(std::vector< Cluster::Ptr > &clusters, std::vector<unsigned char> &converged);
+  void assignSamples(const DataMap &data, std::vector< Cluster::Ptr > &clusters);
 
   inline float truncatedGaussian( const float &sqr_dist );
 
@@ -0,0 +1,126 @@
+/**
+ * $Id$
+ *
+ * Copyright (c) 2014, Johann Prankl
+ * @author Johann Prankl (prankl@acin.tuwien.ac.at)
+ */
+
+#ifndef KP_DATA_MATRIX_2D_VIEW_HPP
+#define KP_DATA_MATRIX_2D_VIEW_HPP
+
+#include <stddef.h>
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include "DataMatrix2D.hpp"
+
+namespace kp 
+{
+
+/**
+ * DataMatrix2DView
+ * Non-owning 2d view of elements of type T stored with an arbitrary byte stride per element 
+ * and per row, e.g. the z-coordinate or the colour of the points of an organized point cloud.
+ * The view does not copy the data, the owner has to outlive the view.
+ */
+template <class T>
+class DataMatrix2DView
+{
+public:
+  int rows, cols;
+  unsigned char *data;          // first element
+  size_t elem_step;             // bytes between two elements of a row
+  size_t row_step;              // bytes between two rows
+
+  DataMatrix2DView() : rows(0), cols(0), data(0), elem_step(sizeof(T)), row_step(0) {}
+  DataMatrix2DView(T *_data, int _rows, int _cols, size_t _elem_step=sizeof(T), size_t _row_step=0);
+  DataMatrix2DView(DataMatrix2D<T> &mat);
+
+  /** a view to const data can be created from a view to non-const data (of the same type only) **/
+  template <class T2>
+  DataMatrix2DView(const DataMatrix2DView<T2> &view, typename boost::enable_if<boost::is_same<T, const T2> >::type* = 0)
+   : rows(view.rows), cols(view.cols), data(view.data), elem_step(view.elem_step), row_step(view.row_step) {}
+
+  inline T& operator()(int row, int col) const;
+  inline T& operator[](int i) const;
+
+  inline bool empty() const {return (rows<=0 || cols<=0);}
+  inline bool isContinuous() const {return (elem_step==sizeof(T) && row_step==cols*sizeof(T));}
+  inline int size() const {return rows*cols;}
+
+  template <class T2>
+  void copyTo(DataMatrix2D<T2> &mat) const;
+};
+
+
+/**
+ * get a view to a DataMatrix2D
+ */
+template <class T>
+inline DataMatrix2DView<T> getView(DataMatrix2D<T> &mat) 
+{
+  return DataMatrix2DView<T>(mat);
+}
+
+template <class T>
+inline DataMatrix2DView<const T> getView(const DataMatrix2D<T> &mat) 
+{
+  if (mat.data.size()==0)
+    return DataMatrix2DView<const T>();
+  return DataMatrix2DView<const T>(&mat.data[0], mat.rows, mat.cols);
+}
+
+
+
+/*********************** INLINE METHODES **************************/
+
+template <class T>
+DataMatrix2DView<T>::DataMatrix2DView(T *_data, int _rows, int _cols, size_t _elem_step, size_t _row_step)
+ : rows(_rows), cols(_cols), data((unsigned char*)_data), elem_step(_elem_step), row_step(_row_step)
+{
+  if (row_step==0)
+    row_step = cols*elem_step;
+}
+
+template <class T>
+DataMatrix2DView<T>::DataMatrix2DView(DataMatrix2D<T> &mat)
+ : rows(mat.rows), cols(mat.cols), data(0), elem_step(sizeof(T)), row_step(mat.cols*sizeof(T))
+{
+  if (mat.data.size()>0)
+    data = (unsigned char*)&mat.data[0];
+}
+
+template <class T>
+inline T& DataMatrix2DView<T>::operator()(int row, int col) const
+{
+  return *(T*)(data + row*row_step + col*elem_step);
+}
+
+template <class T>
+inline T& DataMatrix2DView<T>::operator[](int i) const
+{
+  return operator()(i/cols, i%cols);
+}
+
+/**
+ * copyTo
+ * copies the viewed elements to a continuous matrix
+ */
+template <class T> template <class T2>
+void DataMatrix2DView<T>::copyTo(DataMatrix2D<T2> &mat) const
+{
+  mat.resize(rows, cols);
+
+  int z=0;
+  for (int v=0; v<rows; v++)
+  {
+    const unsigned char *d = data + v*row_step;
+    for (int u=0; u<cols; u++, z++, d+=elem_step)
+      mat.data[z] = *(const T*)d;
+  }
+}
+
+
+} //--END--
+
+#endif
+
@@ -17,6 +17,48 @@ using namespace std;
 
 double ImageTransformRANSAC::SQRT2 = sqrt(2.);
 
+
+/**
+ * ImageTransformProblem
+ * similarity, affine or homography samples for PreemptiveRANSAC
+ */
+class ImageTransformProblem
+{
+public:
+  typedef Eigen::Matrix3f Hypothesis;
+
+  ImageTransformRANSAC &imt;
+  int type;
+  const std::vector<Eigen::Vector2f,Eigen::aligned_allocator<Eigen::Vector2f> > &src_pts;
+  const std::vector<Eigen::Vector2f,Eigen::aligned_allocator<Eigen::Vector2f> > &tgt_pts;
+  float sqr_inl_dist;
+
+  ImageTransformProblem(ImageTransformRANSAC &_imt, int _type,
+        const std::vector<Eigen::Vector2f,Eigen::aligned_allocator<Eigen::Vector2f> > &_src_pts,
+        const std::vector<Eigen::Vector2f,Eigen::aligned_allocator<Eigen::Vector2f> > &_tgt_pts, float _sqr_inl_dist)
+   : imt(_imt), type(_type), src_pts(_src_pts), tgt_pts(_tgt_pts), sqr_inl_dist(_sqr_inl_dist) {}
+
+  int getSampleSize() const { return type; }
+  int getNumberOfData() const { return src_pts.size(); }
+
+  bool estimate(const std::vector<int> &sample, Hypothesis &h) const
+  {
+    if (type==ImageTransformRANSAC::SIMILARITY)
+      imt.estimateSimilarityLS(src_pts, sample, tgt_pts, sample, h);
+    else if (type==ImageTransformRANSAC::AFFINE)
+      imt.estimateAffineLS(src_pts, sample, tgt_pts, sample, h);
+    else imt.estimateHomographyLS(src_pts, sample, tgt_pts, sample, h);
+    return true;
+  }
+
+  /** same distance as ImageTransformRANSAC::getDistances **/
+  bool isInlier(const Hypothesis &h, int idx) const
+  {
+    return ((h.topLeftCorner<2,2>()*src_pts[idx] + h.block<2,1>(0,2) - tgt_pts[idx]).squaredNorm() < sqr_inl_dist);
+  }
+};
+
+
 /********************** ImageTransformRANSAC ************************
  * Constructor/Destructor
  */
@@ -36,22 +78,6 @@ ImageTransformRANSAC::~ImageTransformRANSAC()
 
 
 
-/**
- * GetRandIdx
- */
-void ImageTransformRANSAC::getRandIdx(int size, int num, std::vector<int> &idx)
-{
-  int temp;
-  idx.clear();
-  for (int i=0; i<num; i++)
-  {
-    do{
-      temp = rand()%size;
-    }while(contains(idx,temp));
-    idx.push_back(temp);
-  }
-}
-
 /**
  * GetDistances
  */
@@ -74,23 +100,6 @@ void ImageTransformRANSAC::getDistances(
   }
 }
 
-/**
- * CountInliers
- */
-unsigned ImageTransformRANSAC::countInliers(std::vector<float> &dists)
-{
-  unsigned cnt=0;
-  float sqr_dist = (float)param.inl_dist*param.inl_dist;
-
-  for (unsigned i = 0; i < dists.size(); i++)
-  {
-    if (dists[i] < sqr_dist)
-      cnt++;
-  }
-
-  return cnt;
-}
-
 /**
  * GetInliers
  */
@@ -142,6 +151,26 @@ void  ImageTransformRANSAC::normalizePoints(const std::vector<Eigen::Vector2d,Ei
 
 
 
+/**
+ * ransac
+ * returns the number of inliers of the best transformation
+ */
+int ImageTransformRANSAC::ransac(int type,
+        const std::vector<Eigen::Vector2f,Eigen::aligned_allocator<Eigen::Vector2f> > &src_pts,
+        const std::vector<Eigen::Vector2f,Eigen::aligned_allocator<Eigen::Vector2f> > &tgt_pts,
+        Eigen::Matrix3f &transform, int &nb_trials)
+{
+  PreemptiveRANSAC<ImageTransformProblem> ransac( PreemptiveRANSAC<ImageTransformProblem>::Parameter(
+        param.eta_ransac, param.max_rand_trials, param.nb_hypotheses_batch, param.nb_points_block, param.prosac,
+        param.nb_threads, param.seed) );
+  ImageTransformProblem problem(*this, type, src_pts, tgt_pts, (float)param.inl_dist*param.inl_dist);
+
+  return ransac.compute(problem, transform, nb_trials);
+}
+
+
+
+
 /************************** PUBLIC *************************/
 /**
  * @brief ImageTransformRANSAC::estimateSimilarityLS
@@ -524,35 +553,11 @@ void ImageTransformRANSAC::ransacSimilarity(
   if (src_pts.size()<3 || src_pts.size()!=tgt_pts.size())
     throw std::runtime_error("[ImageTransformRANSAC::ransacSimilarity] Invalide points!");
 
-  // int ransac
   int k=0;
-  float sig=2., sv_sig=0.;
-  float eps = sig/(float)src_pts.size();
-  std::vector<int> idx_keys;
-  Eigen::Matrix3f tmpT;
+  float sv_sig=0.;
   std::vector<float> dists(src_pts.size());
 
-  //ransac pose
-  while (pow(1. - pow(eps,2), k) >= param.eta_ransac && k < (int)param.max_rand_trials)
-  {
-
-    getRandIdx(src_pts.size(), 2, idx_keys);
-
-    estimateSimilarityLS(src_pts, idx_keys, tgt_pts, idx_keys, tmpT);
-
-    getDistances(src_pts, tgt_pts, tmpT, dists);
-    sig = countInliers(dists);
-
-    if (sig > sv_sig)
-    {
-      sv_sig = sig;
-      transform = tmpT;
-
-      eps = sv_sig / (float)src_pts.size();
-    }
-
-    k++;
-  }
+  sv_sig = ransac(SIMILARITY, src_pts, tgt_pts, transform, k);
 
   inliers.clear();
   if (sv_sig>2.1)
@@ -586,35 +591,11 @@ void ImageTransformRANSAC::ransacAffine(
   if (src_pts.size()<4 || src_pts.size()!=tgt_pts.size())
     throw std::runtime_error("[ImageTransformRANSAC::ransacAffine] Invalide points!");
 
-  // int ransac
   int k=0;
-  float sig=3., sv_sig=0.;
-  float eps = sig/(float)src_pts.size();
-  std::vector<int> idx_keys;
-  Eigen::Matrix3f tmpT;
+  float sv_sig=0.;
   std::vector<float> dists(src_pts.size());
 
-  //ransac pose
-  while (pow(1. - pow(eps,3), k) >= param.eta_ransac && k < (int)param.max_rand_trials)
-  {
-
-    getRandIdx(src_pts.size(), 3, idx_keys);
-
-    estimateAffineLS(src_pts, idx_keys, tgt_pts, idx_keys, tmpT);
-
-    getDistances(src_pts, tgt_pts, tmpT, dists);
-    sig = countInliers(dists);
-
-    if (sig > sv_sig)
-    {
-      sv_sig = sig;
-      transform = tmpT;
-
-      eps = sv_sig / (float)src_pts.size();
-    }
-
-    k++;
-  }
+  sv_sig = ransac(AFFINE, src_pts, tgt_pts, transform, k);
 
   inliers.clear();
   if (sv_sig>3.1)
@@ -648,35 +629,11 @@ void ImageTransformRANSAC::ransacHomography(
   if (src_pts.size()<5 || src_pts.size()!=tgt_pts.size())
     throw std::runtime_error("[ImageTransformRANSAC::ransacHomography] Invalide points!");
 
-  // int ransac
   int k=0;
-  float sig=4., sv_sig=0.;
-  float eps = sig/(float)src_pts.size();
-  std::vector<int> idx_keys;
-  Eigen::Matrix3f tmpT;
+  float sv_sig=0.;
   std::vector<float> dists(src_pts.size());
 
-  //ransac pose
-  while (pow(1. - pow(eps,4), k) >= param.eta_ransac && k < (int)param.max_rand_trials)
-  {
-
-    getRandIdx(src_pts.size(), 4, idx_keys);
-
-    estimateHomographyLS(src_pts, idx_keys, tgt_pts, idx_keys, tmpT);
-
-    getDistances(src_pts, tgt_pts, tmpT, dists);
-    sig = countInliers(dists);
-
-    if (sig > sv_sig)
-    {
-      sv_sig = sig;
-      transform = tmpT;
-
-      eps = sv_sig / (float)src_pts.size();
-    }
-
-    k++;
-  }
+  sv_sig = ransac(HOMOGRAPHY, src_pts, tgt_pts, transform, k);
 
   inliers.clear();
   if (sv_sig>4.1)
@@ -15,6 +15,41 @@ namespace kp
 using namespace std;
 
 
+/**
+ * PlaneProblem
+ * 3 point samples for PreemptiveRANSAC, hypothesis is a point and the normal
+ */
+class PlaneProblem
+{
+public:
+  typedef Eigen::Matrix<float,3,2> Hypothesis;
+
+  PlaneEstimationRANSAC &pe;
+  const std::vector<Eigen::Vector3f> &pts;
+  float inl_dist;
+
+  PlaneProblem(PlaneEstimationRANSAC &_pe, const std::vector<Eigen::Vector3f> &_pts, float _inl_dist)
+   : pe(_pe), pts(_pts), inl_dist(_inl_dist) {}
+
+  int getSampleSize() const { return 3; }
+  int getNumberOfData() const { return pts.size(); }
+
+  bool estimate(const std::vector<int> &sample, Hypothesis &h) const
+  {
+    Eigen::Vector3f n;
+    pe.explicitToNormal(pts[sample[0]], pts[sample[1]], pts[sample[2]], n);
+    h.col(0) = pts[sample[0]];
+    h.col(1) = n;
+    return !isnan(n[0]);
+  }
+
+  bool isInlier(const Hypothesis &h, int idx) const
+  {
+    return (fabs((pts[idx]-h.col(0)).dot(h.col(1))) < inl_dist);
+  }
+};
+
+
 /********************** PlaneEstimationRANSAC ************************
  * Constructor/Destructor
  */
@@ -34,22 +69,6 @@ PlaneEstimationRANSAC::~PlaneEstimationRANSAC()
 
 
 
-/**
- * GetRandIdx
- */
-void PlaneEstimationRANSAC::getRandIdx(int size, int num, std::vector<int> &idx)
-{
-  int temp;
-  idx.clear();
-  for (int i=0; i<num; i++)
-  {
-    do{
-      temp = rand()%size;
-    }while(contains(idx,temp));
-    idx.push_back(temp);
-  }
-}
-
 /**
  * GetDistances
  */
@@ -63,22 +82,6 @@ void PlaneEstimationRANSAC::getDistances(const std::vector<Eigen::Vector3f> &pts
   }
 }
 
-/**
- * countInliers
- */
-unsigned PlaneEstimationRANSAC::countInliers(std::vector<float> &dists)
-{
-  unsigned cnt=0;
-
-  for (unsigned i = 0; i < dists.size(); i++)
-  {
-    if (dists[i] < param.inl_dist)
-      cnt++; 
-  }
-
-  return cnt;
-}
-
 /**
  * GetInliers
  */
@@ -98,34 +101,22 @@ void PlaneEstimationRANSAC::getInliers(std::vector<float> &dists, std::vector<in
  */
 void PlaneEstimationRANSAC::ransac(const std::vector<Eigen::Vector3f> &pts, Eigen::Vector3f &pt, Eigen::Vector3f &n, std::vector<int> &inliers)
 {
-  // int ransac
   int k=0;
-  float sig=3., sv_sig=0.;
-  float eps = sig/(float)pts.size();
-  std::vector<int> idx_keys;
-  Eigen::Vector3f tmp_n;
+  float sv_sig=0.;
   std::vector<float> dists(pts.size());
+  PlaneProblem::Hypothesis plane;
 
-  //ransac pose
-  while (pow(1. - pow(eps,3), k) >= param.eta_ransac && k < (int)param.max_rand_trials)
-  {
-    getRandIdx(pts.size(), 3, idx_keys);
+  //ransac plane
+  PreemptiveRANSAC<PlaneProblem> ransac( PreemptiveRANSAC<PlaneProblem>::Parameter(param.eta_ransac,
+        param.max_rand_trials, param.nb_hypotheses_batch, param.nb_points_block, param.prosac, param.nb_threads,
+        param.seed) );
+  PlaneProblem problem(*this, pts, param.inl_dist);
 
-    const Eigen::Vector3f &tmp_pt = pts[idx_keys[0]];
-    explicitToNormal(tmp_pt, pts[idx_keys[1]], pts[idx_keys[2]], tmp_n);    
-  
-    getDistances(pts, tmp_pt, tmp_n, dists);
-    sig = countInliers(dists);
-
-    if (sig > sv_sig)
-    {
-      sv_sig = sig;
-      pt = tmp_pt;
-      n = tmp_n; 
-      eps = sv_sig / (float)pts.size(); 
-    }
-
-    k++;
+  sv_sig = ransac.compute(problem, plane, k);
+  if (sv_sig>0)
+  {
+    pt = plane.col(0);
+    n = plane.col(1);
   }
 
   inliers.clear();
@@ -13,6 +13,7 @@
 #include <stdexcept>
 #include <Eigen/Dense>
 #include "SmartPtr.hpp"
+#include "PreemptiveRANSAC.hpp"
 
 
 
@@ -32,9 +33,17 @@ public:
     double inl_dist;
     double eta_ransac;               // eta for pose ransac
     unsigned max_rand_trials;         // max. number of trials for pose ransac
-
-    Parameter(double _inl_dist=0.01, double _eta_ransac=0.01, unsigned _max_rand_trials=10000)
-     : inl_dist(_inl_dist), eta_ransac(_eta_ransac), max_rand_trials(_max_rand_trials) {}
+    int nb_hypotheses_batch;         // hypotheses scored together (preemptive ransac)
+    int nb_points_block;             // preemption block size, 0 scores all hypotheses on all points
+    bool prosac;                     // progressive sampling, points have to be sorted by quality
+    int nb_threads;                  // 0 uses all processors
+    unsigned seed;
+
+    Parameter(double _inl_dist=0.01, double _eta_ransac=0.01, unsigned _max_rand_trials=10000,
+        int _nb_hypotheses_batch=1, int _nb_points_block=0, bool _prosac=false, int _nb_threads=0, unsigned _seed=1)
+     : inl_dist(_inl_dist), eta_ransac(_eta_ransac), max_rand_trials(_max_rand_trials),
+       nb_hypotheses_batch(_nb_hypotheses_batch), nb_points_block(_nb_points_block), prosac(_prosac),
+       nb_threads(_nb_threads), seed(_seed) {}
   };
 
 private:
@@ -42,14 +51,11 @@ private:
   void computeCovarianceMatrix (const std::vector<Eigen::Vector3f> &pts, 
         const std::vector<int> &indices, const Eigen::Vector3f &mean, Eigen::Matrix3f &cov);
   void getInliers(std::vector<float> &dists, std::vector<int> &inliers);
-  unsigned countInliers(std::vector<float> &dists);
   void getDistances(const std::vector<Eigen::Vector3f> &pts, 
         const Eigen::Vector3f &pt, const Eigen::Vector3f &n, std::vector<float> &dists);
-  void getRandIdx(int size, int num, std::vector<int> &idx);
   void ransac(const std::vector<Eigen::Vector3f> &pts,
         Eigen::Vector3f &pt, Eigen::Vector3f &n, std::vector<int> &inliers);
 
-  inline bool contains(const std::vector<int> &idx, int num);
   inline float sqr(const float &d) {return d*d;}
 
 
@@ -86,13 +92,6 @@ public:
 
 
 /*********************** INLINE METHODES **************************/
-inline bool PlaneEstimationRANSAC::contains(const std::vector<int> &idx, int num)
-{
-  for (unsigned i=0; i<idx.size(); i++)
-    if (idx[i]==num)
-      return true;
-  return false;
-}
 
 /**
  * explicitToImplicit
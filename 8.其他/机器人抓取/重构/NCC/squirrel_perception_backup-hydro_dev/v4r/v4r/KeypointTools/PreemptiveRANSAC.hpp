@@ -0,0 +1,315 @@
+/*
+ * PreemptiveRANSAC.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef KP_PREEMPTIVE_RANSAC_HPP
+#define KP_PREEMPTIVE_RANSAC_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include "SeededRandom.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+namespace kp
+{
+
+/**
+ * PreemptiveRANSAC
+ * Hypothesize-and-verify core shared by the RANSAC estimators of KeypointTools.
+ * Hypotheses are generated in batches (in parallel) and scored preemptively: all hypotheses
+ * of a batch are scored on a block of data points (in random order), then only the better half
+ * is kept for the next block (Nister, "Preemptive RANSAC"), the last one is scored on all data.
+ * The number of batches follows the usual adaptive termination with eta and max_rand_trials.
+ * The default parameters (one hypothesis per batch, no preemption) give the plain sequential
+ * RANSAC, nb_hypotheses_batch and nb_points_block have to be set for the preemptive scoring.
+ * With prosac=true the data has to be sorted by quality (best first) and samples are drawn
+ * progressively from the best points (Chum and Matas, "PROSAC").
+ * Every hypothesis draws its sample with its own generator seeded from (seed, hypothesis number)
+ * and ties are broken by the hypothesis number, so the result only depends on the seed and not
+ * on the number of threads.
+ *
+ * The problem has to provide (const and thread safe):
+ *   typedef ... Hypothesis;
+ *   int getSampleSize() const;
+ *   int getNumberOfData() const;
+ *   bool estimate(const std::vector<int> &sample, Hypothesis &h) const;
+ *   bool isInlier(const Hypothesis &h, int idx) const;
+ */
+template<class Problem>
+class PreemptiveRANSAC
+{
+public:
+  typedef typename Problem::Hypothesis Hypothesis;
+
+  class Parameter
+  {
+  public:
+    double eta_ransac;               // eta for adaptive termination
+    unsigned max_rand_trials;        // max. number of hypotheses
+    int nb_hypotheses_batch;         // hypotheses generated and scored together
+    int nb_points_block;             // preemption block size (data points), 0 scores all hypotheses on all data
+    bool prosac;                     // progressive sampling, data sorted by quality
+    int nb_threads;                  // 0 uses all processors
+    unsigned seed;
+
+    Parameter(double _eta_ransac=0.01, unsigned _max_rand_trials=10000, int _nb_hypotheses_batch=1,
+        int _nb_points_block=0, bool _prosac=false, int _nb_threads=0, unsigned _seed=1)
+     : eta_ransac(_eta_ransac), max_rand_trials(_max_rand_trials), nb_hypotheses_batch(_nb_hypotheses_batch),
+       nb_points_block(_nb_points_block), prosac(_prosac), nb_threads(_nb_threads), seed(_seed) {}
+  };
+
+private:
+  // prosac schedule
+  int n_prosac;
+  int T_n_prime;
+  double T_n;
+
+  void initProsac(int sample_size, int nb_data);
+  void nextProsac(int t, int sample_size, int nb_data, int &n, bool &use_n);
+  void getSample(SeededRandom &rand, int sample_size, int n, bool use_n, std::vector<int> &sample);
+
+  inline bool contains(const std::vector<int> &idx, int num);
+
+  struct BetterScore
+  {
+    const std::vector<int> &score;
+    BetterScore(const std::vector<int> &_score) : score(_score) {}
+    inline bool operator()(int a, int b) const
+    {
+      return (score[a]>score[b] || (score[a]==score[b] && a<b));
+    }
+  };
+
+public:
+  Parameter param;
+
+  PreemptiveRANSAC(const Parameter &p=Parameter()) : param(p) {}
+  ~PreemptiveRANSAC() {}
+
+  /**
+   * @brief compute best hypothesis
+   * @param problem
+   * @param best best hypothesis (unchanged if no valid hypothesis was found)
+   * @param nb_trials number of generated hypotheses
+   * @return number of inliers of the best hypothesis
+   */
+  int compute(const Problem &problem, Hypothesis &best, int &nb_trials);
+};
+
+
+
+/*********************** INLINE METHODES **************************/
+
+template<class Problem>
+inline bool PreemptiveRANSAC<Problem>::contains(const std::vector<int> &idx, int num)
+{
+  for (unsigned i=0; i<idx.size(); i++)
+    if (idx[i]==num)
+      return true;
+  return false;
+}
+
+/**
+ * initProsac
+ */
+template<class Problem>
+void PreemptiveRANSAC<Problem>::initProsac(int sample_size, int nb_data)
+{
+  n_prosac = sample_size;
+  T_n_prime = 1;
+  T_n = param.max_rand_trials;
+  for (int i=0; i<sample_size; i++)
+    T_n *= (double)(n_prosac-i) / (double)(nb_data-i);
+}
+
+/**
+ * nextProsac
+ * size of the sampling set for hypothesis t (starting with 1) and if point n-1 has to be in the sample
+ */
+template<class Problem>
+void PreemptiveRANSAC<Problem>::nextProsac(int t, int sample_size, int nb_data, int &n, bool &use_n)
+{
+  if (t > T_n_prime && n_prosac < nb_data)
+  {
+    double T_n1 = T_n * (double)(n_prosac+1) / (double)(n_prosac+1-sample_size);
+    n_prosac++;
+    T_n_prime += std::max(1, (int)ceil(T_n1 - T_n));
+    T_n = T_n1;
+  }
+
+  n = n_prosac;
+  use_n = !(T_n_prime < t);
+}
+
+/**
+ * getSample
+ */
+template<class Problem>
+void PreemptiveRANSAC<Problem>::getSample(SeededRandom &rand, int sample_size, int n, bool use_n, std::vector<int> &sample)
+{
+  int temp;
+  sample.clear();
+
+  if (use_n)
+  {
+    sample.push_back(n-1);
+    n--;
+  }
+
+  while ((int)sample.size()<sample_size)
+  {
+    do{
+      temp = rand.uniform(n);
+    }while(contains(sample,temp));
+    sample.push_back(temp);
+  }
+}
+
+/**
+ * compute
+ */
+template<class Problem>
+int PreemptiveRANSAC<Problem>::compute(const Problem &problem, Hypothesis &best, int &nb_trials)
+{
+  int sample_size = problem.getSampleSize();
+  int nb_data = problem.getNumberOfData();
+  int batch = std::max(1, param.nb_hypotheses_batch);
+  int nb_threads = param.nb_threads;
+
+  nb_trials = 0;
+  if (nb_data < sample_size || sample_size<=0)
+    return 0;
+
+#ifdef _OPENMP
+  if (nb_threads<=0)
+    nb_threads = omp_get_num_procs();
+#endif
+  if (nb_threads<=0)
+    nb_threads = 1;
+
+  int k=0, round=0;
+  int best_score=0;
+  float eps = sample_size/(float)nb_data;
+
+  std::vector<Hypothesis, Eigen::aligned_allocator<Hypothesis> > hyps(batch);
+  std::vector<int> score(batch), valid(batch), ns(batch), use_ns(batch);
+  std::vector<int> survivors, order;
+
+  if (param.prosac)
+    initProsac(sample_size, nb_data);
+
+  while (pow(1. - pow(eps,sample_size), k) >= param.eta_ransac && k < (int)param.max_rand_trials)
+  {
+    int nb = std::min(batch, (int)param.max_rand_trials-k);
+
+    // sampling set of each hypothesis, the prosac schedule is sequential
+    for (int j=0; j<nb; j++)
+    {
+      if (param.prosac)
+      {
+        bool use_n;
+        nextProsac(k+j+1, sample_size, nb_data, ns[j], use_n);
+        use_ns[j] = use_n;
+      }
+      else
+      {
+        ns[j] = nb_data;
+        use_ns[j] = false;
+      }
+    }
+
+    // generate hypotheses
+    #pragma omp parallel for num_threads(nb_threads) schedule(dynamic,1) if(nb>1)
+    for (int j=0; j<nb; j++)
+    {
+      std::vector<int> sample;
+      SeededRandom rand(param.seed, k+j);
+      getSample(rand, sample_size, ns[j], use_ns[j], sample);
+      valid[j] = problem.estimate(sample, hyps[j]);
+      score[j] = 0;
+    }
+
+    survivors.clear();
+    for (int j=0; j<nb; j++)
+      if (valid[j]) survivors.push_back(j);
+
+    // random order of the data for the preemptive scoring, without preemption all data is scored as given
+    bool preemptive = (param.nb_points_block>0 && nb>1);
+    if (preemptive)
+    {
+      SeededRandom rand(param.seed, ~(unsigned long long)round);
+      order.resize(nb_data);
+      for (int i=0; i<nb_data; i++)
+        order[i] = i;
+      for (int i=nb_data-1; i>0; i--)
+        std::swap(order[i], order[rand.uniform(i+1)]);
+    }
+
+    int pos=0, nb_blocks=0;
+    while (pos<nb_data && survivors.size()>0)
+    {
+      int end = nb_data;
+      if (param.nb_points_block>0 && survivors.size()>1)
+        end = std::min(pos+param.nb_points_block, nb_data);
+
+      #pragma omp parallel for num_threads(nb_threads) schedule(dynamic,1) if(survivors.size()>1)
+      for (int s=0; s<(int)survivors.size(); s++)
+      {
+        int j = survivors[s];
+        int cnt=0;
+        for (int i=pos; i<end; i++)
+          if (problem.isInlier(hyps[j], preemptive ? order[i] : i))
+            cnt++;
+        score[j] += cnt;
+      }
+
+      pos = end;
+      nb_blocks++;
+
+      // keep nb * 2^-blocks hypotheses
+      if (pos<nb_data && survivors.size()>1)
+      {
+        int nb_keep = std::max(1, nb>>std::min(nb_blocks,30));
+        if (nb_keep < (int)survivors.size())
+        {
+          std::sort(survivors.begin(), survivors.end(), BetterScore(score));
+          survivors.resize(nb_keep);
+        }
+      }
+    }
+
+    // survivors are scored on all data
+    if (survivors.size()>0)
+    {
+      std::sort(survivors.begin(), survivors.end(), BetterScore(score));
+      int j = survivors[0];
+      if (score[j] > best_score)
+      {
+        best_score = score[j];
+        best = hyps[j];
+        eps = best_score / (float)nb_data;
+      }
+    }
+
+    k += nb;
+    round++;
+  }
+
+  nb_trials = k;
+  return best_score;
+}
+
+
+} //--END--
+
+#endif
+
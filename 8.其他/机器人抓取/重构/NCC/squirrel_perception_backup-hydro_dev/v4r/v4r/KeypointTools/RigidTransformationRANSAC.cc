@@ -14,6 +14,40 @@ namespace kp
 using namespace std;
 
 
+/**
+ * RigidTransformationProblem
+ * 4 point samples for PreemptiveRANSAC
+ */
+class RigidTransformationProblem
+{
+public:
+  typedef Eigen::Matrix4f Hypothesis;
+
+  RigidTransformationRANSAC &rt;
+  const std::vector<Eigen::Vector3f > &src_pts;
+  const std::vector<Eigen::Vector3f > &tgt_pts;
+  float sqr_inl_dist;
+
+  RigidTransformationProblem(RigidTransformationRANSAC &_rt, const std::vector<Eigen::Vector3f > &_src_pts,
+        const std::vector<Eigen::Vector3f > &_tgt_pts, float _sqr_inl_dist)
+   : rt(_rt), src_pts(_src_pts), tgt_pts(_tgt_pts), sqr_inl_dist(_sqr_inl_dist) {}
+
+  int getSampleSize() const { return 4; }
+  int getNumberOfData() const { return src_pts.size(); }
+
+  bool estimate(const std::vector<int> &sample, Hypothesis &h) const
+  {
+    rt.estimateRigidTransformationSVD(src_pts, sample, tgt_pts, sample, h);
+    return true;
+  }
+
+  bool isInlier(const Hypothesis &h, int idx) const
+  {
+    return ((h.topLeftCorner<3,3>()*src_pts[idx] + h.block<3,1>(0,3) - tgt_pts[idx]).squaredNorm() < sqr_inl_dist);
+  }
+};
+
+
 /********************** RigidTransformationRANSAC ************************
  * Constructor/Destructor
  */
@@ -33,22 +67,6 @@ RigidTransformationRANSAC::~RigidTransformationRANSAC()
 
 
 
-/**
- * GetRandIdx
- */
-void RigidTransformationRANSAC::GetRandIdx(int size, int num, std::vector<int> &idx)
-{
-  int temp;
-  idx.clear();
-  for (int i=0; i<num; i++)
-  {
-    do{
-      temp = rand()%size;
-    }while(Contains(idx,temp));
-    idx.push_back(temp);
-  }
-}
-
 /**
  * GetDistances
  */
@@ -70,23 +88,6 @@ void RigidTransformationRANSAC::GetDistances(
   }
 }
 
-/**
- * CountInliers
- */
-unsigned RigidTransformationRANSAC::CountInliers(std::vector<float> &dists)
-{
-  unsigned cnt=0;
-  float sqrDist = (float)param.inl_dist*param.inl_dist;
-
-  for (unsigned i = 0; i < dists.size(); i++)
-  {
-    if (dists[i] < sqrDist)
-      cnt++;
-  }
-
-  return cnt;
-}
-
 /**
  * GetInliers
  */
@@ -112,35 +113,17 @@ void RigidTransformationRANSAC::Ransac(
       Eigen::Matrix4f &transform,
       std::vector<int> &inliers)
 {
-  // int ransac
   int k=0;
-  float sig=3., svSig=0.;
-  float eps = sig/(float)srcPts.size();
-  std::vector<int> idxKeys;
-  Eigen::Matrix4f tmpRT;
+  float svSig=0.;
   std::vector<float> dists(srcPts.size());
 
   //ransac pose
-  while (pow(1. - pow(eps,4), k) >= param.eta_ransac && k < (int)param.max_rand_trials)
-  {
-
-    GetRandIdx(srcPts.size(), 4, idxKeys);
+  PreemptiveRANSAC<RigidTransformationProblem> ransac( PreemptiveRANSAC<RigidTransformationProblem>::Parameter(
+        param.eta_ransac, param.max_rand_trials, param.nb_hypotheses_batch, param.nb_points_block, param.prosac,
+        param.nb_threads, param.seed) );
+  RigidTransformationProblem problem(*this, srcPts, tgtPts, (float)param.inl_dist*param.inl_dist);
 
-    estimateRigidTransformationSVD(srcPts, idxKeys, tgtPts, idxKeys, tmpRT);
-
-    GetDistances(srcPts, tgtPts, tmpRT, dists);
-    sig = CountInliers(dists);
-
-    if (sig > svSig)
-    {
-      svSig = sig;
-      transform = tmpRT;
-      
-      eps = svSig / (float)srcPts.size(); 
-    }
-
-    k++;
-  }
+  svSig = ransac.compute(problem, transform, k);
 
   inliers.clear();
   if (svSig>3.1)
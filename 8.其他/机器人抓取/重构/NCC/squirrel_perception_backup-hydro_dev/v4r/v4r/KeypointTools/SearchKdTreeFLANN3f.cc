@@ -7,6 +7,7 @@
 
 
 #include "SearchKdTreeFLANN3f.hh"
+#include <omp.h>
 
 
 namespace kp 
@@ -65,6 +66,99 @@ void SearchKdTreeFLANN3f::convertPointsToArray(const std::vector<Eigen::Vector3f
   }
 }
 
+/**
+ * batchSearch
+ * k nearest neighbours if k>0, else radius search. Each thread searches a contiguous block of
+ * queries into its own buffer, the buffers are packed into result afterwards.
+ */
+void SearchKdTreeFLANN3f::batchSearch(const float *points, int nb_points, int k, float sqr_radius, const ::flann::SearchParams &params, BatchResult &result)
+{
+  result.offsets.assign((nb_points>0 ? nb_points+1 : 1), 0);
+
+  if (!data || nb_points<=0 || total_nr_points==0)
+  {
+    result.indices.clear();
+    result.sqr_dists.clear();
+    return;
+  }
+
+  if (k > total_nr_points)
+    k = total_nr_points;
+
+  int nb_threads = omp_get_max_threads();
+  if (nb_threads > nb_points)
+    nb_threads = nb_points;
+
+  #pragma omp parallel num_threads(nb_threads)
+  {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+    int start = (int)(((long)nb_points*tid)/nt);
+    int end = (int)(((long)nb_points*(tid+1))/nt);
+
+    // thread local, so that several threads can batch search the same tree
+    std::vector<int> indices;
+    std::vector<float> sqr_dists;
+    std::vector<std::vector<int> > nn_indices(1);
+    std::vector<std::vector<float> > nn_sqr_dists(1);
+
+    for (int i=start; i<end; i++)
+    {
+      const float *pt = &points[i*dim];
+
+      bool valid = true;
+      for (int j=0; j<dim; j++)
+        if (isnan(pt[j])) valid = false;
+      if (!valid)
+        continue;
+
+      ::flann::Matrix<float> query(const_cast<float*>(pt), 1, dim);
+      int n0 = indices.size();
+      int n;
+
+      if (k>0)
+      {
+        indices.resize(n0+k);
+        sqr_dists.resize(n0+k);
+        ::flann::Matrix<int> k_indices_mat(&indices[n0], 1, k);
+        ::flann::Matrix<float> k_distances_mat(&sqr_dists[n0], 1, k);
+        flann_index->knnSearch(query, k_indices_mat, k_distances_mat, k, params);
+        n = k;
+      }
+      else
+      {
+        n = flann_index->radiusSearch(query, nn_indices, nn_sqr_dists, sqr_radius, params);
+        indices.insert(indices.end(), nn_indices[0].begin(), nn_indices[0].begin()+n);
+        sqr_dists.insert(sqr_dists.end(), nn_sqr_dists[0].begin(), nn_sqr_dists[0].begin()+n);
+      }
+
+      if (!identity_mapping)
+      {
+        for (int j=n0; j<n0+n; j++)
+          indices[j] = index_mapping[indices[j]];
+      }
+
+      result.offsets[i+1] = n;
+    }
+
+    #pragma omp barrier
+    #pragma omp single
+    {
+      for (int i=0; i<nb_points; i++)
+        result.offsets[i+1] += result.offsets[i];
+
+      result.indices.resize(result.offsets[nb_points]);
+      result.sqr_dists.resize(result.offsets[nb_points]);
+    }
+
+    if (indices.size()>0)
+    {
+      std::copy(indices.begin(), indices.end(), result.indices.begin()+result.offsets[start]);
+      std::copy(sqr_dists.begin(), sqr_dists.end(), result.sqr_dists.begin()+result.offsets[start]);
+    }
+  }
+}
+
 
 
 
@@ -93,7 +187,7 @@ void SearchKdTreeFLANN3f::setInputPoints(const std::vector<Eigen::Vector3f> &poi
  */
 void SearchKdTreeFLANN3f::nearestKSearch(const Eigen::Vector3f &pt, int k, std::vector<int> &k_indices, std::vector<float> &k_distances)
 {
-  if (!data || isnan(pt[0]) || isnan(pt[1]) || isnan(pt[2]))
+  if (!data || k<=0 || isnan(pt[0]) || isnan(pt[1]) || isnan(pt[2]))
   {
     k_indices.clear();
     k_distances.clear();
@@ -181,7 +275,7 @@ void SearchKdTreeFLANN3f::radiusSearch(const Eigen::Vector3f &pt, double radius,
  */
 void SearchKdTreeFLANN3f::nearestKSearch(int idx, int k, std::vector<int> &k_indices, std::vector<float> &k_distances)
 {
-  if (idx>=total_nr_points || !data)
+  if (idx>=total_nr_points || !data || k<=0)
   {
     k_indices.clear();
     k_distances.clear();
@@ -257,13 +351,57 @@ void SearchKdTreeFLANN3f::radiusSearch(int idx, double radius, std::vector<int>
 }
 
 
+/**
+ * nearestKSearch (batch)
+ */
+void SearchKdTreeFLANN3f::nearestKSearch(const float *points, int nb_points, int k, BatchResult &result)
+{
+  // batchSearch would take k<=0 for a radius search
+  if (k<=0)
+  {
+    result.offsets.assign((nb_points>0 ? nb_points+1 : 1), 0);
+    result.indices.clear();
+    result.sqr_dists.clear();
+    return;
+  }
+
+  batchSearch(points, nb_points, k, 0., param_k, result);
+}
+
+void SearchKdTreeFLANN3f::nearestKSearch(const std::vector<Eigen::Vector3f> &points, int k, BatchResult &result)
+{
+  nearestKSearch((points.size()>0 ? &points[0][0] : NULL), points.size(), k, result);
+}
+
+/**
+ * radiusSearch (batch)
+ */
+void SearchKdTreeFLANN3f::radiusSearch(const float *points, int nb_points, double radius, BatchResult &result, unsigned int max_nn)
+{
+  ::flann::SearchParams params(param_radius);
+  if (max_nn == 0 || max_nn >= static_cast<unsigned int>(total_nr_points))
+    params.max_neighbors = -1;
+  else
+    params.max_neighbors = max_nn;
+
+  batchSearch(points, nb_points, 0, static_cast<float>(radius*radius), params, result);
+}
+
+void SearchKdTreeFLANN3f::radiusSearch(const std::vector<Eigen::Vector3f> &points, double radius, BatchResult &result, unsigned int max_nn)
+{
+  radiusSearch((points.size()>0 ? &points[0][0] : NULL), points.size(), radius, result, max_nn);
+}
+
 /**
  * clean
  */
 void SearchKdTreeFLANN3f::clean()
 {
   if (flann_index)
+  {
     delete flann_index;
+    flann_index = NULL;
+  }
 
   if (data)
   {
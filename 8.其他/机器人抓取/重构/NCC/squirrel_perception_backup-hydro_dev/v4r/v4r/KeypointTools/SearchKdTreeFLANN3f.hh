@@ -36,6 +36,21 @@ public:
     : sorted(_sorted), epsilon(_epsilon) {}
   };
 
+  /**
+   * Packed results of a batch query: the neighbours of query i are stored in
+   * indices/sqr_dists [offsets[i], offsets[i+1])
+   */
+  class BatchResult
+  {
+  public:
+    std::vector<int> offsets;
+    std::vector<int> indices;
+    std::vector<float> sqr_dists;
+
+    inline int size() const { return (offsets.size()>0 ? offsets.size()-1 : 0); }
+    inline int size(int i) const { return offsets[i+1]-offsets[i]; }
+  };
+
   typedef ::flann::Index< ::flann::L2_Simple<float> > FLANNIndex;
   typedef SmartPtr< ::kp::SearchKdTreeFLANN3f > Ptr;
   typedef SmartPtr< ::kp::SearchKdTreeFLANN3f const> ConstPtr;
@@ -56,6 +71,8 @@ private:
   ::flann::SearchParams param_radius;
 
   void convertPointsToArray(const std::vector<Eigen::Vector3f> &points);
+  void batchSearch(const float *points, int nb_points, int k, float sqr_radius, 
+        const ::flann::SearchParams &params, BatchResult &result);
 
 
 public:
@@ -72,6 +89,15 @@ public:
   void radiusSearch(int idx, double radius,
         std::vector<int> &k_indices, std::vector<float> &k_sqr_dists, unsigned int max_nn=0);
 
+  /** batch queries of nb_points contiguous points (3 floats each), multithreaded (also safe to call concurrently on the same tree), k<=0 gives empty results */
+  void nearestKSearch(const float *points, int nb_points, int k, BatchResult &result);
+  void nearestKSearch(const std::vector<Eigen::Vector3f> &points, int k, BatchResult &result);
+
+  void radiusSearch(const float *points, int nb_points, double radius, BatchResult &result, 
+        unsigned int max_nn=0);
+  void radiusSearch(const std::vector<Eigen::Vector3f> &points, double radius, BatchResult &result, 
+        unsigned int max_nn=0);
+
 
 
   SearchKdTreeFLANN3f(const Parameter &p=Parameter());
@@ -0,0 +1,59 @@
+/*
+ * SeededRandom.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef KP_SEEDED_RANDOM_HPP
+#define KP_SEEDED_RANDOM_HPP
+
+
+namespace kp
+{
+
+/**
+ * SeededRandom
+ * small xorshift64* generator with splitmix64 seeding from (seed, stream).
+ * Parallel loops give each item (hypothesis, sample, ...) its own stream, so the random numbers
+ * of an item do not depend on the thread computing it.
+ */
+class SeededRandom
+{
+private:
+  unsigned long long state;
+
+public:
+  SeededRandom(unsigned long long seed, unsigned long long stream)
+  {
+    // splitmix64 of seed and stream, the state must not be 0
+    state = seed*0x9E3779B97F4A7C15ULL + stream + 1;
+    state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    state = (state ^ (state >> 27)) * 0x94D049BB133111EBULL;
+    state = state ^ (state >> 31);
+    if (state==0) state = 0x9E3779B97F4A7C15ULL;
+  }
+
+  inline unsigned long long next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+  }
+
+  /** uniform in [0, size) **/
+  inline int uniform(int size)
+  {
+    return (int)((next()>>11) % (unsigned long long)size);
+  }
+
+  /** uniform in [0, 1) **/
+  inline double uniform()
+  {
+    return (double)(next()>>11) * (1.0/9007199254740992.0);
+  }
+};
+
+} //--END--
+
+#endif
@@ -12,6 +12,7 @@
 #include <opencv2/core/core.hpp>
 #include <stdexcept>
 #include "DataMatrix2D.hpp"
+#include "DataMatrix2DView.hpp"
 #include "PointTypes.hpp"
 
 
@@ -19,28 +20,36 @@ namespace kp
 {
 
 
-void convertImage(const DataMatrix2D<PointXYZRGB> &cloud, cv::Mat &image)
+/**
+ * convertImage
+ * bgr image of an organized cloud, the view can also point into a pcl::PointCloud (see KeypointConversions/cloudViews.hpp)
+ */
+inline void convertImage(const DataMatrix2DView<const PointXYZRGB> &cloud, cv::Mat &image)
 {
   if (cloud.rows<=1)
     throw std::runtime_error("[convertCloudToImage] Need an organized point cloud!");
 
   image = cv::Mat_<cv::Vec3b>(cloud.rows, cloud.cols);
 
-  int z=0;
   for (int v = 0; v < cloud.rows; v++) 
   {
-    for (int u = 0; u < cloud.cols; u++,z++) 
+    cv::Vec3b *cv_pt = image.ptr<cv::Vec3b>(v);
+    for (int u = 0; u < cloud.cols; u++, cv_pt++) 
     {
-      cv::Vec3b &cv_pt = image.at<cv::Vec3b> (v, u);
-      const PointXYZRGB &pt = cloud.data[z];
+      const PointXYZRGB &pt = cloud(v,u);
 
-      cv_pt[2] = pt.r;
-      cv_pt[1] = pt.g;
-      cv_pt[0] = pt.b;
+      (*cv_pt)[2] = pt.r;
+      (*cv_pt)[1] = pt.g;
+      (*cv_pt)[0] = pt.b;
     }
   }
 }
 
+inline void convertImage(const DataMatrix2D<PointXYZRGB> &cloud, cv::Mat &image)
+{
+  convertImage(getView(cloud), image);
+}
+
 
 
 } //--END--
@@ -64,11 +64,10 @@ namespace faat_pcl
 
           //compute signatures
           typedef typename pcl::SHOTColorEstimation<PointInT, pcl::Normal, pcl::SHOT1344> SHOTEstimator;
-          typename pcl::search::KdTree<PointInT>::Ptr tree (new pcl::search::KdTree<PointInT>);
 
           pcl::PointCloud<pcl::SHOT1344>::Ptr shots (new pcl::PointCloud<pcl::SHOT1344>);
           SHOTEstimator shot_estimate;
-          shot_estimate.setSearchMethod (tree);
+          this->setCachedSearch (shot_estimate, keypoints);
           shot_estimate.setInputNormals (normals);
           shot_estimate.setInputCloud (keypoints);
           shot_estimate.setSearchSurface(processed);
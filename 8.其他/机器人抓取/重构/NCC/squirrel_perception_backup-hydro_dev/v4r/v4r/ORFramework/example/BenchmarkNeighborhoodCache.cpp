@@ -0,0 +1,280 @@
+/*
+ * BenchmarkNeighborhoodCache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits>
+
+#include <pcl/point_types.h>
+#include <pcl/common/time.h>
+#include <pcl/common/centroid.h>
+#include <pcl/common/io.h>
+#include <pcl/common/eigen.h>
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/features/shot_omp.h>
+#include <pcl/keypoints/uniform_sampling.h>
+#include <pcl/search/organized.h>
+
+#include "v4r/ORFramework/keypoint_neighborhood_cache.h"
+
+// This program compares the keypoint neighbourhoods of the planarity filter and of SHOT-OMP
+// searched for each stage (as before the KeypointNeighborhoodCache) with the cached ones,
+// on a synthetic 640x480 scene
+
+typedef pcl::PointXYZ PointT;
+
+void printUsage(const char *argv0)
+{
+  printf(
+    "Times the radius searches of the planarity filter and SHOT with and without KeypointNeighborhoodCache\n"
+    "usage: %s [support_radius] [sampling_density] [runs]\n"
+    "  support_radius   ... radius of the neighbourhoods [m] (default 0.04)\n"
+    "  sampling_density ... uniform sampling of the keypoints [m] (default 0.01)\n"
+    "  runs             ... number of runs, the times are averaged (default 5)\n", argv0);
+  printf(" Example: %s 0.04 0.01 5\n",argv0);
+}
+
+// table plane seen from above with spheres on it, 525px focal length, 1mm depth noise
+void createScene(pcl::PointCloud<PointT> &cloud)
+{
+  const int width = 640;
+  const int height = 480;
+  const float f = 525.f;
+  const float cx = 319.5f;
+  const float cy = 239.5f;
+
+  // plane n.x = d, tilted by 30 degrees around the x axis
+  const Eigen::Vector3f n(0.f, -sin(M_PI/6.), -cos(M_PI/6.));
+  const float d = -1.f;
+
+  const int nr_spheres = 6;
+  Eigen::Vector3f centers[nr_spheres];
+  float radii[nr_spheres];
+  for(int s = 0; s < nr_spheres; s++)
+  {
+    radii[s] = 0.04f + 0.02f * (s % 3);
+    Eigen::Vector3f on_plane(-0.3f + 0.12f * s, -0.1f + 0.08f * (s % 2), 0.f);
+    on_plane[2] = (d - n[1]*on_plane[1]) / n[2];
+    centers[s] = on_plane - n * radii[s];
+  }
+
+  cloud.width = width;
+  cloud.height = height;
+  cloud.is_dense = false;
+  cloud.points.resize(width*height);
+
+  srand(0);
+  for(int v = 0; v < height; v++)
+  {
+    for(int u = 0; u < width; u++)
+    {
+      Eigen::Vector3f ray((u - cx) / f, (v - cy) / f, 1.f);
+      float t = std::numeric_limits<float>::infinity();
+
+      float denom = n.dot(ray);
+      if(fabs(denom) > 1e-6)
+      {
+        float tp = d / denom;
+        if(tp > 0.f)
+          t = tp;
+      }
+
+      for(int s = 0; s < nr_spheres; s++)
+      {
+        // |t*ray - c|^2 = r^2
+        float a = ray.dot(ray);
+        float b = -2.f * ray.dot(centers[s]);
+        float c = centers[s].dot(centers[s]) - radii[s]*radii[s];
+        float disc = b*b - 4.f*a*c;
+        if(disc < 0.f)
+          continue;
+        float ts = (-b - sqrt(disc)) / (2.f*a);
+        if( (ts > 0.f) && (ts < t) )
+          t = ts;
+      }
+
+      PointT &p = cloud.at(u,v);
+      if( (!pcl_isfinite(t)) || (t > 3.f) )
+      {
+        p.x = p.y = p.z = std::numeric_limits<float>::quiet_NaN();
+        continue;
+      }
+
+      float noise = 0.002f * (static_cast<float>(rand()) / RAND_MAX - 0.5f);
+      p.getVector3fMap() = ray * (t + noise);
+    }
+  }
+}
+
+bool isNonPlanar(const Eigen::Vector3f &eigenValues, float threshold_planar)
+{
+  float eigsum = eigenValues.sum();
+  return (fabs(eigenValues[0] - eigenValues[1]) < 1.5e-4) || (eigsum != 0 && fabs(eigenValues[0] / eigsum) > threshold_planar);
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 4)
+  {
+    printUsage(argv[0]);
+    return(0);
+  }
+
+  float support_radius = (argc > 1 ? atof(argv[1]) : 0.04f);
+  float sampling_density = (argc > 2 ? atof(argv[2]) : 0.01f);
+  int runs = (argc > 3 ? atoi(argv[3]) : 5);
+  if( (support_radius <= 0.f) || (sampling_density <= 0.f) || (runs < 1) )
+  {
+    printUsage(argv[0]);
+    return(0);
+  }
+  const float threshold_planar = 1.e-2;
+
+  pcl::PointCloud<PointT>::Ptr cloud(new pcl::PointCloud<PointT>);
+  createScene(*cloud);
+
+  pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
+  pcl::IntegralImageNormalEstimation<PointT, pcl::Normal> ne;
+  ne.setNormalEstimationMethod(ne.COVARIANCE_MATRIX);
+  ne.setMaxDepthChangeFactor(0.02f);
+  ne.setNormalSmoothingSize(10.0f);
+  ne.setInputCloud(cloud);
+  ne.compute(*normals);
+
+  pcl::PointCloud<int> sampled;
+  pcl::UniformSampling<PointT> us;
+  us.setRadiusSearch(sampling_density);
+  us.setInputCloud(cloud);
+  us.compute(sampled);
+  std::vector<int> candidates(sampled.points.begin(), sampled.points.end());
+
+  printf("scene: %dx%d, %d keypoint candidates, support radius %.3f, %d runs\n",
+         (int)cloud->width, (int)cloud->height, (int)candidates.size(), support_radius, runs);
+
+  double uncached_filter = 0, uncached_shot = 0, cached_filter = 0, cached_shot = 0, cached_search = 0;
+  size_t cached_searches = 0, cached_lookups = 0;
+  std::vector<int> keypoints_uncached, keypoints_cached;
+  pcl::PointCloud<pcl::SHOT352> shots_uncached, shots_cached;
+
+  for(int r = 0; r < runs; r++)
+  {
+    // uncached: one search per keypoint in the filter, SHOT searches again (reference frame and descriptor)
+    {
+      pcl::StopWatch watch;
+      pcl::search::OrganizedNeighbor<PointT> tree;
+      tree.setInputCloud(cloud);
+      keypoints_uncached.clear();
+      std::vector<int> indices;
+      std::vector<float> distances;
+      for(size_t i = 0; i < candidates.size(); i++)
+      {
+        if(!tree.radiusSearch(cloud->points[candidates[i]], support_radius, indices, distances))
+          continue;
+
+        EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
+        Eigen::Vector4f xyz_centroid;
+        EIGEN_ALIGN16 Eigen::Vector3f eigenValues;
+        EIGEN_ALIGN16 Eigen::Matrix3f eigenVectors;
+        pcl::computeMeanAndCovarianceMatrix(*cloud, indices, covariance_matrix, xyz_centroid);
+        pcl::eigen33(covariance_matrix, eigenVectors, eigenValues);
+        if(isNonPlanar(eigenValues, threshold_planar))
+          keypoints_uncached.push_back(candidates[i]);
+      }
+      uncached_filter += watch.getTime();
+
+      pcl::PointCloud<PointT>::Ptr keypoints(new pcl::PointCloud<PointT>);
+      pcl::copyPointCloud(*cloud, keypoints_uncached, *keypoints);
+
+      watch.reset();
+      pcl::SHOTEstimationOMP<PointT, pcl::Normal, pcl::SHOT352> shot_estimate;
+      shot_estimate.setInputCloud(keypoints);
+      shot_estimate.setSearchSurface(cloud);
+      shot_estimate.setInputNormals(normals);
+      shot_estimate.setRadiusSearch(support_radius);
+      shot_estimate.compute(shots_uncached);
+      uncached_shot += watch.getTime();
+    }
+
+    // cached: the filter searches in parallel, SHOT takes neighbourhoods and reference frames from the cache
+    {
+      pcl::StopWatch watch;
+      faat_pcl::rec_3d_framework::KeypointNeighborhoodCache<PointT>::Ptr cache(new faat_pcl::rec_3d_framework::KeypointNeighborhoodCache<PointT>);
+      cache->setInputCloud(cloud);
+      cache->setRadius(support_radius);
+      cache->compute(candidates);
+      keypoints_cached.clear();
+      for(size_t i = 0; i < candidates.size(); i++)
+      {
+        const faat_pcl::rec_3d_framework::KeypointNeighborhoodCache<PointT>::Neighborhood *n = cache->get(candidates[i]);
+        if( n && (!n->indices_.empty()) && isNonPlanar(n->eigen_values_, threshold_planar) )
+          keypoints_cached.push_back(candidates[i]);
+      }
+      cached_filter += watch.getTime();
+
+      pcl::PointCloud<PointT>::Ptr keypoints(new pcl::PointCloud<PointT>);
+      pcl::copyPointCloud(*cloud, keypoints_cached, *keypoints);
+
+      watch.reset();
+      pcl::SHOTEstimationOMP<PointT, pcl::Normal, pcl::SHOT352> shot_estimate;
+      faat_pcl::rec_3d_framework::CachedNeighborSearch<PointT>::Ptr search(new faat_pcl::rec_3d_framework::CachedNeighborSearch<PointT>(cache));
+      pcl::PointCloud<pcl::ReferenceFrame>::Ptr frames(new pcl::PointCloud<pcl::ReferenceFrame>);
+      cache->computeReferenceFrames(keypoints_cached, *frames);
+      search->setQueryCloud(keypoints.get(), keypoints_cached);
+      shot_estimate.setSearchMethod(search);
+      shot_estimate.setInputReferenceFrames(frames);
+      shot_estimate.setInputCloud(keypoints);
+      shot_estimate.setSearchSurface(cloud);
+      shot_estimate.setInputNormals(normals);
+      shot_estimate.setRadiusSearch(support_radius);
+      shot_estimate.compute(shots_cached);
+      cached_shot += watch.getTime();
+
+      cached_search += cache->getSearchTime();
+      cached_searches += cache->getNumberOfSearches();
+      cached_lookups += cache->getNumberOfLookups();
+    }
+  }
+
+  // both runs have to describe the same keypoints with the same descriptors
+  float max_diff = 0.f;
+  int nan_mismatches = 0;
+  if( (keypoints_uncached == keypoints_cached) && (shots_uncached.points.size() == shots_cached.points.size()) )
+  {
+    for(size_t k = 0; k < shots_cached.points.size(); k++)
+    {
+      for(int i = 0; i < 352; i++)
+      {
+        float a = shots_uncached.points[k].descriptor[i];
+        float b = shots_cached.points[k].descriptor[i];
+        if(pcl_isfinite(a) != pcl_isfinite(b))
+          nan_mismatches++;
+        else if(pcl_isfinite(a))
+          max_diff = std::max(max_diff, (float)fabs(a - b));
+      }
+    }
+  }
+  else
+  {
+    printf("ERROR: keypoints differ (%d uncached, %d cached)\n", (int)keypoints_uncached.size(), (int)keypoints_cached.size());
+    return(1);
+  }
+
+  double uncached_total = (uncached_filter + uncached_shot) / runs;
+  double cached_total = (cached_filter + cached_shot) / runs;
+
+  printf("keypoints after the planarity filter: %d\n", (int)keypoints_cached.size());
+  printf("uncached: filter %8.2f ms  SHOT %8.2f ms  total %8.2f ms  (%d radius searches)\n",
+         uncached_filter / runs, uncached_shot / runs, uncached_total, (int)(candidates.size() + 2*keypoints_cached.size()));
+  printf("cached:   filter %8.2f ms  SHOT %8.2f ms  total %8.2f ms  (%d radius searches in %.2f ms, %d reused)\n",
+         cached_filter / runs, cached_shot / runs, cached_total, (int)(cached_searches / runs), cached_search / runs,
+         (int)(cached_lookups / runs));
+  printf("saved:    %8.2f ms per frame (%.1f%%)\n", uncached_total - cached_total,
+         (uncached_total > 0 ? 100. * (uncached_total - cached_total) / uncached_total : 0.));
+  printf("descriptors: max abs difference %g, %d NaN mismatches\n", max_diff, nan_mismatches);
+
+  return(0);
+}
@@ -162,6 +162,13 @@ namespace faat_pcl
           scene_rfs_->clear ();
         }
 
+        /* scene_rfs_ is shared by all hypotheses of a scene, the scenes have to be grouped one by one */
+        virtual bool
+        usesSpecificCG () const
+        {
+          return true;
+        }
+
         void
         specificCG (PointInTPtr & /*scene_clooud*/, PointInTPtr & /*scene_keypoints*/, ObjectHypothesis<PointInT> & oh)
         {
@@ -0,0 +1,484 @@
+/*
+ * ivfpq_index.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ivfpq_index.h"
+#include "persistence_utils.h"
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+  const char IVFPQ_MAGIC[8] = { 'I', 'V', 'F', 'P', 'Q', '0', '0', '3' };
+
+  template<typename T>
+  void
+  writeVector (std::ofstream & out, const std::vector<T> & v)
+  {
+    uint64_t size = v.size ();
+    out.write (reinterpret_cast<const char *> (&size), sizeof(size));
+    if (size > 0)
+      out.write (reinterpret_cast<const char *> (&v[0]), size * sizeof(T));
+  }
+
+  template<typename T>
+  bool
+  readVector (std::ifstream & in, std::vector<T> & v)
+  {
+    uint64_t size = 0;
+    if (!in.read (reinterpret_cast<char *> (&size), sizeof(size)))
+      return false;
+
+    v.resize (size);
+    if (size > 0)
+      in.read (reinterpret_cast<char *> (&v[0]), size * sizeof(T));
+
+    return static_cast<bool> (in);
+  }
+}
+
+uint64_t
+faat_pcl::rec_3d_framework::IVFPQIndex::computeFingerprint (const std::string & s)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < s.size (); i++)
+  {
+    hash ^= static_cast<unsigned char> (s[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+int
+faat_pcl::rec_3d_framework::IVFPQIndex::nearestCentroid (const float * v, const float * centroids, int k, size_t dim, size_t stride)
+{
+  int best = 0;
+  float best_dist = std::numeric_limits<float>::max ();
+  for (int c = 0; c < k; c++)
+  {
+    const float * centroid = centroids + c * stride;
+    float dist = 0.f;
+    for (size_t d = 0; d < dim && dist < best_dist; d++)
+    {
+      float diff = v[d] - centroid[d];
+      dist += diff * diff;
+    }
+
+    if (dist < best_dist)
+    {
+      best_dist = dist;
+      best = c;
+    }
+  }
+
+  return best;
+}
+
+void
+faat_pcl::rec_3d_framework::IVFPQIndex::computeSubOffsets ()
+{
+  int m = std::max (1, std::min (m_, static_cast<int> (cols_)));
+  sub_offsets_.resize (m + 1);
+  max_sub_dim_ = 0;
+  for (int j = 0; j <= m; j++)
+  {
+    sub_offsets_[j] = static_cast<int> (j * cols_ / m);
+    if (j > 0)
+      max_sub_dim_ = std::max (max_sub_dim_, sub_offsets_[j] - sub_offsets_[j - 1]);
+  }
+}
+
+void
+faat_pcl::rec_3d_framework::IVFPQIndex::kmeans (const std::vector<float> & data, size_t n, size_t dim, int k,
+                                                 std::vector<float> & centroids) const
+{
+  k = static_cast<int> (std::min (static_cast<size_t> (k), n));
+  centroids.resize (k * dim);
+  for (int c = 0; c < k; c++)
+    memcpy (&centroids[c * dim], &data[(c * n / k) * dim], dim * sizeof(float));
+
+  std::vector<int> assignment (n, -1);
+  std::vector<double> sums (k * dim);
+  std::vector<int> counts (k);
+
+  for (int it = 0; it < kmeans_iterations_; it++)
+  {
+    int changed = 0;
+
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:changed)
+    for (int i = 0; i < static_cast<int> (n); i++)
+    {
+      int a = nearestCentroid (&data[i * dim], &centroids[0], k, dim, dim);
+      if (a != assignment[i])
+      {
+        assignment[i] = a;
+        changed++;
+      }
+    }
+
+    if (changed == 0)
+      break;
+
+    //accumulate serially, the result does not depend on the number of threads
+    std::fill (sums.begin (), sums.end (), 0.0);
+    std::fill (counts.begin (), counts.end (), 0);
+    for (size_t i = 0; i < n; i++)
+    {
+      counts[assignment[i]]++;
+      for (size_t d = 0; d < dim; d++)
+        sums[assignment[i] * dim + d] += data[i * dim + d];
+    }
+
+    for (int c = 0; c < k; c++)
+    {
+      if (counts[c] == 0)
+        continue;
+
+      for (size_t d = 0; d < dim; d++)
+        centroids[c * dim + d] = static_cast<float> (sums[c * dim + d] / counts[c]);
+    }
+
+    //empty clusters split the currently largest one
+    for (int c = 0; c < k; c++)
+    {
+      if (counts[c] > 0)
+        continue;
+
+      int largest = static_cast<int> (std::max_element (counts.begin (), counts.end ()) - counts.begin ());
+      for (size_t d = 0; d < dim; d++)
+      {
+        float v = centroids[largest * dim + d];
+        centroids[c * dim + d] = v * (1.f + 1e-3f) + 1e-6f;
+        centroids[largest * dim + d] = v * (1.f - 1e-3f) - 1e-6f;
+      }
+
+      counts[c] = counts[largest] / 2;
+      counts[largest] -= counts[c];
+    }
+  }
+}
+
+bool
+faat_pcl::rec_3d_framework::IVFPQIndex::mapRawData (const std::string & raw_filename)
+{
+  raw_data_ = 0;
+  raw_region_.reset ();
+  raw_file_.reset ();
+
+  try
+  {
+    raw_file_.reset (new boost::interprocess::file_mapping (raw_filename.c_str (), boost::interprocess::read_only));
+    raw_region_.reset (new boost::interprocess::mapped_region (*raw_file_, boost::interprocess::read_only));
+  }
+  catch (boost::interprocess::interprocess_exception & e)
+  {
+    std::cout << "Cannot map " << raw_filename << ": " << e.what () << std::endl;
+    raw_file_.reset ();
+    return false;
+  }
+
+  if (raw_region_->get_size () != rows_ * cols_ * sizeof(float))
+  {
+    std::cout << raw_filename << " does not have the expected size" << std::endl;
+    raw_region_.reset ();
+    raw_file_.reset ();
+    return false;
+  }
+
+  raw_data_ = static_cast<const float *> (raw_region_->get_address ());
+  return true;
+}
+
+bool
+faat_pcl::rec_3d_framework::IVFPQIndex::build (const float * data, size_t rows, size_t cols, const std::string & raw_filename)
+{
+  if (rows == 0 || cols == 0)
+    return false;
+
+  rows_ = rows;
+  cols_ = cols;
+  computeSubOffsets ();
+  int m = static_cast<int> (sub_offsets_.size ()) - 1;
+
+  {
+    std::string tmp = PersistenceUtils::getTemporaryFilename (raw_filename);
+    std::ofstream out (tmp.c_str (), std::ios::binary | std::ios::trunc);
+    out.write (reinterpret_cast<const char *> (data), rows * cols * sizeof(float));
+    out.close ();
+    if (!out)
+    {
+      std::cout << "Cannot write " << tmp << std::endl;
+      return false;
+    }
+
+    if (!PersistenceUtils::commitTemporaryFile (raw_filename))
+      return false;
+  }
+
+  //coarse quantizer, trained on a strided sample of the data
+  size_t n_samples = std::min (rows, static_cast<size_t> (std::max (training_samples_, nlist_)));
+  std::vector<float> sample (n_samples * cols);
+  for (size_t i = 0; i < n_samples; i++)
+    memcpy (&sample[i * cols], data + (i * rows / n_samples) * cols, cols * sizeof(float));
+
+  kmeans (sample, n_samples, cols, nlist_, coarse_centroids_);
+  int nlist = static_cast<int> (coarse_centroids_.size () / cols);
+
+  //product quantizer, trained on the residuals of the sample
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int i = 0; i < static_cast<int> (n_samples); i++)
+  {
+    int a = nearestCentroid (&sample[i * cols], &coarse_centroids_[0], nlist, cols, cols);
+    for (size_t d = 0; d < cols; d++)
+      sample[i * cols + d] -= coarse_centroids_[a * cols + d];
+  }
+
+  pq_centroids_.assign (m * PQ_CENTROIDS * max_sub_dim_, 0.f);
+  for (int j = 0; j < m; j++)
+  {
+    size_t dsub = sub_offsets_[j + 1] - sub_offsets_[j];
+    std::vector<float> sub (n_samples * dsub);
+    for (size_t i = 0; i < n_samples; i++)
+      memcpy (&sub[i * dsub], &sample[i * cols + sub_offsets_[j]], dsub * sizeof(float));
+
+    std::vector<float> codebook;
+    kmeans (sub, n_samples, dsub, PQ_CENTROIDS, codebook);
+
+    //with less than 256 samples the remaining codewords repeat the first one and are never chosen
+    int k = static_cast<int> (codebook.size () / dsub);
+    for (int c = 0; c < PQ_CENTROIDS; c++)
+      memcpy (&pq_centroids_[(j * PQ_CENTROIDS + c) * max_sub_dim_], &codebook[(c < k ? c : 0) * dsub], dsub * sizeof(float));
+  }
+
+  //encode everything
+  std::vector<int> assignment (rows);
+  std::vector<uint8_t> codes (rows * m);
+
+#pragma omp parallel
+  {
+    std::vector<float> residual (cols);
+
+#pragma omp for schedule(dynamic, 256)
+    for (int i = 0; i < static_cast<int> (rows); i++)
+    {
+      const float * v = data + static_cast<size_t> (i) * cols;
+      int a = nearestCentroid (v, &coarse_centroids_[0], nlist, cols, cols);
+      assignment[i] = a;
+
+      for (size_t d = 0; d < cols; d++)
+        residual[d] = v[d] - coarse_centroids_[a * cols + d];
+
+      for (int j = 0; j < m; j++)
+      {
+        codes[static_cast<size_t> (i) * m + j] = static_cast<uint8_t> (nearestCentroid (&residual[sub_offsets_[j]],
+                                                                                        &pq_centroids_[j * PQ_CENTROIDS * max_sub_dim_],
+                                                                                        PQ_CENTROIDS, sub_offsets_[j + 1] - sub_offsets_[j],
+                                                                                        max_sub_dim_));
+      }
+    }
+  }
+
+  list_ids_.assign (nlist, std::vector<int> ());
+  list_codes_.assign (nlist, std::vector<uint8_t> ());
+  for (size_t i = 0; i < rows; i++)
+  {
+    list_ids_[assignment[i]].push_back (static_cast<int> (i));
+    list_codes_[assignment[i]].insert (list_codes_[assignment[i]].end (), codes.begin () + i * m, codes.begin () + (i + 1) * m);
+  }
+
+  return mapRawData (raw_filename);
+}
+
+bool
+faat_pcl::rec_3d_framework::IVFPQIndex::save (const std::string & filename) const
+{
+  std::string tmp = PersistenceUtils::getTemporaryFilename (filename);
+  std::ofstream out (tmp.c_str (), std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "Cannot open file " << tmp << std::endl;
+    return false;
+  }
+
+  out.write (IVFPQ_MAGIC, sizeof(IVFPQ_MAGIC));
+  uint64_t dims[2] = { rows_, cols_ };
+  out.write (reinterpret_cast<const char *> (dims), sizeof(dims));
+  out.write (reinterpret_cast<const char *> (&fingerprint_), sizeof(fingerprint_));
+  int32_t max_sub_dim = max_sub_dim_;
+  out.write (reinterpret_cast<const char *> (&max_sub_dim), sizeof(max_sub_dim));
+
+  writeVector (out, sub_offsets_);
+  writeVector (out, coarse_centroids_);
+  writeVector (out, pq_centroids_);
+
+  uint64_t nlist = list_ids_.size ();
+  out.write (reinterpret_cast<const char *> (&nlist), sizeof(nlist));
+  for (size_t l = 0; l < list_ids_.size (); l++)
+  {
+    writeVector (out, list_ids_[l]);
+    writeVector (out, list_codes_[l]);
+  }
+
+  out.close ();
+  if (!out)
+  {
+    std::cout << "Cannot write " << tmp << std::endl;
+    return false;
+  }
+
+  return PersistenceUtils::commitTemporaryFile (filename);
+}
+
+bool
+faat_pcl::rec_3d_framework::IVFPQIndex::load (const std::string & filename, const std::string & raw_filename)
+{
+  std::ifstream in (filename.c_str (), std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(IVFPQ_MAGIC)];
+  if (!in.read (magic, sizeof(magic)) || memcmp (magic, IVFPQ_MAGIC, sizeof(magic)) != 0)
+  {
+    std::cout << filename << " is not a compressed descriptor index" << std::endl;
+    return false;
+  }
+
+  uint64_t dims[2];
+  uint64_t fingerprint;
+  int32_t max_sub_dim;
+  in.read (reinterpret_cast<char *> (dims), sizeof(dims));
+  in.read (reinterpret_cast<char *> (&fingerprint), sizeof(fingerprint));
+  in.read (reinterpret_cast<char *> (&max_sub_dim), sizeof(max_sub_dim));
+
+  bool ok = static_cast<bool> (in);
+  ok = ok && readVector (in, sub_offsets_);
+  ok = ok && readVector (in, coarse_centroids_);
+  ok = ok && readVector (in, pq_centroids_);
+
+  uint64_t nlist = 0;
+  ok = ok && in.read (reinterpret_cast<char *> (&nlist), sizeof(nlist));
+  if (ok)
+  {
+    list_ids_.resize (nlist);
+    list_codes_.resize (nlist);
+    for (size_t l = 0; l < nlist && ok; l++)
+      ok = readVector (in, list_ids_[l]) && readVector (in, list_codes_[l]);
+  }
+
+  if (!ok || sub_offsets_.size () < 2)
+  {
+    std::cout << "Cannot read " << filename << std::endl;
+    rows_ = cols_ = 0;
+    return false;
+  }
+
+  rows_ = dims[0];
+  cols_ = dims[1];
+  fingerprint_ = fingerprint;
+  max_sub_dim_ = max_sub_dim;
+  if (!mapRawData (raw_filename))
+  {
+    rows_ = cols_ = 0;
+    return false;
+  }
+
+  return true;
+}
+
+void
+faat_pcl::rec_3d_framework::IVFPQIndex::searchCandidates (const float * query, size_t min_candidates,
+                                                           std::vector<std::pair<float, int> > & candidates) const
+{
+  candidates.clear ();
+  if (rows_ == 0)
+    return;
+
+  int nlist = static_cast<int> (list_ids_.size ());
+  int m = static_cast<int> (sub_offsets_.size ()) - 1;
+
+  std::vector<std::pair<float, int> > coarse (nlist);
+  for (int l = 0; l < nlist; l++)
+  {
+    const float * centroid = &coarse_centroids_[l * cols_];
+    float dist = 0.f;
+    for (size_t d = 0; d < cols_; d++)
+    {
+      float diff = query[d] - centroid[d];
+      dist += diff * diff;
+    }
+    coarse[l] = std::make_pair (dist, l);
+  }
+
+  std::sort (coarse.begin (), coarse.end ());
+
+  size_t max_candidates = std::max (static_cast<size_t> (std::max (rerank_, 1)), min_candidates);
+  std::priority_queue<std::pair<float, int> > best;
+  std::vector<float> residual (cols_);
+  std::vector<float> table (m * PQ_CENTROIDS);
+  size_t seen = 0;
+
+  for (int l = 0; l < nlist; l++)
+  {
+    if (l >= nprobe_ && seen >= min_candidates)
+      break;
+
+    int list = coarse[l].second;
+    const std::vector<int> & ids = list_ids_[list];
+    if (ids.empty ())
+      continue;
+
+    for (size_t d = 0; d < cols_; d++)
+      residual[d] = query[d] - coarse_centroids_[list * cols_ + d];
+
+    //distance of the residual to every codeword, per subquantizer
+    for (int j = 0; j < m; j++)
+    {
+      int dsub = sub_offsets_[j + 1] - sub_offsets_[j];
+      const float * r = &residual[sub_offsets_[j]];
+      for (int c = 0; c < PQ_CENTROIDS; c++)
+      {
+        const float * codeword = &pq_centroids_[(j * PQ_CENTROIDS + c) * max_sub_dim_];
+        float dist = 0.f;
+        for (int d = 0; d < dsub; d++)
+        {
+          float diff = r[d] - codeword[d];
+          dist += diff * diff;
+        }
+        table[j * PQ_CENTROIDS + c] = dist;
+      }
+    }
+
+    const uint8_t * codes = &list_codes_[list][0];
+    for (size_t e = 0; e < ids.size (); e++)
+    {
+      float dist = 0.f;
+      for (int j = 0; j < m; j++)
+        dist += table[j * PQ_CENTROIDS + codes[e * m + j]];
+
+      if (best.size () < max_candidates)
+        best.push (std::make_pair (dist, ids[e]));
+      else if (dist < best.top ().first)
+      {
+        best.pop ();
+        best.push (std::make_pair (dist, ids[e]));
+      }
+    }
+
+    seen += ids.size ();
+  }
+
+  candidates.resize (best.size ());
+  for (size_t i = candidates.size (); i > 0; i--)
+  {
+    candidates[i - 1] = best.top ();
+    best.pop ();
+  }
+}
@@ -0,0 +1,241 @@
+/*
+ * ivfpq_index.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_REC_FRAMEWORK_IVFPQ_INDEX_H_
+#define FAAT_PCL_REC_FRAMEWORK_IVFPQ_INDEX_H_
+
+#include "faat_3d_rec_framework_defines.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <vector>
+#include <string>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+namespace faat_pcl
+{
+  namespace rec_3d_framework
+  {
+
+    /**
+     * \brief Compressed descriptor index (IVF-PQ): a coarse k-means quantizer splits the descriptors into
+     * inverted lists, each entry of a list stores the product-quantized residual to its list centroid
+     * (one byte per subquantizer). A query visits the nprobe closest lists, ranks their entries with
+     * asymmetric distances from per-list lookup tables and re-ranks the best candidates with the exact
+     * distance. The raw descriptors needed for re-ranking live in a memory mapped file, so only the codes
+     * and the centroids are resident.
+     */
+    class FAAT_3D_FRAMEWORK_API IVFPQIndex
+    {
+      size_t rows_;
+      size_t cols_;
+
+      /** \brief Fingerprint of the training data the index was built from, set by the caller */
+      uint64_t fingerprint_;
+
+      int nlist_;
+      int m_;
+      int nprobe_;
+      int rerank_;
+      int training_samples_;
+      int kmeans_iterations_;
+
+      /** \brief nlist_ x cols_ coarse centroids */
+      std::vector<float> coarse_centroids_;
+
+      /** \brief Subquantizer j covers dimensions [sub_offsets_[j], sub_offsets_[j+1]) */
+      std::vector<int> sub_offsets_;
+
+      /** \brief Codebook of subquantizer j starts at j * 256 * max_sub_dim_, 256 centroids of max_sub_dim_ floats */
+      std::vector<float> pq_centroids_;
+      int max_sub_dim_;
+
+      std::vector<std::vector<int> > list_ids_;
+      std::vector<std::vector<uint8_t> > list_codes_;
+
+      boost::shared_ptr<boost::interprocess::file_mapping> raw_file_;
+      boost::shared_ptr<boost::interprocess::mapped_region> raw_region_;
+      const float * raw_data_;
+
+      bool
+      mapRawData (const std::string & raw_filename);
+
+      void
+      computeSubOffsets ();
+
+      /** \brief Lloyd's k-means on n contiguous vectors of size dim, deterministic (strided initialization) */
+      void
+      kmeans (const std::vector<float> & data, size_t n, size_t dim, int k, std::vector<float> & centroids) const;
+
+      /** \brief Index of the closest of the k centroids (squared L2) */
+      static int
+      nearestCentroid (const float * v, const float * centroids, int k, size_t dim, size_t stride);
+
+    public:
+
+      static const int PQ_CENTROIDS = 256;
+
+      IVFPQIndex ()
+      {
+        rows_ = cols_ = 0;
+        fingerprint_ = 0;
+        nlist_ = 1024;
+        m_ = 32;
+        nprobe_ = 16;
+        rerank_ = 64;
+        training_samples_ = 65536;
+        kmeans_iterations_ = 15;
+        max_sub_dim_ = 0;
+        raw_data_ = 0;
+      }
+
+      /** \brief Number of coarse centroids / inverted lists */
+      void
+      setNumberOfLists (int n)
+      {
+        nlist_ = n;
+      }
+
+      /** \brief Number of subquantizers, i.e. bytes per encoded descriptor (clamped to the descriptor size) */
+      void
+      setNumberOfSubquantizers (int m)
+      {
+        m_ = m;
+      }
+
+      /** \brief Number of inverted lists visited per query */
+      void
+      setNumberOfProbes (int n)
+      {
+        nprobe_ = n;
+      }
+
+      /** \brief Number of candidates re-ranked with the exact distance (at least k are always re-ranked) */
+      void
+      setRerankCandidates (int n)
+      {
+        rerank_ = n;
+      }
+
+      /** \brief Maximum number of descriptors used to train the quantizers */
+      void
+      setTrainingSamples (int n)
+      {
+        training_samples_ = n;
+      }
+
+      void
+      setKmeansIterations (int n)
+      {
+        kmeans_iterations_ = n;
+      }
+
+      size_t
+      size () const
+      {
+        return rows_;
+      }
+
+      size_t
+      getDimension () const
+      {
+        return cols_;
+      }
+
+      /**
+       * \brief Identifies the training data (e.g. the metadata of the descriptor files) the index is built from.
+       * It is saved with the index, so that a saved index can be validated without reading the descriptors.
+       */
+      void
+      setFingerprint (uint64_t fingerprint)
+      {
+        fingerprint_ = fingerprint;
+      }
+
+      uint64_t
+      getFingerprint () const
+      {
+        return fingerprint_;
+      }
+
+      /** \brief FNV-1a hash of s, stable across platforms and runs */
+      static uint64_t
+      computeFingerprint (const std::string & s);
+
+      /**
+       * \brief Trains the quantizers on (a sample of) the rows x cols descriptors in data, encodes all of them
+       * and writes the raw descriptors to raw_filename (which is mapped afterwards, data can be released)
+       */
+      bool
+      build (const float * data, size_t rows, size_t cols, const std::string & raw_filename);
+
+      bool
+      save (const std::string & filename) const;
+
+      /**
+       * \brief Loads an index written by save, raw_filename is the file that was passed to build. The raw
+       * descriptors are only mapped, not read, it fails if their size does not match the index. Whether the
+       * index is still valid for the training data is up to the caller (see getFingerprint).
+       */
+      bool
+      load (const std::string & filename, const std::string & raw_filename);
+
+      /**
+       * \brief Approximate squared L2 distances and ids of the best max(rerank, min_candidates) entries, sorted.
+       * Lists beyond nprobe are visited until min_candidates entries have been seen.
+       */
+      void
+      searchCandidates (const float * query, size_t min_candidates, std::vector<std::pair<float, int> > & candidates) const;
+
+      inline const float *
+      getRawDescriptor (int id) const
+      {
+        return raw_data_ + static_cast<size_t> (id) * cols_;
+      }
+
+      /**
+       * \brief k nearest neighbours of query under DistT (a flann distance functor), so distances are directly
+       * comparable with the ones of a flann::Index<DistT>. If less than k entries are found, the remaining
+       * neighbours get index -1 and an infinite distance (sorted last) and must be skipped by the caller.
+       * Returns the number found.
+       */
+      template<typename DistT>
+      int
+      knnSearch (const float * query, int k, int * indices, float * distances, const DistT & distance = DistT ()) const
+      {
+        std::vector<std::pair<float, int> > candidates;
+        searchCandidates (query, static_cast<size_t> (k), candidates);
+
+        for (size_t i = 0; i < candidates.size (); i++)
+          candidates[i].first = static_cast<float> (distance (query, getRawDescriptor (candidates[i].second), cols_));
+
+        int found = std::min (k, static_cast<int> (candidates.size ()));
+        std::partial_sort (candidates.begin (), candidates.begin () + found, candidates.end ());
+
+        for (int i = 0; i < k; i++)
+        {
+          if (i < found)
+          {
+            indices[i] = candidates[i].second;
+            distances[i] = candidates[i].first;
+          }
+          else
+          {
+            indices[i] = -1;
+            distances[i] = std::numeric_limits<float>::infinity ();
+          }
+        }
+
+        return found;
+      }
+    };
+  }
+}
+
+#endif /* FAAT_PCL_REC_FRAMEWORK_IVFPQ_INDEX_H_ */
@@ -0,0 +1,492 @@
+/*
+ * keypoint_neighborhood_cache.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_REC_FRAMEWORK_KEYPOINT_NEIGHBORHOOD_CACHE_H_
+#define FAAT_PCL_REC_FRAMEWORK_KEYPOINT_NEIGHBORHOOD_CACHE_H_
+
+#include "faat_3d_rec_framework_defines.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/common/centroid.h>
+#include <pcl/common/eigen.h>
+#include <pcl/common/time.h>
+#include <pcl/search/search.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/search/organized.h>
+
+namespace faat_pcl
+{
+  namespace rec_3d_framework
+  {
+    /**
+     * \brief Radius neighbourhoods of keypoints of one cloud, searched once and shared by the keypoint
+     * extractors (planarity filter), and the local descriptors (SHOT support and reference frame).
+     * Each neighbourhood keeps its indices and squared distances sorted by distance, the centroid,
+     * the covariance and its eigenvalues; the SHOT reference frame is computed on demand.
+     * New points are searched in parallel, points already in the cache are not searched again.
+     * Changing the cloud or the radius empties the cache.
+     */
+    template<typename PointInT>
+      class FAAT_3D_FRAMEWORK_API KeypointNeighborhoodCache
+      {
+      public:
+        typedef typename pcl::PointCloud<PointInT>::Ptr PointInTPtr;
+        typedef boost::shared_ptr<KeypointNeighborhoodCache<PointInT> > Ptr;
+
+        struct Neighborhood
+        {
+          std::vector<int> indices_;
+          std::vector<float> sqr_distances_;
+          Eigen::Vector3f centroid_;
+          Eigen::Matrix3f covariance_;
+          /** \brief increasing order */
+          Eigen::Vector3f eigen_values_;
+          /** \brief rows are the x, y and z axis, NaN if there are not enough neighbours */
+          Eigen::Matrix3f rf_;
+          bool rf_computed_;
+        };
+
+      private:
+        PointInTPtr input_;
+        float radius_;
+        bool force_unorganized_;
+        typename pcl::search::Search<PointInT>::Ptr tree_;
+
+        //slot of each point of input_ in neighborhoods_, -1 if not cached
+        std::vector<int> slot_;
+        std::vector<int> point_of_slot_;
+        std::vector<Neighborhood> neighborhoods_;
+
+        double search_time_;
+        size_t searches_;
+        mutable size_t lookups_;
+
+        void
+        computeNeighborhood (int point, Neighborhood & n) const
+        {
+          n.rf_computed_ = false;
+          n.indices_.clear ();
+          n.sqr_distances_.clear ();
+          if (!pcl_isfinite (input_->points[point].z))
+            return;
+
+          tree_->radiusSearch (point, radius_, n.indices_, n.sqr_distances_);
+          if (n.indices_.empty ())
+            return;
+
+          EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
+          Eigen::Vector4f xyz_centroid;
+          EIGEN_ALIGN16 Eigen::Vector3f eigenValues;
+          EIGEN_ALIGN16 Eigen::Matrix3f eigenVectors;
+          pcl::computeMeanAndCovarianceMatrix (*input_, n.indices_, covariance_matrix, xyz_centroid);
+          pcl::eigen33 (covariance_matrix, eigenVectors, eigenValues);
+
+          n.centroid_ = xyz_centroid.head<3> ();
+          n.covariance_ = covariance_matrix;
+          n.eigen_values_ = eigenValues;
+        }
+
+        /** \brief Same as pcl::SHOTLocalReferenceFrameEstimation::getLocalRF on the cached neighbourhood */
+        void
+        computeReferenceFrame (int point, Neighborhood & n) const
+        {
+          n.rf_computed_ = true;
+          n.rf_.setConstant (std::numeric_limits<float>::quiet_NaN ());
+
+          const Eigen::Vector4f central_point = input_->points[point].getVector4fMap ();
+          Eigen::Matrix<double, Eigen::Dynamic, 4> vij (n.indices_.size (), 4);
+          Eigen::Matrix3d cov_m = Eigen::Matrix3d::Zero ();
+          double sum = 0.0;
+          int valid_nn_points = 0;
+
+          for (size_t i = 0; i < n.indices_.size (); i++)
+          {
+            Eigen::Vector4f pt = input_->points[n.indices_[i]].getVector4fMap ();
+            if (pt.head<3> () == central_point.head<3> ())
+              continue;
+
+            vij.row (valid_nn_points).matrix () = (pt - central_point).cast<double> ();
+            vij (valid_nn_points, 3) = 0;
+            double distance = radius_ - sqrt (n.sqr_distances_[i]);
+            cov_m += distance * (vij.row (valid_nn_points).head<3> ().transpose () * vij.row (valid_nn_points).head<3> ());
+            sum += distance;
+            valid_nn_points++;
+          }
+
+          if (valid_nn_points < 5)
+            return;
+
+          cov_m /= sum;
+          Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver (cov_m);
+
+          Eigen::Vector4d v1 = Eigen::Vector4d::Zero ();
+          Eigen::Vector4d v3 = Eigen::Vector4d::Zero ();
+          v1.head<3> ().matrix () = solver.eigenvectors ().col (2);
+          v3.head<3> ().matrix () = solver.eigenvectors ().col (0);
+
+          int plusNormal = 0, plusTangentDirection1 = 0;
+          for (int ne = 0; ne < valid_nn_points; ne++)
+          {
+            if (vij.row (ne).dot (v1) >= 0)
+              plusTangentDirection1++;
+            if (vij.row (ne).dot (v3) >= 0)
+              plusNormal++;
+          }
+
+          //tangent
+          plusTangentDirection1 = 2 * plusTangentDirection1 - valid_nn_points;
+          if (plusTangentDirection1 == 0)
+          {
+            int points = 5;
+            int medianIndex = valid_nn_points / 2;
+            for (int i = -points / 2; i <= points / 2; i++)
+              if (vij.row (medianIndex - i).dot (v1) > 0)
+                plusTangentDirection1++;
+
+            if (plusTangentDirection1 < points / 2 + 1)
+              v1 *= -1;
+          }
+          else if (plusTangentDirection1 < 0)
+            v1 *= -1;
+
+          //normal
+          plusNormal = 2 * plusNormal - valid_nn_points;
+          if (plusNormal == 0)
+          {
+            int points = 5;
+            int medianIndex = valid_nn_points / 2;
+            for (int i = -points / 2; i <= points / 2; i++)
+              if (vij.row (medianIndex - i).dot (v3) > 0)
+                plusNormal++;
+
+            if (plusNormal < points / 2 + 1)
+              v3 *= -1;
+          }
+          else if (plusNormal < 0)
+            v3 *= -1;
+
+          Eigen::Vector3f x_axis = v1.head<3> ().cast<float> ();
+          Eigen::Vector3f z_axis = v3.head<3> ().cast<float> ();
+          n.rf_.row (0) = x_axis.transpose ();
+          n.rf_.row (2) = z_axis.transpose ();
+          n.rf_.row (1) = z_axis.cross (x_axis).transpose ();
+        }
+
+      public:
+
+        KeypointNeighborhoodCache ()
+        {
+          radius_ = 0.f;
+          force_unorganized_ = false;
+          search_time_ = 0.0;
+          searches_ = 0;
+          lookups_ = 0;
+        }
+
+        void
+        setInputCloud (const PointInTPtr & input)
+        {
+          if (input_.get () == input.get ())
+            return;
+
+          input_ = input;
+          clear ();
+        }
+
+        PointInTPtr
+        getInputCloud () const
+        {
+          return input_;
+        }
+
+        void
+        setRadius (float r)
+        {
+          if (r == radius_)
+            return;
+
+          radius_ = r;
+          clear ();
+        }
+
+        float
+        getRadius () const
+        {
+          return radius_;
+        }
+
+        /** \brief Use a kd-tree even if the cloud is organized */
+        void
+        setForceUnorganized (bool b)
+        {
+          if (b != force_unorganized_)
+            tree_.reset ();
+          force_unorganized_ = b;
+        }
+
+        void
+        clear ()
+        {
+          tree_.reset ();
+          slot_.clear ();
+          point_of_slot_.clear ();
+          neighborhoods_.clear ();
+          search_time_ = 0.0;
+          searches_ = 0;
+          lookups_ = 0;
+        }
+
+        /** \brief Searches the neighbourhoods of the points (indices of the input cloud) that are not cached yet */
+        void
+        compute (const std::vector<int> & points)
+        {
+          if (!input_)
+          {
+            PCL_ERROR("KeypointNeighborhoodCache :: No input cloud\n");
+            return;
+          }
+
+          if (slot_.size () != input_->points.size ())
+            slot_.assign (input_->points.size (), -1);
+
+          size_t first = neighborhoods_.size ();
+          for (size_t i = 0; i < points.size (); i++)
+          {
+            int p = points[i];
+            if (p < 0 || p >= static_cast<int> (slot_.size ()) || slot_[p] != -1)
+              continue;
+
+            slot_[p] = static_cast<int> (point_of_slot_.size ());
+            point_of_slot_.push_back (p);
+          }
+
+          if (point_of_slot_.size () == first)
+            return;
+
+          if (!tree_)
+          {
+            if (input_->isOrganized () && !force_unorganized_)
+              tree_.reset (new pcl::search::OrganizedNeighbor<PointInT> (true));
+            else
+              tree_.reset (new pcl::search::KdTree<PointInT> (true));
+            tree_->setInputCloud (input_);
+          }
+
+          neighborhoods_.resize (point_of_slot_.size ());
+
+          pcl::StopWatch timer;
+#pragma omp parallel for schedule(dynamic, 16)
+          for (int s = static_cast<int> (first); s < static_cast<int> (neighborhoods_.size ()); s++)
+            computeNeighborhood (point_of_slot_[s], neighborhoods_[s]);
+
+          search_time_ += timer.getTime ();
+          searches_ += neighborhoods_.size () - first;
+        }
+
+        /** \brief SHOT reference frames of the points, one per point (NaN if it has less than 5 neighbours) */
+        void
+        computeReferenceFrames (const std::vector<int> & points, pcl::PointCloud<pcl::ReferenceFrame> & frames)
+        {
+          compute (points);
+
+          std::vector<int> missing;
+          for (size_t i = 0; i < points.size (); i++)
+          {
+            int p = points[i];
+            if (p < 0 || p >= static_cast<int> (slot_.size ()) || slot_[p] == -1)
+              continue;
+            if (!neighborhoods_[slot_[p]].rf_computed_)
+            {
+              missing.push_back (p);
+              //no duplicates in the parallel loop
+              neighborhoods_[slot_[p]].rf_computed_ = true;
+            }
+          }
+
+#pragma omp parallel for schedule(dynamic, 16)
+          for (int i = 0; i < static_cast<int> (missing.size ()); i++)
+            computeReferenceFrame (missing[i], neighborhoods_[slot_[missing[i]]]);
+
+          frames.points.resize (points.size ());
+          frames.width = static_cast<uint32_t> (points.size ());
+          frames.height = 1;
+          frames.is_dense = true;
+          for (size_t i = 0; i < points.size (); i++)
+          {
+            Eigen::Matrix3f rf;
+            const Neighborhood * n = get (points[i]);
+            if (n)
+              rf = n->rf_;
+            else
+              rf.setConstant (std::numeric_limits<float>::quiet_NaN ());
+
+            if (!pcl_isfinite (rf (0, 0)))
+              frames.is_dense = false;
+
+            for (int d = 0; d < 3; ++d)
+            {
+              frames.points[i].x_axis[d] = rf.row (0)[d];
+              frames.points[i].y_axis[d] = rf.row (1)[d];
+              frames.points[i].z_axis[d] = rf.row (2)[d];
+            }
+          }
+        }
+
+        /** \brief Cached neighbourhood of a point of the input cloud, NULL if it is not cached */
+        const Neighborhood *
+        get (int point) const
+        {
+          if (point < 0 || point >= static_cast<int> (slot_.size ()) || slot_[point] == -1)
+            return 0;
+
+          return &neighborhoods_[slot_[point]];
+        }
+
+        /** \brief Same as get (), counted as a search saved by the cache */
+        const Neighborhood *
+        lookup (int point) const
+        {
+          const Neighborhood * n = get (point);
+          if (n)
+          {
+#pragma omp atomic
+            lookups_++;
+          }
+          return n;
+        }
+
+        /** \brief Time spent in radius searches and covariances since the cache was last emptied [ms] */
+        double
+        getSearchTime () const
+        {
+          return search_time_;
+        }
+
+        size_t
+        getNumberOfSearches () const
+        {
+          return searches_;
+        }
+
+        /** \brief Number of neighbourhoods handed out again instead of being searched */
+        size_t
+        getNumberOfLookups () const
+        {
+          return lookups_;
+        }
+      };
+
+    /**
+     * \brief Search method for pcl features on keypoints (setInputCloud = keypoints, setSearchSurface = cache cloud)
+     * that answers the radius searches of the keypoints from a KeypointNeighborhoodCache.
+     * Any other query falls back to a kd-tree on the search surface, which is only built if needed.
+     */
+    template<typename PointInT>
+      class FAAT_3D_FRAMEWORK_API CachedNeighborSearch : public pcl::search::Search<PointInT>
+      {
+      public:
+        typedef boost::shared_ptr<CachedNeighborSearch<PointInT> > Ptr;
+        typedef typename pcl::search::Search<PointInT>::PointCloud PointCloud;
+        typedef typename pcl::search::Search<PointInT>::PointCloudConstPtr PointCloudConstPtr;
+        typedef typename pcl::search::Search<PointInT>::IndicesConstPtr IndicesConstPtr;
+
+        using pcl::search::Search<PointInT>::nearestKSearch;
+        using pcl::search::Search<PointInT>::radiusSearch;
+
+      private:
+        using pcl::search::Search<PointInT>::input_;
+        using pcl::search::Search<PointInT>::indices_;
+
+        typename KeypointNeighborhoodCache<PointInT>::Ptr cache_;
+        const PointCloud * query_cloud_;
+        std::vector<int> query_indices_;
+        mutable typename pcl::search::Search<PointInT>::Ptr fallback_;
+
+        typename pcl::search::Search<PointInT>::Ptr
+        getFallback () const
+        {
+          typename pcl::search::Search<PointInT>::Ptr tree;
+#pragma omp critical (cached_neighbor_search_fallback)
+          {
+            if (!fallback_)
+            {
+              fallback_.reset (new pcl::search::KdTree<PointInT> (true));
+              fallback_->setInputCloud (input_, indices_);
+            }
+            tree = fallback_;
+          }
+          return tree;
+        }
+
+      public:
+
+        CachedNeighborSearch (const typename KeypointNeighborhoodCache<PointInT>::Ptr & cache) :
+          pcl::search::Search<PointInT> ("CachedNeighborSearch", true), cache_ (cache), query_cloud_ (0)
+        {
+        }
+
+        /** \brief Point i of cloud is point indices[i] of the cache cloud */
+        void
+        setQueryCloud (const PointCloud * cloud, const std::vector<int> & indices)
+        {
+          query_cloud_ = cloud;
+          query_indices_ = indices;
+        }
+
+        void
+        setInputCloud (const PointCloudConstPtr & cloud, const IndicesConstPtr & indices = IndicesConstPtr ())
+        {
+          input_ = cloud;
+          indices_ = indices;
+          fallback_.reset ();
+        }
+
+        int
+        nearestKSearch (const PointInT & point, int k, std::vector<int> & k_indices, std::vector<float> & k_sqr_distances) const
+        {
+          return getFallback ()->nearestKSearch (point, k, k_indices, k_sqr_distances);
+        }
+
+        int
+        radiusSearch (const PointInT & point, double radius, std::vector<int> & k_indices, std::vector<float> & k_sqr_distances,
+                      unsigned int max_nn = 0) const
+        {
+          return getFallback ()->radiusSearch (point, radius, k_indices, k_sqr_distances, max_nn);
+        }
+
+        int
+        radiusSearch (const PointCloud & cloud, int index, double radius, std::vector<int> & k_indices,
+                      std::vector<float> & k_sqr_distances, unsigned int max_nn = 0) const
+        {
+          const typename KeypointNeighborhoodCache<PointInT>::Neighborhood * n = 0;
+          if (&cloud == query_cloud_ && index >= 0 && index < static_cast<int> (query_indices_.size ())
+              && input_.get () == cache_->getInputCloud ().get () && !indices_ && radius <= cache_->getRadius ())
+            n = cache_->lookup (query_indices_[index]);
+
+          if (!n)
+            return getFallback ()->radiusSearch (cloud.points[index], radius, k_indices, k_sqr_distances, max_nn);
+
+          //neighbours are sorted by distance
+          size_t nr = n->indices_.size ();
+          if (radius < cache_->getRadius ())
+            nr = std::upper_bound (n->sqr_distances_.begin (), n->sqr_distances_.end (), static_cast<float> (radius * radius))
+                - n->sqr_distances_.begin ();
+          if (max_nn > 0 && nr > max_nn)
+            nr = max_nn;
+
+          k_indices.assign (n->indices_.begin (), n->indices_.begin () + nr);
+          k_sqr_distances.assign (n->sqr_distances_.begin (), n->sqr_distances_.begin () + nr);
+          return static_cast<int> (nr);
+        }
+      };
+  }
+}
+
+#endif /* FAAT_PCL_REC_FRAMEWORK_KEYPOINT_NEIGHBORHOOD_CACHE_H_ */
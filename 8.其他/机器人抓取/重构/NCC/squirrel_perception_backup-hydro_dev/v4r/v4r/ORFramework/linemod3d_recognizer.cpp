@@ -2,8 +2,53 @@
 #include "faat_3d_rec_framework_defines.h"
 #include <v4r/ORUtils/pcl_opencv.h>
 #include <pcl/common/angles.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 //add functions
 
+#ifdef __SSE2__
+/** \brief block_sums += data, saturating at 255 */
+inline void
+addToBlockSums (unsigned char * block_sums, const unsigned char * data, size_t size)
+{
+  const size_t size_16 = size - size % 16;
+  for (size_t i = 0; i < size_16; i += 16)
+  {
+    __m128i sums = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (block_sums + i));
+    __m128i values = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (data + i));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (block_sums + i), _mm_adds_epu8 (sums, values));
+  }
+  for (size_t i = size_16; i < size; i++)
+    block_sums[i] = static_cast<unsigned char> (std::min (255, block_sums[i] + data[i]));
+}
+
+/** \brief Adds the 8-bit block sums to the 16-bit score sums and clears the block sums */
+inline void
+flushBlockSums (unsigned char * block_sums, unsigned short * score_sums, size_t size)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const size_t size_16 = size - size % 16;
+  for (size_t i = 0; i < size_16; i += 16)
+  {
+    __m128i block = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (block_sums + i));
+    __m128i lo = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (score_sums + i));
+    __m128i hi = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (score_sums + i + 8));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (score_sums + i), _mm_add_epi16 (lo, _mm_unpacklo_epi8 (block, zero)));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (score_sums + i + 8), _mm_add_epi16 (hi, _mm_unpackhi_epi8 (block, zero)));
+  }
+  for (size_t i = size_16; i < size; i++)
+    score_sums[i] = static_cast<unsigned short> (score_sums[i] + block_sums[i]);
+  std::memset (block_sums, 0, size);
+}
+#endif
+
 inline std::vector<int> getViewIdsFromTemplateViewFile(std::string file)
 {
     std::vector<int> view_ids;
@@ -85,6 +130,378 @@ void rotateOrganizedPointCloud(typename pcl::PointCloud<PointInT>::Ptr & cloud,
   }
 }
 
+template<typename PointInT>
+void
+faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::trainModel (ModelT & model, std::vector<pcl::SparseQuantizedMultiModTemplate> & templates)
+{
+  int n_views = static_cast<int> (model.view_filenames_.size ());
+  templates.clear ();
+  templates.resize (n_views);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int kk = 0; kk < n_views; kk++)
+  {
+    //the source loads the view into the model, each view gets its own copy
+    ModelT model_view = model;
+    model_view.views_.reset (new std::vector<PointInTPtr>);
+    model_view.poses_.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
+    model_view.indices_.reset (new std::vector<pcl::PointIndices>);
+    source_->loadInMemorySpecificModelAndView(training_dir_, model_view, kk);
+    int v = 0;
+
+    //use indices_->at (v).indices to define the mask to compute the linemod template
+    //input cloud is views_->at (v)
+
+    //views without object indices are masked as a whole (all valid points)
+    pcl::PointIndices view_indices;
+    if (model_view.indices_ && model_view.indices_->size () > static_cast<size_t> (v))
+    {
+      view_indices = model_view.indices_->at (v);
+    }
+    else
+    {
+      const PointInTPtr & view = model_view.views_->at (v);
+      view_indices.indices.reserve (view->points.size ());
+      for (size_t k = 0; k < view->points.size (); k++)
+      {
+        if (pcl_isfinite (view->points[k].z))
+          view_indices.indices.push_back (static_cast<int> (k));
+      }
+    }
+
+    pcl::MaskMap mask;
+    pcl::RegionXY region;
+    getMaskFromObjectIndices(view_indices, model_view.views_->at (v), mask, region);
+
+    typename pcl::ColorGradientModality<PointInT> color_grad_mod;
+    color_grad_mod.setInputCloud (model_view.views_->at (v));
+    color_grad_mod.processInputData ();
+
+    typename pcl::SurfaceNormalModality<PointInT> surface_norm_mod;
+    surface_norm_mod.setInputCloud (model_view.views_->at (v));
+    surface_norm_mod.processInputData ();
+
+    std::vector<pcl::QuantizableModality*> modalities (2);
+    modalities[0] = &color_grad_mod;
+    modalities[1] = &surface_norm_mod;
+
+    std::vector<pcl::MaskMap*> masks (2);
+    masks[0] = &mask;
+    masks[1] = &mask;
+
+    pcl::LINEMOD linemod;
+    int template_id = linemod.createAndAddTemplate(modalities, masks, region);
+    templates[kk] = linemod.getTemplate(template_id);
+  }
+}
+
+template<typename PointInT>
+std::string
+faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::getTemplatesFile ()
+{
+  std::stringstream file;
+  file << training_dir_ << "/linemod_templates_" << descr_name_;
+  if(search_model_.compare("") != 0)
+  {
+    std::string model_name (search_model_);
+    std::replace (model_name.begin (), model_name.end (), '/', '_');
+    file << "_" << model_name;
+  }
+  file << ".lmb";
+  return file.str();
+}
+
+template<typename PointInT>
+bool
+faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::loadTemplates (const std::string & file, const std::vector<ModelTPtr> & models)
+{
+  std::ifstream in (file.c_str (), std::ifstream::in | std::ifstream::binary);
+  if (!in.is_open ())
+    return false;
+
+  char magic[4];
+  int version = 0;
+  int n_models = 0;
+  in.read (magic, 4);
+  in.read (reinterpret_cast<char*> (&version), sizeof(int));
+  in.read (reinterpret_cast<char*> (&n_models), sizeof(int));
+  if (!in.good () || strncmp (magic, "LM3D", 4) != 0 || version != 1 || n_models != static_cast<int> (models.size ()))
+    return false;
+
+  std::vector<view_model> template_id_to_model;
+  for (int i = 0; i < n_models; i++)
+  {
+    std::string class_id[2];
+    for (int k = 0; k < 2; k++)
+    {
+      int length = 0;
+      in.read (reinterpret_cast<char*> (&length), sizeof(int));
+      if (!in.good () || length < 0 || length > 4096)
+        return false;
+      class_id[k].resize (length);
+      if (length > 0)
+        in.read (&class_id[k][0], length);
+    }
+
+    //the file was written for another set of models
+    if (class_id[0] != models[i]->class_ || class_id[1] != models[i]->id_)
+      return false;
+
+    int n_templates = 0;
+    in.read (reinterpret_cast<char*> (&n_templates), sizeof(int));
+    if (!in.good () || n_templates < 0)
+      return false;
+
+    std::vector<int> view_ids (n_templates);
+    if (n_templates > 0)
+      in.read (reinterpret_cast<char*> (&view_ids[0]), n_templates * sizeof(int));
+
+    for (int j = 0; j < n_templates; j++)
+    {
+      view_model vm;
+      vm.model_ = models[i];
+      vm.view_id_ = view_ids[j];
+      template_id_to_model.push_back (vm);
+    }
+  }
+
+  if (!in.good ())
+    return false;
+
+  linemod_.deserialize (in);
+  if (linemod_.getNumOfTemplates () != template_id_to_model.size ())
+    return false;
+
+  template_id_to_model_ = template_id_to_model;
+  return true;
+}
+
+template<typename PointInT>
+void
+faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::saveTemplates (const std::string & file, const std::vector<ModelTPtr> & models)
+{
+  std::ofstream out (file.c_str (), std::ofstream::out | std::ofstream::binary);
+  if (!out.is_open ())
+  {
+    PCL_WARN("Could not write linemod templates to %s\n", file.c_str ());
+    return;
+  }
+
+  int version = 1;
+  int n_models = static_cast<int> (models.size ());
+  out.write ("LM3D", 4);
+  out.write (reinterpret_cast<const char*> (&version), sizeof(int));
+  out.write (reinterpret_cast<const char*> (&n_models), sizeof(int));
+
+  size_t t = 0;
+  for (size_t i = 0; i < models.size (); i++)
+  {
+    const std::string * class_id[2] = {&models[i]->class_, &models[i]->id_};
+    for (int k = 0; k < 2; k++)
+    {
+      int length = static_cast<int> (class_id[k]->size ());
+      out.write (reinterpret_cast<const char*> (&length), sizeof(int));
+      out.write (class_id[k]->c_str (), length);
+    }
+
+    std::vector<int> view_ids;
+    for (; t < template_id_to_model_.size () && template_id_to_model_[t].model_ == models[i]; t++)
+      view_ids.push_back (template_id_to_model_[t].view_id_);
+
+    int n_templates = static_cast<int> (view_ids.size ());
+    out.write (reinterpret_cast<const char*> (&n_templates), sizeof(int));
+    if (n_templates > 0)
+      out.write (reinterpret_cast<const char*> (&view_ids[0]), n_templates * sizeof(int));
+  }
+
+  linemod_.serialize (out);
+  out.close ();
+}
+
+template<typename PointInT>
+void
+faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::createTemplateShards ()
+{
+  int n_templates = static_cast<int> (linemod_.getNumOfTemplates ());
+  int n_shards = 1;
+#ifdef _OPENMP
+  n_shards = omp_get_num_procs ();
+#endif
+  n_shards = std::max (1, std::min (n_shards, n_templates));
+
+  linemod_shard_offsets_.resize (n_shards + 1);
+  for (int s = 0; s <= n_shards; s++)
+    linemod_shard_offsets_[s] = static_cast<int> ((static_cast<long long> (n_templates) * s) / n_shards);
+}
+
+template<typename PointInT>
+void
+faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::detectTemplates (const std::vector<pcl::QuantizableModality*> & modalities,
+                                                                          std::vector<pcl::LINEMODDetection> & detections,
+                                                                          float min_scale, float max_scale, float scale_multiplier)
+{
+  detections.clear ();
+  if (linemod_shard_offsets_.size () < 2 || modalities.size () == 0)
+    return;
+
+  //response maps of the scene, computed once as in pcl::LINEMOD::detectTemplatesSemiScaleInvariant and shared by all shards
+  const size_t nr_modalities = modalities.size ();
+  const int nr_bins = 8;
+  const size_t step_size = 8;
+
+  std::vector<pcl::EnergyMaps> modality_energy_maps (nr_modalities);
+  std::vector<std::vector<pcl::LinearizedMaps> > modality_linearized_maps (nr_modalities, std::vector<pcl::LinearizedMaps> (nr_bins));
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int modality_index = 0; modality_index < static_cast<int> (nr_modalities); modality_index++)
+  {
+    const pcl::QuantizedMap & quantized_map = modalities[modality_index]->getSpreadedQuantizedMap ();
+    const size_t width = quantized_map.getWidth ();
+    const size_t height = quantized_map.getHeight ();
+    const unsigned char * quantized_data = quantized_map.getData ();
+
+    pcl::EnergyMaps & energy_maps = modality_energy_maps[modality_index];
+    energy_maps.initialize (width, height, nr_bins);
+    for (int bin_index = 0; bin_index < nr_bins; ++bin_index)
+    {
+      //same (neighbouring orientation) masks as pcl::LINEMOD, otherwise the scores would differ
+      const unsigned char base_bit = static_cast<unsigned char> (0x1);
+      unsigned char val0 = static_cast<unsigned char> (base_bit << bin_index);
+      unsigned char val1 = static_cast<unsigned char> (val0 | (base_bit << (bin_index+1)&7) | (base_bit << (bin_index+7)&7));
+      unsigned char val2 = static_cast<unsigned char> (val1 | (base_bit << (bin_index+2)&7) | (base_bit << (bin_index+6)&7));
+      unsigned char val3 = static_cast<unsigned char> (val2 | (base_bit << (bin_index+3)&7) | (base_bit << (bin_index+5)&7));
+      for (size_t index = 0; index < width*height; ++index)
+      {
+        if ((val0 & quantized_data[index]) != 0)
+          ++energy_maps (bin_index, index);
+        if ((val1 & quantized_data[index]) != 0)
+          ++energy_maps (bin_index, index);
+        if ((val2 & quantized_data[index]) != 0)
+          ++energy_maps (bin_index, index);
+        if ((val3 & quantized_data[index]) != 0)
+          ++energy_maps (bin_index, index);
+      }
+
+      const unsigned char * energy_map = energy_maps (bin_index);
+      pcl::LinearizedMaps & maps = modality_linearized_maps[modality_index][bin_index];
+      maps.initialize (width, height, step_size);
+      const size_t lin_width = width / step_size;
+      const size_t lin_height = height / step_size;
+      for (size_t map_row = 0; map_row < step_size; ++map_row)
+      {
+        for (size_t map_col = 0; map_col < step_size; ++map_col)
+        {
+          unsigned char * linearized_map = maps (map_col, map_row);
+          for (size_t row_index = 0; row_index < lin_height; ++row_index)
+          {
+            for (size_t col_index = 0; col_index < lin_width; ++col_index)
+            {
+              const size_t tmp_col_index = col_index*step_size + map_col;
+              const size_t tmp_row_index = row_index*step_size + map_row;
+              linearized_map[row_index*lin_width + col_index] = energy_map[tmp_row_index*width + tmp_col_index];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const size_t mem_width = modality_energy_maps[0].getWidth () / step_size;
+  const size_t mem_height = modality_energy_maps[0].getHeight () / step_size;
+  const size_t mem_size = mem_width * mem_height;
+
+  //the maps are only read from here on, every shard scores its own templates
+  int n_shards = static_cast<int> (linemod_shard_offsets_.size ()) - 1;
+  std::vector<std::vector<pcl::LINEMODDetection> > shard_detections (n_shards);
+
+#pragma omp parallel
+  {
+    std::vector<unsigned short> score_sums (mem_size);
+#ifdef __SSE2__
+    //8-bit sums of up to 63 bins (energies are at most 4), flushed into score_sums before they could saturate
+    std::vector<unsigned char> block_sums (mem_size);
+#endif
+
+#pragma omp for schedule(dynamic, 1)
+    for (int s = 0; s < n_shards; s++)
+    {
+      for (int template_index = linemod_shard_offsets_[s]; template_index < linemod_shard_offsets_[s + 1]; template_index++)
+      {
+        const pcl::SparseQuantizedMultiModTemplate & templ = linemod_.getTemplate (template_index);
+        for (float scale = min_scale; scale <= max_scale; scale *= scale_multiplier)
+        {
+          std::fill (score_sums.begin (), score_sums.end (), 0);
+#ifdef __SSE2__
+          std::fill (block_sums.begin (), block_sums.end (), 0);
+          int block_max = 0;
+#endif
+
+          int max_score = 0;
+          for (size_t feature_index = 0; feature_index < templ.features.size (); ++feature_index)
+          {
+            const pcl::QuantizedMultiModFeature & feature = templ.features[feature_index];
+            for (int bin_index = 0; bin_index < nr_bins; ++bin_index)
+            {
+              if ((feature.quantized_value & (0x1 << bin_index)) != 0)
+              {
+                max_score += 4;
+                const unsigned char * data = modality_linearized_maps[feature.modality_index][bin_index].getOffsetMap (
+                    static_cast<size_t> (static_cast<float> (feature.x) * scale),
+                    static_cast<size_t> (static_cast<float> (feature.y) * scale));
+#ifdef __SSE2__
+                if (block_max + 4 > 255)
+                {
+                  flushBlockSums (&block_sums[0], &score_sums[0], mem_size);
+                  block_max = 0;
+                }
+                addToBlockSums (&block_sums[0], data, mem_size);
+                block_max += 4;
+#else
+                for (size_t mem_index = 0; mem_index < mem_size; ++mem_index)
+                  score_sums[mem_index] = static_cast<unsigned short> (score_sums[mem_index] + data[mem_index]);
+#endif
+              }
+            }
+          }
+#ifdef __SSE2__
+          flushBlockSums (&block_sums[0], &score_sums[0], mem_size);
+#endif
+
+          size_t max_value = 0;
+          size_t max_index = 0;
+          for (size_t mem_index = 0; mem_index < mem_size; ++mem_index)
+          {
+            if (score_sums[mem_index] > max_value)
+            {
+              max_value = score_sums[mem_index];
+              max_index = mem_index;
+            }
+          }
+
+          pcl::LINEMODDetection detection;
+          detection.x = static_cast<int> ((max_index % mem_width) * step_size);
+          detection.y = static_cast<int> ((max_index / mem_width) * step_size);
+          detection.template_id = template_index;
+          detection.score = static_cast<float> (max_value) / static_cast<float> (max_score);
+          detection.scale = scale;
+          shard_detections[s].push_back (detection);
+        }
+      }
+    }
+  }
+
+  for (size_t modality_index = 0; modality_index < nr_modalities; ++modality_index)
+  {
+    modality_energy_maps[modality_index].releaseAll ();
+    for (size_t bin_index = 0; bin_index < modality_linearized_maps[modality_index].size (); ++bin_index)
+      modality_linearized_maps[modality_index][bin_index].releaseAll ();
+  }
+
+  //LINEMOD reports detections template by template, concatenating the shards in order gives the serial result
+  for (size_t s = 0; s < shard_detections.size (); s++)
+    detections.insert (detections.end (), shard_detections[s].begin (), shard_detections[s].end ());
+}
+
 template<typename PointInT>
 void
 faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::initialize (bool force_retrain)
@@ -100,6 +517,7 @@ faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::initialize (bool force_
 
     std::cout << "Models size:" << models->size () << std::endl;
 
+    bool trained = force_retrain;
     if (force_retrain)
     {
       for (size_t i = 0; i < models->size (); i++)
@@ -128,51 +546,10 @@ faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::initialize (bool force_
         if (!bf::exists (desc_dir))
           bf::create_directory (desc_dir);
 
-        //for (size_t v = 0; v < models->at (i)->views_->size (); v++)
-        for (size_t kk = 0; kk < models->at (i)->view_filenames_.size (); kk++)
-        {
-          source_->loadInMemorySpecificModelAndView(training_dir_, *(models->at (i)), (int)kk);
-          int v = 0;
-
-          /*cv::Mat_ < cv::Vec3b > colorImage;
-          PCLOpenCV::ConvertPCLCloud2Image<pcl::PointXYZRGBA> (models->at (i)->views_->at (v), colorImage);
-          cv::namedWindow("test");
-          cv::imshow("test", colorImage);
-          cv::waitKey(0);*/
-
-          //use models->at(i)->indices_->at (v).indices to define the mask to compute the linemod template
-          //input cloud is models->at (i)->views_->at (v)
-
-          pcl::MaskMap mask;
-          pcl::RegionXY region;
-          getMaskFromObjectIndices(models->at(i)->indices_->at (v), models->at (i)->views_->at (v), mask, region);
-
-          typename pcl::ColorGradientModality<PointInT> color_grad_mod;
-          color_grad_mod.setInputCloud (models->at (i)->views_->at (v));
-          color_grad_mod.processInputData ();
-
-          typename pcl::SurfaceNormalModality<PointInT> surface_norm_mod;
-          surface_norm_mod.setInputCloud (models->at (i)->views_->at (v));
-          surface_norm_mod.processInputData ();
-
-          std::vector<pcl::QuantizableModality*> modalities (2);
-          modalities[0] = &color_grad_mod;
-          modalities[1] = &surface_norm_mod;
-
-          std::vector<pcl::MaskMap*> masks (2);
-          masks[0] = &mask;
-          masks[1] = &mask;
-
-          linemod.createAndAddTemplate(modalities, masks, region);
-
-          /*std::stringstream path_view;
-          path_view << path << "/view_" << v << ".pcd";
-          pcl::io::savePCDFileBinary (path_view.str (), *models->at (i)->views_->at (v));
-
-          std::stringstream path_pose;
-          path_pose << path << "/pose_" << v << ".txt";
-          PersistenceUtils::writeMatrixToFile (path_pose.str (), models->at (i)->poses_->at (v));*/
-        }
+        std::vector<pcl::SparseQuantizedMultiModTemplate> templates;
+        trainModel (*models->at (i), templates);
+        for (size_t kk = 0; kk < templates.size (); kk++)
+          linemod.addTemplate(templates[kk]);
 
         //save all templates in file
         std::cout << "Number of templates:" << linemod.getNumOfTemplates() << std::endl;
@@ -195,6 +572,7 @@ faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::initialize (bool force_
         if(!source_->getLoadIntoMemory())
           models->at (i)->views_->clear();
 
+        trained = true;
       } else {
         std::cout << "Model already trained..." << std::endl;
         //there is no need to keep the views in memory once the model has been trained
@@ -202,43 +580,52 @@ faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::initialize (bool force_
       }
     }
 
-    //once we are here, its time to load templates
-    std::vector<std::string> lmt_filenames;
-    for (size_t i = 0; i < models->size (); i++)
+    //once we are here, its time to load templates, all models in one file if it is up to date
+    std::string templates_file = getTemplatesFile ();
+    if (trained || !loadTemplates (templates_file, *models))
     {
-      pcl::ScopeTime t("Model finished");
+      //load templates of each model
+      std::vector<std::string> lmt_filenames;
+      for (size_t i = 0; i < models->size (); i++)
+      {
+        pcl::ScopeTime t("Model finished");
 
-      std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
-      std::stringstream path_descriptor;
-      path_descriptor << path << "/linemod_templates.lmt";
-      lmt_filenames.push_back(path_descriptor.str());
-      std::cout << lmt_filenames[i] << std::endl;
-    }
+        std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
+        std::stringstream path_descriptor;
+        path_descriptor << path << "/linemod_templates.lmt";
+        lmt_filenames.push_back(path_descriptor.str());
+        std::cout << lmt_filenames[i] << std::endl;
+      }
 
-    //TODO: Load poses... and manage structure to handle linemod detections...
-    //might be tricky to handle things in the right order... template_id and views should be accurately matched
-    //load templates loa
-    linemod_.loadTemplates(lmt_filenames);
+      //TODO: Load poses... and manage structure to handle linemod detections...
+      //might be tricky to handle things in the right order... template_id and views should be accurately matched
+      //load templates loa
+      linemod_.loadTemplates(lmt_filenames);
 
-    template_id_to_model_.resize(linemod_.getNumOfTemplates());
-    int templates_per_model = linemod_.getNumOfTemplates() / models->size();
-    std::cout << "Number of templates loaded from multiple files:" << linemod_.getNumOfTemplates()  << " x model:" << templates_per_model << std::endl;
+      template_id_to_model_.resize(linemod_.getNumOfTemplates());
+      int templates_per_model = linemod_.getNumOfTemplates() / models->size();
+      std::cout << "Number of templates loaded from multiple files:" << linemod_.getNumOfTemplates()  << " x model:" << templates_per_model << std::endl;
 
-    int t = 0;
-    for (size_t i = 0; i < models->size (); i++)
-    {
-      std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
-      std::stringstream file;
-      file << path << "/template_to_view_id.txt";
-      std::vector<int> view_ids = getViewIdsFromTemplateViewFile(file.str());
-      for(size_t j=0; j < view_ids.size(); j++, t++)
+      int t = 0;
+      for (size_t i = 0; i < models->size (); i++)
       {
-        template_id_to_model_[t].model_ = models->at(i) ;
-        template_id_to_model_[t].view_id_ = view_ids[j];
+        std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
+        std::stringstream file;
+        file << path << "/template_to_view_id.txt";
+        std::vector<int> view_ids = getViewIdsFromTemplateViewFile(file.str());
+        for(size_t j=0; j < view_ids.size(); j++, t++)
+        {
+          template_id_to_model_[t].model_ = models->at(i) ;
+          template_id_to_model_[t].view_id_ = view_ids[j];
+        }
       }
+
+      std::cout << t << " " << linemod_.getNumOfTemplates() << std::endl;
+
+      saveTemplates (templates_file, *models);
     }
 
-    std::cout << t << " " << linemod_.getNumOfTemplates() << std::endl;
+    createTemplateShards ();
 
     if(ICP_iterations_ > 0 && icp_type_ == 1)
       source_->createVoxelGridAndDistanceTransform(VOXEL_SIZE_ICP_);
@@ -275,7 +662,7 @@ faat_pcl::rec_3d_framework::LineMod3DPipeline<PointInT>::recognize ()
     std::cout << "Number of templates loaded from multiple files:" << linemod_.getNumOfTemplates() << std::endl;
 
     std::vector<pcl::LINEMODDetection> detections;
-    linemod_.detectTemplatesSemiScaleInvariant (modalities, detections);
+    detectTemplates (modalities, detections);
     //linemod_.detectTemplates (modalities, detections);
     std::cout << detections.size() << std::endl;
 
@@ -79,6 +79,34 @@ namespace faat_pcl
           std::vector<view_model> template_id_to_model_;
           pcl::LINEMOD linemod_;
 
+          /** \brief Templates of linemod_ split into contiguous blocks, shard s holds templates [linemod_shard_offsets_[s], linemod_shard_offsets_[s+1]) */
+          std::vector<int> linemod_shard_offsets_;
+
+          /** \brief Templates of all views of model, in view order, views are loaded and processed in parallel */
+          void
+          trainModel (ModelT & model, std::vector<pcl::SparseQuantizedMultiModTemplate> & templates);
+
+          /** \brief File with the templates of all models and the template to model/view mapping */
+          std::string
+          getTemplatesFile ();
+
+          bool
+          loadTemplates (const std::string & file, const std::vector<ModelTPtr> & models);
+
+          void
+          saveTemplates (const std::string & file, const std::vector<ModelTPtr> & models);
+
+          void
+          createTemplateShards ();
+
+          /**
+           * \brief Same detections as linemod_.detectTemplatesSemiScaleInvariant. The response maps (energy maps and their
+           * linearized copies) of the scene are computed once and shared, the shards are scored against them in parallel.
+           */
+          void
+          detectTemplates (const std::vector<pcl::QuantizableModality*> & modalities, std::vector<pcl::LINEMODDetection> & detections,
+                           float min_scale = 0.6944444f, float max_scale = 1.44f, float scale_multiplier = 1.2f);
+
           void getMaskFromObjectIndices(pcl::PointIndices & indices,
                                             PointInTPtr & cloud,
                                             pcl::MaskMap & mask, pcl::RegionXY & region)
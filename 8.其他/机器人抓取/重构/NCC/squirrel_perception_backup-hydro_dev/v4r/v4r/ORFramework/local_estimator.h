@@ -10,6 +10,7 @@
 
 #include "normal_estimator.h"
 #include "faat_3d_rec_framework_defines.h"
+#include "keypoint_neighborhood_cache.h"
 #include "pcl/keypoints/uniform_sampling.h"
 #include <pcl/surface/mls.h>
 #include <pcl/keypoints/harris_3d.h>
@@ -31,6 +32,7 @@ protected:
     typename pcl::PointCloud<PointInT>::Ptr input_;
     float radius_;
     pcl::PointIndicesConstPtr keypoint_indices_;
+    typename KeypointNeighborhoodCache<PointInT>::Ptr neighborhood_cache_;
 
 public:
 
@@ -40,6 +42,15 @@ public:
         input_ = input;
     }
 
+    /**
+     * \brief Neighbourhoods searched by the extractor are stored in (and taken from) this cache
+     */
+    void
+    setNeighborhoodCache (const typename KeypointNeighborhoodCache<PointInT>::Ptr & cache)
+    {
+        neighborhood_cache_ = cache;
+    }
+
     void
     setSupportRadius (float f)
     {
@@ -78,9 +89,8 @@ private:
     using faat_pcl::rec_3d_framework::KeypointExtractor<PointInT>::input_;
     using faat_pcl::rec_3d_framework::KeypointExtractor<PointInT>::radius_;
     using KeypointExtractor<PointInT>::keypoint_indices_;
+    using KeypointExtractor<PointInT>::neighborhood_cache_;
     float sampling_density_;
-    boost::shared_ptr<std::vector<std::vector<int> > > neighborhood_indices_;
-    boost::shared_ptr<std::vector<std::vector<float> > > neighborhood_dist_;
     float max_distance_;
     float threshold_planar_;
     bool z_adaptative_;
@@ -89,37 +99,25 @@ private:
     void
     filterPlanar (PointInTPtr & input, pcl::PointCloud<int> & keypoints_cloud)
     {
-        pcl::PointCloud<int> filtered_keypoints;
-        //create a search object
-        typename pcl::search::Search<PointInT>::Ptr tree;
-        if (input->isOrganized () && !force_unorganized_)
-            tree.reset (new pcl::search::OrganizedNeighbor<PointInT> ());
-        else
-            tree.reset (new pcl::search::KdTree<PointInT> (false));
-        tree->setInputCloud (input);
-
-        neighborhood_indices_.reset (new std::vector<std::vector<int> >);
-        neighborhood_indices_->resize (keypoints_cloud.points.size ());
-        neighborhood_dist_.reset (new std::vector<std::vector<float> >);
-        neighborhood_dist_->resize (keypoints_cloud.points.size ());
-
-        filtered_keypoints.points.resize (keypoints_cloud.points.size ());
+        //neighbourhoods are searched in parallel and kept for the descriptors
+        typename KeypointNeighborhoodCache<PointInT>::Ptr cache = neighborhood_cache_;
+        if (!cache)
+            cache.reset (new KeypointNeighborhoodCache<PointInT>);
+
+        cache->setForceUnorganized (force_unorganized_);
+        cache->setInputCloud (input);
+        cache->setRadius (radius_);
+        cache->compute (std::vector<int> (keypoints_cloud.points.begin (), keypoints_cloud.points.end ()));
+
         int good = 0;
 
         for (size_t i = 0; i < keypoints_cloud.points.size (); i++)
         {
-
-            if (tree->radiusSearch (keypoints_cloud[i], radius_, (*neighborhood_indices_)[good], (*neighborhood_dist_)[good]))
+            const typename KeypointNeighborhoodCache<PointInT>::Neighborhood * n = cache->get (keypoints_cloud.points[i]);
+            if (n && !n->indices_.empty ())
             {
-
-                EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
-                Eigen::Vector4f xyz_centroid;
-                EIGEN_ALIGN16 Eigen::Vector3f eigenValues;
-                EIGEN_ALIGN16 Eigen::Matrix3f eigenVectors;
-
-                //compute planarity of the region
-                computeMeanAndCovarianceMatrix (*input, (*neighborhood_indices_)[good], covariance_matrix, xyz_centroid);
-                pcl::eigen33 (covariance_matrix, eigenVectors, eigenValues);
+                //planarity of the region
+                const Eigen::Vector3f & eigenValues = n->eigen_values_;
 
                 float eigsum = eigenValues.sum ();
                 if (!pcl_isfinite(eigsum))
@@ -143,13 +141,7 @@ private:
             }
         }
 
-        neighborhood_indices_->resize (good);
-        neighborhood_dist_->resize (good);
         keypoints_cloud.points.resize (good);
-
-        neighborhood_indices_->clear ();
-        neighborhood_dist_->clear ();
-
     }
 
 public:
@@ -558,17 +550,17 @@ protected:
 
     bool adaptative_MLS_;
 
-    boost::shared_ptr<std::vector<std::vector<int> > > neighborhood_indices_;
-    boost::shared_ptr<std::vector<std::vector<float> > > neighborhood_dist_;
-
-    //std::vector< std::vector<int> > neighborhood_indices_;
-    //std::vector< std::vector<float> > neighborhood_dist_;
+    /** \brief keypoint neighbourhoods of the current cloud, shared by keypoint extraction and descriptors */
+    typename KeypointNeighborhoodCache<PointInT>::Ptr neighborhood_cache_;
 
     void
     computeKeypoints (PointInTPtr & cloud, PointInTPtr & keypoints, pcl::PointCloud<pcl::Normal>::Ptr & normals)
     {
         keypoint_indices_.indices.clear();
         keypoints.reset (new pcl::PointCloud<PointInT>);
+        neighborhood_cache_->setInputCloud (cloud);
+        neighborhood_cache_->clear ();
+        neighborhood_cache_->setRadius (support_radius_);
         for (size_t i = 0; i < keypoint_extractor_.size (); i++)
         {
             keypoint_extractor_[i]->setInputCloud (cloud);
@@ -576,6 +568,7 @@ protected:
                 keypoint_extractor_[i]->setNormals (normals);
 
             keypoint_extractor_[i]->setSupportRadius (support_radius_);
+            keypoint_extractor_[i]->setNeighborhoodCache (neighborhood_cache_);
 
             PointInTPtr detected_keypoints;
             //std::vector<int> keypoint_indices;
@@ -588,12 +581,34 @@ protected:
         }
     }
 
+    /**
+     * \brief Lets a SHOT-like estimator (input cloud = keypoints, search surface = cloud of computeKeypoints) take
+     * the support neighbourhoods and the local reference frames of the keypoints from the neighbourhood cache
+     */
+    template<typename EstimatorT> void
+    setCachedSearch (EstimatorT & estimator, const PointInTPtr & keypoints)
+    {
+        typename CachedNeighborSearch<PointInT>::Ptr search (new CachedNeighborSearch<PointInT> (neighborhood_cache_));
+        estimator.setSearchMethod (search);
+
+        //keypoint extractors without indices
+        if (keypoint_indices_.indices.size () != keypoints->points.size ())
+            return;
+
+        neighborhood_cache_->setRadius (support_radius_);
+        pcl::PointCloud<pcl::ReferenceFrame>::Ptr frames (new pcl::PointCloud<pcl::ReferenceFrame>);
+        neighborhood_cache_->computeReferenceFrames (keypoint_indices_.indices, *frames);
+        search->setQueryCloud (keypoints.get (), keypoint_indices_.indices);
+        estimator.setInputReferenceFrames (frames);
+    }
+
 public:
 
     LocalEstimator ()
     {
         adaptative_MLS_ = false;
         keypoint_extractor_.clear ();
+        neighborhood_cache_.reset (new KeypointNeighborhoodCache<PointInT>);
     }
 
 
@@ -676,6 +691,11 @@ public:
         normals = normals_;
     }
 
+    typename KeypointNeighborhoodCache<PointInT>::Ptr getNeighborhoodCache() const
+    {
+        return neighborhood_cache_;
+    }
+
     /*void
          setFilterPlanar (bool b)
          {
@@ -16,6 +16,10 @@
 #include <v4r/ORRecognition/correspondence_grouping.h>
 #include <v4r/ORRecognition/hypotheses_verification.h>
 #include "recognizer.h"
+#include "training_manifest.h"
+#include "ivfpq_index.h"
+#include "model_database.h"
+#include <boost/function.hpp>
 
 inline bool
 correspSorter (const pcl::Correspondence & i, const pcl::Correspondence & j)
@@ -60,6 +64,9 @@ namespace faat_pcl
           using Recognizer<PointInT>::input_;
           using Recognizer<PointInT>::models_;
           using Recognizer<PointInT>::transforms_;
+          using Recognizer<PointInT>::models_before_hv_;
+          using Recognizer<PointInT>::transforms_before_hv_;
+          using Recognizer<PointInT>::icp_scene_indices_;
           using Recognizer<PointInT>::ICP_iterations_;
           using Recognizer<PointInT>::icp_type_;
           using Recognizer<PointInT>::VOXEL_SIZE_ICP_;
@@ -97,9 +104,22 @@ namespace faat_pcl
           /** \brief Computes a feature */
           typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > estimator_;
 
+          /** \brief Creates additional estimators so that views can be trained in parallel */
+          boost::function<typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > ()> estimator_factory_;
+
+          /** \brief Maximum number of threads used for training (0 means one per core) */
+          int max_training_threads_;
+
           /** \brief Point-to-point correspondence grouping algorithm */
           typename boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointInT, PointInT> > cg_algorithm_;
 
+          /** \brief Creates additional CG and HV instances so that the scenes of a batch are processed in parallel */
+          boost::function<typename boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointInT, PointInT> > ()> cg_algorithm_factory_;
+          boost::function<typename boost::shared_ptr<faat_pcl::HypothesisVerification<PointInT, PointInT> > ()> hv_algorithm_factory_;
+
+          /** \brief Maximum number of threads used by recognizeBatch (0 means one per core) */
+          int max_recognition_threads_;
+
           /** \brief Descriptor name */
           std::string descr_name_;
 
@@ -110,6 +130,14 @@ namespace faat_pcl
           flann::Index<DistT> * flann_index_;
           //flann::NNIndex<DistT> * flann_index_;
 
+          /** \brief Compressed index replacing flann_index_ if use_compressed_index_ is set */
+          boost::shared_ptr<IVFPQIndex> compressed_index_;
+          bool use_compressed_index_;
+          int compressed_nlist_;
+          int compressed_m_;
+          int compressed_nprobe_;
+          int compressed_rerank_;
+
           std::map< std::pair< ModelTPtr, int >, std::vector<int> > model_view_id_to_flann_models_;
           std::vector<flann_model> flann_models_;
           std::vector<codebook_model> codebook_models_;
@@ -146,6 +174,38 @@ namespace faat_pcl
           void
           loadFeaturesAndCreateFLANN ();
 
+          /**
+           * \brief Loads flann_models_ and the caches of all models. Without load_descriptors only the model, view and
+           * keypoint of each descriptor are kept (a loaded compressed index has the descriptors).
+           */
+          void
+          loadFeatures (std::vector<ModelTPtr> & models, bool load_descriptors);
+
+          /**
+           * \brief Appends the descriptors of one view to flann_models_
+           */
+          void
+          addFlannModels (flann_model & descr_model, const typename pcl::PointCloud<FeatureT>::Ptr & signature, int & idx_flann_models);
+
+          /**
+           * \brief Appends n_keypoints entries of one view to flann_models_, without descriptors
+           */
+          void
+          addFlannModels (flann_model & descr_model, size_t n_keypoints, int & idx_flann_models);
+
+          /**
+           * \brief Loads the descriptors of a model from its model database and fills the pose, keypoint and normal caches
+           */
+          void
+          loadFeaturesFromDatabase (const ModelDatabase & db, ModelTPtr & model, int & idx_flann_models, bool load_descriptors);
+
+          /**
+           * \brief Fingerprint of the descriptor files of all models (names, sizes and modification times), a saved
+           * compressed index is reused if it was built for the same fingerprint
+           */
+          uint64_t
+          computeDescriptorsFingerprint (const std::vector<ModelTPtr> & models);
+
           template <typename Type>
           inline void
           convertToFLANN (const std::vector<Type> &models, flann::Matrix<float> &data)
@@ -170,6 +230,26 @@ namespace faat_pcl
           void
           nearestKSearch (flann::Index<DistT> * index, flann::Matrix<float> & p, int k, flann::Matrix<int> &indices, flann::Matrix<float> &distances);
 
+          std::string
+          getCompressedIndexFN () const
+          {
+            return flann_index_fn_ + "_ivfpq.bin";
+          }
+
+          /** \brief Raw descriptors mapped by the compressed index for re-ranking */
+          std::string
+          getCompressedIndexDataFN () const
+          {
+            return flann_index_fn_ + "_ivfpq_raw.bin";
+          }
+
+          /**
+           * \brief Computes and saves descriptors, keypoints and normals of one view of a model.
+           * Returns false if some file could not be written.
+           */
+          bool
+          trainView (typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > & estimator, ModelT & model, int v);
+
           void
           getPose (ModelT & model, int view_id, Eigen::Matrix4f & pose_matrix);
 
@@ -185,6 +265,32 @@ namespace faat_pcl
           void
           getView (ModelT & model, int view_id, PointInTPtr & view);
 
+          void
+          computeFeatures (typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > & estimator, const PointInTPtr & input,
+                           PointInTPtr & processed, PointInTPtr & keypoints_pointcloud, typename pcl::PointCloud<FeatureT>::Ptr & signatures);
+
+          void
+          computeSceneNormals (typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > & estimator, const PointInTPtr & input,
+                               PointInTPtr & processed, PointInTPtr & keypoints_pointcloud, pcl::PointCloud<pcl::Normal>::Ptr & scene_normals);
+
+          /**
+           * \brief Builds the object hypotheses of one scene from the knn_ nearest neighbours of each signature
+           * (row-major, one row of knn_ entries per signature).
+           */
+          void
+          generateHypotheses (const typename pcl::PointCloud<FeatureT>::Ptr & signatures, const int * nn_indices, const float * nn_distances,
+                              std::map<std::string, ObjectHypothesis<PointInT> > & object_hypotheses);
+
+          /**
+           * \brief Clusters the correspondences of each object hypothesis and appends the resulting poses.
+           */
+          void
+          groupHypotheses (typename boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointInT, PointInT> > & cg,
+                           PointInTPtr & processed, PointInTPtr & keypoints_pointcloud, pcl::PointCloud<pcl::Normal>::Ptr & scene_normals,
+                           std::map<std::string, ObjectHypothesis<PointInT> > & object_hypotheses,
+                           std::vector<ModelTPtr> & models,
+                           std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > & transforms);
+
           void
           drawCorrespondences (PointInTPtr & cloud, ObjectHypothesis<PointInT> & oh, PointInTPtr & keypoints_pointcloud, pcl::Correspondences & correspondences)
           {
@@ -237,6 +343,12 @@ namespace faat_pcl
 
           }
 
+          /** \brief True if the CG relies on state prepared by prepareSpecificCG, which forces sequential grouping in recognizeBatch */
+          virtual bool usesSpecificCG() const
+          {
+            return false;
+          }
+
 //          virtual void cgVerificationAndPoseEstimation(
 //                    PointInTPtr keypoints_pointcloud,
 //                    PointInTPtr processed,
@@ -260,6 +372,14 @@ namespace faat_pcl
           distance_same_keypoint_ = 0.001f * 0.001f;
           max_descriptor_distance_ = std::numeric_limits<float>::infinity();
           correspondence_distance_constant_weight_ = 1.f;
+          max_training_threads_ = 0;
+          max_recognition_threads_ = 0;
+          flann_index_ = 0;
+          use_compressed_index_ = false;
+          compressed_nlist_ = 1024;
+          compressed_m_ = 32;
+          compressed_nprobe_ = 16;
+          compressed_rerank_ = 64;
         }
 
         size_t getFeatureType() const
@@ -332,6 +452,30 @@ namespace faat_pcl
           use_codebook_ = t;
         }
 
+        /**
+         * \brief Matches descriptors with a compressed IVF-PQ index (see IVFPQIndex) instead of the kd-tree forest.
+         * Only the quantized descriptors stay in memory, the raw ones are memory mapped for the exact re-ranking.
+         * Trades a small recall loss for much less memory and faster queries on large model databases.
+         */
+        void
+        setUseCompressedIndex (bool use)
+        {
+          use_compressed_index_ = use;
+        }
+
+        /**
+         * \brief Parameters of the compressed index: number of inverted lists, bytes per descriptor,
+         * lists visited per query and candidates re-ranked with the exact distance
+         */
+        void
+        setCompressedIndexParameters (int nlist, int m, int nprobe, int rerank)
+        {
+          compressed_nlist_ = nlist;
+          compressed_m_ = m;
+          compressed_nprobe_ = nprobe;
+          compressed_rerank_ = rerank;
+        }
+
         void setIndexFN(std::string & in)
         {
           flann_index_fn_ = in;
@@ -396,6 +540,22 @@ namespace faat_pcl
           estimator_ = feat;
         }
 
+        /**
+         * \brief Sets a function returning new, independent instances of the local feature estimator.
+         * If set, initialize() trains (model, view) pairs in parallel, one estimator per thread.
+         */
+        void
+        setFeatureEstimatorFactory (boost::function<typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > ()> factory)
+        {
+          estimator_factory_ = factory;
+        }
+
+        void
+        setMaxTrainingThreads (int n)
+        {
+          max_training_threads_ = n;
+        }
+
         /**
          * \brief Sets the CG algorithm
          */
@@ -405,6 +565,28 @@ namespace faat_pcl
           cg_algorithm_ = alg;
         }
 
+        /**
+         * \brief Sets functions returning new, independent instances of the CG and HV algorithms.
+         * If set, recognizeBatch() groups and verifies the scenes in parallel, one instance per thread.
+         */
+        void
+        setCGAlgorithmFactory (boost::function<typename boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointInT, PointInT> > ()> factory)
+        {
+          cg_algorithm_factory_ = factory;
+        }
+
+        void
+        setHVAlgorithmFactory (boost::function<typename boost::shared_ptr<faat_pcl::HypothesisVerification<PointInT, PointInT> > ()> factory)
+        {
+          hv_algorithm_factory_ = factory;
+        }
+
+        void
+        setMaxRecognitionThreads (int n)
+        {
+          max_recognition_threads_ = n;
+        }
+
         /**
          * \brief Sets the HV algorithm
          */
@@ -448,7 +630,9 @@ namespace faat_pcl
 
         /**
          * \brief Initializes the FLANN structure from the provided source
-         * It does training for the models that havent been trained yet
+         * It does training for the models that havent been trained yet. Progress is kept in a
+         * manifest per model, so an interrupted training resumes where it stopped and models
+         * whose training data changed are retrained.
          */
 
         void
@@ -460,6 +644,18 @@ namespace faat_pcl
 
         void
         recognize ();
+
+        /**
+         * \brief Performs recognition on several scenes at once
+         * The descriptors of all scenes are matched with a single FLANN query, features, grouping and
+         * verification run in parallel if the corresponding factories are set. The results are the
+         * same as calling recognize() for each scene, getModels()/getTransforms() (and the hypotheses before HV)
+         * return the last scene. The ICP scene indices belong to the input cloud and are not used for the batch.
+         */
+        void
+        recognizeBatch (const std::vector<PointInTPtr> & scenes,
+                        std::vector<boost::shared_ptr<std::vector<ModelTPtr> > > & models,
+                        std::vector<boost::shared_ptr<std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > > > & transforms);
       };
   }
 }
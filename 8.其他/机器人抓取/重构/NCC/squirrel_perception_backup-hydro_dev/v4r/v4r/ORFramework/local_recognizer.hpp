@@ -1,19 +1,45 @@
 #include "local_recognizer.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 //#include <pcl/visualization/pcl_visualizer.h>
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  uint64_t
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::computeDescriptorsFingerprint (const std::vector<ModelTPtr> & models)
+  {
+    //the order of the models is the order of the descriptors in the index
+    std::stringstream fp;
+    fp << descr_name_ << " " << sizeof(static_cast<FeatureT *> (0)->histogram) / sizeof(float);
+    for (size_t i = 0; i < models.size (); i++)
+    {
+      std::string path = source_->getModelDescriptorDir (*models[i], training_dir_, descr_name_);
+      fp << " " << models[i]->class_ << "/" << models[i]->id_ << " " << TrainingManifest::computeFingerprint (path);
+    }
+
+    return IVFPQIndex::computeFingerprint (fp.str ());
+  }
+
 template<template<class > class Distance, typename PointInT, typename FeatureT>
   void
-  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::loadFeaturesAndCreateFLANN ()
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::loadFeatures (std::vector<ModelTPtr> & models,
+                                                                                                   bool load_descriptors)
   {
-    boost::shared_ptr < std::vector<ModelTPtr> > models = source_->getModels ();
-    std::cout << "Models size:" << models->size () << std::endl;
-    std::cout << "use cache:" << static_cast<int>(use_cache_) << std::endl;
     int idx_flann_models = 0;
-    for (size_t i = 0; i < models->size (); i++)
+    for (size_t i = 0; i < models.size (); i++)
     {
       pcl::ScopeTime t("Model finished");
 
-      std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
+      std::string path = source_->getModelDescriptorDir (*models[i], training_dir_, descr_name_);
+
+      //a model database replaces the descriptor, keypoint, normal and pose files of the model
+      ModelDatabase db;
+      if (db.load (ModelDatabase::getFilename (path)))
+      {
+        loadFeaturesFromDatabase (db, models[i], idx_flann_models, load_descriptors);
+        continue;
+      }
+
       bf::path inside = path;
       bf::directory_iterator end_itr;
 
@@ -28,7 +54,8 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
         std::vector < std::string > strs;
         boost::split (strs, file_name, boost::is_any_of ("_"));
 
-        if (strs[0] == "descriptor")
+        //skip temporary files left behind by an interrupted training
+        if (strs[0] == "descriptor" && boost::algorithm::ends_with (file_name, ".pcd"))
         {
           //std::cout << "Using cache:" << (int)use_cache_ << std::endl;
           std::string full_file_name = itr_in->path ().string ();
@@ -37,14 +64,14 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
           boost::split (strs, name, boost::is_any_of ("_"));
 
           flann_model descr_model;
-          descr_model.model = models->at (i);
+          descr_model.model = models[i];
           descr_model.view_id = atoi (strs[1].c_str ());
 
           if (use_cache_)
           {
 
             std::stringstream dir_keypoints;
-            std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
+            std::string path = source_->getModelDescriptorDir (*models[i], training_dir_, descr_name_);
             dir_keypoints << path << "/keypoint_indices_" << descr_model.view_id << ".pcd";
 
             std::stringstream dir_pose;
@@ -52,7 +79,7 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
 
             Eigen::Matrix4f pose_matrix;
             PersistenceUtils::readMatrixFromFile2 (dir_pose.str (), pose_matrix);
-            std::pair<std::string, int> pair_model_view = std::make_pair (models->at (i)->id_, descr_model.view_id);
+            std::pair<std::string, int> pair_model_view = std::make_pair (models[i]->id_, descr_model.view_id);
             poses_cache_[pair_model_view] = pose_matrix;
 
             //load keypoints and save them to cache
@@ -76,33 +103,68 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
             }
           }
 
-          typename pcl::PointCloud<FeatureT>::Ptr signature (new pcl::PointCloud<FeatureT> ());
-          pcl::io::loadPCDFile (full_file_name, *signature);
-
-          int size_feat = sizeof(signature->points[0].histogram) / sizeof(float);
-
-          std::vector<int> idx_flann_models_for_this_view;
-          idx_flann_models_for_this_view.reserve(signature->points.size ());
-
-          for (size_t dd = 0; dd < signature->points.size (); dd++)
+          if (load_descriptors)
           {
-            descr_model.keypoint_id = static_cast<int> (dd);
-            descr_model.descr.resize (size_feat);
+            typename pcl::PointCloud<FeatureT>::Ptr signature (new pcl::PointCloud<FeatureT> ());
+            pcl::io::loadPCDFile (full_file_name, *signature);
 
-            memcpy (&descr_model.descr[0], &signature->points[dd].histogram[0], size_feat * sizeof(float));
-
-            flann_models_.push_back (descr_model);
-            idx_flann_models_for_this_view.push_back(idx_flann_models);
-            idx_flann_models++;
+            addFlannModels (descr_model, signature, idx_flann_models);
+          }
+          else
+          {
+            //the number of descriptors is in the header
+            pcl::PCLPointCloud2 header;
+            pcl::PCDReader reader;
+            if (reader.readHeader (full_file_name, header) == 0)
+              addFlannModels (descr_model, static_cast<size_t> (header.width) * header.height, idx_flann_models);
           }
+        }
+      }
+    }
+  }
 
-          std::pair< ModelTPtr, int > pp = std::make_pair(descr_model.model,descr_model.view_id);
-          model_view_id_to_flann_models_[pp] = idx_flann_models_for_this_view;
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::loadFeaturesAndCreateFLANN ()
+  {
+    boost::shared_ptr < std::vector<ModelTPtr> > models = source_->getModels ();
+    std::cout << "Models size:" << models->size () << std::endl;
+    std::cout << "use cache:" << static_cast<int>(use_cache_) << std::endl;
 
-        }
+    //a saved compressed index of the same descriptor files replaces the descriptors, it is validated with the
+    //metadata of the files so that neither the descriptors nor the raw file of the index have to be read
+    uint64_t descriptors_fingerprint = 0;
+    bool compressed_index_loaded = false;
+    if (use_compressed_index_)
+    {
+      compressed_index_.reset (new IVFPQIndex);
+      compressed_index_->setNumberOfLists (compressed_nlist_);
+      compressed_index_->setNumberOfSubquantizers (compressed_m_);
+      compressed_index_->setNumberOfProbes (compressed_nprobe_);
+      compressed_index_->setRerankCandidates (compressed_rerank_);
+
+      descriptors_fingerprint = computeDescriptorsFingerprint (*models);
+      if (bf::exists (getCompressedIndexFN ()) && bf::exists (getCompressedIndexDataFN ()))
+      {
+        pcl::ScopeTime t("Loading compressed index");
+        compressed_index_loaded = compressed_index_->load (getCompressedIndexFN (), getCompressedIndexDataFN ())
+            && compressed_index_->getFingerprint () == descriptors_fingerprint;
       }
     }
 
+    loadFeatures (*models, !compressed_index_loaded);
+
+    int size_feat = sizeof(static_cast<FeatureT *> (0)->histogram) / sizeof(float);
+    if (compressed_index_loaded
+        && (compressed_index_->size () != flann_models_.size () || compressed_index_->getDimension () != static_cast<size_t> (size_feat)))
+    {
+      std::cout << "The compressed index does not match the descriptors, rebuilding it" << std::endl;
+      compressed_index_loaded = false;
+      flann_models_.clear ();
+      model_view_id_to_flann_models_.clear ();
+      loadFeatures (*models, true);
+    }
+
     specificLoadFeaturesAndCreateFLANN();
     std::cout << "Number of features:" << flann_models_.size () << std::endl;
 
@@ -191,41 +253,151 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
       PCL_INFO("Farther away than threshold %d\n", higher_than_thres);
     }*/
 
+    //with a loaded compressed index flann_models_ has no descriptors to convert
     std::string filename;
     if(codebook_models_.size() > 0) {
       convertToFLANN<codebook_model> (codebook_models_, flann_data_);
       filename = cb_flann_index_fn_;
-    } else {
+    } else if (!compressed_index_loaded) {
       convertToFLANN<flann_model> (flann_models_, flann_data_);
       filename = flann_index_fn_;
     }
 
+    if (use_compressed_index_ && !compressed_index_loaded)
+    {
+      pcl::ScopeTime t("Building and saving compressed index");
+      compressed_index_->setFingerprint (descriptors_fingerprint);
+      if (!codebook_models_.empty ()
+          || !compressed_index_->build (flann_data_.ptr (), flann_data_.rows, flann_data_.cols, getCompressedIndexDataFN ())
+          || !compressed_index_->save (getCompressedIndexFN ()))
+      {
+        PCL_ERROR("Could not create the compressed index, using the kd-tree index\n");
+        compressed_index_.reset ();
+      }
+
+      //the raw descriptors are now memory mapped by the compressed index
+      if (compressed_index_)
+      {
+        delete[] flann_data_.ptr ();
+        flann_data_ = flann::Matrix<float> ();
+      }
+    }
+
+    if (!compressed_index_)
+    {
 #if defined (_WIN32)
-    flann_index_ = new flann::Index<DistT> (flann_data_, flann::KDTreeIndexParams (4));
-    flann_index_->buildIndex ();
-#else
-    bf::path idx_file_path = filename;
-    if(bf::exists(idx_file_path)) {
-      pcl::ScopeTime t("Loading flann index");
-      flann_index_ = new flann::Index<DistT> (flann_data_, flann::SavedIndexParams (filename));
-    } else {
-      pcl::ScopeTime t("Building and saving flann index");
       flann_index_ = new flann::Index<DistT> (flann_data_, flann::KDTreeIndexParams (4));
       flann_index_->buildIndex ();
-      flann_index_->save (filename);
-    }
+#else
+      bf::path idx_file_path = filename;
+      if(bf::exists(idx_file_path)) {
+        pcl::ScopeTime t("Loading flann index");
+        flann_index_ = new flann::Index<DistT> (flann_data_, flann::SavedIndexParams (filename));
+      } else {
+        pcl::ScopeTime t("Building and saving flann index");
+        flann_index_ = new flann::Index<DistT> (flann_data_, flann::KDTreeIndexParams (4));
+        flann_index_->buildIndex ();
+        flann_index_->save (filename);
+      }
 #endif
+    }
 
     //once the descriptors in flann_models_ have benn converted to flann_data_, i can delete them
+    //(swap releases the memory, clear would keep the capacity)
     for(size_t i=0; i < flann_models_.size(); i++)
-      flann_models_[i].descr.clear();
+      std::vector<float> ().swap (flann_models_[i].descr);
 
     for(size_t i=0; i < codebook_models_.size(); i++)
-      codebook_models_[i].descr.clear();
+      std::vector<float> ().swap (codebook_models_[i].descr);
 
     std::cout << "End load feature and create flann" << std::endl;
   }
 
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::addFlannModels (flann_model & descr_model,
+                                                                                                     const typename pcl::PointCloud<FeatureT>::Ptr & signature,
+                                                                                                     int & idx_flann_models)
+  {
+    int size_feat = sizeof(signature->points[0].histogram) / sizeof(float);
+
+    size_t first = flann_models_.size ();
+    addFlannModels (descr_model, signature->points.size (), idx_flann_models);
+
+    for (size_t dd = 0; dd < signature->points.size (); dd++)
+      flann_models_[first + dd].descr.assign (signature->points[dd].histogram, signature->points[dd].histogram + size_feat);
+  }
+
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::addFlannModels (flann_model & descr_model,
+                                                                                                     size_t n_keypoints,
+                                                                                                     int & idx_flann_models)
+  {
+    std::vector<int> idx_flann_models_for_this_view;
+    idx_flann_models_for_this_view.reserve(n_keypoints);
+
+    descr_model.descr.clear ();
+    for (size_t dd = 0; dd < n_keypoints; dd++)
+    {
+      descr_model.keypoint_id = static_cast<int> (dd);
+
+      flann_models_.push_back (descr_model);
+      idx_flann_models_for_this_view.push_back(idx_flann_models);
+      idx_flann_models++;
+    }
+
+    std::pair< ModelTPtr, int > pp = std::make_pair(descr_model.model,descr_model.view_id);
+    model_view_id_to_flann_models_[pp] = idx_flann_models_for_this_view;
+  }
+
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::loadFeaturesFromDatabase (const ModelDatabase & db,
+                                                                                                               ModelTPtr & model,
+                                                                                                               int & idx_flann_models,
+                                                                                                               bool load_descriptors)
+  {
+    bool load_normals = (cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_;
+
+    for (size_t v = 0; v < db.size (); v++)
+    {
+      const ModelDatabase::View & view = db.getViewAt (v);
+
+      typename pcl::PointCloud<FeatureT>::Ptr signature (new pcl::PointCloud<FeatureT> ());
+      if (load_descriptors ? !db.getCloud (view, "descriptor", *signature) : (view.clouds_.count ("descriptor") == 0))
+        continue;
+
+      flann_model descr_model;
+      descr_model.model = model;
+      descr_model.view_id = view.id_;
+
+      //the data is in memory anyway, so it goes to the caches also without use_cache_
+      std::pair<std::string, int> pair_model_view = std::make_pair (model->id_, view.id_);
+      poses_cache_[pair_model_view] = view.pose_;
+
+      typename pcl::PointCloud<PointInT>::Ptr keypoints (new pcl::PointCloud<PointInT> ());
+      db.getCloud (view, "keypoint_indices", *keypoints);
+      keypoints_cache_[pair_model_view] = keypoints;
+
+      if (load_normals)
+      {
+        pcl::PointCloud<pcl::Normal>::Ptr normals_cloud (new pcl::PointCloud<pcl::Normal> ());
+        db.getCloud (view, "normals", *normals_cloud);
+        normals_cache_[pair_model_view] = normals_cloud;
+
+        pcl::PointCloud<IndexPoint>::Ptr index_cloud (new pcl::PointCloud<IndexPoint> ());
+        db.getCloud (view, "keypoints_indices_to_processed_and_normals", *index_cloud);
+        idxpoint_cache_[pair_model_view] = index_cloud;
+      }
+
+      if (load_descriptors)
+        addFlannModels (descr_model, signature, idx_flann_models);
+      else
+        addFlannModels (descr_model, db.getCloudSize (view, "descriptor"), idx_flann_models);
+    }
+  }
+
 template<template<class > class Distance, typename PointInT, typename FeatureT>
   void
   faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::nearestKSearch (flann::Index<DistT> * index,
@@ -234,9 +406,132 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
                                                                                                      flann::Matrix<int> &indices,
                                                                                                      flann::Matrix<float> &distances)
   {
+    if (compressed_index_)
+    {
+      for (size_t r = 0; r < p.rows; r++)
+        compressed_index_->knnSearch (p[r], k, indices[r], distances[r], DistT ());
+      return;
+    }
+
     index->knnSearch (p, indices, distances, k, flann::SearchParams (kdtree_splits_));
   }
 
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  bool
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::trainView (
+                                                                                              typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > & estimator,
+                                                                                              ModelT & model, int v)
+  {
+    PointInTPtr processed (new pcl::PointCloud<PointInT>);
+    typename pcl::PointCloud<FeatureT>::Ptr signatures (new pcl::PointCloud<FeatureT> ());
+    PointInTPtr keypoints_pointcloud;
+
+    if(model.indices_ && (model.indices_->at (v).indices.size() > 0) && estimator->acceptsIndices())
+    {
+      estimator->setIndices(model.indices_->at (v));
+    }
+
+    bool success = estimator->estimate (model.views_->at (v), processed, keypoints_pointcloud, signatures);
+
+    //nothing to save for this view, but it is done
+    if (!success)
+    {
+      std::cout << "Could not compute features for " << model.id_ << " view " << v << std::endl;
+      return true;
+    }
+
+    std::string path = source_->getModelDescriptorDir (model, training_dir_, descr_name_);
+
+    //all files are written under a temporary name and renamed afterwards, the view is added to the manifest
+    //by the caller once everything is in place
+    bool saved = true;
+
+    std::stringstream path_view;
+    path_view << path << "/view_" << v << ".pcd";
+    saved &= PersistenceUtils::savePCDFileBinaryAtomic (path_view.str (), *processed);
+
+    std::stringstream path_pose;
+    path_pose << path << "/pose_" << v << ".txt";
+    saved &= PersistenceUtils::writeMatrixToFileAtomic (path_pose.str (), model.poses_->at (v));
+
+    if(static_cast<size_t>(v) < model.self_occlusions_->size()) {
+      std::stringstream path_entropy;
+      path_entropy << path << "/entropy_" << v << ".txt";
+      saved &= PersistenceUtils::writeFloatToFileAtomic (path_entropy.str (), model.self_occlusions_->at (v));
+    }
+
+    //save keypoints and signatures to disk
+    std::stringstream keypoints_sstr;
+    keypoints_sstr << path << "/keypoint_indices_" << v << ".pcd";
+    saved &= PersistenceUtils::savePCDFileBinaryAtomic (keypoints_sstr.str (), *keypoints_pointcloud);
+
+    pcl::PointCloud<pcl::Normal>::Ptr normals;
+    PointInTPtr processed_normals = processed;
+    if(estimator->needNormals())
+    {
+      estimator->getNormals(normals);
+    }
+    else if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
+    {
+      //the cg alg require normals but the estimator did not compute them, compute them now
+      boost::shared_ptr<faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal> > normal_estimator;
+      normal_estimator.reset (new faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal>);
+      normal_estimator->setCMR (false);
+      normal_estimator->setDoVoxelGrid (false);
+      normal_estimator->setRemoveOutliers (false);
+      normal_estimator->setValuesForCMRFalse (0.003f, 0.02f);
+      normal_estimator->setForceUnorganized(true);
+
+      if(estimator->acceptsIndices())
+      {
+        pcl::PointIndices indices;
+        estimator->getKeypointIndices(indices);
+        normal_estimator->setIndices(indices.indices);
+      }
+
+      processed_normals.reset (new pcl::PointCloud<PointInT>);
+      normals.reset (new pcl::PointCloud<pcl::Normal>);
+      normal_estimator->estimate (model.views_->at (v), processed_normals, normals);
+    }
+
+    if (normals)
+    {
+      //save normals to disk...
+      std::stringstream normals_sstr;
+      normals_sstr << path << "/normals_" << v << ".pcd";
+      saved &= PersistenceUtils::savePCDFileBinaryAtomic (normals_sstr.str (), *normals);
+
+      //use the keypoints point cloud to find the NN in processed, so we can have indices between keypoints and processed,normals
+      pcl::octree::OctreePointCloudSearch<PointInT> octree (0.005);
+      octree.setInputCloud (processed_normals);
+      octree.addPointsFromInputCloud ();
+
+      std::vector<int> pointIdxNKNSearch;
+      std::vector<float> pointNKNSquaredDistance;
+      pcl::PointCloud<IndexPoint> keypoints_indices_to_processed;
+      for(size_t j=0; j < keypoints_pointcloud->points.size(); j++)
+      {
+        if (octree.nearestKSearch (keypoints_pointcloud->points[j], 1, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
+        {
+          IndexPoint ip;
+          ip.idx = pointIdxNKNSearch[0];
+          keypoints_indices_to_processed.push_back(ip);
+        }
+      }
+
+      std::stringstream kitp_sstr;
+      kitp_sstr << path << "/keypoints_indices_to_processed_and_normals_" << v << ".pcd";
+      saved &= PersistenceUtils::savePCDFileBinaryAtomic (kitp_sstr.str (), keypoints_indices_to_processed);
+    }
+
+    //the descriptor is written last, loadFeaturesAndCreateFLANN only picks up views that have one
+    std::stringstream path_descriptor;
+    path_descriptor << path << "/descriptor_" << v << ".pcd";
+    saved &= PersistenceUtils::savePCDFileBinaryAtomic (path_descriptor.str (), *signatures);
+
+    return saved;
+  }
+
 template<template<class > class Distance, typename PointInT, typename FeatureT>
   void
   faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::initialize (bool force_retrain)
@@ -267,182 +562,153 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
       }
     }
 
+    //find out which (model, view) pairs still need to be trained
+    std::vector<TrainingManifest> manifests (models->size ());
+    std::vector<int> views_left (models->size (), 0);
+    std::vector<bool> training_failed (models->size (), false);
+    std::vector<std::pair<int, int> > jobs;
+    bool retrained = false;
+
     for (size_t i = 0; i < models->size (); i++)
     {
-      std::cout << models->at (i)->class_ << " " << models->at (i)->id_ << std::endl;
+      ModelT & model = *models->at (i);
+      std::cout << model.class_ << " " << model.id_ << std::endl;
 
-      if (!source_->modelAlreadyTrained (*models->at (i), training_dir_, descr_name_))
+      std::string path = source_->getModelDescriptorDir (model, training_dir_, descr_name_);
+      std::string fingerprint = TrainingManifest::computeFingerprint (source_->getModelDirectory (model, training_dir_), model.source_file_);
+
+      bool has_manifest = false;
+      if (source_->modelAlreadyTrained (model, training_dir_, descr_name_))
       {
-        std::cout << "Model not trained..." << models->at (i)->views_->size () << std::endl;
-        if(!source_->getLoadIntoMemory())
-          source_->loadInMemorySpecificModel(training_dir_, *(models->at (i)));
+        has_manifest = manifests[i].load (path);
 
-        std::cout << "number of views:" << models->at (i)->views_->size () << " " << source_->getLoadIntoMemory() << std::endl;
-        for (size_t v = 0; v < models->at (i)->views_->size (); v++)
+        if (!has_manifest)
         {
-          PointInTPtr processed (new pcl::PointCloud<PointInT>);
-          typename pcl::PointCloud<FeatureT>::Ptr signatures (new pcl::PointCloud<FeatureT> ());
-          PointInTPtr keypoints_pointcloud;
+          //trained before manifests existed, trust it
+          std::cout << "Model already trained..." << std::endl;
+          model.views_->clear();
+          continue;
+        }
 
-          if(models->at(i)->indices_)
-          {
-              std::cout << models->at(i)->indices_->at (v).indices.size() << " " << estimator_->acceptsIndices() << std::endl;
-          }
-          else
-          {
-              std::cout << "indices are not defined";
-          }
+        if (manifests[i].getFingerprint () != fingerprint)
+        {
+          std::cout << "Training data of " << model.id_ << " changed, retraining..." << std::endl;
+          source_->removeDescDirectory (model, training_dir_, descr_name_);
+          has_manifest = false;
+        }
+        else if (manifests[i].isComplete ())
+        {
+          std::cout << "Model already trained..." << std::endl;
+          //there is no need to keep the views in memory once the model has been trained
+          model.views_->clear();
+          continue;
+        }
+      }
 
-          if(models->at(i)->indices_ && (models->at(i)->indices_->at (v).indices.size() > 0)
-                                     && estimator_->acceptsIndices())
-          {
-            std::cout << "accepts indices:" << estimator_->acceptsIndices() << " size:" << models->at(i)->indices_->at (v).indices.size() << std::endl;
-            estimator_->setIndices(models->at(i)->indices_->at (v));
-          }
-          else
-          {
-              std::cout << "accepts indices:" << estimator_->acceptsIndices() << std::endl;
-          }
+      retrained = true;
 
-          bool success = estimator_->estimate (models->at (i)->views_->at (v), processed, keypoints_pointcloud, signatures);
-          std::cout << "success:" << success << std::endl;
+      //a model database of this descriptor would miss the views trained now
+      bf::path db_file_path = ModelDatabase::getFilename (path);
+      if (bf::exists (db_file_path))
+        bf::remove (db_file_path);
 
-          if (success)
-          {
-            std::string path = source_->getModelDescriptorDir (*models->at (i), training_dir_, descr_name_);
+      if(!source_->getLoadIntoMemory())
+        source_->loadInMemorySpecificModel(training_dir_, model);
 
-            bf::path desc_dir = path;
-            if (!bf::exists (desc_dir))
-              bf::create_directory (desc_dir);
+      bf::path desc_dir = path;
+      if (!bf::exists (desc_dir))
+        bf::create_directory (desc_dir);
 
-            std::stringstream path_view;
-            path_view << path << "/view_" << v << ".pcd";
-            pcl::io::savePCDFileBinary (path_view.str (), *processed);
+      if (!has_manifest)
+        manifests[i].create (path, fingerprint);
+      else
+        std::cout << "Resuming training of " << model.id_ << ", " << manifests[i].getNumberOfDoneViews () << " views already done" << std::endl;
 
-            std::stringstream path_pose;
-            path_pose << path << "/pose_" << v << ".txt";
-            PersistenceUtils::writeMatrixToFile (path_pose.str (), models->at (i)->poses_->at (v));
+      for (size_t v = 0; v < model.views_->size (); v++)
+      {
+        if (!manifests[i].isViewDone (static_cast<int> (v)))
+        {
+          jobs.push_back (std::make_pair (static_cast<int> (i), static_cast<int> (v)));
+          views_left[i]++;
+        }
+      }
 
-            if(v < models->at (i)->self_occlusions_->size()) {
-              std::stringstream path_entropy;
-              path_entropy << path << "/entropy_" << v << ".txt";
-              PersistenceUtils::writeFloatToFile (path_entropy.str (), models->at (i)->self_occlusions_->at (v));
-            }
+      if (views_left[i] == 0)
+      {
+        manifests[i].setComplete ();
+        if(!source_->getLoadIntoMemory())
+          model.views_->clear();
+      }
+    }
 
-            //save keypoints and signatures to disk
-            std::stringstream keypoints_sstr;
-            keypoints_sstr << path << "/keypoint_indices_" << v << ".pcd";
-            pcl::io::savePCDFileBinary (keypoints_sstr.str (), *keypoints_pointcloud);
+    //one estimator per thread, estimators keep per-call state (indices, normals, keypoints)
+    int num_threads = 1;
+    if (estimator_factory_ && jobs.size () > 1)
+    {
+#ifdef _OPENMP
+      num_threads = omp_get_num_procs ();
+#endif
+      if (max_training_threads_ > 0)
+        num_threads = std::min (num_threads, max_training_threads_);
 
-            std::stringstream path_descriptor;
-            path_descriptor << path << "/descriptor_" << v << ".pcd";
-            pcl::io::savePCDFileBinary (path_descriptor.str (), *signatures);
+      num_threads = std::min (num_threads, static_cast<int> (jobs.size ()));
+    }
 
-            if(estimator_->needNormals())
-            {
-              PCL_WARN("estimator needs normals\n");
-
-              //save normals to disk...
-              std::stringstream normals_sstr;
-              normals_sstr << path << "/normals_" << v << ".pcd";
-              pcl::PointCloud<pcl::Normal>::Ptr normals;
-              estimator_->getNormals(normals);
-              pcl::io::savePCDFileBinary (normals_sstr.str (), *normals);
-
-              //use the keypoints point cloud to find the NN in processed, so we can have indices between keypoints and processed,normals
-              pcl::octree::OctreePointCloudSearch<PointInT> octree (0.005);
-              octree.setInputCloud (processed);
-              octree.addPointsFromInputCloud ();
-
-              std::vector<int> pointIdxNKNSearch;
-              std::vector<float> pointNKNSquaredDistance;
-              pcl::PointCloud<IndexPoint> keypoints_indices_to_processed;
-              for(size_t j=0; j < keypoints_pointcloud->points.size(); j++)
-              {
-                if (octree.nearestKSearch (keypoints_pointcloud->points[j], 1, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
-                {
-                  IndexPoint ip;
-                  ip.idx = pointIdxNKNSearch[0];
-                  keypoints_indices_to_processed.push_back(ip);
-                }
-              }
+    std::vector<typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > > estimators (num_threads);
+    estimators[0] = estimator_;
+    for (int t = 1; t < num_threads; t++)
+      estimators[t] = estimator_factory_ ();
 
-              std::stringstream kitp_sstr;
-              kitp_sstr << path << "/keypoints_indices_to_processed_and_normals_" << v << ".pcd";
-              pcl::io::savePCDFileBinary (kitp_sstr.str (), keypoints_indices_to_processed);
-            }
-            else
-            {
-              PCL_WARN("estimator does not need normals\n");
+    std::cout << "Training " << jobs.size () << " views with " << num_threads << " threads" << std::endl;
 
-              //the cg alg require normals but the estimator did not compute them, compute them now
-              if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
-              {
-                PCL_ERROR("Need to compute normals due to the cg algorithm\n");
-                boost::shared_ptr<faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal> > normal_estimator;
-                normal_estimator.reset (new faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal>);
-                normal_estimator->setCMR (false);
-                normal_estimator->setDoVoxelGrid (false);
-                normal_estimator->setRemoveOutliers (false);
-                normal_estimator->setValuesForCMRFalse (0.003f, 0.02f);
-                normal_estimator->setForceUnorganized(true);
-
-                if(estimator_->acceptsIndices())
-                {
-                  pcl::PointIndices indices;
-                  estimator_->getKeypointIndices(indices);
-                  normal_estimator->setIndices(indices.indices);
-                }
-                PointInTPtr processed (new pcl::PointCloud<PointInT>);
-                pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
-                normal_estimator->estimate (models->at (i)->views_->at (v), processed, normals);
-
-                std::stringstream normals_sstr;
-                normals_sstr << path << "/normals_" << v << ".pcd";
-                pcl::io::savePCDFileBinary (normals_sstr.str (), *normals);
-
-                //use the keypoints point cloud to find the NN in processed, so we can have indices between keypoints and processed,normals
-                pcl::octree::OctreePointCloudSearch<PointInT> octree (0.005);
-                octree.setInputCloud (processed);
-                octree.addPointsFromInputCloud ();
-
-                std::vector<int> pointIdxNKNSearch;
-                std::vector<float> pointNKNSquaredDistance;
-                pcl::PointCloud<IndexPoint> keypoints_indices_to_processed;
-                for(size_t j=0; j < keypoints_pointcloud->points.size(); j++)
-                {
-                  if (octree.nearestKSearch (keypoints_pointcloud->points[j], 1, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
-                  {
-                    IndexPoint ip;
-                    ip.idx = pointIdxNKNSearch[0];
-                    keypoints_indices_to_processed.push_back(ip);
-                  }
-                }
-
-                std::stringstream kitp_sstr;
-                kitp_sstr << path << "/keypoints_indices_to_processed_and_normals_" << v << ".pcd";
-                pcl::io::savePCDFileBinary (kitp_sstr.str (), keypoints_indices_to_processed);
-
-                //should we take the normals from the model?
-              }
-              else
-              {
-                  PCL_WARN("gc algorithm does not need normals\n");
-              }
-            }
-          }
-        }
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+    for (int j = 0; j < static_cast<int> (jobs.size ()); j++)
+    {
+#ifdef _OPENMP
+      int thread_id = omp_get_thread_num ();
+#else
+      int thread_id = 0;
+#endif
+      int i = jobs[j].first;
+      int v = jobs[j].second;
+      bool saved = trainView (estimators[thread_id], *models->at (i), v);
 
-        if(!source_->getLoadIntoMemory())
-          models->at (i)->views_->clear();
+#pragma omp critical (training_manifest)
+      {
+        if (saved)
+          manifests[i].addView (v);
+        else
+          training_failed[i] = true;
 
-      } else {
-        std::cout << "Model already trained..." << std::endl;
-        //there is no need to keep the views in memory once the model has been trained
-        models->at (i)->views_->clear();
+        views_left[i]--;
+        if (views_left[i] == 0)
+        {
+          if (!training_failed[i])
+            manifests[i].setComplete ();
+          else
+            PCL_ERROR("Some views of %s could not be saved, they will be trained again next time\n", models->at (i)->id_.c_str ());
+
+          if(!source_->getLoadIntoMemory())
+            models->at (i)->views_->clear();
+        }
       }
     }
 
+    //a saved index does not contain the descriptors that have just been computed
+    if (retrained)
+    {
+      bf::path idx_file_path = flann_index_fn_;
+      if (bf::exists (idx_file_path))
+        bf::remove (idx_file_path);
+
+      bf::path cb_idx_file_path = cb_flann_index_fn_;
+      if (bf::exists (cb_idx_file_path))
+        bf::remove (cb_idx_file_path);
+
+      if (bf::exists (getCompressedIndexFN ()))
+        bf::remove (getCompressedIndexFN ());
+    }
+
     loadFeaturesAndCreateFLANN ();
 
    if(ICP_iterations_ > 0 && icp_type_ == 1)
@@ -452,229 +718,231 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
 
 template<template<class > class Distance, typename PointInT, typename FeatureT>
   void
-  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::recognize ()
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::computeFeatures (
+                                                                                                    typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > & estimator,
+                                                                                                    const PointInTPtr & input,
+                                                                                                    PointInTPtr & processed,
+                                                                                                    PointInTPtr & keypoints_pointcloud,
+                                                                                                    typename pcl::PointCloud<FeatureT>::Ptr & signatures)
   {
-
-    models_.reset (new std::vector<ModelTPtr>);
-    transforms_.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
-
-    PointInTPtr processed;
-    typename pcl::PointCloud<FeatureT>::Ptr signatures (new pcl::PointCloud<FeatureT> ());
-    PointInTPtr keypoints_pointcloud;
-
+    processed.reset( (new pcl::PointCloud<PointInT>));
+    if (indices_.size () > 0)
     {
-      pcl::ScopeTime t("Compute keypoints and features");
-      if (signatures_ != 0 && processed_ != 0 && (signatures_->size () == keypoints_input_->points.size ()))
+      if(estimator->acceptsIndices())
       {
-        keypoints_pointcloud = keypoints_input_;
-        signatures = signatures_;
-        processed = processed_;
-        std::cout << "Using the ISPK ..." << std::endl;
+        estimator->setIndices(indices_);
+        estimator->estimate (input, processed, keypoints_pointcloud, signatures);
       }
       else
       {
-        processed.reset( (new pcl::PointCloud<PointInT>));
-        if (indices_.size () > 0)
-        {
-          if(estimator_->acceptsIndices())
-          {
-            estimator_->setIndices(indices_);
-            estimator_->estimate (input_, processed, keypoints_pointcloud, signatures);
-          }
-          else
-          {
-            PointInTPtr sub_input (new pcl::PointCloud<PointInT>);
-            pcl::copyPointCloud (*input_, indices_, *sub_input);
-            estimator_->estimate (sub_input, processed, keypoints_pointcloud, signatures);
-          }
-        }
-        else
-        {
-          estimator_->estimate (input_, processed, keypoints_pointcloud, signatures);
-        }
-
-        processed_ = processed;
-        estimator_->getKeypointIndices(keypoint_indices_);
+        PointInTPtr sub_input (new pcl::PointCloud<PointInT>);
+        pcl::copyPointCloud (*input, indices_, *sub_input);
+        estimator->estimate (sub_input, processed, keypoints_pointcloud, signatures);
       }
-      std::cout << "Number of keypoints:" << keypoints_pointcloud->points.size () << std::endl;
     }
+    else
+    {
+      estimator->estimate (input, processed, keypoints_pointcloud, signatures);
+    }
+  }
 
-    keypoint_cloud_ = keypoints_pointcloud;
-
-    int size_feat = sizeof(signatures->points[0].histogram) / sizeof(float);
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::computeSceneNormals (
+                                                                                                        typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > & estimator,
+                                                                                                        const PointInTPtr & input,
+                                                                                                        PointInTPtr & processed,
+                                                                                                        PointInTPtr & keypoints_pointcloud,
+                                                                                                        pcl::PointCloud<pcl::Normal>::Ptr & scene_normals)
+  {
+    pcl::PointCloud<pcl::Normal>::Ptr all_scene_normals;
 
-    //feature matching and object hypotheses
-    typename std::map<std::string, ObjectHypothesis<PointInT> > object_hypotheses;
+    if(estimator->needNormals())
     {
-      //double time_nn = 0;
-      double time_pk = 0;
+      estimator->getNormals(all_scene_normals);
+    }
+    else
+    {
+      //compute them...
+      PCL_ERROR("Need to compute normals due to the cg algorithm\n");
+      all_scene_normals.reset(new pcl::PointCloud<pcl::Normal>);
+      boost::shared_ptr<faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal> > normal_estimator;
+      normal_estimator.reset (new faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal>);
+      normal_estimator->setCMR (false);
+      normal_estimator->setDoVoxelGrid (false);
+      normal_estimator->setRemoveOutliers (false);
+      normal_estimator->setValuesForCMRFalse (0.003f, 0.02f);
+      normal_estimator->setForceUnorganized(true);
+      PointInTPtr processed (new pcl::PointCloud<PointInT>);
+      normal_estimator->estimate (input, processed, all_scene_normals);
+    }
+    std::vector<int> correct_indices;
+    getIndicesFromCloud<PointInT>(processed, keypoints_pointcloud, correct_indices);
+    pcl::copyPointCloud(*all_scene_normals, correct_indices, *scene_normals);
+  }
 
-      flann::Matrix<int> indices;
-      flann::Matrix<float> distances;
-      size_t k = knn_;
-      distances = flann::Matrix<float> (new float[k], 1, k);
-      indices = flann::Matrix<int> (new int[k], 1, k);
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::generateHypotheses (
+                                                                                                       const typename pcl::PointCloud<FeatureT>::Ptr & signatures,
+                                                                                                       const int * nn_indices, const float * nn_distances,
+                                                                                                       std::map<std::string, ObjectHypothesis<PointInT> > & object_hypotheses)
+  {
+    //double time_nn = 0;
+    double time_pk = 0;
 
-      Eigen::Matrix4f homMatrixPose;
-      typename pcl::PointCloud<PointInT>::Ptr keypoints (new pcl::PointCloud<PointInT> ());
-      pcl::PointCloud<pcl::Normal>::Ptr normals_model_view_cloud (new pcl::PointCloud<pcl::Normal> ());
-      pcl::PointCloud<IndexPoint>::Ptr indices_from_keypoints_to_normals (new pcl::PointCloud<IndexPoint> ());
-      PointInT model_keypoint;
-      pcl::Normal model_view_normal;
+    size_t k = knn_;
 
-      flann::Matrix<float> p = flann::Matrix<float> (new float[size_feat], 1, size_feat);
+    Eigen::Matrix4f homMatrixPose;
+    typename pcl::PointCloud<PointInT>::Ptr keypoints (new pcl::PointCloud<PointInT> ());
+    pcl::PointCloud<pcl::Normal>::Ptr normals_model_view_cloud (new pcl::PointCloud<pcl::Normal> ());
+    pcl::PointCloud<IndexPoint>::Ptr indices_from_keypoints_to_normals (new pcl::PointCloud<IndexPoint> ());
+    PointInT model_keypoint;
+    pcl::Normal model_view_normal;
 
-      pcl::ScopeTime t("Generating object hypotheses");
-      for (size_t idx = 0; idx < signatures->points.size (); idx++)
-      {
+    for (size_t idx = 0; idx < signatures->points.size (); idx++)
+    {
+      const int * indices = nn_indices + idx * k;
+      const float * distances = nn_distances + idx * k;
+
+      //the compressed index pads missing neighbours with -1, they are sorted last
+      if (indices[0] < 0)
+        continue;
+
+      int dist = distances[0];
+      if(dist > max_descriptor_distance_)
+          continue;
+
+      std::vector<int> flann_models_indices;
+      std::vector<float> model_distances;
+      if(use_codebook_) {
+        //indices[0] points to the codebook entry
+        int cb_entry = indices[0];
+//        int cb_entries = static_cast<int>(codebook_models_[cb_entry].clustered_indices_to_flann_models_.size());
+        //std::cout << "Codebook entries:" << cb_entries << " " << cb_entry << " " << codebook_models_.size() << std::endl;
+        flann_models_indices = codebook_models_[cb_entry].clustered_indices_to_flann_models_;
+        model_distances.reserve(flann_models_indices.size());
+        for(size_t ii=0; ii < flann_models_indices.size(); ii++)
         {
-          //boost::posix_time::ptime start_time (boost::posix_time::microsec_clock::local_time ());
-          //nearestKSearch (flann_index_, signatures->points[idx].histogram, size_feat, k, indices, distances);
-          memcpy (&p.ptr ()[0], &signatures->points[idx].histogram[0], size_feat * sizeof(float));
-          nearestKSearch (flann_index_, p, k, indices, distances);
-          //boost::posix_time::ptime end_time = boost::posix_time::microsec_clock::local_time ();
-          //time_nn += (end_time - start_time).total_microseconds ();
+            model_distances.push_back(dist);
         }
+      } else {
+        flann_models_indices.reserve(k);
+        model_distances.reserve(k);
+        for(size_t ii=0; ii < k && indices[ii] >= 0; ii++)
+        {
+          flann_models_indices.push_back(indices[ii]);
+          model_distances.push_back(distances[ii]);
+        }
+      }
+      std::vector<PointInT> model_keypoints_for_scene_keypoint;
+      std::vector<std::string> model_id_for_scene_keypoint;
 
-        int dist = distances[0][0];
-        if(dist > max_descriptor_distance_)
-            continue;
+      for (size_t ii = 0; ii < flann_models_indices.size(); ii++)
+      {
+        {
+          boost::posix_time::ptime start_time (boost::posix_time::microsec_clock::local_time ());
+          getPose (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, homMatrixPose);
+          getKeypoints (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, keypoints);
 
-        std::vector<int> flann_models_indices;
-        std::vector<float> model_distances;
-        if(use_codebook_) {
-          //indices[0][0] points to the codebook entry
-          int cb_entry = indices[0][0];
-//          int cb_entries = static_cast<int>(codebook_models_[cb_entry].clustered_indices_to_flann_models_.size());
-          //std::cout << "Codebook entries:" << cb_entries << " " << cb_entry << " " << codebook_models_.size() << std::endl;
-          flann_models_indices = codebook_models_[cb_entry].clustered_indices_to_flann_models_;
-          model_distances.reserve(flann_models_indices.size());
-          for(size_t ii=0; ii < flann_models_indices.size(); ii++)
-          {
-              model_distances.push_back(dist);
-          }
-        } else {
-          flann_models_indices.reserve(k);
-          model_distances.reserve(k);
-          for(size_t ii=0; ii < k; ii++)
-          {
-            flann_models_indices.push_back(indices[0][ii]);
-            model_distances.push_back(distances[0][ii]);
-          }
+          boost::posix_time::ptime end_time = boost::posix_time::microsec_clock::local_time ();
+          time_pk += (end_time - start_time).total_microseconds ();
         }
 
-        std::vector<PointInT> model_keypoints_for_scene_keypoint;
-        std::vector<std::string> model_id_for_scene_keypoint;
-
-        for (size_t ii = 0; ii < flann_models_indices.size(); ii++)
+        //assert(normals_model_view_cloud->points.size() == processed->points.size());
+        //homMatrixPose should go from model to view (inverse from view to model)
+        model_keypoint.getVector4fMap () = homMatrixPose.inverse () * keypoints->points[flann_models_.at (flann_models_indices[ii]).keypoint_id].getVector4fMap ();
+        if(model_keypoints_for_scene_keypoint.size() != 0)
         {
+          bool found = false;
+          for(size_t kk=0; kk < model_keypoints_for_scene_keypoint.size(); kk++)
           {
-            boost::posix_time::ptime start_time (boost::posix_time::microsec_clock::local_time ());
-            getPose (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, homMatrixPose);
-            getKeypoints (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, keypoints);
 
-            boost::posix_time::ptime end_time = boost::posix_time::microsec_clock::local_time ();
-            time_pk += (end_time - start_time).total_microseconds ();
-          }
-
-          //assert(normals_model_view_cloud->points.size() == processed->points.size());
-          //homMatrixPose should go from model to view (inverse from view to model)
-          model_keypoint.getVector4fMap () = homMatrixPose.inverse () * keypoints->points[flann_models_.at (flann_models_indices[ii]).keypoint_id].getVector4fMap ();
-          if(model_keypoints_for_scene_keypoint.size() != 0)
-          {
-            bool found = false;
-            for(size_t kk=0; kk < model_keypoints_for_scene_keypoint.size(); kk++)
+            if(model_id_for_scene_keypoint[kk].compare(flann_models_.at (flann_models_indices[kk]).model->id_) == 0)
             {
-
-              if(model_id_for_scene_keypoint[kk].compare(flann_models_.at (flann_models_indices[kk]).model->id_) == 0)
+              if( (model_keypoints_for_scene_keypoint[kk].getVector3fMap() - model_keypoint.getVector3fMap()).squaredNorm() < distance_same_keypoint_)
               {
-                if( (model_keypoints_for_scene_keypoint[kk].getVector3fMap() - model_keypoint.getVector3fMap()).squaredNorm() < distance_same_keypoint_)
-                {
-                  found = true;
-                  break;
-                }
+                found = true;
+                break;
               }
             }
-
-            if(found)
-              continue;
-          }
-          else
-          {
-            model_keypoints_for_scene_keypoint.push_back(model_keypoint);
-            model_id_for_scene_keypoint.push_back(flann_models_.at (flann_models_indices[ii]).model->id_);
           }
 
-          if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
-          {
-            getNormals (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, normals_model_view_cloud);
-            getIndicesToProcessedAndNormals (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, indices_from_keypoints_to_normals);
-            int normal_idx = indices_from_keypoints_to_normals->points[flann_models_.at (flann_models_indices[ii]).keypoint_id].idx;
-            model_view_normal.getNormalVector3fMap () = homMatrixPose.block<3,3>(0,0).inverse () * normals_model_view_cloud->points[normal_idx].getNormalVector3fMap ();
-          }
+          if(found)
+            continue;
+        }
+        else
+        {
+          model_keypoints_for_scene_keypoint.push_back(model_keypoint);
+          model_id_for_scene_keypoint.push_back(flann_models_.at (flann_models_indices[ii]).model->id_);
+        }
 
-          float dist = model_distances[ii];
+        if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
+        {
+          getNormals (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, normals_model_view_cloud);
+          getIndicesToProcessedAndNormals (*(flann_models_.at (flann_models_indices[ii]).model), flann_models_.at (flann_models_indices[ii]).view_id, indices_from_keypoints_to_normals);
+          int normal_idx = indices_from_keypoints_to_normals->points[flann_models_.at (flann_models_indices[ii]).keypoint_id].idx;
+          model_view_normal.getNormalVector3fMap () = homMatrixPose.block<3,3>(0,0).inverse () * normals_model_view_cloud->points[normal_idx].getNormalVector3fMap ();
+        }
 
-          typename std::map<std::string, ObjectHypothesis<PointInT> >::iterator it_map;
-          if ((it_map = object_hypotheses.find (flann_models_.at (flann_models_indices[ii]).model->id_)) != object_hypotheses.end ())
+        float dist = model_distances[ii];
+
+        typename std::map<std::string, ObjectHypothesis<PointInT> >::iterator it_map;
+        if ((it_map = object_hypotheses.find (flann_models_.at (flann_models_indices[ii]).model->id_)) != object_hypotheses.end ())
+        {
+          (*it_map).second.correspondences_pointcloud->points.push_back(model_keypoint);
+          //if(estimator_->needNormals())
+          if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
           {
-            (*it_map).second.correspondences_pointcloud->points.push_back(model_keypoint);
-            //if(estimator_->needNormals())
-            if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
-            {
-              (*it_map).second.normals_pointcloud->points.push_back(model_view_normal);
-            }
+            (*it_map).second.normals_pointcloud->points.push_back(model_view_normal);
+          }
 
-            (*(*it_map).second.correspondences_to_inputcloud).push_back(pcl::Correspondence ((*it_map).second.correspondences_pointcloud->points.size()-1, static_cast<int> (idx), dist));
+          (*(*it_map).second.correspondences_to_inputcloud).push_back(pcl::Correspondence ((*it_map).second.correspondences_pointcloud->points.size()-1, static_cast<int> (idx), dist));
 //            (*(*it_map).second.feature_distances_).push_back(dist);
-            (*it_map).second.indices_to_flann_models_.push_back(flann_models_indices[ii]);
+          (*it_map).second.indices_to_flann_models_.push_back(flann_models_indices[ii]);
 //            (*it_map).second.num_corr_++;
-          }
-          else
+        }
+        else
+        {
+          //create object hypothesis
+          ObjectHypothesis<PointInT> oh;
+          oh.correspondences_pointcloud.reset (new pcl::PointCloud<PointInT> ());
+          //if(estimator_->needNormals())
+          if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
           {
-            //create object hypothesis
-            ObjectHypothesis<PointInT> oh;
-            oh.correspondences_pointcloud.reset (new pcl::PointCloud<PointInT> ());
-            //if(estimator_->needNormals())
-            if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
-            {
-              oh.normals_pointcloud.reset (new pcl::PointCloud<pcl::Normal> ());
-              oh.normals_pointcloud->points.resize (1);
-              oh.normals_pointcloud->points.reserve (signatures->points.size ());
-              oh.normals_pointcloud->points[0] = model_view_normal;
-            }
+            oh.normals_pointcloud.reset (new pcl::PointCloud<pcl::Normal> ());
+            oh.normals_pointcloud->points.resize (1);
+            oh.normals_pointcloud->points.reserve (signatures->points.size ());
+            oh.normals_pointcloud->points[0] = model_view_normal;
+          }
 
 //            oh.feature_distances_.reset (new std::vector<float>);
-            oh.correspondences_to_inputcloud.reset (new pcl::Correspondences ());
+          oh.correspondences_to_inputcloud.reset (new pcl::Correspondences ());
 
-            oh.correspondences_pointcloud->points.resize (1);
-            oh.correspondences_to_inputcloud->resize (1);
+          oh.correspondences_pointcloud->points.resize (1);
+          oh.correspondences_to_inputcloud->resize (1);
 //            oh.feature_distances_->resize (1);
-            oh.indices_to_flann_models_.resize(1);
+          oh.indices_to_flann_models_.resize(1);
 
-            oh.correspondences_pointcloud->points.reserve (signatures->points.size ());
-            oh.correspondences_to_inputcloud->reserve (signatures->points.size ());
+          oh.correspondences_pointcloud->points.reserve (signatures->points.size ());
+          oh.correspondences_to_inputcloud->reserve (signatures->points.size ());
 //            oh.feature_distances_->reserve (signatures->points.size ());
-            oh.indices_to_flann_models_.reserve(signatures->points.size ());
+          oh.indices_to_flann_models_.reserve(signatures->points.size ());
 
-            oh.correspondences_pointcloud->points[0] = model_keypoint;
-            oh.correspondences_to_inputcloud->at (0) = pcl::Correspondence (0, static_cast<int> (idx), dist);
+          oh.correspondences_pointcloud->points[0] = model_keypoint;
+          oh.correspondences_to_inputcloud->at (0) = pcl::Correspondence (0, static_cast<int> (idx), dist);
 //            oh.feature_distances_->at (0) = dist;
-            oh.indices_to_flann_models_[0] = flann_models_indices[ii];
+          oh.indices_to_flann_models_[0] = flann_models_indices[ii];
 //            oh.num_corr_ = 1;
-            oh.model_ = flann_models_.at (flann_models_indices[ii]).model;
+          oh.model_ = flann_models_.at (flann_models_indices[ii]).model;
 
-            object_hypotheses[oh.model_->id_] = oh;
-          }
+          object_hypotheses[oh.model_->id_] = oh;
         }
       }
+    }
 
-      delete[] indices.ptr ();
-      delete[] distances.ptr ();
-      delete[] p.ptr ();
-
-      typename std::map<std::string, ObjectHypothesis<PointInT> >::iterator it_map;
-      for (it_map = object_hypotheses.begin(); it_map != object_hypotheses.end (); it_map++) {
+    typename std::map<std::string, ObjectHypothesis<PointInT> >::iterator it_map;
+    for (it_map = object_hypotheses.begin(); it_map != object_hypotheses.end (); it_map++) {
 
 //          std::cout << "Showing local recognizer keypoints for " << it_map->first << std::endl;
 //                     pcl::visualization::PCLVisualizer viewer("Keypoint Viewer for local recognizer");
@@ -690,18 +958,159 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
 //                     viewer.addPointCloudNormals<pcl::PointXYZRGB,pcl::Normal>(pKeypointCloud, it_map->second.normals_pointcloud, 5, 0.04);
 //                     viewer.spin();
 
-        ObjectHypothesis<PointInT> oh = (*it_map).second;
-        size_t num_corr = oh.correspondences_to_inputcloud->size();
-        oh.correspondences_pointcloud->points.resize(num_corr);
-        if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
-          oh.normals_pointcloud->points.resize(num_corr);
+      ObjectHypothesis<PointInT> oh = (*it_map).second;
+      size_t num_corr = oh.correspondences_to_inputcloud->size();
+      oh.correspondences_pointcloud->points.resize(num_corr);
+      if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
+        oh.normals_pointcloud->points.resize(num_corr);
 
-        oh.correspondences_to_inputcloud->resize(num_corr);
+      oh.correspondences_to_inputcloud->resize(num_corr);
 //        oh.feature_distances_->resize(num_corr);
+    }
+
+    //std::cout << "Time nearest searches:" << time_nn / 1000.f << " ms" << std::endl;
+    std::cout << "Time pose/keypoint get:" << time_pk / 1000.f << " ms" << std::endl;
+  }
+
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::groupHypotheses (
+                                                                                                    typename boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointInT, PointInT> > & cg,
+                                                                                                    PointInTPtr & processed,
+                                                                                                    PointInTPtr & keypoints_pointcloud,
+                                                                                                    pcl::PointCloud<pcl::Normal>::Ptr & scene_normals,
+                                                                                                    std::map<std::string, ObjectHypothesis<PointInT> > & object_hypotheses,
+                                                                                                    std::vector<ModelTPtr> & models,
+                                                                                                    std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > & transforms)
+  {
+    typename std::map<std::string, ObjectHypothesis<PointInT> >::iterator it_map;
+
+    prepareSpecificCG(processed, keypoints_pointcloud);
+    pcl::ScopeTime t("Geometric verification, RANSAC and transform estimation");
+    for (it_map = object_hypotheses.begin (); it_map != object_hypotheses.end (); it_map++)
+    {
+      std::vector < pcl::Correspondences > corresp_clusters;
+      cg->setSceneCloud (keypoints_pointcloud);
+      cg->setInputCloud ((*it_map).second.correspondences_pointcloud);
+
+      if((cg && cg->getRequiresNormals()) || save_hypotheses_)
+      {
+        std::cout << "CG alg requires normals..." << ((*it_map).second.normals_pointcloud)->points.size() << " " << (scene_normals)->points.size() << std::endl;
+        cg->setInputAndSceneNormals((*it_map).second.normals_pointcloud, scene_normals);
       }
+      //we need to pass the keypoints_pointcloud and the specific object hypothesis
+      specificCG(processed, keypoints_pointcloud, it_map->second);
+      cg->setModelSceneCorrespondences ((*it_map).second.correspondences_to_inputcloud);
+      cg->cluster (corresp_clusters);
+
+      std::cout << "Instances:" << corresp_clusters.size () << " Total correspondences:" << (*it_map).second.correspondences_to_inputcloud->size () << " " << it_map->first << std::endl;
+      std::vector<bool> good_indices_for_hypothesis (corresp_clusters.size (), true);
+
+      if (threshold_accept_model_hypothesis_ < 1.f)
+      {
+        //sort the hypotheses for each model according to their correspondences and take those that are threshold_accept_model_hypothesis_ over the max cardinality
+        int max_cardinality = -1;
+        for (size_t i = 0; i < corresp_clusters.size (); i++)
+        {
+          //std::cout <<  (corresp_clusters[i]).size() << " -- " << (*(*it_map).second.correspondences_to_inputcloud).size() << std::endl;
+          if (max_cardinality < static_cast<int> (corresp_clusters[i].size ()))
+          {
+            max_cardinality = static_cast<int> (corresp_clusters[i].size ());
+          }
+        }
+
+        for (size_t i = 0; i < corresp_clusters.size (); i++)
+        {
+          if (static_cast<float> ((corresp_clusters[i]).size ()) < (threshold_accept_model_hypothesis_ * static_cast<float> (max_cardinality)))
+          {
+            good_indices_for_hypothesis[i] = false;
+          }
+        }
+      }
+
+      int keeping = 0;
+      for (size_t i = 0; i < corresp_clusters.size (); i++)
+      {
+
+        if (!good_indices_for_hypothesis[i])
+          continue;
+
+        //drawCorrespondences (processed, it_map->second, keypoints_pointcloud, corresp_clusters[i]);
 
-      //std::cout << "Time nearest searches:" << time_nn / 1000.f << " ms" << std::endl;
-      std::cout << "Time pose/keypoint get:" << time_pk / 1000.f << " ms" << std::endl;
+        Eigen::Matrix4f best_trans;
+        typename pcl::registration::TransformationEstimationSVD < PointInT, PointInT > t_est;
+        t_est.estimateRigidTransformation (*(*it_map).second.correspondences_pointcloud, *keypoints_pointcloud, corresp_clusters[i], best_trans);
+
+        models.push_back ((*it_map).second.model_);
+        transforms.push_back (best_trans);
+
+        keeping++;
+      }
+
+      std::cout << "kept " << keeping << " out of " << corresp_clusters.size () << std::endl;
+    }
+
+    clearSpecificCG();
+  }
+
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::recognize ()
+  {
+
+    models_.reset (new std::vector<ModelTPtr>);
+    transforms_.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
+
+    PointInTPtr processed;
+    typename pcl::PointCloud<FeatureT>::Ptr signatures (new pcl::PointCloud<FeatureT> ());
+    PointInTPtr keypoints_pointcloud;
+
+    {
+      pcl::ScopeTime t("Compute keypoints and features");
+      if (signatures_ != 0 && processed_ != 0 && (signatures_->size () == keypoints_input_->points.size ()))
+      {
+        keypoints_pointcloud = keypoints_input_;
+        signatures = signatures_;
+        processed = processed_;
+        std::cout << "Using the ISPK ..." << std::endl;
+      }
+      else
+      {
+        computeFeatures (estimator_, input_, processed, keypoints_pointcloud, signatures);
+
+        processed_ = processed;
+        estimator_->getKeypointIndices(keypoint_indices_);
+      }
+      std::cout << "Number of keypoints:" << keypoints_pointcloud->points.size () << std::endl;
+    }
+
+    keypoint_cloud_ = keypoints_pointcloud;
+
+    int size_feat = sizeof(signatures->points[0].histogram) / sizeof(float);
+
+    //feature matching and object hypotheses
+    typename std::map<std::string, ObjectHypothesis<PointInT> > object_hypotheses;
+    {
+      pcl::ScopeTime t("Generating object hypotheses");
+
+      //all keypoints of the scene are matched with one query
+      size_t k = knn_;
+      size_t num_queries = signatures->points.size ();
+      flann::Matrix<float> p (new float[num_queries * size_feat], num_queries, size_feat);
+      flann::Matrix<int> indices (new int[num_queries * k], num_queries, k);
+      flann::Matrix<float> distances (new float[num_queries * k], num_queries, k);
+
+      for (size_t idx = 0; idx < num_queries; idx++)
+        memcpy (&p.ptr ()[idx * size_feat], &signatures->points[idx].histogram[0], size_feat * sizeof(float));
+
+      if (num_queries > 0)
+        nearestKSearch (flann_index_, p, k, indices, distances);
+
+      generateHypotheses (signatures, indices.ptr (), distances.ptr (), object_hypotheses);
+
+      delete[] indices.ptr ();
+      delete[] distances.ptr ();
+      delete[] p.ptr ();
     }
 
     if(save_hypotheses_)
@@ -727,104 +1136,14 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
     }
     else
     {
-      typename std::map<std::string, ObjectHypothesis<PointInT> >::iterator it_map;
-
       {
         pcl::PointCloud<pcl::Normal>::Ptr scene_normals(new pcl::PointCloud<pcl::Normal>);
         if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
         {
-          pcl::PointCloud<pcl::Normal>::Ptr all_scene_normals;
-
-          if(estimator_->needNormals())
-          {
-            estimator_->getNormals(all_scene_normals);
-          }
-          else
-          {
-            //compute them...
-            PCL_ERROR("Need to compute normals due to the cg algorithm\n");
-            all_scene_normals.reset(new pcl::PointCloud<pcl::Normal>);
-            boost::shared_ptr<faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal> > normal_estimator;
-            normal_estimator.reset (new faat_pcl::rec_3d_framework::PreProcessorAndNormalEstimator<PointInT, pcl::Normal>);
-            normal_estimator->setCMR (false);
-            normal_estimator->setDoVoxelGrid (false);
-            normal_estimator->setRemoveOutliers (false);
-            normal_estimator->setValuesForCMRFalse (0.003f, 0.02f);
-            normal_estimator->setForceUnorganized(true);
-            PointInTPtr processed (new pcl::PointCloud<PointInT>);
-            normal_estimator->estimate (input_, processed, all_scene_normals);
-          }
-          std::vector<int> correct_indices;
-          getIndicesFromCloud<PointInT>(processed, keypoints_pointcloud, correct_indices);
-          pcl::copyPointCloud(*all_scene_normals, correct_indices, *scene_normals);
-        }
-
-        prepareSpecificCG(processed, keypoints_pointcloud);
-        pcl::ScopeTime t("Geometric verification, RANSAC and transform estimation");
-        for (it_map = object_hypotheses.begin (); it_map != object_hypotheses.end (); it_map++)
-        {
-          std::vector < pcl::Correspondences > corresp_clusters;
-          cg_algorithm_->setSceneCloud (keypoints_pointcloud);
-          cg_algorithm_->setInputCloud ((*it_map).second.correspondences_pointcloud);
-
-          if((cg_algorithm_ && cg_algorithm_->getRequiresNormals()) || save_hypotheses_)
-          {
-            std::cout << "CG alg requires normals..." << ((*it_map).second.normals_pointcloud)->points.size() << " " << (scene_normals)->points.size() << std::endl;
-            cg_algorithm_->setInputAndSceneNormals((*it_map).second.normals_pointcloud, scene_normals);
-          }
-          //we need to pass the keypoints_pointcloud and the specific object hypothesis
-          specificCG(processed, keypoints_pointcloud, it_map->second);
-          cg_algorithm_->setModelSceneCorrespondences ((*it_map).second.correspondences_to_inputcloud);
-          cg_algorithm_->cluster (corresp_clusters);
-
-          std::cout << "Instances:" << corresp_clusters.size () << " Total correspondences:" << (*it_map).second.correspondences_to_inputcloud->size () << " " << it_map->first << std::endl;
-          std::vector<bool> good_indices_for_hypothesis (corresp_clusters.size (), true);
-
-          if (threshold_accept_model_hypothesis_ < 1.f)
-          {
-            //sort the hypotheses for each model according to their correspondences and take those that are threshold_accept_model_hypothesis_ over the max cardinality
-            int max_cardinality = -1;
-            for (size_t i = 0; i < corresp_clusters.size (); i++)
-            {
-              //std::cout <<  (corresp_clusters[i]).size() << " -- " << (*(*it_map).second.correspondences_to_inputcloud).size() << std::endl;
-              if (max_cardinality < static_cast<int> (corresp_clusters[i].size ()))
-              {
-                max_cardinality = static_cast<int> (corresp_clusters[i].size ());
-              }
-            }
-
-            for (size_t i = 0; i < corresp_clusters.size (); i++)
-            {
-              if (static_cast<float> ((corresp_clusters[i]).size ()) < (threshold_accept_model_hypothesis_ * static_cast<float> (max_cardinality)))
-              {
-                good_indices_for_hypothesis[i] = false;
-              }
-            }
-          }
-
-          int keeping = 0;
-          for (size_t i = 0; i < corresp_clusters.size (); i++)
-          {
-
-            if (!good_indices_for_hypothesis[i])
-              continue;
-
-            //drawCorrespondences (processed, it_map->second, keypoints_pointcloud, corresp_clusters[i]);
-
-            Eigen::Matrix4f best_trans;
-            typename pcl::registration::TransformationEstimationSVD < PointInT, PointInT > t_est;
-            t_est.estimateRigidTransformation (*(*it_map).second.correspondences_pointcloud, *keypoints_pointcloud, corresp_clusters[i], best_trans);
-
-            models_->push_back ((*it_map).second.model_);
-            transforms_->push_back (best_trans);
-
-            keeping++;
-          }
-
-          std::cout << "kept " << keeping << " out of " << corresp_clusters.size () << std::endl;
+          computeSceneNormals (estimator_, input_, processed, keypoints_pointcloud, scene_normals);
         }
 
-        clearSpecificCG();
+        groupHypotheses (cg_algorithm_, processed, keypoints_pointcloud, scene_normals, object_hypotheses, *models_, *transforms_);
       }
 
       std::cout << "Number of hypotheses:" << models_->size() << std::endl;
@@ -854,6 +1173,182 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
     }
   }
 
+template<template<class > class Distance, typename PointInT, typename FeatureT>
+  void
+  faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::recognizeBatch (
+                                                                                                   const std::vector<PointInTPtr> & scenes,
+                                                                                                   std::vector<boost::shared_ptr<std::vector<ModelTPtr> > > & models,
+                                                                                                   std::vector<boost::shared_ptr<std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > > > & transforms)
+  {
+    int num_scenes = static_cast<int> (scenes.size ());
+    models.resize (num_scenes);
+    transforms.resize (num_scenes);
+
+    if (num_scenes == 0)
+      return;
+
+    //saved hypotheses and ISPK are per call state, recognize the scenes one by one
+    bool use_ispk = (signatures_ != 0 && processed_ != 0 && (signatures_->size () == keypoints_input_->points.size ()));
+    if (save_hypotheses_ || use_ispk)
+    {
+      //icp_scene_indices_ refer to input_, not to the scenes of the batch
+      PointInTPtr input = input_;
+      pcl::PointIndicesPtr icp_scene_indices = icp_scene_indices_;
+      icp_scene_indices_.reset ();
+      for (int i = 0; i < num_scenes; i++)
+      {
+        input_ = scenes[i];
+        recognize ();
+        models[i] = models_;
+        transforms[i] = transforms_;
+      }
+      input_ = input;
+      icp_scene_indices_ = icp_scene_indices;
+      return;
+    }
+
+    int max_threads = 1;
+#ifdef _OPENMP
+    max_threads = omp_get_num_procs ();
+#endif
+    if (max_recognition_threads_ > 0)
+      max_threads = std::min (max_threads, max_recognition_threads_);
+    max_threads = std::max (1, std::min (max_threads, num_scenes));
+
+    std::vector<PointInTPtr> processed (num_scenes);
+    std::vector<PointInTPtr> keypoints (num_scenes);
+    std::vector<typename pcl::PointCloud<FeatureT>::Ptr> signatures (num_scenes);
+    std::vector<pcl::PointCloud<pcl::Normal>::Ptr> scene_normals (num_scenes);
+    bool cg_requires_normals = (cg_algorithm_ && cg_algorithm_->getRequiresNormals());
+
+    //keypoints and features, one estimator per thread
+    {
+      pcl::ScopeTime t("Compute keypoints and features (batch)");
+
+      int num_threads = (estimator_factory_ ? max_threads : 1);
+      std::vector<typename boost::shared_ptr<LocalEstimator<PointInT, FeatureT> > > estimators (num_threads);
+      estimators[0] = estimator_;
+      for (int t = 1; t < num_threads; t++)
+        estimators[t] = estimator_factory_ ();
+
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+      for (int i = 0; i < num_scenes; i++)
+      {
+#ifdef _OPENMP
+        int thread_id = omp_get_thread_num ();
+#else
+        int thread_id = 0;
+#endif
+        signatures[i].reset (new pcl::PointCloud<FeatureT> ());
+        computeFeatures (estimators[thread_id], scenes[i], processed[i], keypoints[i], signatures[i]);
+
+        //the normals are only available from the estimator right after the estimation
+        scene_normals[i].reset (new pcl::PointCloud<pcl::Normal>);
+        if (cg_requires_normals)
+          computeSceneNormals (estimators[thread_id], scenes[i], processed[i], keypoints[i], scene_normals[i]);
+      }
+
+      processed_ = processed.back ();
+      keypoint_cloud_ = keypoints.back ();
+    }
+
+    //one query with the keypoints of all scenes
+    std::vector<std::map<std::string, ObjectHypothesis<PointInT> > > object_hypotheses (num_scenes);
+    {
+      pcl::ScopeTime t("Generating object hypotheses (batch)");
+
+      int size_feat = sizeof(signatures[0]->points[0].histogram) / sizeof(float);
+      size_t k = knn_;
+      std::vector<size_t> offsets (num_scenes + 1, 0);
+      for (int i = 0; i < num_scenes; i++)
+        offsets[i + 1] = offsets[i] + signatures[i]->points.size ();
+
+      size_t num_queries = offsets.back ();
+      flann::Matrix<float> p (new float[num_queries * size_feat], num_queries, size_feat);
+      flann::Matrix<int> indices (new int[num_queries * k], num_queries, k);
+      flann::Matrix<float> distances (new float[num_queries * k], num_queries, k);
+
+      for (int i = 0; i < num_scenes; i++)
+        for (size_t idx = 0; idx < signatures[i]->points.size (); idx++)
+          memcpy (&p.ptr ()[(offsets[i] + idx) * size_feat], &signatures[i]->points[idx].histogram[0], size_feat * sizeof(float));
+
+      if (num_queries > 0)
+        nearestKSearch (flann_index_, p, k, indices, distances);
+
+      //model poses and keypoints are loaded (or taken from the caches) sequentially
+      for (int i = 0; i < num_scenes; i++)
+        generateHypotheses (signatures[i], indices.ptr () + offsets[i] * k, distances.ptr () + offsets[i] * k, object_hypotheses[i]);
+
+      delete[] indices.ptr ();
+      delete[] distances.ptr ();
+      delete[] p.ptr ();
+    }
+
+    if (ICP_iterations_ > 0 || hv_algorithm_) {
+      //Prepare scene and model clouds for the pose refinement step
+      source_->voxelizeAllModels (VOXEL_SIZE_ICP_);
+    }
+
+    //correspondence grouping and pose refinement, one CG instance per thread
+    {
+      int num_threads = ((cg_algorithm_factory_ && !usesSpecificCG ()) ? max_threads : 1);
+      std::vector<typename boost::shared_ptr<faat_pcl::CorrespondenceGrouping<PointInT, PointInT> > > cg_algorithms (num_threads);
+      cg_algorithms[0] = cg_algorithm_;
+      for (int t = 1; t < num_threads; t++)
+        cg_algorithms[t] = cg_algorithm_factory_ ();
+
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+      for (int i = 0; i < num_scenes; i++)
+      {
+#ifdef _OPENMP
+        int thread_id = omp_get_thread_num ();
+#else
+        int thread_id = 0;
+#endif
+        models[i].reset (new std::vector<ModelTPtr>);
+        transforms[i].reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
+
+        groupHypotheses (cg_algorithms[thread_id], processed[i], keypoints[i], scene_normals[i], object_hypotheses[i], *models[i], *transforms[i]);
+
+        //icp_scene_indices_ refer to input_, the scenes of the batch are refined on all points
+        if (ICP_iterations_ > 0)
+          poseRefinement (scenes[i], pcl::PointIndicesPtr (), *models[i], *transforms[i]);
+      }
+    }
+
+    //as after recognize(), the hypotheses of the last scene before the verification
+    if (hv_algorithm_ && (models.back ()->size () > 0))
+    {
+      models_before_hv_ = models.back ();
+      transforms_before_hv_ = transforms.back ();
+    }
+
+    //hypotheses verification, one HV instance per thread
+    if (hv_algorithm_)
+    {
+      int num_threads = (hv_algorithm_factory_ ? max_threads : 1);
+      std::vector<typename boost::shared_ptr<faat_pcl::HypothesisVerification<PointInT, PointInT> > > hv_algorithms (num_threads);
+      hv_algorithms[0] = hv_algorithm_;
+      for (int t = 1; t < num_threads; t++)
+        hv_algorithms[t] = hv_algorithm_factory_ ();
+
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+      for (int i = 0; i < num_scenes; i++)
+      {
+#ifdef _OPENMP
+        int thread_id = omp_get_thread_num ();
+#else
+        int thread_id = 0;
+#endif
+        if (models[i]->size () > 0)
+          hypothesisVerification (hv_algorithms[thread_id], scenes[i], models[i], transforms[i]);
+      }
+    }
+
+    models_ = models.back ();
+    transforms_ = transforms.back ();
+  }
+
 template<template<class > class Distance, typename PointInT, typename FeatureT>
 void
 faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::getView (ModelT & model, int view_id, PointInTPtr & view)
@@ -873,7 +1368,7 @@ faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, Feature
                                                                                                                        pcl::PointCloud<IndexPoint>::Ptr & index_cloud)
 {
 
-  if (use_cache_)
+  if (!idxpoint_cache_.empty ())
    {
    typedef std::pair<std::string, int> mv_pair;
    mv_pair pair_model_view = std::make_pair (model.id_, view_id);
@@ -903,7 +1398,7 @@ faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, Feature
                                                                                                 pcl::PointCloud<pcl::Normal>::Ptr & normals_cloud)
 {
 
-  if (use_cache_)
+  if (!normals_cache_.empty ())
    {
    typedef std::pair<std::string, int> mv_pair;
    mv_pair pair_model_view = std::make_pair (model.id_, view_id);
@@ -933,7 +1428,7 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
   faat_pcl::rec_3d_framework::LocalRecognitionPipeline<Distance, PointInT, FeatureT>::getPose (ModelT & model, int view_id, Eigen::Matrix4f & pose_matrix)
   {
 
-    if (use_cache_)
+    if (!poses_cache_.empty ())
     {
       typedef std::pair<std::string, int> mv_pair;
       mv_pair pair_model_view = std::make_pair (model.id_, view_id);
@@ -964,7 +1459,7 @@ template<template<class > class Distance, typename PointInT, typename FeatureT>
                                                                                                typename pcl::PointCloud<PointInT>::Ptr & keypoints_cloud)
   {
 
-    if (use_cache_)
+    if (!keypoints_cache_.empty ())
     {
       std::pair<std::string, int> pair_model_view = std::make_pair (model.id_, view_id);
       typename std::map<std::pair<std::string, int>, PointInTPtr>::iterator it = keypoints_cache_.find (pair_model_view);
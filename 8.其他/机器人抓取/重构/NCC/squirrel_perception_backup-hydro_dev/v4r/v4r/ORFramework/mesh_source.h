@@ -14,8 +14,14 @@
 #include <pcl/io/io.h>
 #include <pcl/io/pcd_io.h>
 #include "vtk_model_sampling.h"
+#include "software_renderer.h"
 #include <boost/function.hpp>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace faat_pcl
 {
@@ -48,8 +54,180 @@ namespace faat_pcl
         float radius_sphere_;
         float view_angle_;
         bool gen_organized_;
+        bool use_software_renderer_;
         boost::function<bool (const Eigen::Vector3f &)> campos_constraints_func_;
 
+        /**
+         * \brief Renders all views of polydata with SoftwareRenderer (no VTK window needed). The model
+         * is centered on its centroid, views are rendered in parallel with one set of buffers per thread.
+         * As in RenderViewsTesselatedSphere, the model is scaled so that its largest side is radius_sphere_ / 2
+         * for rendering, views and poses are scaled back to the model units afterwards.
+         */
+        void
+        renderViewsSoftware (vtkPolyData * polydata, std::vector<typename pcl::PointCloud<PointInT>::Ptr> & views,
+                             std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > & poses,
+                             std::vector<float> & entropies)
+        {
+          RenderMesh mesh;
+          mesh.vertices_.resize (polydata->GetNumberOfPoints ());
+          for (vtkIdType i = 0; i < polydata->GetNumberOfPoints (); i++)
+          {
+            double p[3];
+            polydata->GetPoint (i, p);
+            mesh.vertices_[i] = Eigen::Vector3f (float (p[0]), float (p[1]), float (p[2]));
+          }
+
+          vtkUnsignedCharArray * colors = vtkUnsignedCharArray::SafeDownCast (polydata->GetPointData ()->GetScalars ());
+          if (colors && colors->GetNumberOfComponents () >= 3 && colors->GetNumberOfTuples () == polydata->GetNumberOfPoints ())
+          {
+            mesh.vertex_colors_.resize (polydata->GetNumberOfPoints ());
+            for (vtkIdType i = 0; i < polydata->GetNumberOfPoints (); i++)
+            {
+              unsigned char rgb[4];
+              colors->GetTupleValue (i, rgb);
+              mesh.vertex_colors_[i] = Eigen::Vector3f (rgb[0], rgb[1], rgb[2]);
+            }
+          }
+
+          vtkSmartPointer < vtkCellArray > cells = polydata->GetPolys ();
+          vtkIdType npts = 0, *ptIds = NULL;
+          for (cells->InitTraversal (); cells->GetNextCell (npts, ptIds);)
+          {
+            //triangulate polygons as a fan
+            for (vtkIdType k = 2; k < npts; k++)
+              mesh.faces_.push_back (Eigen::Vector3i (static_cast<int> (ptIds[0]), static_cast<int> (ptIds[k - 1]), static_cast<int> (ptIds[k])));
+          }
+
+          Eigen::Vector3f centroid = mesh.getCentroid ();
+          Eigen::Vector3f min_pt = Eigen::Vector3f::Constant (std::numeric_limits<float>::max ());
+          Eigen::Vector3f max_pt = Eigen::Vector3f::Constant (-std::numeric_limits<float>::max ());
+          for (size_t i = 0; i < mesh.vertices_.size (); i++)
+          {
+            mesh.vertices_[i] -= centroid;
+            min_pt = min_pt.cwiseMin (mesh.vertices_[i]);
+            max_pt = max_pt.cwiseMax (mesh.vertices_[i]);
+          }
+
+          //scale so that the largest side of the bounding box is radius_sphere_ / 2
+          float scale_factor = 1.f;
+          if (!mesh.vertices_.empty ())
+          {
+            float max_side = (max_pt - min_pt).maxCoeff ();
+            if (max_side > 0.f)
+              scale_factor = radius_sphere_ / 2.f / max_side;
+          }
+
+          for (size_t i = 0; i < mesh.vertices_.size (); i++)
+            mesh.vertices_[i] *= scale_factor;
+
+          std::vector<Eigen::Vector3f> cam_positions;
+          SoftwareRenderer::getTesselatedSphereCamPositions (tes_level_, false, cam_positions);
+
+          if (campos_constraints_func_)
+          {
+            int valid = 0;
+            for (size_t i = 0; i < cam_positions.size (); i++)
+            {
+              if (campos_constraints_func_ (cam_positions[i]))
+              {
+                cam_positions[valid] = cam_positions[i];
+                valid++;
+              }
+            }
+
+            cam_positions.resize (valid);
+          }
+
+          SoftwareRenderer renderer;
+          renderer.setResolution (resolution_, resolution_);
+          renderer.setViewAngle (view_angle_);
+          float f = renderer.getFocalLength ();
+          float cx = static_cast<float> (resolution_) / 2.f - 0.5f;
+
+          views.resize (cam_positions.size ());
+          poses.resize (cam_positions.size ());
+          entropies.resize (cam_positions.size ());
+
+#ifdef _OPENMP
+          int num_threads = omp_get_num_procs ();
+#else
+          int num_threads = 1;
+#endif
+          std::vector<RenderBuffers> thread_buffers (num_threads);
+          std::vector<std::vector<unsigned char> > thread_face_seen (num_threads);
+
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+          for (int i = 0; i < static_cast<int> (cam_positions.size ()); i++)
+          {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num ();
+#else
+            int thread_id = 0;
+#endif
+            RenderBuffers & buffers = thread_buffers[thread_id];
+
+            //model (centered) to camera: rotate so that the camera looks at the origin, then move the camera to 0,0,0
+            Eigen::Matrix4f pose = SoftwareRenderer::getLookAtOriginRotation (cam_positions[i]);
+            pose.block<3, 1> (0, 3) = Eigen::Vector3f (0.f, 0.f, radius_sphere_);
+            Eigen::Matrix4f center = Eigen::Matrix4f::Identity ();
+            center.block<3, 1> (0, 3) = centroid * -1.f;
+
+            renderer.render (mesh, pose, buffers);
+
+            //back to model units
+            float inv_scale = 1.f / scale_factor;
+            pose.block<3, 1> (0, 3) *= inv_scale;
+
+            typename pcl::PointCloud<PointInT>::Ptr view (new pcl::PointCloud<PointInT>);
+            if (gen_organized_)
+            {
+              view->width = resolution_;
+              view->height = resolution_;
+              view->points.resize (resolution_ * resolution_);
+              view->is_dense = false;
+            }
+
+            for (int v = 0; v < resolution_; v++)
+            {
+              for (int u = 0; u < resolution_; u++)
+              {
+                int idx = v * resolution_ + u;
+                PointInT p;
+                if (buffers.isValid (idx))
+                {
+                  float z = buffers.depth_[idx] * inv_scale;
+                  p.x = (static_cast<float> (u) - cx) * z / f;
+                  p.y = (static_cast<float> (v) - cx) * z / f;
+                  p.z = z;
+                }
+                else
+                {
+                  if (!gen_organized_)
+                    continue;
+
+                  p.x = p.y = p.z = std::numeric_limits<float>::quiet_NaN ();
+                }
+
+                if (gen_organized_)
+                  view->points[idx] = p;
+                else
+                  view->points.push_back (p);
+              }
+            }
+
+            if (!gen_organized_)
+            {
+              view->width = static_cast<int> (view->points.size ());
+              view->height = 1;
+              view->is_dense = true;
+            }
+
+            views[i] = view;
+            poses[i] = pose * center;
+            entropies[i] = SoftwareRenderer::computeVisibleAreaRatio (mesh, buffers, thread_face_seen[thread_id]);
+          }
+        }
+
       public:
 
         using SourceT::setFilterDuplicateViews;
@@ -60,6 +238,7 @@ namespace faat_pcl
         {
           gen_organized_ = false;
           load_into_memory_ = true;
+          use_software_renderer_ = false;
         }
 
         ~MeshSource(){};
@@ -95,6 +274,44 @@ namespace faat_pcl
           view_angle_ = a;
         }
 
+        /**
+         * \brief Generate training views with the CPU renderer instead of RenderViewsTesselatedSphere.
+         * Does not need a display and uses all cores.
+         */
+        void
+        setUseSoftwareRenderer (bool b)
+        {
+          use_software_renderer_ = b;
+        }
+
+        /**
+         * \brief Loads the views in view_filenames_ with their poses and entropies from a model database
+         */
+        void
+        loadInMemoryFromDatabase (const ModelDatabase & db, ModelT & model)
+        {
+          for (size_t i = 0; i < model.view_filenames_.size (); i++)
+          {
+            //view_<id>.pcd
+            std::string name = model.view_filenames_[i].substr (0, model.view_filenames_[i].length () - 4);
+            const ModelDatabase::View * view = db.getView (atoi (name.substr (name.rfind ('_') + 1).c_str ()));
+
+            typename pcl::PointCloud<PointInT>::Ptr cloud (new pcl::PointCloud<PointInT> ());
+            Eigen::Matrix4f pose = Eigen::Matrix4f::Identity ();
+            float entropy = 0;
+            if (view)
+            {
+              db.getCloud (*view, "view", *cloud);
+              pose = view->pose_;
+              entropy = view->entropy_;
+            }
+
+            model.views_->push_back (cloud);
+            model.poses_->push_back (pose);
+            model.self_occlusions_->push_back (entropy);
+          }
+        }
+
         void
         loadInMemorySpecificModel(std::string & dir, ModelT & model)
         {
@@ -102,6 +319,13 @@ namespace faat_pcl
           pathmodel << dir << "/" << model.class_ << "/" << model.id_;
           bf::path trained_dir = pathmodel.str ();
 
+          ModelDatabase db;
+          if (db.load (ModelDatabase::getFilename (pathmodel.str ())))
+          {
+            loadInMemoryFromDatabase (db, model);
+            return;
+          }
+
           for (size_t i = 0; i < model.view_filenames_.size (); i++)
           {
             std::stringstream view_file;
@@ -145,6 +369,9 @@ namespace faat_pcl
           pathmodel << dir << "/" << model.class_ << "/" << model.id_;
           bf::path trained_dir = pathmodel.str ();
 
+          model.source_file_ = model_path;
+          this->removeModelDirectoryIfSourceChanged (dir, model);
+
           model.views_.reset (new std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr>);
           model.poses_.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
           model.self_occlusions_.reset (new std::vector<float>);
@@ -164,9 +391,13 @@ namespace faat_pcl
 
           if (bf::exists (trained_dir))
           {
-            //load views, poses and self-occlusions
-
-            getViewsFilenames(trained_dir, model.view_filenames_, "view");
+            //load views, poses and self-occlusions, from the model database if there is one
+            ModelDatabase db;
+            bool from_database = db.load (ModelDatabase::getFilename (pathmodel.str ()));
+            if (from_database)
+              getViewsFilenames(db, model.view_filenames_, "view");
+            else
+              getViewsFilenames(trained_dir, model.view_filenames_, "view");
 
             /*std::vector < std::string > view_filenames;
             int number_of_views = 0;
@@ -206,7 +437,10 @@ namespace faat_pcl
 
             if(load_into_memory_)
             {
-              loadInMemorySpecificModel(dir, model);
+              if (from_database)
+                loadInMemoryFromDatabase (db, model);
+              else
+                loadInMemorySpecificModel(dir, model);
               /*typename pcl::PointCloud<PointInT>::Ptr model_cloud(new pcl::PointCloud<PointInT>);
               assembleModelFromViewsAndPoses(model, *(model.poses_), *(model.indices_), model_cloud);
 
@@ -255,28 +489,35 @@ namespace faat_pcl
             vtkSmartPointer < vtkPolyData > mapper = filter_scale->GetOutput();
             mapper->Update ();
 			
-            //generate views
-            pcl::apps::RenderViewsTesselatedSphere render_views;
-            render_views.setResolution (resolution_);
-            render_views.setUseVertices (false);
-            render_views.setRadiusSphere (radius_sphere_);
-            render_views.setComputeEntropies (true);
-            render_views.setTesselationLevel (tes_level_);
-            render_views.setViewAngle (view_angle_);
-            //render_views.addModelFromPolyData (mapper->GetInput ());
-            render_views.addModelFromPolyData (mapper);
-            render_views.setGenOrganized(gen_organized_);
-            render_views.setCamPosConstraints(campos_constraints_func_);
-			
-            render_views.generateViews ();
-			
-			std::vector<typename pcl::PointCloud<PointInT>::Ptr> views_xyz_orig;
+            std::vector<typename pcl::PointCloud<PointInT>::Ptr> views_xyz_orig;
             std::vector < Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > poses;
             std::vector<float> entropies;
 
-            render_views.getViews (views_xyz_orig);
-            render_views.getPoses (poses);
-            render_views.getEntropies (entropies);
+            if (use_software_renderer_)
+            {
+              renderViewsSoftware (mapper, views_xyz_orig, poses, entropies);
+            }
+            else
+            {
+              //generate views
+              pcl::apps::RenderViewsTesselatedSphere render_views;
+              render_views.setResolution (resolution_);
+              render_views.setUseVertices (false);
+              render_views.setRadiusSphere (radius_sphere_);
+              render_views.setComputeEntropies (true);
+              render_views.setTesselationLevel (tes_level_);
+              render_views.setViewAngle (view_angle_);
+              //render_views.addModelFromPolyData (mapper->GetInput ());
+              render_views.addModelFromPolyData (mapper);
+              render_views.setGenOrganized(gen_organized_);
+              render_views.setCamPosConstraints(campos_constraints_func_);
+
+              render_views.generateViews ();
+
+              render_views.getViews (views_xyz_orig);
+              render_views.getPoses (poses);
+              render_views.getEntropies (entropies);
+            }
 
             model.views_.reset (new std::vector<typename pcl::PointCloud<PointInT>::Ptr> ());
             model.poses_.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > ());
@@ -310,6 +551,7 @@ namespace faat_pcl
               PersistenceUtils::writeFloatToFile (path_entropy.str (), model.self_occlusions_->at (i));
             }
 
+            TrainingManifest::writeSourceStamp (direc.str (), model_path);
             loadOrGenerate (dir, model_path, model);
 
           }
@@ -0,0 +1,458 @@
+/*
+ * model_database.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "model_database.h"
+#include "persistence_utils.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+namespace bf = boost::filesystem;
+
+namespace
+{
+  const char MODEL_DB_MAGIC[8] = { 'V', '4', 'R', 'M', 'O', 'D', 'D', 'B' };
+
+  uint64_t
+  fnv1a (const char * data, size_t size)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= static_cast<unsigned char> (data[i]);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  class Writer
+  {
+  public:
+    std::vector<char> buffer;
+
+    void
+    write (const void * data, size_t size)
+    {
+      const char * p = reinterpret_cast<const char *> (data);
+      buffer.insert (buffer.end (), p, p + size);
+    }
+
+    template<typename T>
+    void
+    put (const T & value)
+    {
+      write (&value, sizeof(T));
+    }
+
+    void
+    putString (const std::string & s)
+    {
+      put (static_cast<uint32_t> (s.size ()));
+      write (s.data (), s.size ());
+    }
+  };
+
+  /** \brief Reads from the payload, every read checks the remaining size so a corrupted file cannot overrun */
+  class Reader
+  {
+    const char * data_;
+    size_t size_;
+    size_t pos_;
+
+  public:
+    Reader (const char * data, size_t size) : data_ (data), size_ (size), pos_ (0) {}
+
+    bool
+    read (void * data, size_t size)
+    {
+      if (size > size_ - pos_)
+        return false;
+
+      if (size > 0)
+        memcpy (data, data_ + pos_, size);
+      pos_ += size;
+      return true;
+    }
+
+    template<typename T>
+    bool
+    get (T & value)
+    {
+      return read (&value, sizeof(T));
+    }
+
+    bool
+    getString (std::string & s)
+    {
+      uint32_t size;
+      if (!get (size) || size > size_ - pos_)
+        return false;
+
+      s.assign (data_ + pos_, size);
+      pos_ += size;
+      return true;
+    }
+
+    bool
+    atEnd () const
+    {
+      return pos_ == size_;
+    }
+  };
+
+  void
+  writeCloud (Writer & w, const pcl::PCLPointCloud2 & cloud)
+  {
+    w.put (static_cast<uint32_t> (cloud.height));
+    w.put (static_cast<uint32_t> (cloud.width));
+    w.put (static_cast<uint32_t> (cloud.fields.size ()));
+    for (size_t f = 0; f < cloud.fields.size (); f++)
+    {
+      w.putString (cloud.fields[f].name);
+      w.put (static_cast<uint32_t> (cloud.fields[f].offset));
+      w.put (static_cast<uint8_t> (cloud.fields[f].datatype));
+      w.put (static_cast<uint32_t> (cloud.fields[f].count));
+    }
+    w.put (static_cast<uint8_t> (cloud.is_bigendian));
+    w.put (static_cast<uint32_t> (cloud.point_step));
+    w.put (static_cast<uint32_t> (cloud.row_step));
+    w.put (static_cast<uint8_t> (cloud.is_dense));
+    w.put (static_cast<uint64_t> (cloud.data.size ()));
+    if (!cloud.data.empty ())
+      w.write (&cloud.data[0], cloud.data.size ());
+  }
+
+  bool
+  readCloud (Reader & r, pcl::PCLPointCloud2 & cloud)
+  {
+    uint32_t height, width, num_fields, point_step, row_step;
+    uint8_t is_bigendian, is_dense;
+    uint64_t data_size;
+
+    if (!r.get (height) || !r.get (width) || !r.get (num_fields))
+      return false;
+
+    cloud.height = height;
+    cloud.width = width;
+    cloud.fields.clear ();
+    for (uint32_t f = 0; f < num_fields; f++)
+    {
+      pcl::PCLPointField field;
+      uint32_t offset, count;
+      uint8_t datatype;
+      if (!r.getString (field.name) || !r.get (offset) || !r.get (datatype) || !r.get (count))
+        return false;
+
+      field.offset = offset;
+      field.datatype = datatype;
+      field.count = count;
+      cloud.fields.push_back (field);
+    }
+
+    if (!r.get (is_bigendian) || !r.get (point_step) || !r.get (row_step) || !r.get (is_dense) || !r.get (data_size))
+      return false;
+
+    cloud.is_bigendian = is_bigendian;
+    cloud.point_step = point_step;
+    cloud.row_step = row_step;
+    cloud.is_dense = is_dense;
+
+    if (data_size != static_cast<uint64_t> (point_step) * width * height)
+      return false;
+
+    cloud.data.resize (data_size);
+    return data_size == 0 || r.read (&cloud.data[0], data_size);
+  }
+
+  struct DirectoryEntry
+  {
+    std::string path;
+    std::string prefix;
+    std::string extension;
+    int view_id;
+  };
+
+  /** \brief Splits <prefix>_<id>.<extension>, returns false for other file names */
+  bool
+  parseFilename (const std::string & file, DirectoryEntry & entry)
+  {
+    size_t dot = file.rfind ('.');
+    if (dot == std::string::npos)
+      return false;
+
+    std::string stem = file.substr (0, dot);
+    entry.extension = file.substr (dot + 1);
+
+    size_t underscore = stem.rfind ('_');
+    if (underscore == std::string::npos || underscore == 0 || underscore + 1 == stem.size ())
+      return false;
+
+    std::string id = stem.substr (underscore + 1);
+    for (size_t i = 0; i < id.size (); i++)
+    {
+      if (id[i] < '0' || id[i] > '9')
+        return false;
+    }
+
+    entry.prefix = stem.substr (0, underscore);
+    entry.view_id = atoi (id.c_str ());
+    return true;
+  }
+}
+
+faat_pcl::rec_3d_framework::ModelDatabase::View &
+faat_pcl::rec_3d_framework::ModelDatabase::addView (int view_id)
+{
+  std::map<int, size_t>::iterator it = view_index_.find (view_id);
+  if (it != view_index_.end ())
+    return views_[it->second];
+
+  view_index_[view_id] = views_.size ();
+  views_.push_back (View (view_id));
+  return views_.back ();
+}
+
+bool
+faat_pcl::rec_3d_framework::ModelDatabase::save (const std::string & file) const
+{
+  Writer w;
+  w.put (static_cast<uint64_t> (views_.size ()));
+  for (size_t i = 0; i < views_.size (); i++)
+  {
+    const View & view = views_[i];
+    w.put (static_cast<int32_t> (view.id_));
+
+    uint8_t flags = (view.has_pose_ ? 1 : 0) | (view.has_entropy_ ? 2 : 0) | (view.has_centroid_ ? 4 : 0);
+    w.put (flags);
+
+    //row-major, as in the pose files
+    for (int r = 0; r < 4; r++)
+      for (int c = 0; c < 4; c++)
+        w.put (view.pose_ (r, c));
+
+    w.put (view.entropy_);
+    w.put (view.centroid_[0]);
+    w.put (view.centroid_[1]);
+    w.put (view.centroid_[2]);
+
+    w.put (static_cast<uint32_t> (view.clouds_.size ()));
+    std::map<std::string, pcl::PCLPointCloud2>::const_iterator it;
+    for (it = view.clouds_.begin (); it != view.clouds_.end (); it++)
+    {
+      w.putString (it->first);
+      writeCloud (w, it->second);
+    }
+  }
+
+  std::string tmp = PersistenceUtils::getTemporaryFilename (file);
+  std::ofstream out (tmp.c_str (), std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "Cannot open file " << tmp << std::endl;
+    return false;
+  }
+
+  uint32_t version = VERSION;
+  uint64_t payload_size = w.buffer.size ();
+  uint64_t checksum = fnv1a (w.buffer.empty () ? 0 : &w.buffer[0], w.buffer.size ());
+
+  out.write (MODEL_DB_MAGIC, sizeof(MODEL_DB_MAGIC));
+  out.write (reinterpret_cast<const char *> (&version), sizeof(version));
+  out.write (reinterpret_cast<const char *> (&payload_size), sizeof(payload_size));
+  out.write (reinterpret_cast<const char *> (&checksum), sizeof(checksum));
+  if (!w.buffer.empty ())
+    out.write (&w.buffer[0], w.buffer.size ());
+
+  out.close ();
+  if (!out)
+  {
+    std::cout << "Cannot write " << tmp << std::endl;
+    return false;
+  }
+
+  return PersistenceUtils::commitTemporaryFile (file);
+}
+
+bool
+faat_pcl::rec_3d_framework::ModelDatabase::load (const std::string & file)
+{
+  clear ();
+
+  std::ifstream in (file.c_str (), std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(MODEL_DB_MAGIC)];
+  uint32_t version = 0;
+  uint64_t payload_size = 0, checksum = 0;
+  if (!in.read (magic, sizeof(magic)) || memcmp (magic, MODEL_DB_MAGIC, sizeof(magic)) != 0)
+  {
+    std::cout << file << " is not a model database" << std::endl;
+    return false;
+  }
+
+  in.read (reinterpret_cast<char *> (&version), sizeof(version));
+  in.read (reinterpret_cast<char *> (&payload_size), sizeof(payload_size));
+  in.read (reinterpret_cast<char *> (&checksum), sizeof(checksum));
+  if (!in || version != VERSION)
+  {
+    std::cout << file << " has version " << version << ", expected " << VERSION << std::endl;
+    return false;
+  }
+
+  //the payload size is checked against the file size before allocating
+  std::streampos start = in.tellg ();
+  in.seekg (0, std::ios::end);
+  std::streampos end = in.tellg ();
+  in.seekg (start);
+  if (end - start != static_cast<std::streamoff> (payload_size))
+  {
+    std::cout << file << " is truncated" << std::endl;
+    return false;
+  }
+
+  std::vector<char> payload (payload_size);
+  if (payload_size > 0 && !in.read (&payload[0], payload_size))
+    return false;
+
+  if (fnv1a (payload.empty () ? 0 : &payload[0], payload.size ()) != checksum)
+  {
+    std::cout << file << " is corrupted (checksum mismatch)" << std::endl;
+    return false;
+  }
+
+  Reader r (payload.empty () ? 0 : &payload[0], payload.size ());
+  uint64_t num_views = 0;
+  bool ok = r.get (num_views);
+  for (uint64_t i = 0; i < num_views && ok; i++)
+  {
+    int32_t view_id;
+    uint8_t flags;
+    ok = r.get (view_id) && r.get (flags);
+    if (!ok)
+      break;
+
+    View & view = addView (view_id);
+    view.has_pose_ = (flags & 1) != 0;
+    view.has_entropy_ = (flags & 2) != 0;
+    view.has_centroid_ = (flags & 4) != 0;
+
+    for (int k = 0; k < 16 && ok; k++)
+      ok = r.get (view.pose_ (k / 4, k % 4));
+
+    ok = ok && r.get (view.entropy_) && r.get (view.centroid_[0]) && r.get (view.centroid_[1]) && r.get (view.centroid_[2]);
+
+    uint32_t num_clouds = 0;
+    ok = ok && r.get (num_clouds);
+    for (uint32_t c = 0; c < num_clouds && ok; c++)
+    {
+      std::string name;
+      ok = r.getString (name) && readCloud (r, view.clouds_[name]);
+    }
+  }
+
+  if (!ok || !r.atEnd ())
+  {
+    std::cout << "Cannot read " << file << std::endl;
+    clear ();
+    return false;
+  }
+
+  return true;
+}
+
+bool
+faat_pcl::rec_3d_framework::ModelDatabase::convertDirectory (const std::string & dir)
+{
+  clear ();
+
+  bf::path path = dir;
+  if (!bf::exists (path) || !bf::is_directory (path))
+    return false;
+
+  std::vector<DirectoryEntry> entries;
+  bf::directory_iterator end_itr;
+  for (bf::directory_iterator itr (path); itr != end_itr; ++itr)
+  {
+    if (!bf::is_regular_file (*itr))
+      continue;
+
+#if BOOST_FILESYSTEM_VERSION == 3
+    std::string file = (itr->path ().filename ()).string ();
+#else
+    std::string file = (itr->path ()).filename ();
+#endif
+
+    //temporary files of an interrupted training end with .tmp and are skipped here
+    DirectoryEntry entry;
+    if (!parseFilename (file, entry))
+      continue;
+
+    bool known_txt = entry.extension == "txt" && (entry.prefix == "pose" || entry.prefix == "entropy" || entry.prefix == "centroid");
+    if (!known_txt && entry.extension != "pcd")
+      continue;
+
+    entry.path = itr->path ().string ();
+    entries.push_back (entry);
+  }
+
+  //views are numbered in the directory order of the descriptor files (or view files), the order
+  //loadFeaturesAndCreateFLANN and getViewsFilenames see them in, so saved FLANN indices stay valid
+  const char * primary[] = { "descriptor", "view" };
+  for (size_t p = 0; p < 2; p++)
+  {
+    for (size_t i = 0; i < entries.size (); i++)
+    {
+      if (entries[i].extension == "pcd" && entries[i].prefix == primary[p])
+        addView (entries[i].view_id);
+    }
+  }
+
+  for (size_t i = 0; i < entries.size (); i++)
+  {
+    const DirectoryEntry & entry = entries[i];
+    View & view = addView (entry.view_id);
+
+    if (entry.extension == "pcd")
+    {
+      if (pcl::io::loadPCDFile (entry.path, view.clouds_[entry.prefix]) < 0)
+      {
+        std::cout << "Cannot read " << entry.path << std::endl;
+        clear ();
+        return false;
+      }
+    }
+    else if (entry.prefix == "pose")
+    {
+      view.has_pose_ = PersistenceUtils::readMatrixFromFile2 (entry.path, view.pose_);
+    }
+    else if (entry.prefix == "entropy")
+    {
+      view.has_entropy_ = PersistenceUtils::readFloatFromFile (entry.path, view.entropy_);
+    }
+    else if (entry.prefix == "centroid")
+    {
+      view.has_centroid_ = PersistenceUtils::getCentroidFromFile (entry.path, view.centroid_);
+    }
+  }
+
+  return !empty ();
+}
+
+bool
+faat_pcl::rec_3d_framework::ModelDatabase::convert (const std::string & dir)
+{
+  ModelDatabase db;
+  if (!db.convertDirectory (dir))
+  {
+    std::cout << "Nothing to convert in " << dir << std::endl;
+    return false;
+  }
+
+  return db.save (getFilename (dir));
+}
@@ -0,0 +1,193 @@
+/*
+ * model_database.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_REC_FRAMEWORK_MODEL_DATABASE_H_
+#define FAAT_PCL_REC_FRAMEWORK_MODEL_DATABASE_H_
+
+#include "faat_3d_rec_framework_defines.h"
+#include <pcl/point_cloud.h>
+#include <pcl/PCLPointCloud2.h>
+#include <pcl/conversions.h>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace faat_pcl
+{
+  namespace rec_3d_framework
+  {
+
+    /**
+     * \brief All per-view data of a model directory (the rendered views of a model or one of its descriptor
+     * directories) in a single binary file, replacing the pose_/entropy_/centroid_ text files and the PCD files.
+     * Every view keeps its pose, entropy (self-occlusion), centroid and any number of named point clouds
+     * (e.g. "view", "descriptor", "keypoint_indices", "normals") stored as PCLPointCloud2, so the container
+     * does not depend on the point types.
+     *
+     * The file starts with a magic number, the format version, the payload size and a FNV-1a checksum of the
+     * payload. A file with another version or a wrong checksum is rejected, the loaders then fall back to the
+     * text/PCD files.
+     */
+    class FAAT_3D_FRAMEWORK_API ModelDatabase
+    {
+    public:
+
+      static const unsigned int VERSION = 1;
+
+      class View
+      {
+      public:
+        int id_;
+        bool has_pose_;
+        Eigen::Matrix4f pose_;
+        bool has_entropy_;
+        float entropy_;
+        bool has_centroid_;
+        Eigen::Vector3f centroid_;
+        std::map<std::string, pcl::PCLPointCloud2> clouds_;
+
+        View (int id = 0)
+        {
+          id_ = id;
+          has_pose_ = false;
+          pose_.setIdentity ();
+          has_entropy_ = false;
+          entropy_ = 0.f;
+          has_centroid_ = false;
+          centroid_.setZero ();
+        }
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      };
+
+    private:
+
+      /** \brief Views in the order the text loaders see them (directory order of the descriptor or view files) */
+      std::vector<View, Eigen::aligned_allocator<View> > views_;
+      std::map<int, size_t> view_index_;
+
+    public:
+
+      static std::string
+      getFilename (const std::string & dir)
+      {
+        return dir + "/model_database.bin";
+      }
+
+      /**
+       * \brief Reads file, returns false (and leaves the database empty) if it does not exist, has another
+       * version or is corrupted
+       */
+      bool
+      load (const std::string & file);
+
+      /**
+       * \brief Writes the database to file + ".tmp" and renames it
+       */
+      bool
+      save (const std::string & file) const;
+
+      /**
+       * \brief Reads the pose_<id>.txt (as readMatrixFromFile2), entropy_<id>.txt, centroid_<id>.txt and
+       * <name>_<id>.pcd files of dir. Returns false if dir has no such files or one of them cannot be read.
+       */
+      bool
+      convertDirectory (const std::string & dir);
+
+      /**
+       * \brief Converts dir and saves the result as getFilename (dir), the text and PCD files are kept
+       */
+      static bool
+      convert (const std::string & dir);
+
+      void
+      clear ()
+      {
+        views_.clear ();
+        view_index_.clear ();
+      }
+
+      bool
+      empty () const
+      {
+        return views_.empty ();
+      }
+
+      size_t
+      size () const
+      {
+        return views_.size ();
+      }
+
+      /**
+       * \brief Returns the view with view_id, appending it if it does not exist yet
+       */
+      View &
+      addView (int view_id);
+
+      View &
+      getViewAt (size_t i)
+      {
+        return views_[i];
+      }
+
+      const View &
+      getViewAt (size_t i) const
+      {
+        return views_[i];
+      }
+
+      /**
+       * \brief Returns 0 if there is no view with view_id
+       */
+      const View *
+      getView (int view_id) const
+      {
+        std::map<int, size_t>::const_iterator it = view_index_.find (view_id);
+        if (it == view_index_.end ())
+          return 0;
+
+        return &views_[it->second];
+      }
+
+      /**
+       * \brief Number of points of the cloud name of view (0 if there is none), without converting it
+       */
+      size_t
+      getCloudSize (const View & view, const std::string & name) const
+      {
+        std::map<std::string, pcl::PCLPointCloud2>::const_iterator it = view.clouds_.find (name);
+        if (it == view.clouds_.end ())
+          return 0;
+
+        return static_cast<size_t> (it->second.width) * it->second.height;
+      }
+
+      template<typename PointT>
+        bool
+        getCloud (const View & view, const std::string & name, pcl::PointCloud<PointT> & cloud) const
+        {
+          std::map<std::string, pcl::PCLPointCloud2>::const_iterator it = view.clouds_.find (name);
+          if (it == view.clouds_.end ())
+            return false;
+
+          pcl::fromPCLPointCloud2 (it->second, cloud);
+          return true;
+        }
+
+      template<typename PointT>
+        void
+        setCloud (View & view, const std::string & name, const pcl::PointCloud<PointT> & cloud)
+        {
+          pcl::toPCLPointCloud2 (cloud, view.clouds_[name]);
+        }
+    };
+  }
+}
+
+#endif /* FAAT_PCL_REC_FRAMEWORK_MODEL_DATABASE_H_ */
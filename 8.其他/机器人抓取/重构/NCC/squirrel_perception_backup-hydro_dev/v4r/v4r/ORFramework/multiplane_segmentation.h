@@ -9,6 +9,7 @@
 #define FAAT_PCL_3D_REC_FRAMEWORK_MULTIPLANE_SEGMENTATION_H_
 
 #include "v4r/ORUtils/common_data_structures.h"
+#include "v4r/ORUtils/organized_plane_extraction.h"
 
 namespace faat_pcl
 {
@@ -26,6 +27,7 @@ namespace faat_pcl
       bool merge_planes_;
       pcl::PointCloud<pcl::Normal>::Ptr normal_cloud_;
       bool normals_set_;
+      typename OrganizedPlaneExtraction<PointT>::Ptr plane_extraction_;
 
     public:
       MultiPlaneSegmentation()
@@ -65,6 +67,12 @@ namespace faat_pcl
           normals_set_ = true;
       }
 
+      //planes of organized clouds are read from this (shared) extraction instead of a private one
+      void setPlaneExtraction(typename OrganizedPlaneExtraction<PointT>::Ptr & plane_extraction)
+      {
+          plane_extraction_ = plane_extraction;
+      }
+
       std::vector<PlaneModel<PointT> > getModels()
       {
         return models_;
@@ -9,6 +9,7 @@
 #define FAAT_PCL_3D_REC_FRAMEWORK_MULTIPLANE_SEGMENTATION_HPP_
 
 #include "multiplane_segmentation.h"
+#include "v4r/ORUtils/organized_plane_extraction.hpp"
 #include <pcl/point_types.h>
 #include <pcl/filters/extract_indices.h>
 #include <pcl/filters/voxel_grid.h>
@@ -42,44 +43,29 @@ faat_pcl::MultiPlaneSegmentation<PointT>::segment(bool force_unorganized)
 
   if(input_->isOrganized() && !force_unorganized)
   {
-    pcl::PointCloud<pcl::Normal>::Ptr normal_cloud (new pcl::PointCloud<pcl::Normal>);
-    if(!normals_set_)
+    typename OrganizedPlaneExtraction<PointT>::Ptr extraction = plane_extraction_;
+    if(!extraction)
     {
-        pcl::IntegralImageNormalEstimation<PointT, pcl::Normal> ne;
-        ne.setNormalEstimationMethod (ne.COVARIANCE_MATRIX);
-        ne.setMaxDepthChangeFactor (0.02f);
-        ne.setNormalSmoothingSize (20.0f);
-        ne.setBorderPolicy (pcl::IntegralImageNormalEstimation<PointT, pcl::Normal>::BORDER_POLICY_IGNORE);
-        ne.setInputCloud (input_);
-        ne.compute (*normal_cloud);
-    }
-    else
-    {
-        normal_cloud = normal_cloud_;
+        extraction.reset(new OrganizedPlaneExtraction<PointT>);
+        extraction->setMinPlaneInliers (min_plane_inliers_);
+        extraction->setComputeConvexHulls (false);
+        if(normals_set_)
+            extraction->setNormals (normal_cloud_);
     }
 
-    pcl::OrganizedMultiPlaneSegmentation<PointT, pcl::Normal, pcl::Label> mps;
-    mps.setMinInliers (min_plane_inliers_);
-    mps.setAngularThreshold (0.017453 * 2.f); // 2 degrees
-    mps.setDistanceThreshold (0.01); // 1cm
-    mps.setMaximumCurvature(0.002);
-    mps.setInputNormals (normal_cloud);
-    mps.setInputCloud (input_);
+    extraction->compute (input_);
 
-    std::vector<pcl::PlanarRegion<PointT>, Eigen::aligned_allocator<pcl::PlanarRegion<PointT> > > regions;
     std::vector<pcl::ModelCoefficients> model_coefficients;
     std::vector<pcl::PointIndices> inlier_indices;
-    pcl::PointCloud<pcl::Label>::Ptr labels (new pcl::PointCloud<pcl::Label>);
-    std::vector<pcl::PointIndices> label_indices;
-    std::vector<pcl::PointIndices> boundary_indices;
-
-    typename pcl::PlaneRefinementComparator<PointT, pcl::Normal, pcl::Label>::Ptr ref_comp (
-                                                                                             new pcl::PlaneRefinementComparator<PointT,
-                                                                                                 pcl::Normal, pcl::Label> ());
-    ref_comp->setDistanceThreshold (0.01f, false);
-    ref_comp->setAngularThreshold (0.017453 * 2.f);
-    mps.setRefinementComparator (ref_comp);
-    mps.segmentAndRefine (regions, model_coefficients, inlier_indices, labels, label_indices, boundary_indices);
+    const std::vector<typename OrganizedPlaneExtraction<PointT>::Plane> & planes = extraction->getPlanes();
+    for(size_t i=0; i < planes.size(); i++)
+    {
+      if(static_cast<int>(planes[i].inliers_.indices.size()) < min_plane_inliers_)
+        continue;
+
+      model_coefficients.push_back(planes[i].coefficients_);
+      inlier_indices.push_back(planes[i].inliers_);
+    }
     //mps.segment (model_coefficients, inlier_indices);
 
     //std::cout << model_coefficients.size() << std::endl;
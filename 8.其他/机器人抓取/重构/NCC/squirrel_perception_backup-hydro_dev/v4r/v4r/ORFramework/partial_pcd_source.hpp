@@ -9,7 +9,11 @@
 #define FAAT_PCL_PARTIAL_PCD_SOURCE_HPP_
 
 #include "partial_pcd_source.h"
+#include "software_renderer.h"
 #include <pcl/common/angles.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 template<typename Full3DPointT, typename PointInT, typename OutModelPointT>
 void
@@ -19,6 +23,9 @@ faat_pcl::rec_3d_framework::PartialPCDSource<Full3DPointT, PointInT, OutModelPoi
   pathmodel << dir << "/" << model.class_ << "/" << model.id_;
   bf::path trained_dir = pathmodel.str ();
 
+  model.source_file_ = model_path;
+  this->removeModelDirectoryIfSourceChanged (dir, model);
+
   model.views_.reset (new std::vector<typename pcl::PointCloud<PointInT>::Ptr>);
   model.poses_.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
   model.self_occlusions_.reset (new std::vector<float>);
@@ -161,7 +168,21 @@ faat_pcl::rec_3d_framework::PartialPCDSource<Full3DPointT, PointInT, OutModelPoi
     //pcl::visualization::PCLVisualizer vis_test("vis");
     //vis_test.addCoordinateSystem(0.1f);
 
-    for (size_t i = 0; i < cam_positions.size (); i++)
+    //views are rendered in parallel, each thread splats into its own (reused) buffers
+    SoftwareRenderer renderer;
+    renderer.setResolution (cx_size, cy_size);
+    renderer.setFocalLength (f_);
+
+#ifdef _OPENMP
+    int num_threads = omp_get_num_procs ();
+#else
+    int num_threads = 1;
+#endif
+    std::vector<RenderBuffers> thread_buffers (num_threads);
+    std::vector<RenderBuffers> thread_tmp_buffers (num_threads);
+
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+    for (int i = 0; i < static_cast<int> (cam_positions.size ()); i++)
     {
       //obtain partial views and views poses
       typename pcl::PointCloud<Full3DPointT>::Ptr model_cloud_trans (new pcl::PointCloud<Full3DPointT> ());
@@ -237,300 +258,53 @@ faat_pcl::rec_3d_framework::PartialPCDSource<Full3DPointT, PointInT, OutModelPoi
 
       }
 
-      //reason about occlusions, TODO: Check this crap!
+      //reason about occlusions, splat the model into this thread's buffers
+#ifdef _OPENMP
+      int thread_id = omp_get_thread_num ();
+#else
+      int thread_id = 0;
+#endif
+      RenderBuffers & buffers = thread_buffers[thread_id];
+      renderer.splat (*model_cloud_trans, buffers);
+      renderer.smoothSplats (buffers, thread_tmp_buffers[thread_id]);
+
       int cx_, cy_;
       cx_ = cx_size;
       cy_ = cy_size;
-      int width_ = cx_;
-      int height_ = cy_;
-
-      std::cout << "(cx,cy)" << cx_ << "," << cy_ << std::endl;
-      std::cout << "(width_,height_)" << width_ << "," << height_ << std::endl;
 
       typename pcl::PointCloud<Full3DPointT>::Ptr filtered (new pcl::PointCloud<Full3DPointT> ());
-      typename pcl::PointCloud<Full3DPointT>::ConstPtr model_cloud_trans_const (new pcl::PointCloud<Full3DPointT> (*model_cloud_trans));
-
-      //typename pcl::occlusion_reasoning::ZBuffering<Full3DPointT, Full3DPointT> zbuffer_self_occlusion (cx_, cy_, 525.f);
-      //zbuffer_self_occlusion.computeDepthMap (model_cloud_trans_const, true);
+      filtered->width = cx_;
+      filtered->height = cy_;
+      filtered->points.resize (cx_ * cy_);
+      filtered->is_dense = false;
 
+      for (int cx = 0; cx < cx_; cx++)
       {
-          float * depth_ = new float[cx_ * cy_];
-          uint8_t * r = new uint8_t[cx_ * cy_];
-          uint8_t * g = new uint8_t[cx_ * cy_];
-          uint8_t * b = new uint8_t[cx_ * cy_];
-          Eigen::Vector3f * normals = new Eigen::Vector3f[cx_ * cy_];
-
-          typename pcl::PointCloud<Full3DPointT>::Ptr depth_map (new pcl::PointCloud<Full3DPointT>);
-          depth_map->width = cx_;
-          depth_map->height = cy_;
-          depth_map->points.resize (cx_ * cy_);
-          depth_map->is_dense = false;
-
+        for (int cy = 0; cy < cy_; cy++)
+        {
+          int idx = cy * cx_ + cx;
+          if (buffers.isValid (idx))
           {
-            float cx2, cy2;
-            cx2 = static_cast<float> (cx_) / 2.f - 0.5f;
-            cy2 = static_cast<float> (cy_) / 2.f - 0.5f;
-
-            /*float max_u, max_v, min_u, min_v;
-            max_u = max_v = std::numeric_limits<float>::max () * -1;
-            min_u = min_v = std::numeric_limits<float>::max ();
-
-            for (size_t i = 0; i < model_cloud_trans_const->points.size (); i++)
-            {
-              float b_x = model_cloud_trans_const->points[i].x / model_cloud_trans_const->points[i].z;
-              if (b_x > max_u)
-                max_u = b_x;
-              if (b_x < min_u)
-                min_u = b_x;
-
-              float b_y = model_cloud_trans_const->points[i].y / model_cloud_trans_const->points[i].z;
-              if (b_y > max_v)
-                max_v = b_y;
-              if (b_y < min_v)
-                min_v = b_y;
-            }
-
-            float maxC = std::max (std::max (std::abs (max_u), std::abs (max_v)), std::max (std::abs (min_u), std::abs (min_v)));*/
-            //float f_ = (cx) / maxC;
-            //f_ /= 1.5;
-
-            for (int i = 0; i < (cx_ * cy_); i++)
-              depth_[i] = std::numeric_limits<float>::quiet_NaN ();
-
-            for (size_t i = 0; i < model_cloud_trans_const->points.size (); i++)
-            {
-              float x = model_cloud_trans_const->points[i].x;
-              float y = model_cloud_trans_const->points[i].y;
-              float z = model_cloud_trans_const->points[i].z;
-              int u = static_cast<int> (f_ * x / z + cx2);
-              int v = static_cast<int> (f_ * y / z + cy2);
-
-              if (u >= width_ || v >= height_ || u < 0 || v < 0)
-                continue;
-
-              int idx = v * width_ + u;
-              if(idx >= (cx_ * cy_))
-              {
-                  std::cout << "(u,v)" << u << "," << v << std::endl;
-                  std::cout << "(cx,cy)" << cx_ << "," << cy_ << std::endl;
-                  std::cout << "(width_,height_)" << width_ << "," << height_ << std::endl;
-                  std::cout << idx << " " << cx_ * cy_ << std::endl;
-              }
-
-              assert(idx < cx_ * cy_);
-              if ((z < depth_[idx]) || (!pcl_isfinite(depth_[idx])))
-              {
-                depth_[idx] = z;
-                normals[idx] = model_cloud_trans_const->points[i].getNormalVector3fMap();
-                r[idx] = model_cloud_trans_const->points[i].r;
-                g[idx] = model_cloud_trans_const->points[i].g;
-                b[idx] = model_cloud_trans_const->points[i].b;
-              }
-
-            }
-
-            {
-              int ws = 3;
-              int ws2 = std::floor (static_cast<float> (ws) / 2.f);
-              float * depth_smooth = new float[cx_ * cy_];
-              uint8_t * r_s = new uint8_t[cx_ * cy_];
-              uint8_t * g_s = new uint8_t[cx_ * cy_];
-              uint8_t * b_s = new uint8_t[cx_ * cy_];
-              Eigen::Vector3f * normals_s = new Eigen::Vector3f[cx_ * cy_];
-
-              memcpy (depth_smooth, depth_, sizeof(float) * cx_ * cy_);
-              memcpy (normals_s, normals, sizeof(Eigen::Vector3f) * cx_ * cy_);
-
-              memcpy (r_s, r, sizeof(uint8_t) * cx_ * cy_);
-              memcpy (g_s, g, sizeof(uint8_t) * cx_ * cy_);
-              memcpy (b_s, b, sizeof(uint8_t) * cx_ * cy_);
-
-              for (int u = ws2; u < (cx_ - ws2); u++)
-              {
-                for (int v = ws2; v < (cy_ - ws2); v++)
-                {
-                  //if (!pcl_isfinite(depth_[u * cx_ + v]))
-                  // continue;
-
-                  float min = std::numeric_limits<float>::max ();
-                  uint8_t min_r;
-                  uint8_t min_g;
-                  uint8_t min_b;
-                  Eigen::Vector3f min_normal;
-                  for (int j = (u - ws2); j <= (u + ws2); j++)
-                  {
-                    for (int i = (v - ws2); i <= (v + ws2); i++)
-                    {
-                      int idx = i * width_ + j;
-                      assert(i < cy_ && j < cx_);
-                      assert(idx < cx_ * cy_);
-
-                      if (pcl_isfinite(depth_[idx]) && (depth_[idx] < min))
-                      {
-                        min = depth_[idx];
-                        min_r = r[idx];
-                        min_g = g[idx];
-                        min_b = b[idx];
-                        min_normal = normals[idx];
-                      }
-                    }
-                  }
-
-                  int idx = v * width_ + u;
-                  assert(idx < cx_ * cy_);
-
-                  if (min < (std::numeric_limits<float>::max () - 0.1)) //check that min is not inf...
-                  {
-                    if (((depth_[idx] - min) > 0.01) || !pcl_isfinite(depth_[idx])) //check that the pixel is far away or nan in order to replace it
-                    {
-                      float new_d = 0.f;
-                      int new_r, new_g, new_b;
-                      new_r = new_g = new_b = 0;
-                      Eigen::Vector3f new_normal;
-                      int num = 0;
-                      int ws3 = 2;
-                      for (int j = (u - ws3); j <= (u + ws3); j++)
-                      {
-                        for (int i = (v - ws3); i <= (v + ws3); i++)
-                        {
-                          int idx = i * width_ + j;
-                          if(idx >= cx_ * cy_)
-                              continue;
-
-                          if (pcl_isfinite(depth_[idx]) && (std::abs (depth_[idx] - min) <= 0.005f))
-                          {
-                            new_d += depth_[idx];
-                            new_r += static_cast<int> (r[idx]);
-                            new_g += static_cast<int> (g[idx]);
-                            new_b += static_cast<int> (b[idx]);
-                            num++;
-                            new_normal += normals[idx];
-                          }
-                        }
-                      }
-
-                      uint8_t new_rr;
-                      uint8_t new_gg;
-                      uint8_t new_bb;
-
-                      if (num != 0)
-                      {
-                        new_d /= static_cast<float> (num);
-                        new_r /= static_cast<float> (num);
-                        new_g /= static_cast<float> (num);
-                        new_b /= static_cast<float> (num);
-                        new_rr = static_cast<uint8_t> (new_r);
-                        new_gg = static_cast<uint8_t> (new_g);
-                        new_bb = static_cast<uint8_t> (new_b);
-                        new_normal /= static_cast<float>(num);
-                      }
-                      else
-                      {
-                        new_d = min;
-                        new_rr = min_r;
-                        new_gg = min_g;
-                        new_bb = min_b;
-                        new_normal = min_normal;
-                      }
-
-                      depth_smooth[idx] = new_d;
-                      r_s[idx] = new_rr;
-                      g_s[idx] = new_gg;
-                      b_s[idx] = new_bb;
-                      normals_s[idx] = new_normal;
-                    }
-                  }
-                }
-              }
-
-              memcpy (depth_, depth_smooth, sizeof(float) * cx_ * cy_);
-              memcpy (normals, normals_s, sizeof(Eigen::Vector3f) * cx_ * cy_);
-
-              memcpy (r, r_s, sizeof(uint8_t) * cx_ * cy_);
-              memcpy (g, g_s, sizeof(uint8_t) * cx_ * cy_);
-              memcpy (b, b_s, sizeof(uint8_t) * cx_ * cy_);
-              delete[] r_s;
-              delete[] g_s;
-              delete[] b_s;
-              delete[] normals_s;
-
-              //erode
-              int times_erode = ws2;
-              ws2 = 1;
-              while (times_erode > 0)
-              {
-                for (int u = ws2; u < (cx_ - ws2); u++)
-                {
-                  for (int v = ws2; v < (cy_ - ws2); v++)
-                  {
-
-                    int idx = v * width_ + u;
-
-                    bool to_erode = false;
-                    int nans = 0;
-                    for (int j = (u - ws2); j <= (u + ws2); j++)
-                    {
-                      for (int i = (v - ws2); i <= (v + ws2); i++)
-                      {
-
-                        int idx = i * width_ + j;
-                        if (!pcl_isfinite(depth_smooth[idx]))
-                        {
-                          to_erode = true;
-                          nans++;
-                        }
-                      }
-                    }
-
-                    if (to_erode && ((pow ((ws2 + 1) * 2, 2) - 1) >= 3))
-                    {
-                      depth_[idx] = std::numeric_limits<float>::quiet_NaN ();
-                    }
-                  }
-                }
-                times_erode--;
-              }
-
-              delete[] depth_smooth;
-
-            }
-
-            for (int cx = 0; cx < cx_; cx++)
-            {
-              for (int cy = 0; cy < cy_; cy++)
-              {
-                if (pcl_isfinite(depth_[cy * cx_ + cx]))
-                {
-                  depth_map->at (cx, cy).x = ((cx - (cx_ / 2)) * depth_[cy * cx_ + cx]) / f_;
-                  depth_map->at (cx, cy).y = ((cy - (cy_ / 2)) * depth_[cy * cx_ + cx]) / f_;
-                  depth_map->at (cx, cy).z = depth_[cy * cx_ + cx];
-                  depth_map->at (cx, cy).getNormalVector3fMap() = normals[cy * cx_ + cx];
-
-                  depth_map->at (cx, cy).r = r[cy * cx_ + cx];
-                  depth_map->at (cx, cy).g = g[cy * cx_ + cx];
-                  depth_map->at (cx, cy).b = b[cy * cx_ + cx];
-                }
-                else
-                {
-                  depth_map->at (cx, cy).x = std::numeric_limits<float>::quiet_NaN ();
-                  depth_map->at (cx, cy).y = std::numeric_limits<float>::quiet_NaN ();
-                  depth_map->at (cx, cy).z = std::numeric_limits<float>::quiet_NaN ();
-                  depth_map->at (cx, cy).r = 255;
-                  depth_map->at (cx, cy).g = 255;
-                  depth_map->at (cx, cy).b = 0;
-                }
-              }
-            }
-
-            pcl::copyPointCloud (*depth_map, *filtered);
+            filtered->at (cx, cy).x = ((cx - (cx_ / 2)) * buffers.depth_[idx]) / f_;
+            filtered->at (cx, cy).y = ((cy - (cy_ / 2)) * buffers.depth_[idx]) / f_;
+            filtered->at (cx, cy).z = buffers.depth_[idx];
+            filtered->at (cx, cy).getNormalVector3fMap () = buffers.normals_[idx];
+
+            filtered->at (cx, cy).r = buffers.r_[idx];
+            filtered->at (cx, cy).g = buffers.g_[idx];
+            filtered->at (cx, cy).b = buffers.b_[idx];
+          }
+          else
+          {
+            filtered->at (cx, cy).x = std::numeric_limits<float>::quiet_NaN ();
+            filtered->at (cx, cy).y = std::numeric_limits<float>::quiet_NaN ();
+            filtered->at (cx, cy).z = std::numeric_limits<float>::quiet_NaN ();
+            filtered->at (cx, cy).r = 255;
+            filtered->at (cx, cy).g = 255;
+            filtered->at (cx, cy).b = 0;
           }
-
-          delete[] normals;
-          delete[] depth_;
-          delete[] r;
-          delete[] g;
-          delete[] b;
         }
+      }
 
       std::vector<int> keep;
       std::vector<int> set_to_nan;
@@ -604,7 +378,6 @@ faat_pcl::rec_3d_framework::PartialPCDSource<Full3DPointT, PointInT, OutModelPoi
 
       std::stringstream path_view;
       path_view << direc.str () << "/view_" << std::setfill ('0') << std::setw (8) << i << ".pcd";
-      std::cout << filtered2->points.size() << std::endl;
       pcl::io::savePCDFileBinary (path_view.str (), *filtered2);
 
       std::stringstream path_pose;
@@ -725,6 +498,7 @@ faat_pcl::rec_3d_framework::PartialPCDSource<Full3DPointT, PointInT, OutModelPoi
       }
     }*/
 
+    TrainingManifest::writeSourceStamp (pathmodel.str (), model_path);
     loadOrGenerate (dir, model_path, model);
   }
 }
@@ -266,6 +266,58 @@ namespace faat_pcl
 
           pcl::io::loadPCDFile (view_file.str (), *cloud);
         }
+
+      /**
+       * \brief Files are first written to file + ".tmp" and then renamed, so that an interrupted
+       * training never leaves a truncated file under the final name
+       */
+      inline std::string
+      getTemporaryFilename (const std::string & file)
+      {
+        return file + ".tmp";
+      }
+
+      inline bool
+      commitTemporaryFile (const std::string & file)
+      {
+        boost::system::error_code ec;
+        boost::filesystem::rename (getTemporaryFilename (file), file, ec);
+        if (ec)
+        {
+          std::cout << "Cannot rename " << getTemporaryFilename (file) << " to " << file << ": " << ec.message () << std::endl;
+          return false;
+        }
+
+        return true;
+      }
+
+      template<typename PointT>
+        inline bool
+        savePCDFileBinaryAtomic (const std::string & file, const pcl::PointCloud<PointT> & cloud)
+        {
+          if (pcl::io::savePCDFileBinary (getTemporaryFilename (file), cloud) < 0)
+            return false;
+
+          return commitTemporaryFile (file);
+        }
+
+      inline bool
+      writeMatrixToFileAtomic (const std::string & file, Eigen::Matrix4f & matrix)
+      {
+        if (!writeMatrixToFile (getTemporaryFilename (file), matrix))
+          return false;
+
+        return commitTemporaryFile (file);
+      }
+
+      inline bool
+      writeFloatToFileAtomic (const std::string & file, float value)
+      {
+        if (!writeFloatToFile (getTemporaryFilename (file), value))
+          return false;
+
+        return commitTemporaryFile (file);
+      }
     }
   }
 }
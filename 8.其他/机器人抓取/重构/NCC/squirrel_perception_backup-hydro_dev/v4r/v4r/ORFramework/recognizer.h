@@ -97,30 +97,40 @@ namespace faat_pcl
         typename boost::shared_ptr<faat_pcl::HypothesisVerification<PointInT, PointInT> > hv_algorithm_;
 
         void poseRefinement()
+        {
+          poseRefinement (input_, icp_scene_indices_, *models_, *transforms_);
+        }
+
+        /**
+         * \brief Refines the poses of the hypotheses models/transforms in the scene input with ICP
+         * Only the points scene_indices of the scene are used if given (icp_scene_indices_ belong to input_).
+         */
+        void poseRefinement(const PointInTPtr & input, const pcl::PointIndicesPtr & scene_indices, const std::vector<ModelTPtr> & models,
+                            std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > & transforms)
         {
           pcl::ScopeTime ticp ("ICP ");
           PointInTPtr cloud_voxelized_icp (new pcl::PointCloud<PointInT> ());
           pcl::VoxelGrid<PointInT> voxel_grid_icp;
-          voxel_grid_icp.setInputCloud (input_);
-          if(icp_scene_indices_ && icp_scene_indices_->indices.size() > 0)
+          voxel_grid_icp.setInputCloud (input);
+          if(scene_indices && scene_indices->indices.size() > 0)
           {
-            voxel_grid_icp.setIndices(icp_scene_indices_);
+            voxel_grid_icp.setIndices(scene_indices);
           }
           voxel_grid_icp.setLeafSize (VOXEL_SIZE_ICP_, VOXEL_SIZE_ICP_, VOXEL_SIZE_ICP_);
           voxel_grid_icp.filter (*cloud_voxelized_icp);
-          std::cout << "Number of hypotheses to ICP:" << models_->size () << std::endl;
+          std::cout << "Number of hypotheses to ICP:" << models.size () << std::endl;
           switch (icp_type_)
           {
             case 0:
             {
     #pragma omp parallel for schedule(dynamic,1) num_threads(omp_get_num_procs())
-              for (int i = 0; i < static_cast<int> (models_->size ()); i++)
+              for (int i = 0; i < static_cast<int> (models.size ()); i++)
               {
 
                 ConstPointInTPtr model_cloud;
                 PointInTPtr model_aligned (new pcl::PointCloud<PointInT>);
-                model_cloud = models_->at (i)->getAssembled (VOXEL_SIZE_ICP_);
-                pcl::transformPointCloud (*model_cloud, *model_aligned, transforms_->at (i));
+                model_cloud = models.at (i)->getAssembled (VOXEL_SIZE_ICP_);
+                pcl::transformPointCloud (*model_cloud, *model_aligned, transforms.at (i));
 
                 typename pcl::registration::CorrespondenceRejectorSampleConsensus<PointInT>::Ptr
                                         rej (new pcl::registration::CorrespondenceRejectorSampleConsensus<PointInT> ());
@@ -137,11 +147,11 @@ namespace faat_pcl
                 reg.setMaximumIterations (ICP_iterations_);
                 reg.setMaxCorrespondenceDistance (max_corr_distance_);
 
-                typename pcl::PointCloud<PointInT>::Ptr output_ (new pcl::PointCloud<PointInT> ());
-                reg.align (*output_);
+                pcl::PointCloud<PointInT> icp_output;
+                reg.align (icp_output);
 
                 Eigen::Matrix4f icp_trans = reg.getFinalTransformation ();
-                transforms_->at (i) = icp_trans * transforms_->at (i);
+                transforms.at (i) = icp_trans * transforms.at (i);
               }
             }
               break;
@@ -149,7 +159,7 @@ namespace faat_pcl
             {
 
     #pragma omp parallel for schedule(dynamic,1) num_threads(omp_get_num_procs())
-              for (int i = 0; i < static_cast<int> (models_->size ()); i++)
+              for (int i = 0; i < static_cast<int> (models.size ()); i++)
               {
 
                 typename VoxelBasedCorrespondenceEstimation<PointInT, PointInT>::Ptr
@@ -158,10 +168,10 @@ namespace faat_pcl
                 typename pcl::registration::CorrespondenceRejectorSampleConsensus<PointInT>::Ptr
                             rej (new pcl::registration::CorrespondenceRejectorSampleConsensus<PointInT> ());
 
-                Eigen::Matrix4f scene_to_model_trans = transforms_->at (i).inverse ();
+                Eigen::Matrix4f scene_to_model_trans = transforms.at (i).inverse ();
                 //boost::shared_ptr<VoxelGridDistanceTransform<PointInT> > dt;
                 boost::shared_ptr<distance_field::PropagationDistanceField<PointInT> > dt;
-                models_->at (i)->getVGDT (dt);
+                models.at (i)->getVGDT (dt);
 
                 PointInTPtr model_aligned (new pcl::PointCloud<PointInT>);
                 typename pcl::PointCloud<PointInT>::ConstPtr cloud;
@@ -218,12 +228,12 @@ namespace faat_pcl
                 convergence_criteria->setMaximumIterationsSimilarTransforms(15);
                 convergence_criteria->setFailureAfterMaximumIterations(false);
 
-                typename pcl::PointCloud<PointInT>::Ptr output_ (new pcl::PointCloud<PointInT> ());
-                reg.align (*output_);
+                pcl::PointCloud<PointInT> icp_output;
+                reg.align (icp_output);
 
                 Eigen::Matrix4f icp_trans;
                 icp_trans = reg.getFinalTransformation () * scene_to_model_trans;
-                transforms_->at (i) = icp_trans.inverse ();
+                transforms.at (i) = icp_trans.inverse ();
 
                 /*pcl::registration::DefaultConvergenceCriteria<float>::ConvergenceState conv_state;
                 conv_state = convergence_criteria->getConvergenceState();
@@ -247,27 +257,39 @@ namespace faat_pcl
           models_before_hv_ = models_;
           transforms_before_hv_ = transforms_;
 
+          hypothesisVerification (hv_algorithm_, input_, models_, transforms_);
+        }
+
+        /**
+         * \brief Verifies the hypotheses models/transforms in the scene input with hv, rejected ones are removed
+         */
+        void
+        hypothesisVerification (const typename boost::shared_ptr<faat_pcl::HypothesisVerification<PointInT, PointInT> > & hv,
+                                const PointInTPtr & input,
+                                boost::shared_ptr<std::vector<ModelTPtr> > & models,
+                                boost::shared_ptr<std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > > & transforms)
+        {
           pcl::ScopeTime thv ("HV verification");
 
           std::vector<typename pcl::PointCloud<PointInT>::ConstPtr> aligned_models;
           std::vector<pcl::PointCloud<pcl::Normal>::ConstPtr> aligned_normals;
-          aligned_models.resize (models_->size ());
-          aligned_normals.resize (models_->size ());
+          aligned_models.resize (models->size ());
+          aligned_normals.resize (models->size ());
 
 #pragma omp parallel for schedule(dynamic,1) num_threads(omp_get_num_procs())
-          for (size_t i = 0; i < models_->size (); i++)
+          for (size_t i = 0; i < models->size (); i++)
           {
             //we should get the resolution of the hv_algorithm here... then we can avoid to voxel grid again when computing the cues...
-            //ConstPointInTPtr model_cloud = models_->at (i)->getAssembled (0.005f);
-            ConstPointInTPtr model_cloud = models_->at (i)->getAssembled (VOXEL_SIZE_ICP_);
+            //ConstPointInTPtr model_cloud = models->at (i)->getAssembled (0.005f);
+            ConstPointInTPtr model_cloud = models->at (i)->getAssembled (VOXEL_SIZE_ICP_);
 
             PointInTPtr model_aligned (new pcl::PointCloud<PointInT>);
-            pcl::transformPointCloud (*model_cloud, *model_aligned, transforms_->at (i));
+            pcl::transformPointCloud (*model_cloud, *model_aligned, transforms->at (i));
             aligned_models[i] = model_aligned;
 
-            if (hv_algorithm_->getRequiresNormals () && !recompute_hv_normals_)
+            if (hv->getRequiresNormals () && !recompute_hv_normals_)
             {
-              pcl::PointCloud<pcl::Normal>::ConstPtr normals_cloud = models_->at (i)->getNormalsAssembled (VOXEL_SIZE_ICP_);
+              pcl::PointCloud<pcl::Normal>::ConstPtr normals_cloud = models->at (i)->getNormalsAssembled (VOXEL_SIZE_ICP_);
               pcl::PointCloud<pcl::Normal>::Ptr normals_aligned (new pcl::PointCloud<pcl::Normal>);
               normals_aligned->points.resize (normals_cloud->points.size ());
               normals_aligned->width = normals_cloud->width;
@@ -275,12 +297,12 @@ namespace faat_pcl
               for (size_t k = 0; k < normals_cloud->points.size (); k++)
               {
                 Eigen::Vector3f nt (normals_cloud->points[k].normal_x, normals_cloud->points[k].normal_y, normals_cloud->points[k].normal_z);
-                normals_aligned->points[k].normal_x = static_cast<float> (transforms_->at (i) (0, 0) * nt[0] + transforms_->at (i) (0, 1) * nt[1]
-                    + transforms_->at (i) (0, 2) * nt[2]);
-                normals_aligned->points[k].normal_y = static_cast<float> (transforms_->at (i) (1, 0) * nt[0] + transforms_->at (i) (1, 1) * nt[1]
-                    + transforms_->at (i) (1, 2) * nt[2]);
-                normals_aligned->points[k].normal_z = static_cast<float> (transforms_->at (i) (2, 0) * nt[0] + transforms_->at (i) (2, 1) * nt[1]
-                    + transforms_->at (i) (2, 2) * nt[2]);
+                normals_aligned->points[k].normal_x = static_cast<float> (transforms->at (i) (0, 0) * nt[0] + transforms->at (i) (0, 1) * nt[1]
+                    + transforms->at (i) (0, 2) * nt[2]);
+                normals_aligned->points[k].normal_y = static_cast<float> (transforms->at (i) (1, 0) * nt[0] + transforms->at (i) (1, 1) * nt[1]
+                    + transforms->at (i) (1, 2) * nt[2]);
+                normals_aligned->points[k].normal_z = static_cast<float> (transforms->at (i) (2, 0) * nt[0] + transforms->at (i) (2, 1) * nt[1]
+                    + transforms->at (i) (2, 2) * nt[2]);
 
                 //flip here based on vp?
                 pcl::flipNormalTowardsViewpoint (model_aligned->points[k], 0, 0, 0, normals_aligned->points[k].normal[0],
@@ -292,15 +314,15 @@ namespace faat_pcl
           }
 
           std::vector<bool> mask_hv;
-          hv_algorithm_->setSceneCloud (input_);
-          if (hv_algorithm_->getRequiresNormals () && !recompute_hv_normals_)
+          hv->setSceneCloud (input);
+          if (hv->getRequiresNormals () && !recompute_hv_normals_)
           {
-            hv_algorithm_->addNormalsClouds (aligned_normals);
+            hv->addNormalsClouds (aligned_normals);
           }
 
-          hv_algorithm_->addModels (aligned_models, true);
-          hv_algorithm_->verify ();
-          hv_algorithm_->getMask (mask_hv);
+          hv->addModels (aligned_models, true);
+          hv->verify ();
+          hv->getMask (mask_hv);
 
           boost::shared_ptr<std::vector<ModelTPtr> > models_temp;
           boost::shared_ptr<std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > > transforms_temp;
@@ -308,17 +330,17 @@ namespace faat_pcl
           models_temp.reset (new std::vector<ModelTPtr>);
           transforms_temp.reset (new std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> >);
 
-          for (size_t i = 0; i < models_->size (); i++)
+          for (size_t i = 0; i < models->size (); i++)
           {
             if (!mask_hv[i])
               continue;
 
-            models_temp->push_back (models_->at (i));
-            transforms_temp->push_back (transforms_->at (i));
+            models_temp->push_back (models->at (i));
+            transforms_temp->push_back (transforms->at (i));
           }
 
-          models_ = models_temp;
-          transforms_ = transforms_temp;
+          models = models_temp;
+          transforms = transforms_temp;
 
         }
 
@@ -391,7 +413,7 @@ namespace faat_pcl
         setHVAlgorithm (typename boost::shared_ptr<pcl::HypothesisVerification<PointInT, PointInT> > & alg) = 0;*/
 
         void
-        setHVAlgorithm (const typename boost::shared_ptr<const faat_pcl::HypothesisVerification<PointInT, PointInT> > & alg)
+        setHVAlgorithm (const typename boost::shared_ptr<faat_pcl::HypothesisVerification<PointInT, PointInT> > & alg)
         {
           hv_algorithm_ = alg;
         }
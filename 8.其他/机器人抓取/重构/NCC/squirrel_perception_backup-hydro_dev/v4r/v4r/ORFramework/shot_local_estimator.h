@@ -114,12 +114,11 @@ namespace faat_pcl
           std::cout << keypoints->points.size() << " " << normals->points.size() << " " << processed->points.size() << std::endl;
           //compute signatures
           typedef typename pcl::SHOTEstimation<PointInT, pcl::Normal, pcl::SHOT352> SHOTEstimator;
-          typename pcl::search::KdTree<PointInT>::Ptr tree (new pcl::search::KdTree<PointInT>);
 
           pcl::PointCloud<pcl::SHOT352>::Ptr shots (new pcl::PointCloud<pcl::SHOT352>);
 
           SHOTEstimator shot_estimate;
-          shot_estimate.setSearchMethod (tree);
+          this->setCachedSearch (shot_estimate, keypoints);
           shot_estimate.setInputCloud (keypoints);
           shot_estimate.setSearchSurface(processed);
           shot_estimate.setInputNormals (normals);
@@ -29,8 +29,6 @@ namespace faat_pcl
         using LocalEstimator<PointInT, FeatureT>::support_radius_;
         using LocalEstimator<PointInT, FeatureT>::normal_estimator_;
         using LocalEstimator<PointInT, FeatureT>::keypoint_extractor_;
-        using LocalEstimator<PointInT, FeatureT>::neighborhood_indices_;
-        using LocalEstimator<PointInT, FeatureT>::neighborhood_dist_;
         using LocalEstimator<PointInT, FeatureT>::adaptative_MLS_;
         using LocalEstimator<PointInT, FeatureT>::normals_;
         using LocalEstimator<PointInT, FeatureT>::keypoint_indices_;
@@ -138,13 +136,11 @@ namespace faat_pcl
 
           //compute signatures
           typedef typename pcl::SHOTEstimationOMP<PointInT, pcl::Normal, pcl::SHOT352> SHOTEstimator;
-          typename pcl::search::KdTree<PointInT>::Ptr tree (new pcl::search::KdTree<PointInT>);
-          tree->setInputCloud (processed);
 
           pcl::PointCloud<pcl::SHOT352>::Ptr shots (new pcl::PointCloud<pcl::SHOT352>);
           SHOTEstimator shot_estimate;
           shot_estimate.setNumberOfThreads (8);
-          shot_estimate.setSearchMethod (tree);
+          this->setCachedSearch (shot_estimate, keypoints);
           shot_estimate.setInputCloud (keypoints);
           shot_estimate.setSearchSurface(processed);
           shot_estimate.setInputNormals (normals_);
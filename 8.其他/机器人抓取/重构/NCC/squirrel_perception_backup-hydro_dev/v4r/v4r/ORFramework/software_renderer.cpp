@@ -0,0 +1,420 @@
+/*
+ * software_renderer.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "software_renderer.h"
+#include <map>
+#include <algorithm>
+
+namespace faat_pcl
+{
+  namespace rec_3d_framework
+  {
+
+    float
+    RenderMesh::getFaceArea (int face_id) const
+    {
+      const Eigen::Vector3i & f = faces_[face_id];
+      return 0.5f * ((vertices_[f[1]] - vertices_[f[0]]).cross (vertices_[f[2]] - vertices_[f[0]])).norm ();
+    }
+
+    float
+    RenderMesh::getTotalArea () const
+    {
+      float area = 0.f;
+      for (size_t i = 0; i < faces_.size (); i++)
+        area += getFaceArea (static_cast<int> (i));
+
+      return area;
+    }
+
+    Eigen::Vector3f
+    RenderMesh::getCentroid () const
+    {
+      Eigen::Vector3f centroid = Eigen::Vector3f::Zero ();
+      if (vertices_.empty ())
+        return centroid;
+
+      for (size_t i = 0; i < vertices_.size (); i++)
+        centroid += vertices_[i];
+
+      return centroid / static_cast<float> (vertices_.size ());
+    }
+
+    void
+    RenderBuffers::resize (int width, int height)
+    {
+      if (width == width_ && height == height_)
+        return;
+
+      width_ = width;
+      height_ = height;
+      size_t n = static_cast<size_t> (width * height);
+      depth_.resize (n);
+      normals_.resize (n);
+      r_.resize (n);
+      g_.resize (n);
+      b_.resize (n);
+      labels_.resize (n);
+    }
+
+    void
+    RenderBuffers::clear ()
+    {
+      std::fill (depth_.begin (), depth_.end (), std::numeric_limits<float>::quiet_NaN ());
+      std::fill (normals_.begin (), normals_.end (), Eigen::Vector3f::Zero ());
+      std::fill (r_.begin (), r_.end (), 0);
+      std::fill (g_.begin (), g_.end (), 0);
+      std::fill (b_.begin (), b_.end (), 0);
+      std::fill (labels_.begin (), labels_.end (), -1);
+    }
+
+    void
+    SoftwareRenderer::setViewAngle (float view_angle)
+    {
+      f_ = (static_cast<float> (width_) / 2.f) / std::tan (view_angle / 2.f * static_cast<float> (M_PI) / 180.f);
+    }
+
+    namespace
+    {
+      int
+      getMidPoint (int a, int b, std::vector<Eigen::Vector3f> & vertices, std::map<std::pair<int, int>, int> & cache)
+      {
+        std::pair<int, int> key (std::min (a, b), std::max (a, b));
+        std::map<std::pair<int, int>, int>::const_iterator it = cache.find (key);
+        if (it != cache.end ())
+          return it->second;
+
+        vertices.push_back (((vertices[a] + vertices[b]) * 0.5f).normalized ());
+        int id = static_cast<int> (vertices.size ()) - 1;
+        cache[key] = id;
+        return id;
+      }
+    }
+
+    void
+    SoftwareRenderer::getTesselatedSphereCamPositions (int tes_level, bool use_vertices, std::vector<Eigen::Vector3f> & cam_positions)
+    {
+      //icosahedron centered at the origin, vertices are normalized to the unit sphere
+      float t = (1.f + std::sqrt (5.f)) / 2.f;
+      std::vector<Eigen::Vector3f> vertices;
+      vertices.push_back (Eigen::Vector3f (0, 1, t));
+      vertices.push_back (Eigen::Vector3f (0, -1, t));
+      vertices.push_back (Eigen::Vector3f (0, 1, -t));
+      vertices.push_back (Eigen::Vector3f (0, -1, -t));
+      vertices.push_back (Eigen::Vector3f (1, t, 0));
+      vertices.push_back (Eigen::Vector3f (-1, t, 0));
+      vertices.push_back (Eigen::Vector3f (1, -t, 0));
+      vertices.push_back (Eigen::Vector3f (-1, -t, 0));
+      vertices.push_back (Eigen::Vector3f (t, 0, 1));
+      vertices.push_back (Eigen::Vector3f (-t, 0, 1));
+      vertices.push_back (Eigen::Vector3f (t, 0, -1));
+      vertices.push_back (Eigen::Vector3f (-t, 0, -1));
+
+      for (size_t i = 0; i < vertices.size (); i++)
+        vertices[i].normalize ();
+
+      static const int ico_faces[20][3] = { {0, 8, 4}, {0, 5, 9}, {2, 4, 10}, {2, 11, 5}, {1, 6, 8}, {1, 9, 7}, {3, 10, 6}, {3, 7, 11},
+                                            {0, 4, 5}, {2, 5, 4}, {1, 7, 6}, {3, 6, 7}, {8, 10, 4}, {8, 6, 10}, {9, 5, 11}, {9, 11, 7},
+                                            {0, 1, 8}, {0, 9, 1}, {2, 10, 3}, {2, 3, 11} };
+
+      std::vector<Eigen::Vector3i> faces;
+      for (int i = 0; i < 20; i++)
+        faces.push_back (Eigen::Vector3i (ico_faces[i][0], ico_faces[i][1], ico_faces[i][2]));
+
+      //each level splits every triangle in four, new vertices are projected onto the sphere
+      for (int l = 0; l < tes_level; l++)
+      {
+        std::map<std::pair<int, int>, int> cache;
+        std::vector<Eigen::Vector3i> new_faces;
+        new_faces.reserve (faces.size () * 4);
+        for (size_t i = 0; i < faces.size (); i++)
+        {
+          int a = getMidPoint (faces[i][0], faces[i][1], vertices, cache);
+          int b = getMidPoint (faces[i][1], faces[i][2], vertices, cache);
+          int c = getMidPoint (faces[i][2], faces[i][0], vertices, cache);
+          new_faces.push_back (Eigen::Vector3i (faces[i][0], a, c));
+          new_faces.push_back (Eigen::Vector3i (faces[i][1], b, a));
+          new_faces.push_back (Eigen::Vector3i (faces[i][2], c, b));
+          new_faces.push_back (Eigen::Vector3i (a, b, c));
+        }
+        faces.swap (new_faces);
+      }
+
+      cam_positions.clear ();
+      if (use_vertices)
+      {
+        cam_positions = vertices;
+      }
+      else
+      {
+        cam_positions.resize (faces.size ());
+        for (size_t i = 0; i < faces.size (); i++)
+          cam_positions[i] = (vertices[faces[i][0]] + vertices[faces[i][1]] + vertices[faces[i][2]]) / 3.f;
+      }
+    }
+
+    Eigen::Matrix4f
+    SoftwareRenderer::getLookAtOriginRotation (const Eigen::Vector3f & cam_pos)
+    {
+      Eigen::Vector3f zp = cam_pos * -1.f;
+      zp.normalize ();
+      Eigen::Vector3f yp = (Eigen::Vector3f::UnitY ()).cross (zp);
+
+      //camera on the y axis, any perpendicular direction does the job
+      if (yp.norm () < 1e-6)
+        yp = (Eigen::Vector3f::UnitX ()).cross (zp);
+
+      yp.normalize ();
+      Eigen::Vector3f xp = zp.cross (yp);
+      xp.normalize ();
+
+      Eigen::Matrix4f rot_matrix;
+      rot_matrix.setIdentity ();
+      rot_matrix.block<3, 1> (0, 0) = xp;
+      rot_matrix.block<3, 1> (0, 1) = yp;
+      rot_matrix.block<3, 1> (0, 2) = zp;
+
+      //rotation matrix, the inverse is the transpose
+      Eigen::Matrix4f inv = Eigen::Matrix4f::Identity ();
+      inv.block<3, 3> (0, 0) = rot_matrix.block<3, 3> (0, 0).transpose ();
+      return inv;
+    }
+
+    void
+    SoftwareRenderer::render (const RenderMesh & mesh, const Eigen::Matrix4f & model_to_camera, RenderBuffers & buffers) const
+    {
+      buffers.resize (width_, height_);
+      buffers.clear ();
+
+      float cx = static_cast<float> (width_) / 2.f - 0.5f;
+      float cy = static_cast<float> (height_) / 2.f - 0.5f;
+      bool has_colors = mesh.vertex_colors_.size () == mesh.vertices_.size ();
+
+      Eigen::Matrix3f R = model_to_camera.block<3, 3> (0, 0);
+      Eigen::Vector3f T = model_to_camera.block<3, 1> (0, 3);
+
+      for (size_t f = 0; f < mesh.faces_.size (); f++)
+      {
+        Eigen::Vector3f p[3];
+        float u[3], v[3];
+        bool behind = false;
+        for (int k = 0; k < 3; k++)
+        {
+          p[k] = R * mesh.vertices_[mesh.faces_[f][k]] + T;
+          if (p[k][2] <= 0.f)
+          {
+            behind = true;
+            break;
+          }
+
+          u[k] = f_ * p[k][0] / p[k][2] + cx;
+          v[k] = f_ * p[k][1] / p[k][2] + cy;
+        }
+
+        if (behind)
+          continue;
+
+        float area = (u[1] - u[0]) * (v[2] - v[0]) - (u[2] - u[0]) * (v[1] - v[0]);
+        if (std::abs (area) < 1e-12f)
+          continue;
+
+        int min_u = std::max (0, static_cast<int> (std::floor (std::min (u[0], std::min (u[1], u[2])))));
+        int max_u = std::min (width_ - 1, static_cast<int> (std::ceil (std::max (u[0], std::max (u[1], u[2])))));
+        int min_v = std::max (0, static_cast<int> (std::floor (std::min (v[0], std::min (v[1], v[2])))));
+        int max_v = std::min (height_ - 1, static_cast<int> (std::ceil (std::max (v[0], std::max (v[1], v[2])))));
+
+        if (min_u > max_u || min_v > max_v)
+          continue;
+
+        //face normal pointing towards the camera
+        Eigen::Vector3f normal = (p[1] - p[0]).cross (p[2] - p[0]);
+        normal.normalize ();
+        if (normal.dot (p[0]) > 0.f)
+          normal *= -1.f;
+
+        float inv_z[3] = { 1.f / p[0][2], 1.f / p[1][2], 1.f / p[2][2] };
+
+        for (int pv = min_v; pv <= max_v; pv++)
+        {
+          for (int pu = min_u; pu <= max_u; pu++)
+          {
+            //barycentric coordinates of the pixel center
+            float w0 = ((u[1] - pu) * (v[2] - pv) - (u[2] - pu) * (v[1] - pv)) / area;
+            float w1 = ((u[2] - pu) * (v[0] - pv) - (u[0] - pu) * (v[2] - pv)) / area;
+            float w2 = 1.f - w0 - w1;
+            if (w0 < 0.f || w1 < 0.f || w2 < 0.f)
+              continue;
+
+            //1/z is linear in screen space
+            float z = 1.f / (w0 * inv_z[0] + w1 * inv_z[1] + w2 * inv_z[2]);
+            int idx = pv * width_ + pu;
+            if (buffers.isValid (idx) && buffers.depth_[idx] <= z)
+              continue;
+
+            buffers.depth_[idx] = z;
+            buffers.normals_[idx] = normal;
+            buffers.labels_[idx] = static_cast<int> (f);
+
+            if (has_colors)
+            {
+              float pw0 = w0 * inv_z[0] * z;
+              float pw1 = w1 * inv_z[1] * z;
+              float pw2 = w2 * inv_z[2] * z;
+              Eigen::Vector3f c = mesh.vertex_colors_[mesh.faces_[f][0]] * pw0 + mesh.vertex_colors_[mesh.faces_[f][1]] * pw1
+                  + mesh.vertex_colors_[mesh.faces_[f][2]] * pw2;
+              buffers.r_[idx] = static_cast<uint8_t> (std::min (255.f, std::max (0.f, c[0])));
+              buffers.g_[idx] = static_cast<uint8_t> (std::min (255.f, std::max (0.f, c[1])));
+              buffers.b_[idx] = static_cast<uint8_t> (std::min (255.f, std::max (0.f, c[2])));
+            }
+          }
+        }
+      }
+    }
+
+    void
+    SoftwareRenderer::smoothSplats (RenderBuffers & buffers, RenderBuffers & tmp) const
+    {
+      int width = buffers.width_;
+      int height = buffers.height_;
+      int ws2 = 1;
+      int ws3 = 2;
+
+      tmp.resize (width, height);
+      tmp.depth_ = buffers.depth_;
+      tmp.normals_ = buffers.normals_;
+      tmp.r_ = buffers.r_;
+      tmp.g_ = buffers.g_;
+      tmp.b_ = buffers.b_;
+      tmp.labels_ = buffers.labels_;
+
+      for (int u = ws2; u < (width - ws2); u++)
+      {
+        for (int v = ws2; v < (height - ws2); v++)
+        {
+          float min = std::numeric_limits<float>::max ();
+          int min_idx = -1;
+          for (int j = (u - ws2); j <= (u + ws2); j++)
+          {
+            for (int i = (v - ws2); i <= (v + ws2); i++)
+            {
+              int idx = i * width + j;
+              if (buffers.isValid (idx) && (buffers.depth_[idx] < min))
+              {
+                min = buffers.depth_[idx];
+                min_idx = idx;
+              }
+            }
+          }
+
+          if (min_idx < 0)
+            continue;
+
+          int idx = v * width + u;
+
+          //check that the pixel is far away or nan in order to replace it
+          if (buffers.isValid (idx) && (buffers.depth_[idx] - min) <= 0.01f)
+            continue;
+
+          float new_d = 0.f;
+          int new_r = 0, new_g = 0, new_b = 0;
+          Eigen::Vector3f new_normal = Eigen::Vector3f::Zero ();
+          int num = 0;
+          for (int j = std::max (0, u - ws3); j <= std::min (width - 1, u + ws3); j++)
+          {
+            for (int i = std::max (0, v - ws3); i <= std::min (height - 1, v + ws3); i++)
+            {
+              int nidx = i * width + j;
+              if (buffers.isValid (nidx) && (std::abs (buffers.depth_[nidx] - min) <= 0.005f))
+              {
+                new_d += buffers.depth_[nidx];
+                new_r += static_cast<int> (buffers.r_[nidx]);
+                new_g += static_cast<int> (buffers.g_[nidx]);
+                new_b += static_cast<int> (buffers.b_[nidx]);
+                new_normal += buffers.normals_[nidx];
+                num++;
+              }
+            }
+          }
+
+          if (num != 0)
+          {
+            tmp.depth_[idx] = new_d / static_cast<float> (num);
+            tmp.r_[idx] = static_cast<uint8_t> (new_r / num);
+            tmp.g_[idx] = static_cast<uint8_t> (new_g / num);
+            tmp.b_[idx] = static_cast<uint8_t> (new_b / num);
+            tmp.normals_[idx] = new_normal / static_cast<float> (num);
+          }
+          else
+          {
+            tmp.depth_[idx] = min;
+            tmp.r_[idx] = buffers.r_[min_idx];
+            tmp.g_[idx] = buffers.g_[min_idx];
+            tmp.b_[idx] = buffers.b_[min_idx];
+            tmp.normals_[idx] = buffers.normals_[min_idx];
+          }
+
+          tmp.labels_[idx] = buffers.labels_[min_idx];
+        }
+      }
+
+      buffers.depth_.swap (tmp.depth_);
+      buffers.normals_.swap (tmp.normals_);
+      buffers.r_.swap (tmp.r_);
+      buffers.g_.swap (tmp.g_);
+      buffers.b_.swap (tmp.b_);
+      buffers.labels_.swap (tmp.labels_);
+
+      //erode, tmp.depth_ keeps the smoothed depth
+      tmp.depth_ = buffers.depth_;
+      for (int u = ws2; u < (width - ws2); u++)
+      {
+        for (int v = ws2; v < (height - ws2); v++)
+        {
+          bool to_erode = false;
+          for (int j = (u - ws2); j <= (u + ws2) && !to_erode; j++)
+          {
+            for (int i = (v - ws2); i <= (v + ws2); i++)
+            {
+              if (!tmp.isValid (i * width + j))
+              {
+                to_erode = true;
+                break;
+              }
+            }
+          }
+
+          if (to_erode)
+          {
+            buffers.depth_[v * width + u] = std::numeric_limits<float>::quiet_NaN ();
+            buffers.labels_[v * width + u] = -1;
+          }
+        }
+      }
+    }
+
+    float
+    SoftwareRenderer::computeVisibleAreaRatio (const RenderMesh & mesh, const RenderBuffers & buffers, std::vector<unsigned char> & face_seen)
+    {
+      face_seen.assign (mesh.faces_.size (), 0);
+      float visible = 0.f;
+      for (size_t i = 0; i < buffers.labels_.size (); i++)
+      {
+        int label = buffers.labels_[i];
+        if (label < 0 || face_seen[label])
+          continue;
+
+        face_seen[label] = 1;
+        visible += mesh.getFaceArea (label);
+      }
+
+      float total = mesh.getTotalArea ();
+      if (total <= 0.f)
+        return 0.f;
+
+      return visible / total;
+    }
+  }
+}
@@ -0,0 +1,205 @@
+/*
+ * software_renderer.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_REC_FRAMEWORK_SOFTWARE_RENDERER_H_
+#define FAAT_PCL_REC_FRAMEWORK_SOFTWARE_RENDERER_H_
+
+#include "faat_3d_rec_framework_defines.h"
+#include <pcl/common/common.h>
+#include <vector>
+#include <limits>
+#include <stdint.h>
+
+namespace faat_pcl
+{
+  namespace rec_3d_framework
+  {
+
+    /**
+     * \brief Triangle mesh as consumed by SoftwareRenderer. Vertex colors are optional
+     * (leave the vector empty if the model has none).
+     */
+    struct RenderMesh
+    {
+      std::vector<Eigen::Vector3f> vertices_;
+      std::vector<Eigen::Vector3i> faces_;
+      std::vector<Eigen::Vector3f> vertex_colors_;
+
+      /** \brief Sum of the triangle areas, used to compute self-occlusions of a rendered view */
+      float
+      getTotalArea () const;
+
+      /** \brief Area of triangle face_id */
+      float
+      getFaceArea (int face_id) const;
+
+      Eigen::Vector3f
+      getCentroid () const;
+    };
+
+    /**
+     * \brief Per-view output of SoftwareRenderer. Buffers are row major (v * width + u).
+     * Depth is NaN and label is -1 where nothing has been rendered. The same object can be
+     * passed to consecutive render calls, memory is only reallocated if the resolution changes.
+     */
+    struct RenderBuffers
+    {
+      int width_;
+      int height_;
+      std::vector<float> depth_;
+      std::vector<Eigen::Vector3f> normals_;
+      std::vector<uint8_t> r_, g_, b_;
+      std::vector<int> labels_;
+
+      RenderBuffers ()
+      {
+        width_ = height_ = 0;
+      }
+
+      void
+      resize (int width, int height);
+
+      void
+      clear ();
+
+      inline bool
+      isValid (int idx) const
+      {
+        return pcl_isfinite(depth_[idx]);
+      }
+    };
+
+    /**
+     * \brief CPU rasterizer / splatter used to generate training views without a VTK/OpenGL window.
+     * Meshes are rasterized with a z-buffer (depth, face normal, interpolated vertex color and face id
+     * per pixel), point clouds with normals are splatted into the same buffers. Camera positions on the
+     * tesselated sphere are computed without VTK as well, so view generation can run on headless
+     * machines and in parallel (one RenderBuffers per thread).
+     */
+    class FAAT_3D_FRAMEWORK_API SoftwareRenderer
+    {
+      int width_, height_;
+      float f_;
+
+    public:
+
+      SoftwareRenderer ()
+      {
+        width_ = height_ = 150;
+        f_ = 525.f;
+      }
+
+      void
+      setResolution (int width, int height)
+      {
+        width_ = width;
+        height_ = height;
+      }
+
+      void
+      setFocalLength (float f)
+      {
+        f_ = f;
+      }
+
+      /** \brief Sets the focal length so that the image covers view_angle (degrees) horizontally */
+      void
+      setViewAngle (float view_angle);
+
+      int
+      getWidth () const
+      {
+        return width_;
+      }
+
+      int
+      getHeight () const
+      {
+        return height_;
+      }
+
+      float
+      getFocalLength () const
+      {
+        return f_;
+      }
+
+      /**
+       * \brief Camera positions on the unit sphere obtained by subdividing an icosahedron tes_level times.
+       * If use_vertices is false, the centers of the faces are returned (as RenderViewsTesselatedSphere does).
+       */
+      static void
+      getTesselatedSphereCamPositions (int tes_level, bool use_vertices, std::vector<Eigen::Vector3f> & cam_positions);
+
+      /**
+       * \brief Rotation taking points from the object frame to a camera placed at cam_pos looking at the origin.
+       * Follows the convention used by PartialPCDSource (z towards the object, y from UnitY x z).
+       */
+      static Eigen::Matrix4f
+      getLookAtOriginRotation (const Eigen::Vector3f & cam_pos);
+
+      /** \brief Rasterizes mesh transformed by model_to_camera into buffers */
+      void
+      render (const RenderMesh & mesh, const Eigen::Matrix4f & model_to_camera, RenderBuffers & buffers) const;
+
+      /**
+       * \brief Splats a cloud already in camera coordinates into buffers, keeping the closest point per pixel.
+       * PointT needs xyz, normal and rgb fields, the label is the index of the point in the cloud.
+       */
+      template<typename PointT>
+      void
+      splat (const pcl::PointCloud<PointT> & cloud, RenderBuffers & buffers) const
+      {
+        buffers.resize (width_, height_);
+        buffers.clear ();
+
+        float cx = static_cast<float> (width_) / 2.f - 0.5f;
+        float cy = static_cast<float> (height_) / 2.f - 0.5f;
+
+        for (size_t i = 0; i < cloud.points.size (); i++)
+        {
+          float z = cloud.points[i].z;
+          if (!pcl_isfinite(z) || z <= 0.f)
+            continue;
+
+          int u = static_cast<int> (f_ * cloud.points[i].x / z + cx);
+          int v = static_cast<int> (f_ * cloud.points[i].y / z + cy);
+
+          if (u >= width_ || v >= height_ || u < 0 || v < 0)
+            continue;
+
+          int idx = v * width_ + u;
+          if ((z < buffers.depth_[idx]) || !buffers.isValid (idx))
+          {
+            buffers.depth_[idx] = z;
+            buffers.normals_[idx] = cloud.points[i].getNormalVector3fMap ();
+            buffers.r_[idx] = cloud.points[i].r;
+            buffers.g_[idx] = cloud.points[i].g;
+            buffers.b_[idx] = cloud.points[i].b;
+            buffers.labels_[idx] = static_cast<int> (i);
+          }
+        }
+      }
+
+      /**
+       * \brief Fills holes left by splatting: pixels that are NaN or behind the closest surface in a 3x3
+       * neighbourhood get the average of the 5x5 neighbours close to that surface. Afterwards the silhouette
+       * is eroded by one pixel. tmp is used as scratch space and can be reused across calls.
+       */
+      void
+      smoothSplats (RenderBuffers & buffers, RenderBuffers & tmp) const;
+
+      /**
+       * \brief Fraction of the mesh surface visible in buffers (computed from the face labels), this is
+       * the self-occlusion value stored with each view
+       */
+      static float
+      computeVisibleAreaRatio (const RenderMesh & mesh, const RenderBuffers & buffers, std::vector<unsigned char> & face_seen);
+    };
+  }
+}
+
+#endif /* FAAT_PCL_REC_FRAMEWORK_SOFTWARE_RENDERER_H_ */
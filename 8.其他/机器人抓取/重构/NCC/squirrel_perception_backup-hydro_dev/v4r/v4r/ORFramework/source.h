@@ -12,6 +12,8 @@
 #include <boost/algorithm/string.hpp>
 #include <pcl/io/pcd_io.h>
 #include "persistence_utils.h"
+#include "model_database.h"
+#include "training_manifest.h"
 #include <pcl/filters/voxel_grid.h>
 #include <v4rexternal/EDT/propagation_distance_field.h>
 #include <pcl/common/transforms.h>
@@ -45,6 +47,7 @@ namespace faat_pcl
       boost::shared_ptr<std::vector<float> > self_occlusions_;
       std::string id_;
       std::string class_;
+      std::string source_file_; //file the views are generated from (e.g. the mesh), empty if there is none
       PointTPtr assembled_;
       pcl::PointCloud<pcl::Normal>::Ptr normals_assembled_;
       std::vector<std::string> view_filenames_;
@@ -305,6 +308,26 @@ namespace faat_pcl
         }
       }
 
+      /**
+       * \brief Same as getViewsFilenames for the views of a model database (<prefix>_<id>.pcd, in database order)
+       */
+      void
+      getViewsFilenames (const ModelDatabase & db,
+                           std::vector<std::string> & view_filenames,
+                           const std::string & prefix)
+      {
+        for (size_t i = 0; i < db.size (); i++)
+        {
+          const ModelDatabase::View & view = db.getViewAt (i);
+          if (view.clouds_.find (prefix) == view.clouds_.end ())
+            continue;
+
+          std::stringstream file;
+          file << prefix << "_" << view.id_ << ".pcd";
+          view_filenames.push_back (file.str ());
+        }
+      }
+
       void
       createClassAndModelDirectories (std::string & training_dir, std::string & class_str, std::string & id_str)
       {
@@ -561,6 +584,48 @@ namespace faat_pcl
         bf::remove_all (desc_dir);
       }
 
+      /**
+       * \brief Removes the generated views of m, and with them all its descriptor directories, if its source file
+       * changed since they were generated. A model directory without source stamp gets one for the current file.
+       */
+      void
+      removeModelDirectoryIfSourceChanged (std::string & base_dir, ModelT & m)
+      {
+        std::string dir = getModelDirectory (m, base_dir);
+        bf::path model_dir = dir;
+        if (!bf::exists (model_dir) || m.source_file_.empty ())
+          return;
+
+        if (TrainingManifest::sourceChanged (dir, m.source_file_))
+        {
+          std::cout << m.source_file_ << " changed, regenerating views of " << m.id_ << std::endl;
+          bf::remove_all (model_dir);
+        }
+        else if (!bf::exists (TrainingManifest::getSourceStampFilename (dir)))
+        {
+          TrainingManifest::writeSourceStamp (dir, m.source_file_);
+        }
+      }
+
+      /**
+       * \brief Converts the text and PCD files of every model (and of its descr_name directory if descr_name
+       * is not empty) into model databases, the loaders use them from then on. The files are kept.
+       */
+      bool
+      convertToModelDatabases (std::string & training_dir, std::string descr_name = "")
+      {
+        bool ok = true;
+        for (size_t i = 0; i < models_->size (); i++)
+        {
+          ok = ModelDatabase::convert (getModelDirectory (*models_->at (i), training_dir)) && ok;
+
+          if (!descr_name.empty () && modelAlreadyTrained (*models_->at (i), training_dir, descr_name))
+            ok = ModelDatabase::convert (getModelDescriptorDir (*models_->at (i), training_dir, descr_name)) && ok;
+        }
+
+        return ok;
+      }
+
       void
       setPath (std::string & path)
       {
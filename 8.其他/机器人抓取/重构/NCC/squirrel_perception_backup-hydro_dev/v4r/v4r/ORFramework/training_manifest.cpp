@@ -0,0 +1,186 @@
+/*
+ * training_manifest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "training_manifest.h"
+#include <boost/functional/hash.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+
+namespace bf = boost::filesystem;
+
+std::string
+faat_pcl::rec_3d_framework::TrainingManifest::computeSourceFingerprint (const std::string & source_file)
+{
+  bf::path file = source_file;
+  if (source_file.empty () || !bf::is_regular_file (file))
+    return "";
+
+  std::stringstream fp;
+  fp << source_file << " " << bf::file_size (file) << " " << bf::last_write_time (file);
+  return fp.str ();
+}
+
+bool
+faat_pcl::rec_3d_framework::TrainingManifest::sourceChanged (const std::string & model_dir, const std::string & source_file)
+{
+  std::ifstream in (getSourceStampFilename (model_dir).c_str ());
+  if (!in)
+    return false;
+
+  std::string stamp;
+  std::getline (in, stamp);
+  return stamp != computeSourceFingerprint (source_file);
+}
+
+bool
+faat_pcl::rec_3d_framework::TrainingManifest::writeSourceStamp (const std::string & model_dir, const std::string & source_file)
+{
+  std::string filename = getSourceStampFilename (model_dir);
+  std::ofstream out (filename.c_str (), std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "Cannot open file " << filename << std::endl;
+    return false;
+  }
+
+  out << computeSourceFingerprint (source_file) << std::endl;
+  return true;
+}
+
+std::string
+faat_pcl::rec_3d_framework::TrainingManifest::computeFingerprint (const std::string & model_dir, const std::string & source_file)
+{
+  bf::path dir = model_dir;
+  if (!bf::exists (dir))
+    return "";
+
+  std::vector<std::string> entries;
+  bf::directory_iterator end_itr;
+  for (bf::directory_iterator itr (dir); itr != end_itr; ++itr)
+  {
+    if (!bf::is_regular_file (*itr))
+      continue;
+
+#if BOOST_FILESYSTEM_VERSION == 3
+    std::string file = (itr->path ().filename ()).string ();
+#else
+    std::string file = (itr->path ()).filename ();
+#endif
+
+    //the converted training data is not training data, the stamp is covered by the source entry below
+    if (file == "model_database.bin" || file == "source_fingerprint.txt")
+      continue;
+
+    std::stringstream entry;
+    entry << file << " " << bf::file_size (itr->path ()) << " " << bf::last_write_time (itr->path ());
+    entries.push_back (entry.str ());
+  }
+
+  //directory iteration order is not defined
+  std::sort (entries.begin (), entries.end ());
+
+  //a changed mesh invalidates the descriptors even if the views were not regenerated
+  entries.push_back ("source " + computeSourceFingerprint (source_file));
+
+  size_t seed = 0;
+  for (size_t i = 0; i < entries.size (); i++)
+    boost::hash_combine (seed, entries[i]);
+
+  std::stringstream fp;
+  fp << std::hex << seed << "_" << std::dec << entries.size ();
+  return fp.str ();
+}
+
+bool
+faat_pcl::rec_3d_framework::TrainingManifest::load (const std::string & descr_dir)
+{
+  filename_ = getManifestFilename (descr_dir);
+  fingerprint_ = "";
+  done_views_.clear ();
+  complete_ = false;
+
+  std::ifstream in (filename_.c_str ());
+  if (!in)
+    return false;
+
+  std::string line;
+  while (std::getline (in, line))
+  {
+    std::stringstream ss (line);
+    std::string key;
+    ss >> key;
+    if (key == "fingerprint")
+    {
+      ss >> fingerprint_;
+    }
+    else if (key == "view")
+    {
+      //a truncated last line (crash while appending) is ignored
+      int view_id;
+      if (ss >> view_id)
+        done_views_.insert (view_id);
+    }
+    else if (key == "complete")
+    {
+      complete_ = true;
+    }
+  }
+
+  return true;
+}
+
+bool
+faat_pcl::rec_3d_framework::TrainingManifest::create (const std::string & descr_dir, const std::string & fingerprint)
+{
+  filename_ = getManifestFilename (descr_dir);
+  fingerprint_ = fingerprint;
+  done_views_.clear ();
+  complete_ = false;
+
+  std::ofstream out (filename_.c_str (), std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "Cannot open file " << filename_ << std::endl;
+    return false;
+  }
+
+  out << "fingerprint " << fingerprint_ << std::endl;
+  return true;
+}
+
+bool
+faat_pcl::rec_3d_framework::TrainingManifest::addView (int view_id)
+{
+  std::ofstream out (filename_.c_str (), std::ios::app);
+  if (!out)
+  {
+    std::cout << "Cannot open file " << filename_ << std::endl;
+    return false;
+  }
+
+  out << "view " << view_id << std::endl;
+  done_views_.insert (view_id);
+  return true;
+}
+
+bool
+faat_pcl::rec_3d_framework::TrainingManifest::setComplete ()
+{
+  std::ofstream out (filename_.c_str (), std::ios::app);
+  if (!out)
+  {
+    std::cout << "Cannot open file " << filename_ << std::endl;
+    return false;
+  }
+
+  out << "complete" << std::endl;
+  complete_ = true;
+  return true;
+}
@@ -0,0 +1,132 @@
+/*
+ * training_manifest.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_REC_FRAMEWORK_TRAINING_MANIFEST_H_
+#define FAAT_PCL_REC_FRAMEWORK_TRAINING_MANIFEST_H_
+
+#include "faat_3d_rec_framework_defines.h"
+#include <boost/filesystem.hpp>
+#include <set>
+#include <string>
+
+namespace faat_pcl
+{
+  namespace rec_3d_framework
+  {
+
+    /**
+     * \brief Keeps track of the views of a model that have been completely trained for a descriptor.
+     * The manifest lives in the descriptor directory (training_manifest.txt) and contains the fingerprint
+     * of the training data the descriptors were computed from, one line per finished view and a final
+     * "complete" line. Views are only added after all their files have been written, so an interrupted
+     * training can be resumed from the manifest and a model whose training data changed is detected by
+     * comparing fingerprints.
+     */
+    class FAAT_3D_FRAMEWORK_API TrainingManifest
+    {
+      std::string filename_;
+      std::string fingerprint_;
+      std::set<int> done_views_;
+      bool complete_;
+
+    public:
+
+      TrainingManifest ()
+      {
+        complete_ = false;
+      }
+
+      /**
+       * \brief Fingerprint of the regular files in model_dir (name, size and modification time) and of the
+       * source_file the views in model_dir were generated from (e.g. the mesh), subdirectories (i.e. descriptor
+       * directories) are ignored
+       */
+      static std::string
+      computeFingerprint (const std::string & model_dir, const std::string & source_file = "");
+
+      /**
+       * \brief Path, size and modification time of source_file, empty if there is no such file
+       */
+      static std::string
+      computeSourceFingerprint (const std::string & source_file);
+
+      static std::string
+      getSourceStampFilename (const std::string & model_dir)
+      {
+        return model_dir + "/source_fingerprint.txt";
+      }
+
+      /**
+       * \brief True if model_dir was generated from a different version of source_file. Model directories without
+       * a stamp (generated before stamps existed) are trusted.
+       */
+      static bool
+      sourceChanged (const std::string & model_dir, const std::string & source_file);
+
+      /**
+       * \brief Records in model_dir that its views were generated from the current version of source_file
+       */
+      static bool
+      writeSourceStamp (const std::string & model_dir, const std::string & source_file);
+
+      static std::string
+      getManifestFilename (const std::string & descr_dir)
+      {
+        return descr_dir + "/training_manifest.txt";
+      }
+
+      /**
+       * \brief Reads the manifest in descr_dir, returns false if there is none
+       */
+      bool
+      load (const std::string & descr_dir);
+
+      /**
+       * \brief Starts a new manifest in descr_dir (overwriting any existing one) for training data with fingerprint
+       */
+      bool
+      create (const std::string & descr_dir, const std::string & fingerprint);
+
+      /**
+       * \brief Records view_id as done. Not thread safe, callers serialize access.
+       */
+      bool
+      addView (int view_id);
+
+      /**
+       * \brief Records that all views of the model have been trained
+       */
+      bool
+      setComplete ();
+
+      bool
+      isViewDone (int view_id) const
+      {
+        return done_views_.find (view_id) != done_views_.end ();
+      }
+
+      bool
+      isComplete () const
+      {
+        return complete_;
+      }
+
+      const std::string &
+      getFingerprint () const
+      {
+        return fingerprint_;
+      }
+
+      size_t
+      getNumberOfDoneViews () const
+      {
+        return done_views_.size ();
+      }
+    };
+  }
+}
+
+#endif /* FAAT_PCL_REC_FRAMEWORK_TRAINING_MANIFEST_H_ */
@@ -17,6 +17,13 @@
 #include <vtkTransform.h>
 #include <vtkTransformFilter.h>
 #include <pcl/common/common.h>
+#include <pcl/console/print.h>
+#include <boost/unordered_map.hpp>
+#include <cmath>
+#include <v4r/KeypointTools/SeededRandom.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace faat_pcl
 {
@@ -75,43 +82,254 @@ namespace faat_pcl
       randomPointTriangle (A[0], A[1], A[2], B[0], B[1], B[2], C[0], C[1], C[2], p);
     }
 
-    template<typename PointT>
-      inline void
-      uniform_sampling (vtkSmartPointer<vtkPolyData> polydata, size_t n_samples, typename pcl::PointCloud<PointT> & cloud_out)
+    /**
+     * \brief Vertices and triangles (first three points of each polygon) of a mesh with the cumulative
+     * triangle areas used to pick triangles proportionally to their area
+     */
+    class SamplingMesh
+    {
+    public:
+      std::vector<double> vertices_;
+      std::vector<vtkIdType> triangles_;
+      std::vector<double> cumulative_areas_;
+      double total_area_;
+
+      SamplingMesh ()
+      {
+        total_area_ = 0;
+      }
+
+      size_t
+      getNumberOfTriangles () const
+      {
+        return cumulative_areas_.size ();
+      }
+
+      /**
+       * \brief Copies the mesh, the areas are computed in parallel (nb_threads=0 uses all processors)
+       */
+      void
+      setInput (vtkPolyData * polydata, int nb_threads = 0)
       {
         polydata->BuildCells ();
-        vtkSmartPointer < vtkCellArray > cells = polydata->GetPolys ();
+        vtkCellArray * cells = polydata->GetPolys ();
+        vtkPoints * points = polydata->GetPoints ();
 
-        double p1[3], p2[3], p3[3], totalArea = 0;
-        std::vector<double> cumulativeAreas (cells->GetNumberOfCells (), 0);
-        size_t i = 0;
+        int nb_vertices = points ? static_cast<int> (points->GetNumberOfPoints ()) : 0;
+        vertices_.resize (3 * nb_vertices);
+        for (int i = 0; i < nb_vertices; i++)
+          points->GetPoint (i, &vertices_[3 * i]);
+
+        triangles_.clear ();
+        triangles_.reserve (3 * cells->GetNumberOfCells ());
         vtkIdType npts = 0, *ptIds = NULL;
-        for (cells->InitTraversal (); cells->GetNextCell (npts, ptIds); i++)
+        for (cells->InitTraversal (); cells->GetNextCell (npts, ptIds);)
+        {
+          if (npts < 3)
+            continue;
+
+          triangles_.push_back (ptIds[0]);
+          triangles_.push_back (ptIds[1]);
+          triangles_.push_back (ptIds[2]);
+        }
+
+        int nb_triangles = static_cast<int> (triangles_.size () / 3);
+        cumulative_areas_.resize (nb_triangles);
+
+#ifdef _OPENMP
+        if (nb_threads <= 0)
+          nb_threads = omp_get_num_procs ();
+#endif
+        if (nb_threads <= 0)
+          nb_threads = 1;
+
+#pragma omp parallel for schedule(static) num_threads(nb_threads)
+        for (int t = 0; t < nb_triangles; t++)
+        {
+          cumulative_areas_[t] = vtkTriangle::TriangleArea (&vertices_[3 * triangles_[3 * t]], &vertices_[3 * triangles_[3 * t + 1]],
+                                                             &vertices_[3 * triangles_[3 * t + 2]]);
+        }
+
+        //the prefix sum stays serial, the CDF must not depend on the number of threads
+        total_area_ = 0;
+        for (int t = 0; t < nb_triangles; t++)
         {
-          polydata->GetPoint (ptIds[0], p1);
-          polydata->GetPoint (ptIds[1], p2);
-          polydata->GetPoint (ptIds[2], p3);
-          totalArea += vtkTriangle::TriangleArea (p1, p2, p3);
-          cumulativeAreas[i] = totalArea;
+          total_area_ += cumulative_areas_[t];
+          cumulative_areas_[t] = total_area_;
         }
+      }
+
+      /**
+       * \brief Random point on the surface, the triangle is picked from the area CDF
+       */
+      inline void
+      sample (kp::SeededRandom & rand, Eigen::Vector4f & p) const
+      {
+        //upper_bound never picks a triangle without area
+        double r = rand.uniform () * total_area_;
+        size_t t = std::upper_bound (cumulative_areas_.begin (), cumulative_areas_.end (), r) - cumulative_areas_.begin ();
+        if (t >= cumulative_areas_.size ())
+          t = cumulative_areas_.size () - 1;
+
+        const double * a = &vertices_[3 * triangles_[3 * t]];
+        const double * b = &vertices_[3 * triangles_[3 * t + 1]];
+        const double * c = &vertices_[3 * triangles_[3 * t + 2]];
+
+        double r1sqr = std::sqrt (rand.uniform ());
+        double r2 = rand.uniform ();
+        for (int k = 0; k < 3; k++)
+          p[k] = static_cast<float> ((1 - r1sqr) * a[k] + r1sqr * ((1 - r2) * b[k] + r2 * c[k]));
+        p[3] = 0.f;
+      }
+    };
+
+    /**
+     * \brief Samples n_samples points uniformly on the surface of polydata. The result only depends on seed,
+     * not on the number of threads (nb_threads=0 uses all processors).
+     */
+    template<typename PointT>
+      inline void
+      uniform_sampling (vtkSmartPointer<vtkPolyData> polydata, size_t n_samples, typename pcl::PointCloud<PointT> & cloud_out,
+                        unsigned int seed = 0, int nb_threads = 0)
+      {
+        SamplingMesh mesh;
+        mesh.setInput (polydata, nb_threads);
 
         cloud_out.points.resize (n_samples);
         cloud_out.width = static_cast<int> (n_samples);
         cloud_out.height = 1;
 
-        for (i = 0; i < n_samples; i++)
+        if (mesh.getNumberOfTriangles () == 0)
+        {
+          cloud_out.points.clear ();
+          cloud_out.width = 0;
+          return;
+        }
+
+#ifdef _OPENMP
+        if (nb_threads <= 0)
+          nb_threads = omp_get_num_procs ();
+#endif
+        if (nb_threads <= 0)
+          nb_threads = 1;
+
+#pragma omp parallel for schedule(static) num_threads(nb_threads)
+        for (int i = 0; i < static_cast<int> (n_samples); i++)
+        {
+          kp::SeededRandom rand (seed, i);
+          Eigen::Vector4f p;
+          mesh.sample (rand, p);
+          cloud_out.points[i].x = p[0];
+          cloud_out.points[i].y = p[1];
+          cloud_out.points[i].z = p[2];
+        }
+      }
+
+    /** \brief Upper bound of the candidates drawn by poisson_disk_sampling (16 bytes each) */
+    const double MAX_POISSON_CANDIDATES = 1e8;
+
+    /**
+     * \brief Poisson-disk sampling of the surface of polydata: no two points are closer than radius.
+     * oversampling * area / radius^2 candidates are drawn as in uniform_sampling (in parallel) and accepted
+     * in order if they keep the distance to the points accepted before (dart throwing on a grid, serial),
+     * so the result only depends on seed. Leaves cloud_out empty if more than MAX_POISSON_CANDIDATES would be needed.
+     */
+    template<typename PointT>
+      inline void
+      poisson_disk_sampling (vtkSmartPointer<vtkPolyData> polydata, float radius, typename pcl::PointCloud<PointT> & cloud_out,
+                             unsigned int seed = 0, int oversampling = 10, int nb_threads = 0)
+      {
+        SamplingMesh mesh;
+        mesh.setInput (polydata, nb_threads);
+
+        cloud_out.points.clear ();
+        cloud_out.width = 0;
+        cloud_out.height = 1;
+
+        if (mesh.getNumberOfTriangles () == 0 || radius <= 0)
+          return;
+
+#ifdef _OPENMP
+        if (nb_threads <= 0)
+          nb_threads = omp_get_num_procs ();
+#endif
+        if (nb_threads <= 0)
+          nb_threads = 1;
+
+        //a tiny radius on a large mesh would overflow the number of candidates (and the memory)
+        double n_candidates_d = std::ceil (std::max (1, oversampling) * mesh.total_area_ / (static_cast<double> (radius) * radius));
+        if (!(n_candidates_d <= MAX_POISSON_CANDIDATES))
+        {
+          PCL_ERROR("poisson_disk_sampling: radius %f needs %g candidates on an area of %f, the maximum is %g\n", radius, n_candidates_d,
+                    mesh.total_area_, MAX_POISSON_CANDIDATES);
+          return;
+        }
+
+        int n_candidates = static_cast<int> (n_candidates_d);
+        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > candidates (n_candidates);
+
+#pragma omp parallel for schedule(static) num_threads(nb_threads)
+        for (int i = 0; i < n_candidates; i++)
+        {
+          kp::SeededRandom rand (seed, i);
+          mesh.sample (rand, candidates[i]);
+        }
+
+        //grid with cell size radius, a conflicting point is in one of the 27 neighbouring cells
+        boost::unordered_map<long long, std::vector<int> > grid;
+        std::vector<int> accepted;
+        float radius_sqr = radius * radius;
+
+        for (int i = 0; i < n_candidates; i++)
+        {
+          const Eigen::Vector4f & p = candidates[i];
+          long long cx = static_cast<long long> (std::floor (p[0] / radius));
+          long long cy = static_cast<long long> (std::floor (p[1] / radius));
+          long long cz = static_cast<long long> (std::floor (p[2] / radius));
+
+          bool keep = true;
+          for (long long dx = -1; dx <= 1 && keep; dx++)
+          {
+            for (long long dy = -1; dy <= 1 && keep; dy++)
+            {
+              for (long long dz = -1; dz <= 1 && keep; dz++)
+              {
+                long long key = (((cx + dx) & 0x1FFFFF) << 42) | (((cy + dy) & 0x1FFFFF) << 21) | ((cz + dz) & 0x1FFFFF);
+                boost::unordered_map<long long, std::vector<int> >::const_iterator it = grid.find (key);
+                if (it == grid.end ())
+                  continue;
+
+                for (size_t j = 0; j < it->second.size () && keep; j++)
+                {
+                  if ((candidates[it->second[j]] - p).squaredNorm () < radius_sqr)
+                    keep = false;
+                }
+              }
+            }
+          }
+
+          if (!keep)
+            continue;
+
+          long long key = ((cx & 0x1FFFFF) << 42) | ((cy & 0x1FFFFF) << 21) | (cz & 0x1FFFFF);
+          grid[key].push_back (i);
+          accepted.push_back (i);
+        }
+
+        cloud_out.points.resize (accepted.size ());
+        cloud_out.width = static_cast<int> (accepted.size ());
+        for (size_t i = 0; i < accepted.size (); i++)
         {
-          Eigen::Vector4f p (0.f, 0.f, 0.f, 0.f);
-          randPSurface (polydata, &cumulativeAreas, totalArea, p);
-          cloud_out.points[i].x = static_cast<float> (p[0]);
-          cloud_out.points[i].y = static_cast<float> (p[1]);
-          cloud_out.points[i].z = static_cast<float> (p[2]);
+          cloud_out.points[i].x = candidates[accepted[i]][0];
+          cloud_out.points[i].y = candidates[accepted[i]][1];
+          cloud_out.points[i].z = candidates[accepted[i]][2];
         }
       }
 
     template<typename PointT>
       inline void
-      uniform_sampling (std::string & file, size_t n_samples, typename pcl::PointCloud<PointT> & cloud_out, float scale = 1.f)
+      uniform_sampling (std::string & file, size_t n_samples, typename pcl::PointCloud<PointT> & cloud_out, float scale = 1.f,
+                        unsigned int seed = 0)
       {
 
         vtkSmartPointer < vtkPLYReader > reader = vtkSmartPointer<vtkPLYReader>::New ();
@@ -139,7 +357,7 @@ namespace faat_pcl
         vtkSmartPointer<vtkPolyData> poly = mapper->GetInput ();
         poly->Update ();
 
-        uniform_sampling (poly, n_samples, cloud_out);
+        uniform_sampling (poly, n_samples, cloud_out, seed);
 
       }
 
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <fstream>
 #include "ghv_opt.h"
+#include "voxel_key_table.h"
 #include <stack>
 #include <pcl/visualization/pcl_visualizer.h>
 #include "v4r/ORUtils/common_data_structures.h"
@@ -130,15 +131,29 @@ namespace faat_pcl
       using faat_pcl::HypothesisVerification<ModelT, SceneT>::scene_sampled_indices_;
       using faat_pcl::HypothesisVerification<ModelT, SceneT>::zbuffer_scene_resolution_;
 
+      /**
+       * \brief Region growing over points with low curvature and similar normals. If neighbourhoods is given
+       * (one list per point, without the point itself, e.g. scene_smooth_neighbourhoods_), no radius
+       * searches are done and tree can be empty.
+       */
       template<typename PointT, typename NormalT>
         inline void
         extractEuclideanClustersSmooth (const typename pcl::PointCloud<PointT> &cloud, const typename pcl::PointCloud<NormalT> &normals, float tolerance,
                                         const typename pcl::search::Search<PointT>::Ptr &tree, std::vector<pcl::PointIndices> &clusters, double eps_angle,
                                         float curvature_threshold, unsigned int min_pts_per_cluster,
-                                        unsigned int max_pts_per_cluster = (std::numeric_limits<int>::max) ())
+                                        unsigned int max_pts_per_cluster = (std::numeric_limits<int>::max) (),
+                                        const std::vector<std::vector<int> > * neighbourhoods = 0)
         {
 
-          if (tree->getInputCloud ()->points.size () != cloud.points.size ())
+          if (neighbourhoods)
+          {
+            if (neighbourhoods->size () != cloud.points.size ())
+            {
+              PCL_ERROR("[pcl::extractEuclideanClusters] Neighbourhoods computed for a different point cloud dataset\n");
+              return;
+            }
+          }
+          else if (tree->getInputCloud ()->points.size () != cloud.points.size ())
           {
             PCL_ERROR("[pcl::extractEuclideanClusters] Tree built for a different point cloud dataset\n");
             return;
@@ -154,6 +169,9 @@ namespace faat_pcl
 
           std::vector<int> nn_indices;
           std::vector<float> nn_distances;
+          std::vector<int> seed_queue;
+          double cos_eps_angle = cos (eps_angle);
+
           // Process all points in the indices vector
           int size = static_cast<int> (cloud.points.size ());
           for (int i = 0; i < size; ++i)
@@ -161,7 +179,7 @@ namespace faat_pcl
             if (processed[i])
               continue;
 
-            std::vector<unsigned int> seed_queue;
+            seed_queue.clear ();
             int sq_idx = 0;
             seed_queue.push_back (i);
 
@@ -169,62 +187,185 @@ namespace faat_pcl
 
             while (sq_idx < static_cast<int> (seed_queue.size ()))
             {
+              int current = seed_queue[sq_idx];
+              sq_idx++;
 
-              if (normals.points[seed_queue[sq_idx]].curvature > curvature_threshold)
-              {
-                sq_idx++;
+              if (normals.points[current].curvature > curvature_threshold)
                 continue;
-              }
 
-              // Search for sq_idx
-              if (!tree->radiusSearch (seed_queue[sq_idx], tolerance, nn_indices, nn_distances))
+              // nn_indices[0] should be the current point, cached neighbourhoods do not contain it
+              const std::vector<int> * nn = &nn_indices;
+              size_t first = 1;
+              if (neighbourhoods)
+              {
+                nn = &(*neighbourhoods)[current];
+                first = 0;
+              }
+              else if (!tree->radiusSearch (current, tolerance, nn_indices, nn_distances))
               {
-                sq_idx++;
                 continue;
               }
 
-              for (size_t j = 1; j < nn_indices.size (); ++j) // nn_indices[0] should be sq_idx
+              for (size_t j = first; j < nn->size (); ++j)
               {
-                if (processed[nn_indices[j]]) // Has this point been processed before ?
+                int neighbour = (*nn)[j];
+                if (processed[neighbour]) // Has this point been processed before ?
                   continue;
 
-                if (normals.points[nn_indices[j]].curvature > curvature_threshold)
-                {
+                if (normals.points[neighbour].curvature > curvature_threshold)
                   continue;
-                }
 
-                //processed[nn_indices[j]] = true;
                 // [-1;1]
+                double dot_p = normals.points[current].normal[0] * normals.points[neighbour].normal[0]
+                    + normals.points[current].normal[1] * normals.points[neighbour].normal[1]
+                    + normals.points[current].normal[2] * normals.points[neighbour].normal[2];
 
-                double dot_p = normals.points[seed_queue[sq_idx]].normal[0] * normals.points[nn_indices[j]].normal[0]
-                    + normals.points[seed_queue[sq_idx]].normal[1] * normals.points[nn_indices[j]].normal[1] + normals.points[seed_queue[sq_idx]].normal[2]
-                    * normals.points[nn_indices[j]].normal[2];
-
-                if (fabs (acos (dot_p)) < eps_angle)
+                //fabs (acos (dot_p)) < eps_angle without the acos (which was NaN for dot products rounded above 1)
+                if (dot_p > cos_eps_angle)
                 {
-                  processed[nn_indices[j]] = true;
-                  seed_queue.push_back (nn_indices[j]);
+                  processed[neighbour] = true;
+                  seed_queue.push_back (neighbour);
                 }
               }
-
-              sq_idx++;
             }
 
             // If this queue is satisfactory, add to the clusters
             if (seed_queue.size () >= min_pts_per_cluster && seed_queue.size () <= max_pts_per_cluster)
             {
-              pcl::PointIndices r;
-              r.indices.resize (seed_queue.size ());
-              for (size_t j = 0; j < seed_queue.size (); ++j)
-                r.indices[j] = seed_queue[j];
-
-              std::sort (r.indices.begin (), r.indices.end ());
-              r.indices.erase (std::unique (r.indices.begin (), r.indices.end ()), r.indices.end ());
-              clusters.push_back (r); // We could avoid a copy by working directly in the vector
+              //points are only queued once, no duplicates to remove
+              clusters.push_back (pcl::PointIndices ());
+              clusters.back ().indices = seed_queue;
+              std::sort (clusters.back ().indices.begin (), clusters.back ().indices.end ());
             }
           }
         }
 
+      /**
+       * \brief Connected components of an organized cloud: 4-neighbours with valid[idx] set are joined if their
+       * distance is below tolerance (scaled by z^2 of the first point if depth_dependent, as in
+       * pcl::EuclideanClusterComparator). Bands of rows are labelled in parallel with union-find and
+       * merged afterwards, the result does not depend on the number of threads.
+       */
+      template<typename PointT>
+        inline void
+        extractEuclideanClustersOrganized (const typename pcl::PointCloud<PointT> &cloud, const std::vector<bool> &valid, float tolerance,
+                                           bool depth_dependent, std::vector<pcl::PointIndices> &clusters, unsigned int min_pts_per_cluster,
+                                           unsigned int max_pts_per_cluster = (std::numeric_limits<int>::max) ())
+        {
+          if (!cloud.isOrganized () || valid.size () != cloud.points.size ())
+          {
+            PCL_ERROR("[extractEuclideanClustersOrganized] Expected an organized cloud and one flag per point\n");
+            return;
+          }
+
+          int width = static_cast<int> (cloud.width);
+          int height = static_cast<int> (cloud.height);
+          std::vector<int> parent (cloud.points.size (), -1);
+
+          const int band_rows = 32;
+          int n_bands = (height + band_rows - 1) / band_rows;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(max_threads_, omp_get_num_procs()))
+          for (int b = 0; b < n_bands; b++)
+          {
+            int row_start = b * band_rows;
+            int row_end = std::min (height, row_start + band_rows);
+            for (int v = row_start; v < row_end; v++)
+            {
+              for (int u = 0; u < width; u++)
+              {
+                int idx = v * width + u;
+                if (!valid[idx])
+                  continue;
+
+                parent[idx] = idx;
+                if (u > 0)
+                  joinOrganizedNeighbours (cloud, valid, tolerance, depth_dependent, parent, idx, idx - 1);
+                if (v > row_start)
+                  joinOrganizedNeighbours (cloud, valid, tolerance, depth_dependent, parent, idx, idx - width);
+              }
+            }
+          }
+
+          //stitch the bands together
+          for (int v = band_rows; v < height; v += band_rows)
+          {
+            for (int u = 0; u < width; u++)
+            {
+              int idx = v * width + u;
+              if (valid[idx])
+                joinOrganizedNeighbours (cloud, valid, tolerance, depth_dependent, parent, idx, idx - width);
+            }
+          }
+
+          //roots are the smallest index of each component, so clusters come out in scan order
+          std::vector<int> root_to_cluster (cloud.points.size (), -1);
+          std::vector<pcl::PointIndices> components;
+          for (int idx = 0; idx < static_cast<int> (parent.size ()); idx++)
+          {
+            if (parent[idx] < 0)
+              continue;
+
+            int root = findOrganizedRoot (parent, idx);
+            if (root_to_cluster[root] < 0)
+            {
+              root_to_cluster[root] = static_cast<int> (components.size ());
+              components.push_back (pcl::PointIndices ());
+            }
+
+            components[root_to_cluster[root]].indices.push_back (idx);
+          }
+
+          for (size_t i = 0; i < components.size (); i++)
+          {
+            if (components[i].indices.size () >= min_pts_per_cluster && components[i].indices.size () <= max_pts_per_cluster)
+            {
+              clusters.push_back (pcl::PointIndices ());
+              clusters.back ().indices.swap (components[i].indices);
+            }
+          }
+        }
+
+      static inline int
+      findOrganizedRoot (std::vector<int> & parent, int idx)
+      {
+        int root = idx;
+        while (parent[root] != root)
+          root = parent[root];
+
+        while (parent[idx] != root)
+        {
+          int next = parent[idx];
+          parent[idx] = root;
+          idx = next;
+        }
+
+        return root;
+      }
+
+      template<typename PointT>
+        static inline void
+        joinOrganizedNeighbours (const typename pcl::PointCloud<PointT> &cloud, const std::vector<bool> &valid, float tolerance,
+                                 bool depth_dependent, std::vector<int> & parent, int idx, int neighbour)
+        {
+          if (!valid[neighbour])
+            return;
+
+          float threshold = tolerance;
+          if (depth_dependent)
+            threshold *= cloud.points[idx].z * cloud.points[idx].z;
+
+          if ((cloud.points[idx].getVector3fMap () - cloud.points[neighbour].getVector3fMap ()).norm () >= threshold)
+            return;
+
+          int root_a = findOrganizedRoot (parent, idx);
+          int root_b = findOrganizedRoot (parent, neighbour);
+          if (root_a < root_b)
+            parent[root_b] = root_a;
+          else if (root_b < root_a)
+            parent[root_a] = root_b;
+        }
+
       void computeClutterCueAtOnce ();
 
       virtual bool
@@ -254,6 +395,11 @@ namespace faat_pcl
       pcl::PointCloud<pcl::PointXYZRGBA>::Ptr clusters_cloud_rgb_;
       pcl::PointCloud<pcl::Normal>::Ptr scene_normals_for_clutter_term_;
 
+      /** \brief Neighbours within cluster_tolerance_ of each point in scene_cloud_downsampled_ (without the point itself),
+       * collected in initialize together with the normal neighbourhoods and reused by the smooth segmentation */
+      std::vector<std::vector<int> > scene_smooth_neighbourhoods_;
+
+      /** \brief Number of active hypotheses occupying each voxel (indexed by the ids in complete_cloud_occupancy_indices_) */
       std::vector<int> complete_cloud_occupancy_by_RM_;
       float res_occupancy_grid_;
       float w_occupied_multiple_cm_;
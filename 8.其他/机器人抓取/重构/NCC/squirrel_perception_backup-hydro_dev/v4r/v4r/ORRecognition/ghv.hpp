@@ -452,7 +452,6 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
     if(!scene_and_normals_set_from_outside_)
     {
         pcl::ScopeTime t("compute scene normals");
-        NormalEstimator_ n3d;
         scene_normals_.reset (new pcl::PointCloud<pcl::Normal> ());
 
         int j = 0;
@@ -477,12 +476,56 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
         typename pcl::search::KdTree<SceneT>::Ptr normals_tree (new pcl::search::KdTree<SceneT>);
         normals_tree->setInputCloud (scene_cloud_downsampled_);
 
-        n3d.setRadiusSearch (radius_normals_);
-        n3d.setSearchMethod (normals_tree);
-        n3d.setInputCloud (scene_cloud_downsampled_);
-        n3d.compute (*scene_normals_);
+        //a single radius search per point gives the normal neighbourhood and the neighbourhood used by the
+        //smooth segmentation, the latter is kept in scene_smooth_neighbourhoods_
+        float search_radius = std::max (radius_normals_, cluster_tolerance_);
+        float radius_normals_sqr = radius_normals_ * radius_normals_;
+        float cluster_tolerance_sqr = cluster_tolerance_ * cluster_tolerance_;
+        scene_normals_->points.resize (scene_cloud_downsampled_->points.size ());
+        scene_smooth_neighbourhoods_.clear ();
+        scene_smooth_neighbourhoods_.resize (scene_cloud_downsampled_->points.size ());
+
+#pragma omp parallel num_threads(std::min(max_threads_, omp_get_num_procs()))
+        {
+            std::vector<int> nn_indices, normal_indices;
+            std::vector<float> nn_distances;
+
+#pragma omp for schedule(dynamic, 64)
+            for (int i = 0; i < static_cast<int> (scene_cloud_downsampled_->points.size ()); i++)
+            {
+                normal_indices.clear ();
+                std::vector<int> & smooth_nn = scene_smooth_neighbourhoods_[i];
+                normals_tree->radiusSearch (scene_cloud_downsampled_->points[i], search_radius, nn_indices, nn_distances);
+                for (size_t k = 0; k < nn_indices.size (); k++)
+                {
+                    if (nn_distances[k] <= radius_normals_sqr)
+                        normal_indices.push_back (nn_indices[k]);
+
+                    if (nn_indices[k] != i && nn_distances[k] <= cluster_tolerance_sqr)
+                        smooth_nn.push_back (nn_indices[k]);
+                }
+
+                //same result as NormalEstimator_ with radius_normals_ and the viewpoint at the origin
+                Eigen::Vector4f plane_parameters;
+                float curvature;
+                pcl::Normal & normal = scene_normals_->points[i];
+                if (pcl::computePointNormal (*scene_cloud_downsampled_, normal_indices, plane_parameters, curvature))
+                {
+                    pcl::flipNormalTowardsViewpoint (scene_cloud_downsampled_->points[i], 0.f, 0.f, 0.f, plane_parameters);
+                    normal.normal_x = plane_parameters[0];
+                    normal.normal_y = plane_parameters[1];
+                    normal.normal_z = plane_parameters[2];
+                    normal.curvature = curvature;
+                }
+                else
+                {
+                    normal.normal_x = normal.normal_y = normal.normal_z = normal.curvature = std::numeric_limits<float>::quiet_NaN ();
+                }
+            }
+        }
 
         //check nans...
+        std::vector<int> new_index (scene_normals_->points.size (), -1);
         j = 0;
         for (size_t i = 0; i < scene_normals_->points.size (); ++i)
         {
@@ -493,9 +536,31 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
             scene_normals_->points[j] = scene_normals_->points[i];
             scene_cloud_downsampled_->points[j] = scene_cloud_downsampled_->points[i];
             scene_sampled_indices_[j] = scene_sampled_indices_[i];
+            new_index[i] = j;
             j++;
         }
 
+        //drop the removed points from the cached neighbourhoods
+        for (size_t i = 0; i < new_index.size (); ++i)
+        {
+            if (new_index[i] < 0)
+                continue;
+
+            std::vector<int> & smooth_nn = scene_smooth_neighbourhoods_[i];
+            size_t kept = 0;
+            for (size_t k = 0; k < smooth_nn.size (); k++)
+            {
+                if (new_index[smooth_nn[k]] >= 0)
+                    smooth_nn[kept++] = new_index[smooth_nn[k]];
+            }
+            smooth_nn.resize (kept);
+
+            if (static_cast<int> (i) != new_index[i])
+                scene_smooth_neighbourhoods_[new_index[i]].swap (smooth_nn);
+        }
+
+        scene_smooth_neighbourhoods_.resize (j);
+
         scene_sampled_indices_.resize(j);
 
         scene_normals_->points.resize (j);
@@ -509,6 +574,7 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
     else
     {
         PCL_WARN("Scene and normals set from outside\n");
+        scene_smooth_neighbourhoods_.clear ();
         scene_sampled_indices_.resize(scene_cloud_downsampled_->points.size());
         for(size_t k=0; k < scene_cloud_downsampled_->points.size(); k++)
         {
@@ -569,70 +635,31 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
             {
                 PCL_WARN("scene cloud is organized, filter points with high curvature and cluster the rest in smooth patches\n");
 
-                typename pcl::EuclideanClusterComparator<SceneT, pcl::Normal, pcl::Label>::Ptr
-                        euclidean_cluster_comparator (new pcl::EuclideanClusterComparator<SceneT, pcl::Normal, pcl::Label> ());
-
-                pcl::PointCloud<pcl::Label>::Ptr labels (new pcl::PointCloud<pcl::Label>);
-                labels->points.resize(scene_cloud_->points.size());
-                labels->width = scene_cloud_->width;
-                labels->height = scene_cloud_->height;
-                labels->is_dense = scene_cloud_->is_dense;
+                std::vector<bool> valid (scene_cloud_->points.size (), false);
 
                 for (size_t j = 0; j < scene_cloud_->points.size (); j++)
                 {
                     const Eigen::Vector3f& xyz_p = scene_cloud_->points[j].getVector3fMap ();
                     if (!pcl_isfinite (xyz_p[0]) || !pcl_isfinite (xyz_p[1]) || !pcl_isfinite (xyz_p[2]))
-                    {
-                        //label_indices[0].indices[label_count[0]++] = static_cast<int>(j);
-                        labels->points[j].label = 0;
                         continue;
-                    }
 
                     //check normal
                     const Eigen::Vector3f& normal = scene_normals_for_clutter_term_->points[j].getNormalVector3fMap ();
                     if (!pcl_isfinite (normal[0]) || !pcl_isfinite (normal[1]) || !pcl_isfinite (normal[2]))
-                    {
-                        //label_indices[0].indices[label_count[0]++] = static_cast<int>(j);
-                        labels->points[j].label = 0;
                         continue;
-                    }
 
                     //check curvature
                     float curvature = scene_normals_for_clutter_term_->points[j].curvature;
                     if(curvature > (curvature_threshold_ * (std::min(1.f,scene_cloud_->points[j].z))))
-                    {
-                        //label_indices[0].indices[label_count[0]++] = static_cast<int>(j);
-                        labels->points[j].label = 0;
                         continue;
-                    }
 
-                    //label_indices[1].indices[label_count[1]++] = static_cast<int>(j);
-                    labels->points[j].label = 1;
+                    valid[j] = true;
                 }
 
-                std::vector<bool> excluded_labels;
-                excluded_labels.resize (2, false);
-                excluded_labels[0] = true;
-
-                euclidean_cluster_comparator->setInputCloud (scene_cloud_);
-                euclidean_cluster_comparator->setLabels (labels);
-                euclidean_cluster_comparator->setExcludeLabels (excluded_labels);
-                euclidean_cluster_comparator->setDistanceThreshold (cluster_tolerance_, true);
-                euclidean_cluster_comparator->setAngularThreshold(0.017453 * 5.f); //5 degrees
-
-                pcl::PointCloud<pcl::Label> euclidean_labels;
                 std::vector<pcl::PointIndices> clusters;
-                pcl::OrganizedConnectedComponentSegmentation<SceneT, pcl::Label> euclidean_segmentation (euclidean_cluster_comparator);
-                euclidean_segmentation.setInputCloud (scene_cloud_);
-                euclidean_segmentation.segment (euclidean_labels, clusters);
+                extractEuclideanClustersOrganized<SceneT> (*scene_cloud_, valid, cluster_tolerance_, true, clusters, 100);
 
                 std::cout << "Number of clusters:" << clusters.size() << std::endl;
-                std::vector<bool> good_cluster(clusters.size(), false);
-                for (size_t i = 0; i < clusters.size (); i++)
-                {
-                    if (clusters[i].indices.size () >= 100)
-                        good_cluster[i] = true;
-                }
 
                 clusters_cloud_->points.resize (scene_sampled_indices_.size ());
                 clusters_cloud_->width = scene_sampled_indices_.size();
@@ -660,9 +687,6 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
                 uint32_t label = 1;
                 for (size_t i = 0; i < clusters.size (); i++)
                 {
-                    if(!good_cluster[i])
-                        continue;
-
                     for (size_t j = 0; j < clusters[i].indices.size (); j++)
                     {
                         clusters_cloud->points[clusters[i].indices[j]].label = label;
@@ -708,8 +732,14 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
             {
 
                 std::vector<pcl::PointIndices> clusters;
+                //neighbourhoods cached while computing the normals are reused if available
+                const std::vector<std::vector<int> > * neighbourhoods = 0;
+                if (scene_smooth_neighbourhoods_.size () == scene_cloud_downsampled_->points.size ())
+                    neighbourhoods = &scene_smooth_neighbourhoods_;
+
                 extractEuclideanClustersSmooth<SceneT, pcl::Normal> (*scene_cloud_downsampled_, *scene_normals_, cluster_tolerance_,
-                                                                     scene_downsampled_tree_, clusters, eps_angle_threshold_, curvature_threshold_, min_points_);
+                                                                     scene_downsampled_tree_, clusters, eps_angle_threshold_, curvature_threshold_, min_points_,
+                                                                     (std::numeric_limits<int>::max) (), neighbourhoods);
 
                 clusters_cloud_->points.resize (scene_cloud_downsampled_->points.size ());
                 clusters_cloud_->width = scene_cloud_downsampled_->width;
@@ -833,76 +863,50 @@ faat_pcl::GHV<ModelT, SceneT>::initialize ()
             }
         }
 
-        //compute the bounding boxes for the models
+        //voxels occupied by the complete models, counters in complete_cloud_occupancy_by_RM_ are only kept for
+        //occupied voxels and complete_cloud_occupancy_indices_ index into them
         {
             pcl::ScopeTime tcues ("complete_cloud_occupancy_by_RM_");
-            ModelT min_pt_all, max_pt_all;
-            min_pt_all.x = min_pt_all.y = min_pt_all.z = std::numeric_limits<float>::max ();
-            max_pt_all.x = max_pt_all.y = max_pt_all.z = (std::numeric_limits<float>::max () - 0.001f) * -1;
 
-            for (size_t i = 0; i < recognition_models_.size (); i++)
+            std::vector<std::vector<uint64_t> > occupied_keys (recognition_models_.size ());
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(max_threads_, omp_get_num_procs()))
+            for (int i = 0; i < static_cast<int> (recognition_models_.size ()); i++)
             {
                 if(!valid_model_[i])
                     continue;
 
-                ModelT min_pt, max_pt;
-                pcl::getMinMax3D (*complete_models_[i], min_pt, max_pt);
-                if (min_pt.x < min_pt_all.x)
-                    min_pt_all.x = min_pt.x;
-
-                if (min_pt.y < min_pt_all.y)
-                    min_pt_all.y = min_pt.y;
-
-                if (min_pt.z < min_pt_all.z)
-                    min_pt_all.z = min_pt.z;
-
-                if (max_pt.x > max_pt_all.x)
-                    max_pt_all.x = max_pt.x;
-
-                if (max_pt.y > max_pt_all.y)
-                    max_pt_all.y = max_pt.y;
+                std::vector<uint64_t> & keys = occupied_keys[i];
+                keys.resize (complete_models_[i]->points.size ());
+                for (size_t j = 0; j < complete_models_[i]->points.size (); j++)
+                {
+                    keys[j] = VoxelKeyTable::makeKey (complete_models_[i]->points[j].x, complete_models_[i]->points[j].y,
+                                                      complete_models_[i]->points[j].z, res_occupancy_grid_);
+                }
 
-                if (max_pt.z > max_pt_all.z)
-                    max_pt_all.z = max_pt.z;
+                std::sort (keys.begin (), keys.end ());
+                keys.erase (std::unique (keys.begin (), keys.end ()), keys.end ());
             }
 
-            int size_x, size_y, size_z;
-            size_x = static_cast<int> (std::ceil (std::abs (max_pt_all.x - min_pt_all.x) / res_occupancy_grid_)) + 1;
-            size_y = static_cast<int> (std::ceil (std::abs (max_pt_all.y - min_pt_all.y) / res_occupancy_grid_)) + 1;
-            size_z = static_cast<int> (std::ceil (std::abs (max_pt_all.z - min_pt_all.z) / res_occupancy_grid_)) + 1;
+            size_t total_keys = 0;
+            for (size_t i = 0; i < occupied_keys.size (); i++)
+                total_keys += occupied_keys[i].size ();
 
-            complete_cloud_occupancy_by_RM_.resize (size_x * size_y * size_z, 0);
+            VoxelKeyTable voxel_ids;
+            voxel_ids.reserve (total_keys);
 
             for (size_t i = 0; i < recognition_models_.size (); i++)
             {
                 if(!valid_model_[i])
                     continue;
 
-                std::vector<bool> banned_vector(size_x * size_y * size_z, false);
-
-                recognition_models_[i]->complete_cloud_occupancy_indices_.resize(complete_models_[i]->points.size ());
-                int used = 0;
-
-                for (size_t j = 0; j < complete_models_[i]->points.size (); j++)
-                {
-                    int pos_x, pos_y, pos_z;
-                    pos_x = static_cast<int> (std::floor ((complete_models_[i]->points[j].x - min_pt_all.x) / res_occupancy_grid_));
-                    pos_y = static_cast<int> (std::floor ((complete_models_[i]->points[j].y - min_pt_all.y) / res_occupancy_grid_));
-                    pos_z = static_cast<int> (std::floor ((complete_models_[i]->points[j].z - min_pt_all.z) / res_occupancy_grid_));
-
-                    int idx = pos_z * size_x * size_y + pos_y * size_x + pos_x;
-
-                    assert(banned_vector.size() > idx);
-                    if (!banned_vector[idx])
-                    {
-                        recognition_models_[i]->complete_cloud_occupancy_indices_[used] = idx;
-                        banned_vector[idx] = true;
-                        used++;
-                    }
-                }
-
-                recognition_models_[i]->complete_cloud_occupancy_indices_.resize(used);
+                std::vector<int> & indices = recognition_models_[i]->complete_cloud_occupancy_indices_;
+                indices.resize (occupied_keys[i].size ());
+                for (size_t j = 0; j < occupied_keys[i].size (); j++)
+                    indices[j] = voxel_ids.insert (occupied_keys[i][j]);
             }
+
+            complete_cloud_occupancy_by_RM_.resize (voxel_ids.size (), 0);
         }
     }
 
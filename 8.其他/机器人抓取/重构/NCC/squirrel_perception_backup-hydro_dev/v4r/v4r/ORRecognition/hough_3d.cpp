@@ -41,6 +41,10 @@
 #include "pcl/impl/instantiate.hpp"
 #include "hough_3d.h"
 #include "hough_3d.hpp"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 PCL_INSTANTIATE_PRODUCT(Hough3DGrouping, ((pcl::PointXYZ)(pcl::PointXYZI)(pcl::PointXYZRGB)(pcl::PointXYZRGBA))
                                          ((pcl::PointXYZ)(pcl::PointXYZI)(pcl::PointXYZRGB)(pcl::PointXYZRGBA))
@@ -48,6 +52,8 @@ PCL_INSTANTIATE_PRODUCT(Hough3DGrouping, ((pcl::PointXYZ)(pcl::PointXYZI)(pcl::P
 
 /////////////////////////////////////////////////////////////////////////////
 
+const int faat_pcl::recognition::HoughSpace3D::N_SHARDS;
+
 faat_pcl::recognition::HoughSpace3D::HoughSpace3D (const Eigen::Vector3d &min_coord, const Eigen::Vector3d &bin_size, const Eigen::Vector3d &max_coord)
 {
   min_coord_ = min_coord;
@@ -56,57 +62,162 @@ faat_pcl::recognition::HoughSpace3D::HoughSpace3D (const Eigen::Vector3d &min_co
   for (int i = 0; i < 3; ++i)
   {
     bin_count_[i] = static_cast<int> (ceil ((max_coord[i] - min_coord_[i]) / bin_size_[i]));
+    if (bin_count_[i] > (1 << 21))
+    {
+      PCL_WARN ("[HoughSpace3D] %d bins in dimension %d, votes beyond %d bins are ignored.\n", bin_count_[i], i, 1 << 21);
+      bin_count_[i] = 1 << 21;
+    }
   }
 
   partial_bin_products_[0] = 1;
   for (int i=1; i<=3; ++i)
     partial_bin_products_[i] = bin_count_[i-1]*partial_bin_products_[i-1];
 
-  total_bins_count_ = partial_bin_products_[3];
-
-  hough_space_.clear ();
-  hough_space_.resize (total_bins_count_, 0.0);
+  shards_.resize (static_cast<size_t> (N_SHARDS));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void
 faat_pcl::recognition::HoughSpace3D::reset ()
 {
-  hough_space_.clear ();
-  hough_space_.resize (total_bins_count_, 0.0);
+  shards_.clear ();
+  shards_.resize (static_cast<size_t> (N_SHARDS));
+}
 
-  voter_ids_.clear ();
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+faat_pcl::recognition::HoughSpace3D::accumulate (const BinVote &bin_vote)
+{
+  Shard &shard = shards_[shardOf (bin_vote.key)];
+  int id = shard.table.insert (bin_vote.key);
+  if (id == static_cast<int> (shard.keys.size ()))
+  {
+    shard.keys.push_back (bin_vote.key);
+    shard.values.push_back (0.0);
+    shard.voter_ids.push_back (std::vector<int> ());
+  }
+
+  shard.values[id] += bin_vote.weight;
+  shard.voter_ids[id].push_back (bin_vote.voter_id);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double
+faat_pcl::recognition::HoughSpace3D::getBinValue (uint64_t key) const
+{
+  const Shard &shard = shards_[shardOf (key)];
+  int id = shard.table.find (key);
+  return (id < 0 ? 0.0 : shard.values[id]);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int
 faat_pcl::recognition::HoughSpace3D::vote (const Eigen::Vector3d &single_vote_coord, double weight, int voter_id)
 {
-  int index = 0;
+  std::vector<BinVote> bin_votes;
+  int index = castVote (single_vote_coord, weight, voter_id, false, bin_votes);
+  for (size_t i = 0; i < bin_votes.size (); ++i)
+    accumulate (bin_votes[i]);
+
+  return (index);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int
+faat_pcl::recognition::HoughSpace3D::voteInt (const Eigen::Vector3d &single_vote_coord, double weight, int voter_id)
+{
+  std::vector<BinVote> bin_votes;
+  int index = castVote (single_vote_coord, weight, voter_id, true, bin_votes);
+  for (size_t i = 0; i < bin_votes.size (); ++i)
+    accumulate (bin_votes[i]);
 
-  for (int i=0; i<3; ++i)
+  return (index);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+faat_pcl::recognition::HoughSpace3D::vote (const std::vector<Eigen::Vector3d> &votes_coord, const std::vector<double> &weights, bool interpolate)
+{
+  int n_votes = static_cast<int> (votes_coord.size ());
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_num_procs ();
+#endif
+
+  // bin votes of thread t for shard s
+  std::vector<std::vector<std::vector<BinVote> > > thread_votes (n_threads, std::vector<std::vector<BinVote> > (N_SHARDS));
+
+#pragma omp parallel num_threads(n_threads)
   {
-    int currentBin = static_cast<int> (floor ((single_vote_coord[i] - min_coord_[i])/bin_size_[i]));
-    if (currentBin < 0 || currentBin >= bin_count_[i])
+    int thread_id = 0;
+    int used_threads = 1;
+#ifdef _OPENMP
+    thread_id = omp_get_thread_num ();
+    used_threads = omp_get_num_threads ();
+#endif
+
+    // contiguous range of voters, so the bin votes of each thread are in voter order
+    int first = static_cast<int> ((static_cast<long long> (n_votes) * thread_id) / used_threads);
+    int last = static_cast<int> ((static_cast<long long> (n_votes) * (thread_id + 1)) / used_threads);
+
+    std::vector<BinVote> bin_votes;
+    std::vector<std::vector<BinVote> > &votes = thread_votes[thread_id];
+    for (int i = first; i < last; ++i)
     {
-      //PCL_ERROR("Current Vote goes out of bounds in the Hough Table!\nDimension: %d, Value inserted: %f, Min value: %f, Max value: %f\n", i, 
-      //  single_vote_coord[i], min_coord_[i], min_coord_[i] + bin_size_[i]*bin_count_[i]);
-      return -1;
+      bin_votes.clear ();
+      castVote (votes_coord[i], weights[i], i, interpolate, bin_votes);
+      for (size_t k = 0; k < bin_votes.size (); ++k)
+        votes[shardOf (bin_votes[k].key)].push_back (bin_votes[k]);
     }
-
-    index += partial_bin_products_[i] * currentBin;
   }
 
-  hough_space_[index] += weight;
-  voter_ids_[index].push_back (voter_id);
-
-  return (index);
+  // every shard sums its bins in voter order
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+  for (int s = 0; s < N_SHARDS; ++s)
+  {
+    for (int t = 0; t < n_threads; ++t)
+    {
+      const std::vector<BinVote> &votes = thread_votes[t][s];
+      for (size_t k = 0; k < votes.size (); ++k)
+        accumulate (votes[k]);
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int
-faat_pcl::recognition::HoughSpace3D::voteInt (const Eigen::Vector3d &single_vote_coord, double weight, int voter_id)
+faat_pcl::recognition::HoughSpace3D::castVote (const Eigen::Vector3d &single_vote_coord, double weight, int voter_id, bool interpolate,
+                                               std::vector<BinVote> &bin_votes) const
 {
+  BinVote bin_vote;
+  bin_vote.voter_id = voter_id;
+
+  if (!interpolate)
+  {
+    int index = 0;
+    int bin[3];
+
+    for (int i=0; i<3; ++i)
+    {
+      int currentBin = static_cast<int> (floor ((single_vote_coord[i] - min_coord_[i])/bin_size_[i]));
+      if (currentBin < 0 || currentBin >= bin_count_[i])
+      {
+        //PCL_ERROR("Current Vote goes out of bounds in the Hough Table!\nDimension: %d, Value inserted: %f, Min value: %f, Max value: %f\n", i, 
+        //  single_vote_coord[i], min_coord_[i], min_coord_[i] + bin_size_[i]*bin_count_[i]);
+        return -1;
+      }
+
+      index += partial_bin_products_[i] * currentBin;
+      bin[i] = currentBin;
+    }
+
+    bin_vote.key = binKey (bin[0], bin[1], bin[2]);
+    bin_vote.weight = weight;
+    bin_votes.push_back (bin_vote);
+
+    return (index);
+  }
+
   int central_bin_index = 0;
 
   const int n_neigh = 27; // total number of neighbours = 3^nDim = 27
@@ -115,7 +226,7 @@ faat_pcl::recognition::HoughSpace3D::voteInt (const Eigen::Vector3d &single_vote
   Eigen::Vector3f bin_centroid;
   Eigen::Vector3f central_bin_weight;
   Eigen::Vector3i interp_bin;
-  std::vector<float> interp_weight (n_neigh);
+  float interp_weight[n_neigh];
 
   for (int n = 0; n < n_neigh; ++n)
     interp_weight[n] = 1.0;
@@ -155,10 +266,9 @@ faat_pcl::recognition::HoughSpace3D::voteInt (const Eigen::Vector3d &single_vote
   }
 
   // For each neighbor of the central point
-  //int counterRealVotes = 0;
   for (int n = 0; n < n_neigh; ++n)
   {
-    int final_bin_index = 0;
+    int neigh_coord[3];
     int exp = 1;
     int curr_neigh_index = 0;
     bool invalid = false;
@@ -183,7 +293,7 @@ faat_pcl::recognition::HoughSpace3D::voteInt (const Eigen::Vector3d &single_vote
           break;
         }
 
-        final_bin_index += curr_neigh_index * partial_bin_products_[d];
+        neigh_coord[d] = curr_neigh_index;
       }
       else
       {
@@ -195,8 +305,9 @@ faat_pcl::recognition::HoughSpace3D::voteInt (const Eigen::Vector3d &single_vote
 
     if (!invalid)
     {
-      hough_space_[final_bin_index] += weight * interp_weight[n];
-      voter_ids_[final_bin_index].push_back (voter_id);
+      bin_vote.key = binKey (neigh_coord[0], neigh_coord[1], neigh_coord[2]);
+      bin_vote.weight = weight * interp_weight[n];
+      bin_votes.push_back (bin_vote);
     }
   }
 
@@ -211,11 +322,14 @@ faat_pcl::recognition::HoughSpace3D::findMaxima (double min_threshold, std::vect
   if (min_threshold < 0)
   {
     double hough_maximum = std::numeric_limits<double>::min ();
-    for (int i = 0; i < total_bins_count_; ++i)
+    for (size_t s = 0; s < shards_.size (); ++s)
     {
-      if (hough_space_[i] > hough_maximum)
+      for (size_t i = 0; i < shards_[s].values.size (); ++i)
       {
-        hough_maximum = hough_space_[i];
+        if (shards_[s].values[i] > hough_maximum)
+        {
+          hough_maximum = shards_[s].values[i];
+        }
       }
     }
 
@@ -225,46 +339,57 @@ faat_pcl::recognition::HoughSpace3D::findMaxima (double min_threshold, std::vect
   maxima_voter_ids.clear ();
   maxima_values.clear ();
 
-  double indexes[3];
+  // (bin key, shard, bin id) of the maxima of each shard, bins without votes are never maxima
+  std::vector<std::vector<std::pair<uint64_t, std::pair<int, int> > > > shard_maxima (shards_.size ());
 
-  //int zeros = 0;
-
-  for (int i=0; i < total_bins_count_; ++i)
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int s = 0; s < static_cast<int> (shards_.size ()); ++s)
   {
-    //if (hough_space_[i] == 0)
-    //{
-    //  ++zeros;
-    //}
-    if (hough_space_[i] < min_threshold)
-      continue;
-
-    // Check with neighbors
-    bool is_maximum = true;
-    int moduled_index = i;
-
-    for (int k = 2; k >= 0; --k){
+    const Shard &shard = shards_[s];
+    for (size_t i = 0; i < shard.keys.size (); ++i)
+    {
+      double value = shard.values[i];
+      if (value < min_threshold)
+        continue;
 
-      moduled_index = moduled_index % partial_bin_products_[k+1];
-      indexes[k] = moduled_index / partial_bin_products_[k];
+      // Check with neighbors
+      bool is_maximum = true;
+      uint64_t key = shard.keys[i];
 
-      if (indexes[k] > 0 && hough_space_[i] < hough_space_[i-partial_bin_products_[k]])
-      {
-        is_maximum = false;
-        break;
-      }
-      if (indexes[k] < bin_count_[k]-1 && hough_space_[i] < hough_space_[i+partial_bin_products_[k]])
+      for (int k = 2; k >= 0; --k)
       {
-        is_maximum = false;
-        break;
+        int index = binCoord (key, k);
+        uint64_t step = static_cast<uint64_t> (1) << (21 * k);
+
+        if (index > 0 && value < getBinValue (key - step))
+        {
+          is_maximum = false;
+          break;
+        }
+        if (index < bin_count_[k]-1 && value < getBinValue (key + step))
+        {
+          is_maximum = false;
+          break;
+        }
       }
-    }
 
-    if (is_maximum)
-    {
-      maxima_values.push_back (hough_space_[i]);
-      maxima_voter_ids.push_back ( voter_ids_[i] );
+      if (is_maximum)
+        shard_maxima[s].push_back (std::make_pair (key, std::make_pair (s, static_cast<int> (i))));
     }
   }
 
+  // same order as the bins of a dense space
+  std::vector<std::pair<uint64_t, std::pair<int, int> > > maxima;
+  for (size_t s = 0; s < shard_maxima.size (); ++s)
+    maxima.insert (maxima.end (), shard_maxima[s].begin (), shard_maxima[s].end ());
+  std::sort (maxima.begin (), maxima.end ());
+
+  for (size_t m = 0; m < maxima.size (); ++m)
+  {
+    const Shard &shard = shards_[maxima[m].second.first];
+    maxima_values.push_back (shard.values[maxima[m].second.second]);
+    maxima_voter_ids.push_back (shard.voter_ids[maxima[m].second.second]);
+  }
+
   return (min_threshold);
 }
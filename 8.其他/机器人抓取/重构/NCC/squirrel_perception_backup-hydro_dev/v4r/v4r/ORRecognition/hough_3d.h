@@ -41,6 +41,7 @@
 #define FAAT_PCL_RECOGNITION_HOUGH_3D_H_
 
 #include "correspondence_grouping.h"
+#include "voxel_key_table.h"
 #include <pcl/recognition/boost.h>
 
 namespace faat_pcl
@@ -48,6 +49,8 @@ namespace faat_pcl
   namespace recognition
   {
     /** \brief HoughSpace3D is a 3D voting space. Cast votes can be interpolated in order to better deal with approximations introduced by bin quantization. A weight can also be associated with each vote. 
+      * Only bins that received a vote are stored (hashed by their bin coordinates and spread over a fixed number of shards),
+      * so memory does not depend on the extent of the space.
       * \author Federico Tombari (original), Tommaso Cavallari (PCL port)
       * \ingroup recognition
       */
@@ -90,6 +93,17 @@ namespace faat_pcl
         int
         voteInt (const Eigen::Vector3d &single_vote_coord, double weight, int voter_id);
 
+        /** \brief Cast the votes of many voters in parallel, the voter id of a vote is its position in votes_coord.
+          * Each thread collects the votes of a contiguous range of voters, the bins are then accumulated per shard
+          * in voter order, so the result is the same as calling vote () / voteInt () for each voter in order.
+          *
+          * \param[in] votes_coord coordinates of the votes.
+          * \param[in] weights weight of each vote.
+          * \param[in] interpolate use voteInt () instead of vote ().
+          */
+        void
+        vote (const std::vector<Eigen::Vector3d> &votes_coord, const std::vector<double> &weights, bool interpolate);
+
         /** \brief Find the bins with most votes.
           * 
           * \param[in] min_threshold the minimum number of votes to be included in a bin in order to have its value returned. 
@@ -103,6 +117,57 @@ namespace faat_pcl
 
       protected:
 
+        /** \brief Weight of a vote (or of one interpolated part of it) for the bin with the given key. */
+        struct BinVote
+        {
+          uint64_t key;
+          double weight;
+          int voter_id;
+        };
+
+        /** \brief Bins whose key falls into the shard, bin i has key keys[i]. */
+        struct Shard
+        {
+          faat_pcl::VoxelKeyTable table;
+          std::vector<uint64_t> keys;
+          std::vector<double> values;
+          std::vector<std::vector<int> > voter_ids;
+        };
+
+        static const int N_SHARDS = 32;
+
+        /** \brief 21 bits per bin coordinate, ordered like the linear index of a dense space (x fastest). */
+        static inline uint64_t
+        binKey (int x, int y, int z)
+        {
+          return (static_cast<uint64_t> (z) << 42) | (static_cast<uint64_t> (y) << 21) | static_cast<uint64_t> (x);
+        }
+
+        static inline int
+        binCoord (uint64_t key, int d)
+        {
+          return static_cast<int> ((key >> (21 * d)) & ((1 << 21) - 1));
+        }
+
+        static inline int
+        shardOf (uint64_t key)
+        {
+          return static_cast<int> (((key * 0x9E3779B97F4A7C15ULL) >> 32) % N_SHARDS);
+        }
+
+        /** \brief The bins and weights of one vote, appended to bin_votes.
+          * \return the linear index of the central bin or -1 if the vote is out of bounds.
+          */
+        int
+        castVote (const Eigen::Vector3d &single_vote_coord, double weight, int voter_id, bool interpolate, std::vector<BinVote> &bin_votes) const;
+
+        void
+        accumulate (const BinVote &bin_vote);
+
+        /** \brief Value of a bin, 0 if it did not receive any vote. */
+        double
+        getBinValue (uint64_t key) const;
+
         /** \brief Minimum coordinate in the Hough Space. */
         Eigen::Vector3d min_coord_;
 
@@ -112,18 +177,11 @@ namespace faat_pcl
         /** \brief Number of bins for each dimension. */
         Eigen::Vector3i bin_count_;
 
-        /** \brief Used to access hough_space_ as if it was a matrix. */
+        /** \brief Linear index of a bin as in a dense space, returned by the vote methods. */
         int partial_bin_products_[4];
 
-        /** \brief Total number of bins in the Hough Space. */
-        int total_bins_count_;
-
-        /** \brief The Hough Space. */
-        std::vector<double> hough_space_;
-        //boost::unordered_map<int, double> hough_space_;
-
-        /** \brief List of voters for each bin. */
-        boost::unordered_map<int, std::vector<int> > voter_ids_;
+        /** \brief The Hough Space, bin values and list of voters for each voted bin. */
+        std::vector<Shard> shards_;
     };
   }
 
@@ -47,6 +47,9 @@
 //#include <pcl/sample_consensus/sac_model_registration.h>
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/board.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 template<typename PointModelT, typename PointSceneT, typename PointModelRfT, typename PointSceneRfT>
@@ -186,7 +189,8 @@ faat_pcl::Hough3DGrouping<PointModelT, PointSceneT, PointModelRfT, PointSceneRfT
 
   float max_distance = -std::numeric_limits<float>::max ();
 
-  // Calculating 3D Hough space dimensions and vote position for each match
+  // Vote position for each match
+#pragma omp parallel for schedule(static)
   for (int i=0; i< n_matches; ++i)
   {
     int scene_index = model_scene_corrs_->at (i).index_match;
@@ -205,7 +209,11 @@ faat_pcl::Hough3DGrouping<PointModelT, PointSceneT, PointModelRfT, PointSceneRfT
     scene_votes[i].x () = scene_point_rf_x[0] * model_point_vote.x () + scene_point_rf_y[0] * model_point_vote.y () + scene_point_rf_z[0] * model_point_vote.z () + scene_point.x ();
     scene_votes[i].y () = scene_point_rf_x[1] * model_point_vote.x () + scene_point_rf_y[1] * model_point_vote.y () + scene_point_rf_z[1] * model_point_vote.z () + scene_point.y ();
     scene_votes[i].z () = scene_point_rf_x[2] * model_point_vote.x () + scene_point_rf_y[2] * model_point_vote.y () + scene_point_rf_z[2] * model_point_vote.z () + scene_point.z ();
+  }
 
+  // Calculating 3D Hough space dimensions
+  for (int i=0; i< n_matches; ++i)
+  {
     if (scene_votes[i].x () < d_min.x ()) 
       d_min.x () = scene_votes[i].x (); 
     if (scene_votes[i].x () > d_max.x ()) 
@@ -231,23 +239,17 @@ faat_pcl::Hough3DGrouping<PointModelT, PointSceneT, PointModelRfT, PointSceneRfT
   // Hough Voting
   hough_space_.reset (new faat_pcl::recognition::HoughSpace3D (d_min, bin_size, d_max));
 
-  for (int i = 0; i < n_matches; ++i)
+  std::vector<double> weights (n_matches, 1.0);
+  if (use_distance_weight_ && max_distance != 0)
   {
-    double weight = 1.0;
-    if (use_distance_weight_ && max_distance != 0)
-    {
-      weight = 1.0 - (model_scene_corrs_->at (i).distance / max_distance);
-    }
-    if (use_interpolation_)
+    for (int i = 0; i < n_matches; ++i)
     {
-      hough_space_->voteInt (scene_votes[i], weight, i);
-    } 
-    else
-    {
-      hough_space_->vote (scene_votes[i], weight, i);
+      weights[i] = 1.0 - (model_scene_corrs_->at (i).distance / max_distance);
     }
   }
 
+  hough_space_->vote (scene_votes, weights, use_interpolation_);
+
   hough_space_initialized_ = true;
 
   return (true);
@@ -276,25 +278,34 @@ faat_pcl::Hough3DGrouping<PointModelT, PointSceneT, PointModelRfT, PointSceneRfT
   PointCloudPtr temp_scene_cloud_ptr (new PointCloud);
   pcl::copyPointCloud<PointSceneT, PointModelT> (*scene_, *temp_scene_cloud_ptr);
 
-  pcl::registration::CorrespondenceRejectorSampleConsensus<PointModelT> corr_rejector;
-  corr_rejector.setMaximumIterations (10000);
-  corr_rejector.setInlierThreshold (hough_bin_size_);
-  corr_rejector.setInputSource (input_);
-  corr_rejector.setInputTarget (temp_scene_cloud_ptr);
+  // one rejector per maximum, each RANSAC starts from the same fixed seed, so the result does not depend on the thread
+  int n_maxima = static_cast<int> (max_values.size ());
+  model_instances.resize (n_maxima);
+  found_transformations_.resize (n_maxima);
+
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_num_procs ();
+#endif
 
-  for (size_t j = 0; j < max_values.size (); ++j)
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+  for (int j = 0; j < n_maxima; ++j)
   {
-    pcl::Correspondences temp_corrs, filtered_corrs;
+    pcl::registration::CorrespondenceRejectorSampleConsensus<PointModelT> corr_rejector;
+    corr_rejector.setMaximumIterations (10000);
+    corr_rejector.setInlierThreshold (hough_bin_size_);
+    corr_rejector.setInputSource (input_);
+    corr_rejector.setInputTarget (temp_scene_cloud_ptr);
+
+    pcl::Correspondences temp_corrs;
     for (size_t i = 0; i < max_ids[j].size (); ++i)
     {
       temp_corrs.push_back (model_scene_corrs_->at (max_ids[j][i]));
     }
     // RANSAC filtering
-    corr_rejector.getRemainingCorrespondences (temp_corrs, filtered_corrs);
+    corr_rejector.getRemainingCorrespondences (temp_corrs, model_instances[j]);
     // Save transformations for recognize
-    found_transformations_.push_back (corr_rejector.getBestTransformation ());
-
-    model_instances.push_back (filtered_corrs);
+    found_transformations_[j] = corr_rejector.getBestTransformation ();
   }
 }
 
@@ -42,6 +42,7 @@
 #include <pcl/features/normal_3d_omp.h>
 #include <functional>
 #include <numeric>
+#include <omp.h>
 
 template<typename ModelT, typename SceneT>
 bool
@@ -71,6 +72,148 @@ faat_pcl::GO3D<ModelT, SceneT>::getInlierOutliersCloud(int hyp_idx, typename pcl
   return true;
 }
 
+template<typename ModelT, typename SceneT>
+void
+faat_pcl::GO3D<ModelT, SceneT>::computeViewDepthBuffers ()
+{
+  view_depth_.resize(occ_clouds_.size());
+  for(size_t k=0; k < occ_clouds_.size(); k++)
+  {
+    const pcl::PointCloud<SceneT> & cloud = *occ_clouds_[k];
+    view_depth_[k].resize(cloud.points.size());
+    for(size_t j=0; j < cloud.points.size(); j++)
+    {
+      const SceneT & p = cloud.points[j];
+      if (pcl_isfinite (p.x) && pcl_isfinite (p.y) && pcl_isfinite (p.z))
+        view_depth_[k][j] = p.z;
+      else
+        view_depth_[k][j] = std::numeric_limits<float>::quiet_NaN ();
+    }
+  }
+}
+
+template<typename ModelT, typename SceneT>
+void
+faat_pcl::GO3D<ModelT, SceneT>::computeVisibleInView (const pcl::PointCloud<ModelT> & model, int k, const Eigen::Matrix4f & trans,
+                                                     Eigen::Matrix3Xf & points, std::vector<float> & zbuffer, std::vector<int> & closest,
+                                                     std::vector<int> & visible)
+{
+  const float f = 525.f;
+  int width = static_cast<int> (occ_clouds_[k]->width);
+  int height = static_cast<int> (occ_clouds_[k]->height);
+  float cx = (static_cast<float> (width) / 2.f - 0.5f);
+  float cy = (static_cast<float> (height) / 2.f - 0.5f);
+  const std::vector<float> & depth = view_depth_[k];
+
+  visible.clear();
+  if (model.points.empty())
+    return;
+
+  //transform all points at once (vectorized by eigen)
+  points.resize(3, model.points.size());
+  points.noalias() = trans.topLeftCorner<3,3>() * const_cast<pcl::PointCloud<ModelT> &>(model).getMatrixXfMap(3, sizeof(ModelT) / sizeof(float), 0);
+  points.colwise() += trans.block<3,1>(0,3);
+
+  //self-occlusion z-buffer, reset only the touched pixels afterwards
+  if (zbuffer.size() < depth.size())
+  {
+    zbuffer.resize(depth.size());
+    closest.resize(depth.size(), -1);
+  }
+
+  //visible holds the touched pixels first
+  for (int i = 0; i < static_cast<int> (points.cols()); i++)
+  {
+    float x = points(0,i);
+    float y = points(1,i);
+    float z = points(2,i);
+    int u = static_cast<int> (f * x / z + cx);
+    int v = static_cast<int> (f * y / z + cy);
+
+    if ((u >= width) || (v >= height) || (u < 0) || (v < 0))
+      continue;
+
+    int idx = v * width + u;
+    float z_oc = depth[idx];
+    if (pcl_isnan(z_oc) || (z - z_oc) > occlusion_thres_)
+      continue;
+
+    if (closest[idx] == -1)
+    {
+      visible.push_back(idx);
+      closest[idx] = i;
+      zbuffer[idx] = z;
+    }
+    else if (z < zbuffer[idx])
+    {
+      closest[idx] = i;
+      zbuffer[idx] = z;
+    }
+  }
+
+  for (size_t j = 0; j < visible.size(); j++)
+  {
+    int idx = visible[j];
+    visible[j] = closest[idx];
+    closest[idx] = -1;
+  }
+}
+
+/*
+ * Visible indices of all models: one depth buffer per view is computed beforehand, the model/view
+ * pairs are evaluated in parallel and the per view results are fused with a mask per model
+ */
+template<typename ModelT, typename SceneT>
+void
+faat_pcl::GO3D<ModelT, SceneT>::computeVisibleIndicesAllViews (std::vector<typename pcl::PointCloud<ModelT>::ConstPtr> & models)
+{
+  computeViewDepthBuffers ();
+
+  int n_views = static_cast<int> (occ_clouds_.size());
+  std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > trans(n_views);
+  for(int k=0; k < n_views; k++)
+    trans[k] = absolute_poses_camera_to_global_[k].inverse();
+
+  int n_pairs = static_cast<int> (models.size()) * n_views;
+  std::vector<std::vector<int> > visible_in_view(n_pairs);
+
+#pragma omp parallel num_threads(std::min(max_threads_, omp_get_num_procs()))
+  {
+    Eigen::Matrix3Xf points;
+    std::vector<float> zbuffer;
+    std::vector<int> closest;
+
+#pragma omp for schedule(dynamic, 1)
+    for (int p = 0; p < n_pairs; p++)
+    {
+      int i = p / n_views;
+      int k = p % n_views;
+      computeVisibleInView (*models[i], k, trans[k], points, zbuffer, closest, visible_in_view[p]);
+    }
+  }
+
+  for (size_t i = 0; i < models.size (); i++)
+  {
+    std::vector<unsigned char> visible(models[i]->points.size(), 0);
+    for (size_t j = 0; j < visible_indices_[i].size(); j++)
+      visible[visible_indices_[i][j]] = 1;
+
+    for(int k=0; k < n_views; k++)
+    {
+      const std::vector<int> & in_view = visible_in_view[i * n_views + k];
+      for (size_t j = 0; j < in_view.size(); j++)
+        visible[in_view[j]] = 1;
+    }
+
+    visible_indices_[i].clear();
+    for (size_t j = 0; j < visible.size(); j++)
+    {
+      if (visible[j])
+        visible_indices_[i].push_back(static_cast<int> (j));
+    }
+  }
+}
+
 template<typename ModelT, typename SceneT>
 void
 faat_pcl::GO3D<ModelT, SceneT>::addModels (std::vector<typename pcl::PointCloud<ModelT>::ConstPtr> & models, bool occlusion_reasoning)
@@ -83,6 +226,10 @@ faat_pcl::GO3D<ModelT, SceneT>::addModels (std::vector<typename pcl::PointCloud<
   else
   {
     visible_indices_.resize(models.size());
+
+    if (parallel_views_)
+      computeVisibleIndicesAllViews (models);
+
     //pcl::visualization::PCLVisualizer vis("visible model");
     for (size_t i = 0; i < models.size (); i++)
     {
@@ -91,7 +238,7 @@ faat_pcl::GO3D<ModelT, SceneT>::addModels (std::vector<typename pcl::PointCloud<
       typename pcl::PointCloud<ModelT>::Ptr filtered (new pcl::PointCloud<ModelT> ());
 
       //scene-occlusions
-      for(size_t k=0; k < occ_clouds_.size(); k++)
+      for(size_t k=0; k < occ_clouds_.size() && !parallel_views_; k++)
       {
         //transform model to camera coordinate
         typename pcl::PointCloud<ModelT>::Ptr model_in_view_coordinates(new pcl::PointCloud<ModelT> ());
@@ -108,8 +255,11 @@ faat_pcl::GO3D<ModelT, SceneT>::addModels (std::vector<typename pcl::PointCloud<
         visible_indices_[i].insert(visible_indices_[i].end(), final_indices.begin(), final_indices.end());
       }
 
-      std::set<int> s( visible_indices_[i].begin(), visible_indices_[i].end() );
-      visible_indices_[i].assign( s.begin(), s.end() );
+      if (!parallel_views_)
+      {
+        std::set<int> s( visible_indices_[i].begin(), visible_indices_[i].end() );
+        visible_indices_[i].assign( s.begin(), s.end() );
+      }
 
       pcl::copyPointCloud(*models[i], visible_indices_[i], *filtered);
 
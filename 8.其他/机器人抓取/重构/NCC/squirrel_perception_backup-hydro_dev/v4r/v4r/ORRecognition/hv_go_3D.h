@@ -78,12 +78,17 @@ namespace faat_pcl
     using faat_pcl::GHV<ModelT, SceneT>::scene_RGB_values_;
     using faat_pcl::GHV<ModelT, SceneT>::scene_GS_values_;
     using faat_pcl::GHV<ModelT, SceneT>::computeClutterCueAtOnce;
+    using faat_pcl::GHV<ModelT, SceneT>::max_threads_;
 
     //typename pcl::PointCloud<SceneT>::Ptr scene_cloud_downsampled_GO3D_;
     //typename pcl::PointCloud<pcl::Normal>::Ptr scene_normals_go3D_;
     std::vector<Eigen::Matrix4f> absolute_poses_camera_to_global_;
     std::vector<typename pcl::PointCloud<SceneT>::ConstPtr > occ_clouds_;
 
+    bool parallel_views_;
+    //depth of each pixel of each occlusion cloud, NaN where invalid
+    std::vector<std::vector<float> > view_depth_;
+
     static float sRGB_LUT[256];
     static float sXYZ_LUT[4000];
 
@@ -155,6 +160,18 @@ namespace faat_pcl
     /*bool
     addModel (int i, boost::shared_ptr<RecognitionModel<ModelT> > & recog_model);*/
 
+    void
+    computeViewDepthBuffers ();
+
+    //same as occlusion_reasoning::filter for the transformed model against view k
+    void
+    computeVisibleInView (const pcl::PointCloud<ModelT> & model, int k, const Eigen::Matrix4f & trans,
+                          Eigen::Matrix3Xf & points, std::vector<float> & zbuffer, std::vector<int> & closest,
+                          std::vector<int> & visible);
+
+    void
+    computeVisibleIndicesAllViews (std::vector<typename pcl::PointCloud<ModelT>::ConstPtr> & models);
+
       //void initialize ();
 
       /*bool
@@ -163,7 +180,13 @@ namespace faat_pcl
     public:
       GO3D()
       {
+        parallel_views_ = false;
+      }
 
+      //precompute one depth buffer per view and evaluate all model/view visibility pairs in parallel
+      void setParallelViews(bool b)
+      {
+        parallel_views_ = b;
       }
 
       /*void setSceneAndNormals(typename pcl::PointCloud<SceneT>::Ptr & scene_cloud_downsampled_GO3D,
@@ -0,0 +1,151 @@
+/*
+ * voxel_key_table.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_VOXEL_KEY_TABLE_H_
+#define FAAT_PCL_VOXEL_KEY_TABLE_H_
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+namespace faat_pcl
+{
+  /**
+   * \brief Open addressing hash table (linear probing) assigning consecutive ids to voxel keys.
+   * Used to keep per-voxel counters only for occupied voxels instead of a dense grid spanning
+   * a bounding box: counters are indexed by the id returned by insert.
+   */
+  class VoxelKeyTable
+  {
+    std::vector<uint64_t> keys_;
+    std::vector<int> ids_;
+    size_t size_;
+
+    static inline uint64_t
+    emptyKey ()
+    {
+      return ~static_cast<uint64_t> (0);
+    }
+
+    static inline uint64_t
+    hash (uint64_t key)
+    {
+      key ^= key >> 33;
+      key *= 0xff51afd7ed558ccdULL;
+      key ^= key >> 33;
+      key *= 0xc4ceb9fe1a85ec53ULL;
+      key ^= key >> 33;
+      return key;
+    }
+
+    void
+    rehash (size_t capacity)
+    {
+      std::vector<uint64_t> old_keys;
+      std::vector<int> old_ids;
+      old_keys.swap (keys_);
+      old_ids.swap (ids_);
+
+      keys_.assign (capacity, emptyKey ());
+      ids_.assign (capacity, -1);
+
+      for (size_t i = 0; i < old_keys.size (); i++)
+      {
+        if (old_keys[i] == emptyKey ())
+          continue;
+
+        size_t slot = findSlot (old_keys[i]);
+        keys_[slot] = old_keys[i];
+        ids_[slot] = old_ids[i];
+      }
+    }
+
+    /** \brief Slot holding key or the empty slot where it would be inserted */
+    inline size_t
+    findSlot (uint64_t key) const
+    {
+      size_t mask = keys_.size () - 1;
+      size_t slot = static_cast<size_t> (hash (key)) & mask;
+      while (keys_[slot] != emptyKey () && keys_[slot] != key)
+        slot = (slot + 1) & mask;
+
+      return slot;
+    }
+
+  public:
+
+    VoxelKeyTable ()
+    {
+      size_ = 0;
+      keys_.assign (16, emptyKey ());
+      ids_.assign (16, -1);
+    }
+
+    /** \brief Makes room for n keys without rehashing */
+    void
+    reserve (size_t n)
+    {
+      size_t capacity = keys_.size ();
+      while (capacity < 2 * n)
+        capacity *= 2;
+
+      if (capacity != keys_.size ())
+        rehash (capacity);
+    }
+
+    /** \brief Id of key, a new id (the number of keys inserted before) if key was not in the table */
+    int
+    insert (uint64_t key)
+    {
+      if (2 * (size_ + 1) > keys_.size ())
+        rehash (keys_.size () * 2);
+
+      size_t slot = findSlot (key);
+      if (keys_[slot] == emptyKey ())
+      {
+        keys_[slot] = key;
+        ids_[slot] = static_cast<int> (size_++);
+      }
+
+      return ids_[slot];
+    }
+
+    /** \brief Id of key or -1 */
+    int
+    find (uint64_t key) const
+    {
+      return ids_[findSlot (key)];
+    }
+
+    size_t
+    size () const
+    {
+      return size_;
+    }
+
+    void
+    clear ()
+    {
+      size_ = 0;
+      keys_.assign (16, emptyKey ());
+      ids_.assign (16, -1);
+    }
+
+    /** \brief Key of the voxel of size resolution containing (x,y,z), 21 bits per coordinate */
+    static inline uint64_t
+    makeKey (float x, float y, float z, float resolution)
+    {
+      const int64_t offset = 1 << 20;
+      const uint64_t mask = (1 << 21) - 1;
+      uint64_t kx = static_cast<uint64_t> (static_cast<int64_t> (std::floor (x / resolution)) + offset) & mask;
+      uint64_t ky = static_cast<uint64_t> (static_cast<int64_t> (std::floor (y / resolution)) + offset) & mask;
+      uint64_t kz = static_cast<uint64_t> (static_cast<int64_t> (std::floor (z / resolution)) + offset) & mask;
+      return (kz << 42) | (ky << 21) | kx;
+    }
+  };
+}
+
+#endif /* FAAT_PCL_VOXEL_KEY_TABLE_H_ */
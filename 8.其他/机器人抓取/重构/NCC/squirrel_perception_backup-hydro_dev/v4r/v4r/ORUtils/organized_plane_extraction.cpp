@@ -0,0 +1,10 @@
+/*
+ * organized_plane_extraction.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "organized_plane_extraction.hpp"
+
+template class faat_pcl::OrganizedPlaneExtraction<pcl::PointXYZ>;
+template class faat_pcl::OrganizedPlaneExtraction<pcl::PointXYZRGB>;
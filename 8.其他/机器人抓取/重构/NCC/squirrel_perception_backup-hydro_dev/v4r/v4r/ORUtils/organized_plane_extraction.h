@@ -0,0 +1,165 @@
+/*
+ * organized_plane_extraction.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_ORGANIZED_PLANE_EXTRACTION_H_
+#define FAAT_PCL_ORGANIZED_PLANE_EXTRACTION_H_
+
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_types.h>
+#include <pcl/PointIndices.h>
+#include <pcl/ModelCoefficients.h>
+#include "common_data_structures.h"
+
+namespace faat_pcl
+{
+  /**
+   * \brief Plane detection on an organized cloud, done once per frame and shared by its consumers
+   * (MultiPlaneSegmentation, PlanePopout, GHV planar models, attention preprocessing).
+   * Normals come from integral images, planes from region growing of the normals
+   * (OrganizedMultiPlaneSegmentation with a plane refinement step). The result holds the plane
+   * coefficients, inliers, a per point plane label, convex hulls and the normals.
+   * compute() does nothing if it already ran for the same cloud (pointer, stamp and size),
+   * call invalidate() if the cloud was modified in place.
+   */
+  template<typename PointT>
+  class OrganizedPlaneExtraction
+  {
+    public:
+      typedef pcl::PointCloud<PointT> PointTCloud;
+      typedef typename PointTCloud::Ptr PointTCloudPtr;
+      typedef typename PointTCloud::ConstPtr PointTCloudConstPtr;
+      typedef boost::shared_ptr<OrganizedPlaneExtraction<PointT> > Ptr;
+
+      struct Plane
+      {
+        pcl::ModelCoefficients coefficients_;
+        pcl::PointIndices inliers_;
+        typename pcl::PointCloud<PointT>::Ptr convex_hull_cloud_;
+      };
+
+    private:
+      PointTCloudConstPtr input_;
+      uint64_t input_stamp_;
+      size_t input_size_;
+      bool computed_;
+
+      pcl::PointCloud<pcl::Normal>::Ptr normals_;
+      bool normals_set_;
+
+      //plane index of each point, -1 if not on a plane
+      std::vector<int> labels_;
+      std::vector<Plane> planes_;
+
+      int min_plane_inliers_;
+      float angular_threshold_;
+      float distance_threshold_;
+      float max_curvature_;
+      float max_depth_change_factor_;
+      float normal_smoothing_size_;
+      bool compute_convex_hulls_;
+
+      int selectDominantPlane(const std::vector<size_t> & counts, const Eigen::Vector3f & direction, float max_angle) const;
+
+    public:
+      OrganizedPlaneExtraction()
+      {
+        input_stamp_ = 0;
+        input_size_ = 0;
+        computed_ = false;
+        normals_set_ = false;
+        min_plane_inliers_ = 1000;
+        angular_threshold_ = 0.017453f * 2.f;
+        distance_threshold_ = 0.01f;
+        max_curvature_ = 0.002f;
+        max_depth_change_factor_ = 0.02f;
+        normal_smoothing_size_ = 20.f;
+        compute_convex_hulls_ = true;
+      }
+
+      void setMinPlaneInliers(int t)
+      {
+        min_plane_inliers_ = t;
+        invalidate();
+      }
+
+      void setAngularThreshold(float t)
+      {
+        angular_threshold_ = t;
+        invalidate();
+      }
+
+      void setDistanceThreshold(float t)
+      {
+        distance_threshold_ = t;
+        invalidate();
+      }
+
+      void setMaximumCurvature(float t)
+      {
+        max_curvature_ = t;
+        invalidate();
+      }
+
+      void setComputeConvexHulls(bool b)
+      {
+        compute_convex_hulls_ = b;
+        invalidate();
+      }
+
+      /** \brief Normals of the next cloud, otherwise they are estimated with integral images */
+      void setNormals(const pcl::PointCloud<pcl::Normal>::Ptr & normals)
+      {
+        normals_ = normals;
+        normals_set_ = true;
+        invalidate();
+      }
+
+      void invalidate()
+      {
+        computed_ = false;
+      }
+
+      /** \brief Returns false if the cloud is not organized */
+      bool compute(const PointTCloudConstPtr & input);
+
+      bool isComputedFor(const PointTCloudConstPtr & input) const
+      {
+        return computed_ && input_.get() == input.get() && input_stamp_ == input->header.stamp &&
+               input_size_ == input->points.size();
+      }
+
+      const std::vector<Plane> & getPlanes() const
+      {
+        return planes_;
+      }
+
+      pcl::PointCloud<pcl::Normal>::Ptr getNormals() const
+      {
+        return normals_;
+      }
+
+      const std::vector<int> & getLabels() const
+      {
+        return labels_;
+      }
+
+      /** \brief Index of the plane with most inliers whose normal is within max_angle of direction (any plane if max_angle >= pi), -1 if none */
+      int getDominantPlane(const Eigen::Vector3f & direction = Eigen::Vector3f::UnitZ(), float max_angle = static_cast<float>(M_PI)) const;
+
+      /** \brief As above, but the planes are ranked by their inliers among indices (e.g. the points within a depth range) */
+      int getDominantPlane(const std::vector<int> & indices, const Eigen::Vector3f & direction = Eigen::Vector3f::UnitZ(), float max_angle = static_cast<float>(M_PI)) const;
+
+      /** \brief Points of indices that are valid and do not belong to plane */
+      void getOffPlaneIndices(int plane, const std::vector<int> & indices, std::vector<int> & off_plane) const;
+
+      /** \brief Planes in the representation consumed by GHV::addPlanarModels */
+      void getPlaneModels(std::vector<PlaneModel<PointT> > & models, float resolution = 0.001f) const;
+  };
+}
+
+#endif /* FAAT_PCL_ORGANIZED_PLANE_EXTRACTION_H_ */
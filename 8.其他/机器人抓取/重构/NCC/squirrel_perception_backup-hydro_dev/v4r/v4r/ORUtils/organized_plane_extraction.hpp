@@ -0,0 +1,214 @@
+/*
+ * organized_plane_extraction.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FAAT_PCL_ORGANIZED_PLANE_EXTRACTION_HPP_
+#define FAAT_PCL_ORGANIZED_PLANE_EXTRACTION_HPP_
+
+#include "organized_plane_extraction.h"
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/segmentation/organized_multi_plane_segmentation.h>
+#include <pcl/segmentation/plane_refinement_comparator.h>
+#include <pcl/surface/convex_hull.h>
+#include <pcl/filters/project_inliers.h>
+#include <pcl/common/io.h>
+
+template<typename PointT>
+bool
+faat_pcl::OrganizedPlaneExtraction<PointT>::compute(const PointTCloudConstPtr & input)
+{
+  if(isComputedFor(input))
+    return true;
+
+  computed_ = false;
+  planes_.clear();
+  labels_.clear();
+
+  if(!input->isOrganized())
+    return false;
+
+  input_ = input;
+  input_stamp_ = input->header.stamp;
+  input_size_ = input->points.size();
+
+  if(!normals_set_ || !normals_ || normals_->points.size() != input->points.size())
+  {
+    normals_.reset(new pcl::PointCloud<pcl::Normal>);
+    pcl::IntegralImageNormalEstimation<PointT, pcl::Normal> ne;
+    ne.setNormalEstimationMethod (ne.COVARIANCE_MATRIX);
+    ne.setMaxDepthChangeFactor (max_depth_change_factor_);
+    ne.setNormalSmoothingSize (normal_smoothing_size_);
+    ne.setBorderPolicy (pcl::IntegralImageNormalEstimation<PointT, pcl::Normal>::BORDER_POLICY_IGNORE);
+    ne.setInputCloud (input);
+    ne.compute (*normals_);
+  }
+
+  //given normals are used for one cloud only
+  normals_set_ = false;
+
+  pcl::OrganizedMultiPlaneSegmentation<PointT, pcl::Normal, pcl::Label> mps;
+  mps.setMinInliers (min_plane_inliers_);
+  mps.setAngularThreshold (angular_threshold_);
+  mps.setDistanceThreshold (distance_threshold_);
+  mps.setMaximumCurvature (max_curvature_);
+  mps.setInputNormals (normals_);
+  mps.setInputCloud (input);
+
+  std::vector<pcl::PlanarRegion<PointT>, Eigen::aligned_allocator<pcl::PlanarRegion<PointT> > > regions;
+  std::vector<pcl::ModelCoefficients> model_coefficients;
+  std::vector<pcl::PointIndices> inlier_indices;
+  pcl::PointCloud<pcl::Label>::Ptr labels (new pcl::PointCloud<pcl::Label>);
+  std::vector<pcl::PointIndices> label_indices;
+  std::vector<pcl::PointIndices> boundary_indices;
+
+  typename pcl::PlaneRefinementComparator<PointT, pcl::Normal, pcl::Label>::Ptr ref_comp (
+                                                                                           new pcl::PlaneRefinementComparator<PointT,
+                                                                                               pcl::Normal, pcl::Label> ());
+  ref_comp->setDistanceThreshold (distance_threshold_, false);
+  ref_comp->setAngularThreshold (angular_threshold_);
+  mps.setRefinementComparator (ref_comp);
+  mps.segmentAndRefine (regions, model_coefficients, inlier_indices, labels, label_indices, boundary_indices);
+
+  labels_.resize(input->points.size(), -1);
+  planes_.resize(model_coefficients.size());
+  for(size_t i=0; i < model_coefficients.size(); i++)
+  {
+    Plane & plane = planes_[i];
+    plane.coefficients_ = model_coefficients[i];
+    plane.inliers_ = inlier_indices[i];
+
+    for(size_t k=0; k < inlier_indices[i].indices.size(); k++)
+      labels_[inlier_indices[i].indices[k]] = static_cast<int>(i);
+
+    if(!compute_convex_hulls_ || inlier_indices[i].indices.size() < 3)
+      continue;
+
+    pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients(model_coefficients[i]));
+    pcl::PointIndices::Ptr inliers (new pcl::PointIndices(inlier_indices[i]));
+    PointTCloudPtr projected (new PointTCloud);
+    pcl::ProjectInliers<PointT> proj;
+    proj.setModelType (pcl::SACMODEL_PLANE);
+    proj.setInputCloud (input);
+    proj.setIndices (inliers);
+    proj.setModelCoefficients (coefficients);
+    proj.filter (*projected);
+
+    pcl::ConvexHull<PointT> convex_hull;
+    convex_hull.setInputCloud (projected);
+    convex_hull.setDimension (2);
+    plane.convex_hull_cloud_.reset(new PointTCloud);
+    convex_hull.reconstruct (*plane.convex_hull_cloud_);
+  }
+
+  computed_ = true;
+  return true;
+}
+
+template<typename PointT>
+int
+faat_pcl::OrganizedPlaneExtraction<PointT>::selectDominantPlane(const std::vector<size_t> & counts, const Eigen::Vector3f & direction, float max_angle) const
+{
+  int best = -1;
+  size_t best_inliers = 0;
+  float min_cos = std::cos(max_angle);
+
+  for(size_t i=0; i < planes_.size(); i++)
+  {
+    const std::vector<float> & c = planes_[i].coefficients_.values;
+    Eigen::Vector3f n(c[0], c[1], c[2]);
+    n.normalize();
+
+    //the orientation of the plane normal is not defined
+    if(max_angle < M_PI && std::abs(n.dot(direction.normalized())) < min_cos)
+      continue;
+
+    if(counts[i] > best_inliers)
+    {
+      best = static_cast<int>(i);
+      best_inliers = counts[i];
+    }
+  }
+
+  return best;
+}
+
+template<typename PointT>
+int
+faat_pcl::OrganizedPlaneExtraction<PointT>::getDominantPlane(const Eigen::Vector3f & direction, float max_angle) const
+{
+  std::vector<size_t> counts(planes_.size());
+  for(size_t i=0; i < planes_.size(); i++)
+    counts[i] = planes_[i].inliers_.indices.size();
+
+  return selectDominantPlane(counts, direction, max_angle);
+}
+
+template<typename PointT>
+int
+faat_pcl::OrganizedPlaneExtraction<PointT>::getDominantPlane(const std::vector<int> & indices, const Eigen::Vector3f & direction, float max_angle) const
+{
+  std::vector<size_t> counts(planes_.size(), 0);
+  for(size_t i=0; i < indices.size(); i++)
+  {
+    if(labels_[indices[i]] >= 0)
+      counts[labels_[indices[i]]]++;
+  }
+
+  return selectDominantPlane(counts, direction, max_angle);
+}
+
+template<typename PointT>
+void
+faat_pcl::OrganizedPlaneExtraction<PointT>::getOffPlaneIndices(int plane, const std::vector<int> & indices, std::vector<int> & off_plane) const
+{
+  off_plane.clear();
+  off_plane.reserve(indices.size());
+  for(size_t i=0; i < indices.size(); i++)
+  {
+    const PointT & p = input_->points[indices[i]];
+    if(!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z))
+      continue;
+
+    if(labels_[indices[i]] != plane || plane < 0)
+      off_plane.push_back(indices[i]);
+  }
+}
+
+template<typename PointT>
+void
+faat_pcl::OrganizedPlaneExtraction<PointT>::getPlaneModels(std::vector<PlaneModel<PointT> > & models, float resolution) const
+{
+  models.clear();
+  if(!computed_)
+    return;
+
+  PointTCloudPtr cloud (new PointTCloud);
+  pcl::copyPointCloud(*input_, *cloud);
+
+  for(size_t i=0; i < planes_.size(); i++)
+  {
+    PlaneModel<PointT> pm;
+    pm.coefficients_ = planes_[i].coefficients_;
+    pm.inliers_ = planes_[i].inliers_;
+    pm.cloud_ = cloud;
+    pm.plane_cloud_.reset(new PointTCloud);
+    pm.projectPlaneCloud(resolution);
+
+    pm.convex_hull_cloud_ = planes_[i].convex_hull_cloud_;
+    if(pm.convex_hull_cloud_)
+    {
+      pcl::ConvexHull<PointT> convex_hull;
+      convex_hull.setInputCloud (pm.plane_cloud_);
+      convex_hull.setDimension (2);
+      pcl::PolygonMeshPtr mesh_out(new pcl::PolygonMesh);
+      convex_hull.reconstruct (*mesh_out);
+      pm.convex_hull_ = mesh_out;
+    }
+
+    models.push_back(pm);
+  }
+}
+
+#endif /* FAAT_PCL_ORGANIZED_PLANE_EXTRACTION_HPP_ */
@@ -35,6 +35,7 @@
 #include "PlanePopout.hh"
 #include "PCLUtils.h"
 #include "PCLFunctions.h"
+#include "v4r/ORUtils/organized_plane_extraction.hpp"
 
 namespace pclA
 {
@@ -340,6 +341,9 @@ bool PlanePopout::NormalisePlane(pcl::ModelCoefficients::Ptr &plane)
 bool PlanePopout::DetectPopout(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, 
                                pcl::PointIndices &popout)
 {
+  if (planeExtraction.get() != 0 && planeExtraction->compute(cloud))
+    return DetectPopoutFromPlanes(cloud, popout);
+
   pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloudFiltered (new pcl::PointCloud<pcl::PointXYZRGB>);
 
   // Filter the PointCloud in z-coordinate
@@ -452,6 +456,68 @@ bool PlanePopout::DetectPopout(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr
   return true;
 }
 
+/**
+ * Detect objects which pop out of the dominant plane of the plane extraction.
+ * The planes are grown regions, so the plane is connected and no clustering is needed.
+ * As in DetectPopout only the points passing FilterZ are considered for the plane.
+ */
+bool PlanePopout::DetectPopoutFromPlanes(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, 
+                                         pcl::PointIndices &popout)
+{
+  // Filter the PointCloud in z-coordinate
+  std::vector<int> zIndices;
+  zFilter.setInputCloud (cloud);
+  zFilter.filter (zIndices);
+  if ((int)zIndices.size() < param.nbNeighbours) {
+    cout << "[PCLAddOns::PlanePopout::DetectPopoutFromPlanes] Only " << (int)zIndices.size() << " are available!"<<endl;
+    return false;
+  }
+
+  // only accept horizontal planes (same test as with RANSAC)
+  // NOTE: assumes that z points up!
+  int plane = planeExtraction->getDominantPlane(zIndices, Eigen::Vector3f::UnitZ(), param.delta);
+  if (plane < 0) {
+    cout<<"PlanePopout::DetectPopoutFromPlanes: No plane found!"<<endl;
+    return false;
+  }
+
+  const faat_pcl::OrganizedPlaneExtraction<pcl::PointXYZRGB>::Plane &table = planeExtraction->getPlanes()[plane];
+
+  if (tableCoefficients.get()==0)
+    tableCoefficients.reset(new pcl::ModelCoefficients());
+  *tableCoefficients = table.coefficients_;
+  if(!NormalisePlane(tableCoefficients))
+    return false;
+
+  // plane points outside of the z range are dropped
+  const std::vector<int> &labels = planeExtraction->getLabels();
+  tableInliers->header = table.inliers_.header;
+  tableInliers->indices.clear();
+  for (unsigned i=0; i<zIndices.size(); i++)
+    if (labels[zIndices[i]] == plane)
+      tableInliers->indices.push_back(zIndices[i]);
+
+  pcl::ProjectInliers<pcl::PointXYZRGB> projPlane;
+  projPlane.setModelType (pcl::SACMODEL_PLANE);
+  projPlane.setInputCloud (cloud);
+  projPlane.setIndices (tableInliers);
+  projPlane.setModelCoefficients (tableCoefficients);
+  projPlane.filter (*tableProjected);
+
+  if (table.convex_hull_cloud_.get() != 0 && tableInliers->indices.size() == table.inliers_.indices.size())
+    *tableHull = *table.convex_hull_cloud_;
+  else
+  {
+    hull.setInputCloud (tableProjected);
+    hull.reconstruct (*tableHull);
+  }
+
+  prism.setInputCloud (cloud);
+  prism.setInputPlanarHull (tableHull);
+  prism.segment (popout); 
+  return true;
+}
+
 /**
  * Filter point cloud depending on z-value
  * (PassThroughFilter)
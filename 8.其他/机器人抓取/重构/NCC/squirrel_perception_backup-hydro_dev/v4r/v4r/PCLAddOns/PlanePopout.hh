@@ -54,6 +54,7 @@
 #include "pcl/search/search.h"
 
 #include "v4r/PCLAddOns/CCLabeling.hh"
+#include "v4r/ORUtils/organized_plane_extraction.h"
 
 namespace pclA
 {
@@ -150,6 +151,11 @@ private:
 
   cv::Ptr<pclA::CCLabeling> ccLabeling;
 
+  faat_pcl::OrganizedPlaneExtraction<pcl::PointXYZRGB>::Ptr planeExtraction;
+
+  bool DetectPopoutFromPlanes(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, 
+                              pcl::PointIndices &popout);
+
 public:
 
   PlanePopout(Parameter _param = Parameter());
@@ -177,6 +183,10 @@ public:
   /** Get the plane coefficients from the dominant plane **/
   void GetDominantPlaneCoefficients(pcl::ModelCoefficients::Ptr &dpc) {dpc = tableCoefficients;}
 
+  /** Take the dominant plane of organized clouds from a (shared) plane extraction instead of RANSAC. **/
+  /** The table inliers then index the input cloud, not the downsampled one. **/
+  void SetPlaneExtraction(const faat_pcl::OrganizedPlaneExtraction<pcl::PointXYZRGB>::Ptr &pe) {planeExtraction = pe;}
+
   /** Process the cloud and detect popouts (==process) **/
   bool DetectPopout(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, 
                     pcl::PointIndices &popout);
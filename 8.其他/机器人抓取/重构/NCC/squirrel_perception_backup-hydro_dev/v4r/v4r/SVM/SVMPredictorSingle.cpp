@@ -76,6 +76,14 @@ void SVMPredictorSingle::setModelFilename(std::string _model_filename)
 { 
   model_filename = _model_filename; 
   
+  // release a previously loaded model
+  if(have_model_filename)
+    svm_free_and_destroy_model(&model);
+  if(have_model_node)
+    free(node);
+  have_model_filename = false;
+  have_model_node = false;
+  
   // allocate memory for model (and nodes)
   if((model=svm_load_model(model_filename.c_str()))==0)
   {
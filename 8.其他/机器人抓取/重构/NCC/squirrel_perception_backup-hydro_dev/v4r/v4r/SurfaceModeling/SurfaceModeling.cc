@@ -189,7 +189,7 @@ void SurfaceModeling::fitPlane(SurfaceModel::Ptr plane)
 /**
  * FitNurbs
  */
-void SurfaceModeling::fitNurbs(SurfaceModel::Ptr surface)
+void SurfaceModeling::fitNurbs(SurfaceModel::Ptr surface, const ON_NurbsSurface *initialNurbs)
 {
   pcl::PointIndices::Ptr points(new pcl::PointIndices());
   points->indices = surface->indices;
@@ -206,7 +206,10 @@ void SurfaceModeling::fitNurbs(SurfaceModel::Ptr surface)
 
   nurbsFitter->setInputCloud(cloud);
   nurbsFitter->setInterior(points);
-  nurbsFitter->compute();
+  if(initialNurbs != 0)
+    nurbsFitter->compute_interior(*initialNurbs);
+  else
+    nurbsFitter->compute();
   nurbsFitter->getInteriorError(surface->error);
   surface->nurbs = nurbsFitter->getNurbs();
   nurbsFitter->getInteriorNormals(surface->normals);
@@ -298,7 +301,8 @@ bool SurfaceModeling::replacePlaneWithBetterNurbs(SurfaceModel::Ptr &surf)
  * See if merging two surfaces gives a better merged surface in terms of savings.
  * @return smart pointer to merged surface, or null pointer
  */
-bool SurfaceModeling::tryMergeSurfaces(SurfaceModel::Ptr surf1, SurfaceModel::Ptr surf2, SurfaceModel::Ptr &mergedSurf)
+bool SurfaceModeling::tryMergeSurfaces(SurfaceModel::Ptr surf1, SurfaceModel::Ptr surf2, SurfaceModel::Ptr &mergedSurf,
+                                       double *separateSavings)
 {
   if( (surf1->indices.size() + surf2->indices.size()) > 3 )
   {
@@ -307,20 +311,31 @@ bool SurfaceModeling::tryMergeSurfaces(SurfaceModel::Ptr surf1, SurfaceModel::Pt
     surf2->addTo(*mergedSurf);
     
     mergedSurf->type = MODEL_NURBS;
-    fitNurbs(mergedSurf);
+
+    // start from the control grid of the larger surface
+    SurfaceModel::Ptr larger = (surf1->indices.size() >= surf2->indices.size() ? surf1 : surf2);
+    if(param.warmStartMerge && (larger->type == MODEL_NURBS))
+      fitNurbs(mergedSurf,&larger->nurbs);
+    else
+      fitNurbs(mergedSurf);
+
     mergedSurf->savings = computeSavingsNormalized(mergedSurf->nurbs.m_cv_count[0] * mergedSurf->nurbs.m_cv_count[1] * COSTS_NURBS_PARAMS,
                                                    mergedSurf->probs, mergedSurf->indices.size(), param.kappa1, param.kappa2);
     //@ep: why mergedSurf->indices.size() as the last argument and not surf1->indices.size()???
     //jp: that's the common normalization factor for individual planes and merged nurbs
-    surf1->savings = computeSavingsNormalized(
+    // (computed locally, pairs sharing a surface are evaluated concurrently)
+    double savings1 = computeSavingsNormalized(
             (surf1->type == MODEL_NURBS ? surf1->nurbs.m_cv_count[0] * surf1->nurbs.m_cv_count[1] * COSTS_NURBS_PARAMS : COSTS_PLANE_PARAMS),
             surf1->probs, mergedSurf->indices.size(), param.kappa1, param.kappa2);
     
-    surf2->savings = computeSavingsNormalized(
+    double savings2 = computeSavingsNormalized(
             (surf2->type == MODEL_NURBS ? surf2->nurbs.m_cv_count[0] * surf2->nurbs.m_cv_count[1] * COSTS_NURBS_PARAMS : COSTS_PLANE_PARAMS),
             surf2->probs, mergedSurf->indices.size(), param.kappa1, param.kappa2);
 
-    if( mergedSurf->savings > (surf1->savings + surf2->savings) )
+    if(separateSavings != 0)
+      *separateSavings = savings1 + savings2;
+
+    if( mergedSurf->savings > (savings1 + savings2) )
     {
       return true;
     }
@@ -373,9 +388,8 @@ bool SurfaceModeling::tryMergeSurfacesWithPlanes(SurfaceModel::Ptr surf1, Surfac
  */
 void SurfaceModeling::modelSelection()
 {
-  // pairs of patches to be merged
-  std::vector<MergedPair> mergePairs;
-  
+  addedTo.resize(surfaces.size(),-1);
+
   if(tryMergeNurbs)
   {
     #pragma omp parallel for
@@ -387,19 +401,17 @@ void SurfaceModeling::modelSelection()
       replacePlaneWithBetterNurbs(surfaces.at(i));
     }
 
-//     exit(0);
-    
-    mergeWithNurbs(mergePairs);
-    
-//     exit(0);
-  }
-  else if (tryMergePlanes)
-  {
-    mergeWithPlanes(mergePairs);
+    mergeWithNurbs();
+    return;
   }
 
-  addedTo.resize(surfaces.size(),-1);
-  
+  if(!tryMergePlanes)
+    return;
+
+  // pairs of patches to be merged
+  std::vector<MergedPair> mergePairs;
+  mergeWithPlanes(mergePairs);
+
   // merge the surfaces from the best to the weakest connection
   std::sort(mergePairs.begin(),mergePairs.end(),cmpSavings);
   
@@ -413,37 +425,13 @@ void SurfaceModeling::modelSelection()
     
     SurfaceModel::Ptr mergedModel;
 
-    bool toBeMerged = false;
-
-    if(tryMergeNurbs)
-    {
-      toBeMerged = tryMergeSurfaces(surfaces.at(mergePairs.at(i).id1),surfaces.at(mergePairs.at(i).id2),mergedModel);
-    }
-    else if(tryMergePlanes)
-    {
-      toBeMerged = tryMergeSurfacesWithPlanes(surfaces.at(mergePairs.at(i).id1),surfaces.at(mergePairs.at(i).id2),mergedModel);
-    }
-    
-    if(toBeMerged)
+    if(tryMergeSurfacesWithPlanes(surfaces.at(mergePairs.at(i).id1),surfaces.at(mergePairs.at(i).id2),mergedModel))
     {
       
       printf("MERGED: %u-%u (%1.5f > %1.5f)\n", mergePairs.at(i).id1, mergePairs.at(i).id2,
              mergedModel->savings, surfaces.at(mergePairs.at(i).id1)->savings + surfaces.at(mergePairs.at(i).id2)->savings);//[SurfaceModeling::modelSelection]  => 
 
-//       std::cerr << "surfaces.at(mergePairs.at(i).id1).indices = " << surfaces.at(mergePairs.at(i).id1)->indices.size() << std::endl;
-//       std::cerr << "surfaces.at(mergePairs.at(i).id2).indices = " << surfaces.at(mergePairs.at(i).id2)->indices.size() << std::endl;
-//       std::cerr << "mergedModel.indices = " << mergedModel->indices.size() << std::endl;
-      
-      surfaces.at(mergePairs.at(i).id1) = mergedModel;
-      surfaces.at(mergePairs.at(i).id2)->selected = false;
-      surfaces.at(mergePairs.at(i).id2)->valid = false;
-      surfaces.at(mergePairs.at(i).id2)->isNew = false;
-      surfaces.at(mergePairs.at(i).id1)->isNew = true;
-
-      addedTo.at(mergePairs.at(i).id2) = mergePairs.at(i).id1;
-
-      modifyNeighbours(mergePairs.at(i).id2,mergePairs.at(i).id1);
-      modifyBoundary(mergePairs.at(i).id2,mergePairs.at(i).id1);
+      mergeSurfaces(mergePairs.at(i).id1,mergePairs.at(i).id2,mergedModel);
 
       for(unsigned int j = i+1; j < mergePairs.size(); j++)
       {
@@ -457,10 +445,26 @@ void SurfaceModeling::modelSelection()
     }
     
   }
-//   exit(0);
   
 }
 
+/**
+ * Replace surface id1 with the merged model and invalidate id2.
+ */
+void SurfaceModeling::mergeSurfaces(int id1, int id2, SurfaceModel::Ptr mergedModel)
+{
+  surfaces.at(id1) = mergedModel;
+  surfaces.at(id2)->selected = false;
+  surfaces.at(id2)->valid = false;
+  surfaces.at(id2)->isNew = false;
+  surfaces.at(id1)->isNew = true;
+
+  addedTo.at(id2) = id1;
+
+  modifyNeighbours(id2,id1);
+  modifyBoundary(id2,id1);
+}
+
 void SurfaceModeling::mergeWithPlanes(std::vector<MergedPair> &mergePairs)
 {
   // Merge first planes
@@ -506,45 +510,105 @@ void SurfaceModeling::mergeWithPlanes(std::vector<MergedPair> &mergePairs)
   }
 }
 
-void SurfaceModeling::mergeWithNurbs(std::vector<MergedPair> &mergePairs)
+/**
+ * Pair (i,j), i < j, is considered for a NURBS merge if both surfaces are alive
+ * and i is a new patch that is not too big.
+ */
+bool SurfaceModeling::isMergeCandidate(unsigned i, unsigned j)
 {
-  // go in a parallel fashion over all neighboring pairs and put them into the stack to merge
-  #pragma omp parallel for shared(mergePairs)
+  if( (!(surfaces.at(i)->isNew)) || (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->valid)) )
+    return false;
+
+  if(surfaces.at(i)->indices.size() >= (unsigned)param.planePointsFixation)
+    return false;
+
+  return ( (surfaces.at(j)->selected) && (surfaces.at(j)->valid) );
+}
+
+/**
+ * Evaluates the pairs in parallel and queues the ones whose merge pays off.
+ * Every pair writes its own slot, the queue is filled afterwards in pair order.
+ */
+void SurfaceModeling::evaluateMergeCandidates(const std::vector<std::pair<int,int> > &pairs, MergeQueue &queue)
+{
+  std::vector<MergeCandidate> candidates(pairs.size());
+  std::vector<char> accepted(pairs.size(),0);
+
+  #pragma omp parallel for schedule(dynamic,1)
+  for(int k = 0; k < (int)pairs.size(); k++)
+  {
+    MergeCandidate &c = candidates.at(k);
+    c.id1 = pairs.at(k).first;
+    c.id2 = pairs.at(k).second;
+    c.version1 = surfaceVersion.at(c.id1);
+    c.version2 = surfaceVersion.at(c.id2);
+    accepted.at(k) = tryMergeSurfaces(surfaces.at(c.id1),surfaces.at(c.id2),c.merged,&c.separateSavings);
+    if(accepted.at(k))
+      c.savings = c.merged->savings;
+  }
+
+  for(unsigned int k = 0; k < pairs.size(); k++)
+  {
+    if(!accepted.at(k))
+      continue;
+
+    cout << "Merge candidates: " << candidates.at(k).id1 << "-" << candidates.at(k).id2 << endl;
+    queue.push(candidates.at(k));
+  }
+}
+
+/**
+ * Greedy NURBS merging: candidate merges are kept in a priority queue keyed by the
+ * savings of the merged surface, together with the fitted model. A merge only changes
+ * the pairs touching the two merged surfaces, so those are re-evaluated and all other
+ * queued results stay valid. Queued results of modified surfaces are recognised by the
+ * surface versions and dropped when they come up.
+ */
+void SurfaceModeling::mergeWithNurbs()
+{
+  surfaceVersion.assign(surfaces.size(),0);
+
+  std::vector<std::pair<int,int> > pairs;
   for(unsigned int i = 0; i < surfaces.size(); i++) 
   {
-    // if surface is valid and selected
-    if( (surfaces.at(i)->isNew) && (surfaces.at(i)->selected) && (surfaces.at(i)->valid) )
+    for(std::set<unsigned>::iterator itr = surfaces.at(i)->neighbors3D.begin(); itr != surfaces.at(i)->neighbors3D.end(); itr++) 
     {
-      // if patch is not too big
-      if(surfaces.at(i)->indices.size() < (unsigned)param.planePointsFixation) 
-      {
-        // go over all neighbors and merge if necessary
-	for(std::set<unsigned>::iterator itr = surfaces.at(i)->neighbors3D.begin(); itr != surfaces.at(i)->neighbors3D.end(); itr++) 
-	{
-          if( (!(surfaces.at(*itr)->selected)) || (!(surfaces.at(*itr)->valid)) )
-	    continue;
-	    
-	  // pair (i,j) where i < j ALWAYS!
-	  if( (*itr) > i ) 
-	  {
-            SurfaceModel::Ptr mergedModel;
-            if( tryMergeSurfaces(surfaces.at(i),surfaces.at(*itr),mergedModel) )
-	    {
-              MergedPair m;
-              m.id1 = i;
-              m.id2 = *itr;
-              m.savings = mergedModel->savings;
-
-              #pragma omp critical
-              {
-                mergePairs.push_back(m);
-		cout << "Merge candidates: " << m.id1 << "-" << m.id2 << endl;
-              }
-            }
-          }
-        }
-      }
+      // pair (i,j) where i < j ALWAYS!
+      if( ((*itr) > i) && isMergeCandidate(i,*itr) )
+        pairs.push_back(std::make_pair((int)i,(int)(*itr)));
+    }
+  }
+
+  MergeQueue queue;
+  evaluateMergeCandidates(pairs,queue);
+
+  while(!queue.empty())
+  {
+    MergeCandidate c = queue.top();
+    queue.pop();
+
+    // one of the surfaces changed since the merge was evaluated
+    if( (c.version1 != surfaceVersion.at(c.id1)) || (c.version2 != surfaceVersion.at(c.id2)) ||
+        (!(surfaces.at(c.id1)->valid)) || (!(surfaces.at(c.id2)->valid)) )
+      continue;
+
+    printf("MERGED: %u-%u (%1.5f > %1.5f)\n", c.id1, c.id2, c.savings, c.separateSavings);//[SurfaceModeling::modelSelection]  => 
+
+    mergeSurfaces(c.id1,c.id2,c.merged);
+    surfaceVersion.at(c.id1)++;
+    surfaceVersion.at(c.id2)++;
+
+    // the neighbours of id2 are now neighbours of id1
+    pairs.clear();
+    for(std::set<unsigned>::iterator itr = surfaces.at(c.id1)->neighbors3D.begin(); itr != surfaces.at(c.id1)->neighbors3D.end(); itr++)
+    {
+      int i = std::min(c.id1,(int)(*itr));
+      int j = std::max(c.id1,(int)(*itr));
+      if( (i != j) && isMergeCandidate(i,j) )
+        pairs.push_back(std::make_pair(i,j));
     }
+
+    evaluateMergeCandidates(pairs,queue);
   }
 }
 
@@ -33,6 +33,7 @@
 #define SURFACE_SURFACEMODELING_HH
 
 #include <iostream>
+#include <queue>
 #include <opencv2/opencv.hpp>
 
 #include <pcl/point_cloud.h>
@@ -73,6 +74,30 @@ bool cmpSavings(const MergedPair &a, const MergedPair &b)
 {
   return (a.savings > b.savings);
 }
+
+struct MergeCandidate
+{
+  int id1, id2;
+  double savings;               // savings of the merged surface
+  double separateSavings;       // savings of id1 and id2 before merging
+  unsigned version1, version2;  // surface versions the merge was evaluated with
+  SurfaceModel::Ptr merged;
+};
+
+// best savings first, ties broken by the pair ids to keep the merge order deterministic
+struct CmpMergeCandidate
+{
+  bool operator()(const MergeCandidate &a, const MergeCandidate &b) const
+  {
+    if(a.savings != b.savings)
+      return (a.savings < b.savings);
+    if(a.id1 != b.id1)
+      return (a.id1 > b.id1);
+    return (a.id2 > b.id2);
+  }
+};
+
+typedef std::priority_queue<MergeCandidate, std::vector<MergeCandidate>, CmpMergeCandidate> MergeQueue;
   
 class SurfaceModeling: public EPBase
 {
@@ -92,11 +117,13 @@ public:
     double bspline_savings;   
     int planePointsFixation;  // classified planes will not be merged with b-splines anymore (5000 for 640x480)
     double z_max;             // Maximum z-value for 3D neighborhood
+    bool warmStartMerge;      // fit merged NURBS starting from the larger surface instead of from scratch (faster, results differ slightly)
 
     Parameter(pcl::on_nurbs::SequentialFitter::Parameter nurbs=pcl::on_nurbs::SequentialFitter::Parameter(),
-       double _sigmaError=0.003, double _kappa1=0.003, double _kappa2=0.9, int _pPF=5000, double _z_max=0.01)
+       double _sigmaError=0.003, double _kappa1=0.003, double _kappa2=0.9, int _pPF=5000, double _z_max=0.01,
+       bool _warmStartMerge=false)
      : nurbsParams(nurbs), sigmaError(_sigmaError),
-       kappa1(_kappa1), kappa2(_kappa2), planePointsFixation(_pPF), z_max(_z_max) {}
+       kappa1(_kappa1), kappa2(_kappa2), planePointsFixation(_pPF), z_max(_z_max), warmStartMerge(_warmStartMerge) {}
   };
 
 private:
@@ -119,6 +146,8 @@ private:
   int minSurfaceSize;
 
   std::vector<int> addedTo;
+  // incremented whenever a surface takes part in a merge, invalidates queued merge results
+  std::vector<unsigned> surfaceVersion;
   
   //inits all necessary data structures
   void init();
@@ -128,12 +157,13 @@ private:
   void computeLeastSquarePlane(SurfaceModel::Ptr plane);
   // fits plane to the patch
   void fitPlane(SurfaceModel::Ptr plane);
-  // fits NURBS to the plane
-  void fitNurbs(SurfaceModel::Ptr model);
+  // fits NURBS to the plane, optionally starting from an existing surface
+  void fitNurbs(SurfaceModel::Ptr model, const ON_NurbsSurface *initialNurbs = 0);
   // replace a model with a NURBS if savings are better
   bool replacePlaneWithBetterNurbs(SurfaceModel::Ptr &surf);
   //merges two models if savings are better
-  bool tryMergeSurfaces(SurfaceModel::Ptr surf1, SurfaceModel::Ptr surf2, SurfaceModel::Ptr &mergedSurf);
+  bool tryMergeSurfaces(SurfaceModel::Ptr surf1, SurfaceModel::Ptr surf2, SurfaceModel::Ptr &mergedSurf,
+                        double *separateSavings = 0);
   bool tryMergeSurfacesWithPlanes(SurfaceModel::Ptr surf1, SurfaceModel::Ptr surf2, SurfaceModel::Ptr &mergedSurf);
   //selects the best model for the patch (plane or NURBS) and merges neigboring pathces if there is a benefit
   void modelSelection();
@@ -142,8 +172,14 @@ private:
   //computes errors for each point in the patch and probabilities to belong to the plane
   void initSurface(SurfaceModel::Ptr surface);
   //merge planes using nurbs
-  void mergeWithNurbs(std::vector<MergedPair> &mergePairs);
+  void mergeWithNurbs();
   void mergeWithPlanes(std::vector<MergedPair> &mergePairs);
+  //checks if pair (i,j), i < j, may be merged with nurbs
+  bool isMergeCandidate(unsigned i, unsigned j);
+  //fits merged nurbs for the pairs and queues the beneficial ones
+  void evaluateMergeCandidates(const std::vector<std::pair<int,int> > &pairs, MergeQueue &queue);
+  //replaces surface id1 with the merged model and removes id2
+  void mergeSurfaces(int id1, int id2, SurfaceModel::Ptr mergedModel);
   //modify neighbors
   void modifyNeighbours(int oldIdx, int newIdx);
   //remove neighbors
@@ -106,6 +106,9 @@ public:
   /** Compare surfaces with gabor filter **/
   double compare(Gabor::Ptr g);
   
+  int getOrientationsNumber() {return N;};
+  int getFiltersNumber() {return filtersNumber;};
+  
   std::vector<double> featureVector;
   
   int max_ori_nr;
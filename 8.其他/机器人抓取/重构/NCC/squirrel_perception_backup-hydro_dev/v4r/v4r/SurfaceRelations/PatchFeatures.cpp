@@ -0,0 +1,391 @@
+/**
+ *  Copyright (C) 2012
+ *    Ekaterina Potapova, Andreas Richtsfeld, Johann Prankl, Thomas Mörwald, Michael Zillich
+ *    Automation and Control Institute
+ *    Vienna University of Technology
+ *    Gusshausstraße 25-29
+ *    1170 Vienna, Austria
+ *    ari(at)acin.tuwien.ac.at
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @file PatchFeatures.cpp
+ * @date October 2026
+ * @version 0.1
+ * @brief Per patch color histogram, texture, fourier and gabor features, computed in one pass.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "PatchFeatures.h"
+
+namespace surface
+{
+
+/************************************************************************************
+ * Constructor/Destructor
+ */
+
+PatchFeatures::PatchFeatures()
+{
+  nrPatches = 0;
+  width = height = 0;
+
+  nrHistBins = 4;
+  UVthreshold = 0.;
+  maxVal = 255.;
+  histSize = nrHistBins*nrHistBins*nrHistBins;
+
+  N = 8;
+  kmax = 5;
+  nbins = 8;
+  binWidth = 32;
+  binStretch = 2;
+  fourierSize = (kmax-1)*nbins;
+
+  en_r.resize(kmax*N);
+  en_i.resize(kmax*N);
+  for(int k = 0; k < kmax; k++)
+  {
+    for(int n = 0; n < N; n++)
+    {
+      en_r[k*N+n] = cos(-2*M_PI/N * k*n);
+      en_i[k*N+n] = sin(-2*M_PI/N * k*n);
+    }
+  }
+
+  gaborOrientations = 0;
+  gaborScales = 0;
+  filtersNumber = 0;
+
+  clearInputs();
+}
+
+PatchFeatures::~PatchFeatures()
+{
+}
+
+void PatchFeatures::setInputCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr _cloud)
+{
+  if ( (_cloud->height<=1) || (_cloud->width<=1) || (!_cloud->isOrganized()) )
+    throw std::runtime_error("[PatchFeatures::setInputCloud] Invalid point cloud (height must be > 1)");
+
+  cloud = _cloud;
+  width = cloud->width;
+  height = cloud->height;
+  have_cloud = true;
+}
+
+void PatchFeatures::setInputEdges(cv::Mat &_edges)
+{
+  if ( (_edges.cols<=0) || (_edges.rows<=0) )
+    throw std::runtime_error("[PatchFeatures::setInputEdges] Invalid image (height|width must be > 1)");
+
+  if ( _edges.type() != CV_8UC1 )
+    throw std::runtime_error("[PatchFeatures::setInputEdges] Invalid image type (must be 8UC1)");
+
+  edges = _edges;
+  width = edges.cols;
+  height = edges.rows;
+  have_edges = true;
+}
+
+void PatchFeatures::setInputImage(cv::Mat &_image)
+{
+  if ( (_image.cols<=0) || (_image.rows<=0) )
+    throw std::runtime_error("[PatchFeatures::setInputImage] Invalid image (height|width must be > 1)");
+
+  if ( _image.type() != CV_8UC1 )
+    throw std::runtime_error("[PatchFeatures::setInputImage] Invalid image type (must be 8UC1)");
+
+  image = _image;
+  width = image.cols;
+  height = image.rows;
+  have_image = true;
+}
+
+void PatchFeatures::setGaborFilters(const std::vector<cv::Mat> &_gaborFilters, int _orientations)
+{
+  if( (_orientations <= 0) || (_gaborFilters.size() == 0) || ((_gaborFilters.size() % _orientations) != 0) )
+    throw std::runtime_error("[PatchFeatures::setGaborFilters] Number of filters is not a multiple of the orientations");
+
+  gaborFilters = _gaborFilters;
+  have_gabor = true;
+
+  // rows computed with a different filter bank cannot be compared
+  if( (filtersNumber != (int) gaborFilters.size()) || (gaborOrientations != _orientations) )
+  {
+    gaborOrientations = _orientations;
+    filtersNumber = gaborFilters.size();
+    gaborScales = filtersNumber/gaborOrientations;
+    gaborFeatures.assign(nrPatches*2*filtersNumber,0.);
+    gaborMaxOri.assign(nrPatches,0.);
+    computed.assign(nrPatches,0);
+  }
+}
+
+void PatchFeatures::clearInputs()
+{
+  have_cloud = false;
+  have_edges = false;
+  have_image = false;
+  have_gabor = false;
+}
+
+void PatchFeatures::resize(int _nrPatches)
+{
+  nrPatches = _nrPatches;
+  hist.resize(nrPatches*histSize,0.);
+  textureRate.resize(nrPatches,0.);
+  fourierBins.resize(nrPatches*fourierSize,0.);
+  gaborFeatures.resize(nrPatches*2*filtersNumber,0.);
+  gaborMaxOri.resize(nrPatches,0.);
+  computed.resize(nrPatches,0);
+}
+
+void PatchFeatures::compute(int patch, const std::vector<int> &indices)
+{
+  int n = indices.size();
+
+  double *h = &hist[patch*histSize];
+  double *fb = &fourierBins[patch*fourierSize];
+  std::fill(h,h+histSize,0.);
+  std::fill(fb,fb+fourierSize,0.);
+
+  std::vector<double> gaborSum(filtersNumber,0.);
+  std::vector<double> gaborSqrSum(filtersNumber,0.);
+
+  int noCol = 0;
+  int texArea = 0;
+
+  for(int idx = 0; idx < n; idx++)
+  {
+    int i = indices[idx] / width;
+    int j = indices[idx] % width;
+
+    if(have_cloud)
+    {
+      pclA::RGBValue color;
+      color.float_value = cloud->points[indices[idx]].rgb;
+
+      int Y =  (0.257 * color.r) + (0.504 * color.g) + (0.098 * color.b) + 16;
+      int U = -(0.148 * color.r) - (0.291 * color.g) + (0.439 * color.b) + 128;
+      int V =  (0.439 * color.r) - (0.368 * color.g) - (0.071 * color.b) + 128;
+
+      int U2 = U-128;
+      int V2 = V-128;
+      if((U2*U2 + V2*V2) < UVthreshold)
+      {
+        noCol++;
+      }
+      else
+      {
+        int yBin = Y*(double)nrHistBins/maxVal;
+        int uBin = U*(double)nrHistBins/maxVal;
+        int vBin = V*(double)nrHistBins/maxVal;
+        h[(yBin*nrHistBins + uBin)*nrHistBins + vBin] += 1;
+      }
+    }
+
+    if(have_edges)
+    {
+      if(edges.at<uchar>(i,j) == 255)
+        texArea++;
+    }
+
+    if(have_image)
+    {
+      // border pixels have a zero magnitude for all coefficients
+      if( ((i-1) < 0) || ((i+1) >= height) || ((j-1) < 0) || ((j+1) >= width) )
+      {
+        for(int k = 1; k < kmax; k++)
+          fb[(k-1)*nbins] += 1;
+      }
+      else
+      {
+        double x[8];
+        x[0] = (double) image.at<uchar>(i,  j+1);
+        x[1] = (double) image.at<uchar>(i-1,j+1);
+        x[2] = (double) image.at<uchar>(i-1,j);
+        x[3] = (double) image.at<uchar>(i-1,j-1);
+        x[4] = (double) image.at<uchar>(i,  j-1);
+        x[5] = (double) image.at<uchar>(i+1,j-1);
+        x[6] = (double) image.at<uchar>(i+1,j);
+        x[7] = (double) image.at<uchar>(i+1,j+1);
+
+        for(int k = 1; k < kmax; k++)
+        {
+          double SX_r = 0.;
+          double SX_i = 0.;
+          for(int m = 0; m < N; m++)
+          {
+            SX_r += x[m]*en_r[k*N+m];
+            SX_i += x[m]*en_i[k*N+m];
+          }
+          double mag = sqrt(SX_r*SX_r + SX_i*SX_i) / ((double) N);
+          uchar Xk = (uchar) ((int) mag);
+
+          int bin = (int) (Xk/((double) binWidth/(binStretch+(6*k))));
+          if(bin >= nbins)
+            bin = nbins-1;
+          fb[(k-1)*nbins + bin] += 1;
+        }
+      }
+    }
+
+    if(have_gabor)
+    {
+      for(int fi = 0; fi < filtersNumber; fi++)
+      {
+        double v = (double) gaborFilters[fi].at<char>(i,j);
+        gaborSum[fi] += v;
+        gaborSqrSum[fi] += v*v;
+      }
+    }
+  }
+
+  double normalization = n - noCol;
+  for(int b = 0; b < histSize; b++)
+    h[b] = (normalization != 0 ? h[b]/normalization : 0.);
+
+  textureRate[patch] = (n > 0 ? (double)texArea / n : 0.);
+
+  double fourierNormalization = ((double)n*(kmax-1));
+  for(int b = 0; b < fourierSize; b++)
+    fb[b] /= fourierNormalization;
+
+  if(have_gabor)
+    computeGaborFeatures(patch,gaborSum,gaborSqrSum,n);
+
+  computed[patch] = 1;
+}
+
+void PatchFeatures::computeGaborFeatures(int patch, const std::vector<double> &sum, const std::vector<double> &sqr_sum, int n)
+{
+  double *f = &gaborFeatures[patch*2*filtersNumber];
+
+  // mean and deviation run over the filters as in Gabor::compute(), trained models depend on it
+  double mean = 0.;
+  for(int fi = 0; fi < filtersNumber; fi++)
+  {
+    mean = (mean + sum[fi]) / ((double) n);
+    f[2*fi] = mean;
+  }
+
+  double stddev = 0.;
+  for(int fi = 0; fi < filtersNumber; fi++)
+  {
+    // sum((x-mean)^2) from the sums of the responses
+    double sqr_dev = sqr_sum[fi] - 2.*mean*sum[fi] + n*mean*mean;
+    stddev = sqrt((stddev + sqr_dev) / ((double) (n-1)));
+    f[2*fi+1] = stddev;
+  }
+
+  // orientation with highest energy
+  int max_ori_nr = 0;
+  double max_ori = 0.;
+  for(int ori = 0; ori < gaborOrientations; ori++)
+  {
+    double ori_mag_sum = 0.;
+    for(int scale = 0; scale < gaborScales; scale++)
+      ori_mag_sum += f[2*(ori*gaborScales + scale)];
+
+    if(ori_mag_sum > max_ori)
+    {
+      max_ori = ori_mag_sum;
+      max_ori_nr = ori;
+    }
+  }
+  gaborMaxOri[patch] = max_ori;
+
+  // shift, when orientation is different
+  if(max_ori_nr != 0)
+    std::rotate(f,f+2*(max_ori_nr*gaborScales),f+2*filtersNumber);
+}
+
+double PatchFeatures::compareColor(int p0, int p1) const
+{
+  if(!computed[p0] || !computed[p1])
+  {
+    printf("[PatchFeatures::compareColor]: Error: Features not computed.\n");
+    return 0.;
+  }
+
+  // Fidelity d=(SUM(sqrt(Pi*Qi)))
+  const double *h0 = &hist[p0*histSize];
+  const double *h1 = &hist[p1*histSize];
+  double overall_sum = 0.;
+  for(int b = 0; b < histSize; b++)
+    overall_sum += sqrt(h0[b]*h1[b]);
+
+  return overall_sum;
+}
+
+double PatchFeatures::compareTexture(int p0, int p1) const
+{
+  if(!computed[p0] || !computed[p1])
+  {
+    printf("[PatchFeatures::compareTexture]: Error: Features not computed.\n");
+    return 0.;
+  }
+
+  return 1. - fabs(textureRate[p0] - textureRate[p1]);
+}
+
+double PatchFeatures::compareFourier(int p0, int p1) const
+{
+  if(!computed[p0] || !computed[p1])
+  {
+    printf("[PatchFeatures::compareFourier]: Error: Features not computed.\n");
+    return 0.;
+  }
+
+  const double *b0 = &fourierBins[p0*fourierSize];
+  const double *b1 = &fourierBins[p1*fourierSize];
+  double fidelity = 0.;
+  for(int b = 0; b < fourierSize; b++)
+    fidelity += sqrt(b0[b]*b1[b]);
+
+  return fidelity;
+}
+
+double PatchFeatures::compareGabor(int p0, int p1) const
+{
+  if(!computed[p0] || !computed[p1])
+  {
+    printf("[PatchFeatures::compareGabor]: Error: Features not computed.\n");
+    return 0.;
+  }
+
+  // sqrt((mu_n-mu_m)² + (si_n-si_m)²), normalised by the maximum energy in one orientation
+  const double *f0 = &gaborFeatures[p0*2*filtersNumber];
+  const double *f1 = &gaborFeatures[p1*2*filtersNumber];
+  double gabor_distance = 0.;
+  for(int idx = 0; idx < 2*filtersNumber; idx += 2)
+  {
+    double mu = f0[idx] - f1[idx];
+    double sig = f0[idx+1] - f1[idx+1];
+    gabor_distance += sqrt(mu*mu + sig*sig);
+  }
+
+  double norm_energy = fmax(gaborMaxOri[p0], gaborMaxOri[p1]);
+  if(norm_energy > 0)
+    return gabor_distance/norm_energy;
+
+  return 0.;
+}
+
+} // end surface
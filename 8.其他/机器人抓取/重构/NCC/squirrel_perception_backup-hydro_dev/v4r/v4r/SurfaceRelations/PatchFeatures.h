@@ -0,0 +1,136 @@
+/**
+ *  Copyright (C) 2012
+ *    Ekaterina Potapova, Andreas Richtsfeld, Johann Prankl, Thomas Mörwald, Michael Zillich
+ *    Automation and Control Institute
+ *    Vienna University of Technology
+ *    Gusshausstraße 25-29
+ *    1170 Vienna, Austria
+ *    ari(at)acin.tuwien.ac.at
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @file PatchFeatures.h
+ * @date October 2026
+ * @version 0.1
+ * @brief Per patch color histogram, texture, fourier and gabor features, computed in one pass.
+ */
+
+#ifndef SURFACE_PATCH_FEATURES_H
+#define SURFACE_PATCH_FEATURES_H
+
+#include <vector>
+#include <stdio.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "v4r/PCLAddOns/PCLUtils.h"
+
+namespace surface
+{
+
+/**
+ * @brief Class PatchFeatures
+ * Computes the features of ColorHistogram (3D YUV), Texture, Fourier and Gabor for all
+ * patches of a frame. Each patch is visited once and all features are accumulated in the
+ * same pass; results are kept in flat buffers with one row per patch (indexed by patch id),
+ * so nothing is allocated per patch and pairs are compared on contiguous rows.
+ * The features and the comparisons give the same values as the single feature classes.
+ */
+class PatchFeatures
+{
+public:
+  typedef boost::shared_ptr<PatchFeatures> Ptr;
+
+private:
+  int nrPatches;
+
+  bool have_cloud;
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;
+  bool have_edges;
+  cv::Mat edges;
+  bool have_image;
+  cv::Mat image;
+  bool have_gabor;
+  std::vector<cv::Mat> gaborFilters;
+
+  int width, height;
+
+  // color histogram (see ColorHistogram, HIST_3D and YUV_MODEL)
+  int nrHistBins;
+  double UVthreshold;
+  double maxVal;
+  int histSize;
+  std::vector<double> hist;                  ///< nrPatches x histSize
+
+  // texture (see Texture)
+  std::vector<double> textureRate;           ///< nrPatches
+
+  // fourier (see Fourier), only coefficients k > 0 are used for comparison
+  int N;
+  int kmax;
+  int nbins;
+  int binWidth;
+  int binStretch;
+  int fourierSize;
+  std::vector<double> en_r, en_i;            ///< kmax x N
+  std::vector<double> fourierBins;           ///< nrPatches x fourierSize
+
+  // gabor (see Gabor)
+  int gaborOrientations;
+  int gaborScales;
+  int filtersNumber;
+  std::vector<double> gaborFeatures;         ///< nrPatches x 2*filtersNumber
+  std::vector<double> gaborMaxOri;           ///< nrPatches
+
+  std::vector<unsigned char> computed;       ///< nrPatches
+
+  void computeGaborFeatures(int patch, const std::vector<double> &sum, const std::vector<double> &sqr_sum, int n);
+
+public:
+
+  PatchFeatures();
+  ~PatchFeatures();
+
+  /** Set the point cloud for the color histograms **/
+  void setInputCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr _cloud);
+  /** Set the canny edge image for the texture rate **/
+  void setInputEdges(cv::Mat &_edges);
+  /** Set the gray level image for the fourier features **/
+  void setInputImage(cv::Mat &_image);
+  /** Set the gabor filter responses (Gabor::gaborFilters) and the number of orientations **/
+  void setGaborFilters(const std::vector<cv::Mat> &_gaborFilters, int _orientations);
+  /** Drop all inputs **/
+  void clearInputs();
+
+  /** Set number of patches, rows of existing patches are kept **/
+  void resize(int _nrPatches);
+  int size() {return nrPatches;};
+
+  /** Compute the features of patch from its indices **/
+  void compute(int patch, const std::vector<int> &indices);
+  bool getComputed(int patch) {return computed[patch] != 0;};
+
+  /** Compare patches, same values as ColorHistogram/Texture/Fourier/Gabor::compare() **/
+  double compareColor(int p0, int p1) const;
+  double compareTexture(int p0, int p1) const;
+  double compareFourier(int p0, int p1) const;
+  double compareGabor(int p0, int p1) const;
+};
+
+}
+
+#endif
+
@@ -97,19 +97,25 @@ void StructuralRelations::init()
   cv::blur(gray_image, edges, cv::Size(3,3));
   cv::Canny(edges, edges, lowThreshold, highThreshold, kernel_size);
 
+  features.clearInputs();
+  features.resize(surfaces.size());
+
+  kept.clear();
+  keptRelations.clear();
+
   if(usedRelations & R_COS)
   {
-    hist.resize(surfaces.size());
+    features.setInputCloud(cloud);
   }
   
   if(usedRelations & R_TR)
   {
-    text.resize(surfaces.size());
+    features.setInputEdges(edges);
   }
   
   if(usedRelations & R_FS)
   {
-    fourier.resize(surfaces.size());
+    features.setInputImage(gray_image2); //gray_image
   }
   
   if(usedRelations & R_GS)
@@ -118,7 +124,7 @@ void StructuralRelations::init()
     permanentGabor->setInputImage(gray_image2); //gray_image
     permanentGabor->computeGaborFilters();
     
-    gabor.resize(surfaces.size());
+    features.setGaborFilters(permanentGabor->gaborFilters,permanentGabor->getOrientationsNumber());
   }
 
   initialized = true;
@@ -160,6 +166,18 @@ void StructuralRelations::setUsedRelations(int _usedRelations)
   usedRelations = _usedRelations;
 }
 
+void StructuralRelations::setKeptRelations(const std::vector<bool> &_kept, const std::vector<Relation> &_relations)
+{
+  kept = _kept;
+  keptRelations.clear();
+  for(unsigned int i = 0; i < _relations.size(); ++i)
+  {
+    int p0 = std::min(_relations.at(i).id_0,_relations.at(i).id_1);
+    int p1 = std::max(_relations.at(i).id_0,_relations.at(i).id_1);
+    keptRelations[std::make_pair(p0,p1)] = _relations.at(i);
+  }
+}
+
 //
 void StructuralRelations::setSurfaces(const std::vector<SurfaceModel::Ptr> _surfaces)
 {
@@ -192,7 +210,7 @@ void StructuralRelations::projectPts2Model()
   for(unsigned int i = 0; i < surfaces.size(); i++)
   {
 
-    if(!(surfaces.at(i)->isNew))
+    if( (!(surfaces.at(i)->isNew)) || (!(needsUpdate.at(i))) )
       continue;
 
     if((surfaces.at(i)->type == pcl::SACMODEL_PLANE) && (surfaces.at(i)->coeffs.size() == 4))
@@ -224,97 +242,48 @@ void StructuralRelations::compute()
     throw std::runtime_error(error_message);
   }
   
-  projectPts2Model();
-  
-  if(usedRelations & R_COS)
+  // a kept surface needs its projected points and features only if it borders a surface that is not kept
+  bool haveKept = (kept.size() == surfaces.size());
+  needsUpdate.assign(surfaces.size(),true);
+  if(haveKept)
   {
-  
-    #pragma omp parallel for
     for(unsigned int i = 0; i < surfaces.size(); i++)
-    {
-      int nrHistBins = 4;
-      double uvThreshold = 0.0f;
+      needsUpdate.at(i) = !(kept.at(i));
 
-      if( (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->isNew)) )
-      {
-        continue;
-      }
-      
-      hist.at(i).reset( new ColorHistogram(nrHistBins,uvThreshold) );
-
-      hist.at(i)->setInputCloud(cloud);
-      hist.at(i)->setIndices(surfaces.at(i)->indices);
-      hist.at(i)->compute();
-    }
-  }
-
-  if(usedRelations & R_TR)
-  {
-    #pragma omp parallel for
-    for(unsigned int i = 0; i < surfaces.size(); i++)
-    {
-      if( (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->isNew)) )
-      {
-        continue;
-      }
-      
-      text.at(i).reset( new Texture() );
-
-      text.at(i)->setInputEdges(edges);
-      text.at(i)->setIndices(surfaces.at(i)->indices);
-
-      text.at(i)->compute();
-    }
-  }
-
-  if(usedRelations & R_FS)
-  {
-    #pragma omp parallel for
-    for(unsigned int i = 0; i < surfaces.size(); i++)
+    std::map<borderIdentification,std::vector<neighboringPair> >::iterator it;
+    for(it = ngbr3D_map.begin(); it != ngbr3D_map.end(); ++it)
     {
-      if( (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->isNew)) )
-      {
+      int p1 = it->first.p1;
+      int p2 = it->first.p2;
+      if( (p1 < 0) || (p2 < 0) || (p1 >= (int)surfaces.size()) || (p2 >= (int)surfaces.size()) )
         continue;
-      }
-      
-      fourier.at(i).reset( new Fourier() );
-
-      fourier.at(i)->setInputImage(gray_image2); //gray_image
-      fourier.at(i)->setIndices(surfaces.at(i)->indices);
-
-      fourier.at(i)->compute();
+      if( (!(kept.at(p1))) || (!(kept.at(p2))) )
+        needsUpdate.at(p1) = needsUpdate.at(p2) = true;
     }
   }
 
-  if(usedRelations & R_GS)
+  projectPts2Model();
+  
+  // all features of a surface in one pass over its points
+  if(usedRelations & (R_COS | R_TR | R_FS | R_GS))
   {
-
-    Gabor::Ptr permanentGabor2 = permanentGabor;
-    
-//     Gabor::Ptr permanentGabor;
-//     permanentGabor.reset( new Gabor() );
-//     permanentGabor->setInputImage(gray_image2); //gray_image
-//     permanentGabor->computeGaborFilters();
-
-    #pragma omp parallel for shared(permanentGabor2)
+    #pragma omp parallel for schedule(dynamic)
     for(unsigned int i = 0; i < surfaces.size(); i++)
     {
-      if( (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->isNew)) )
+      if( (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->isNew)) || (!(needsUpdate.at(i))) )
       {
         continue;
       }
       
-      gabor.at(i).reset( new Gabor() );
-      *(gabor.at(i)) = *permanentGabor2;
-
-      gabor.at(i)->setIndices(surfaces.at(i)->indices);
-
-      gabor.at(i)->compute();
+      features.compute(i,surfaces.at(i)->indices);
     }
   }
 
-  validRelations.clear();
-  #pragma omp parallel for
+  // relations are scored in place, valid ones are collected afterwards in relation order
+  std::vector<unsigned char> isValid(surfaceRelations.size(),0);
+  std::vector<neighboringPair> noBoundary;
+  
+  #pragma omp parallel for schedule(dynamic,16)
   for(unsigned int i = 0; i < surfaceRelations.size(); ++i)
   {   
     int p0 = surfaceRelations.at(i).id_0;
@@ -343,42 +312,55 @@ void StructuralRelations::compute()
       surfaceRelations.at(i).valid = false;
       continue;
     }
+
+    if( haveKept && kept.at(p0) && kept.at(p1) )
+    {
+      std::map<std::pair<int,int>,Relation>::const_iterator itKept = keptRelations.find(std::make_pair(p0,p1));
+      if( (itKept != keptRelations.end()) && (itKept->second.valid) )
+      {
+        surfaceRelations.at(i).rel_value = itKept->second.rel_value;
+        surfaceRelations.at(i).prediction = itKept->second.prediction;
+        surfaceRelations.at(i).rel_probability = itKept->second.rel_probability;
+        surfaceRelations.at(i).valid = true;
+        isValid.at(i) = 1;
+      }
+      else
+      {
+        surfaceRelations.at(i).valid = false;
+      }
+      continue;
+    }
     
     if( (!(surfaces.at(p0)->isNew)) && (!(surfaces.at(p1)->isNew)) )
     {
 //       std::cerr << "Attention! " << p0 << " and " << p1 << std::endl;
       if(surfaceRelations.at(i).valid)
       {
-#pragma omp critical
-{
-	validRelations.push_back(surfaceRelations.at(i));
-}
+        isValid.at(i) = 1;
         continue;
       }
     }
     
-    // current neighbours border
-    std::vector<neighboringPair> currentNeigboringBoundary3D;// = ngbr3D.at(p0).at(p1);
-
     borderIdentification borderId;
     // p1 < p2 ALWAYS!!!
     borderId.p1 = (p0 < p1 ? p0 : p1);
     borderId.p2 = (p0 < p1 ? p1 : p0);
 
+    // current neighbours border, the maps are only read here
+    std::vector<neighboringPair> *currentNeigboringBoundary3D = &noBoundary;
     std::map<borderIdentification,std::vector<neighboringPair> >::iterator it3D; //,borderCompare
     it3D = ngbr3D_map.find(borderId);
     if(it3D != ngbr3D_map.end())
-      currentNeigboringBoundary3D = it3D->second;
+      currentNeigboringBoundary3D = &(it3D->second);
   
-    std::vector<neighboringPair> currentNeigboringBoundary2D;// = ngbr2D.at(p0).at(p1);
-
+    std::vector<neighboringPair> *currentNeigboringBoundary2D = &noBoundary;
     std::map<borderIdentification,std::vector<neighboringPair> >::iterator it2D; //,borderCompare
     it2D = ngbr2D_map.find(borderId);
     if(it2D != ngbr2D_map.end())
-      currentNeigboringBoundary2D = it2D->second;
+      currentNeigboringBoundary2D = &(it2D->second);
       
       //@ep: if there are no border in 3D it means there is no real connection between pixels, right?
-      if(currentNeigboringBoundary3D.size() > 0)
+      if(currentNeigboringBoundary3D->size() > 0)
       {
         
         Relation r = surfaceRelations.at(i);
@@ -386,25 +368,25 @@ void StructuralRelations::compute()
         
         if(usedRelations & R_COS)
         {
-          double colorSimilarity = hist.at(p0)->compare(hist.at(p1));
+          double colorSimilarity = features.compareColor(p0,p1);
           r.rel_value.push_back(colorSimilarity);           // r_co ... color similarity (histogram) of the patch
         }
 
         if(usedRelations & R_TR)
         {
-          double textureRate = text.at(p0)->compare(text.at(p1));
+          double textureRate = features.compareTexture(p0,p1);
           r.rel_value.push_back(textureRate);               // r_tr ... difference of texture rate
         }
 
         if(usedRelations & R_GS)
         {
-          double gaborRate = gabor.at(p0)->compare(gabor.at(p1));
+          double gaborRate = features.compareGabor(p0,p1);
           r.rel_value.push_back(gaborRate);                 // r_ga ... Gabor similarity of patch texture
         }
 
         if(usedRelations & R_FS)
         {
-          double fourierRate = fourier.at(p0)->compare(fourier.at(p1));
+          double fourierRate = features.compareFourier(p0,p1);
           r.rel_value.push_back(fourierRate);               // r_fo ... Fourier similarity of patch texture
         }
         
@@ -419,7 +401,7 @@ void StructuralRelations::compute()
         {
 	  BoundaryRelationsMeanColor::Ptr meanColor( new BoundaryRelationsMeanColor() );
 	  meanColor->setInputCloud(cloud_model);
-          meanColor->setBoundary(currentNeigboringBoundary3D/*ngbr3D.at(p0).at(p1)*/);
+          meanColor->setBoundary(*currentNeigboringBoundary3D/*ngbr3D.at(p0).at(p1)*/);
 	  surface::meanVal meanColorVal = meanColor->compute();
           r.rel_value.push_back(1.-meanColorVal.mean);      // r_co3 ... color similarity on 3D border
         }
@@ -429,7 +411,7 @@ void StructuralRelations::compute()
         {
           BoundaryRelationsMeanCurvature::Ptr meanCurvature( new BoundaryRelationsMeanCurvature() );
           meanCurvature->setInputCloud(cloud_model);
-          meanCurvature->setBoundary(currentNeigboringBoundary3D/*ngbr3D.at(p0).at(p1)*/);
+          meanCurvature->setBoundary(*currentNeigboringBoundary3D/*ngbr3D.at(p0).at(p1)*/);
 	  meanCurvature->setNormals(normals);
 	  meanCurvatureVal = meanCurvature->compute();
         }
@@ -443,7 +425,7 @@ void StructuralRelations::compute()
         {
           BoundaryRelationsMeanDepth::Ptr meanDepth( new BoundaryRelationsMeanDepth() );
           meanDepth->setInputCloud(cloud_model);
-          meanDepth->setBoundary(currentNeigboringBoundary2D/*ngbr2D.at(p0).at(p1)*/);
+          meanDepth->setBoundary(*currentNeigboringBoundary2D/*ngbr2D.at(p0).at(p1)*/);
           surface::meanVal meanDepthVal = meanDepth->compute();
 
           if(usedRelations & R_DM2)
@@ -459,35 +441,28 @@ void StructuralRelations::compute()
         if(usedRelations & R_CUV3)
         {
           //@ep: BUG this is done to be consistent with the old code
-          meanCurvatureVal.stddev /= currentNeigboringBoundary2D.size();//ngbr2D.at(p0).at(p1).size();
+          meanCurvatureVal.stddev /= currentNeigboringBoundary2D->size();//ngbr2D.at(p0).at(p1).size();
 	  r.rel_value.push_back(meanCurvatureVal.stddev);   // r_cu3 ... curvature variance of 3D neighboring points
         }
 	
 	if(usedRelations & R_3D2)
         {
-	  double ratio3Dboundary2Dboundary = ((double)currentNeigboringBoundary3D.size())/((double)currentNeigboringBoundary2D.size());
+	  double ratio3Dboundary2Dboundary = ((double)currentNeigboringBoundary3D->size())/((double)currentNeigboringBoundary2D->size());
           r.rel_value.push_back(ratio3Dboundary2Dboundary); // r_3d2 ... relation 3D neighbors / 2D neighbors
         }
  
         r.valid = true;
         surfaceRelations.at(i) = r;
-#pragma omp critical
-{
-        validRelations.push_back(r);
-}
+        isValid.at(i) = 1;
       }
   }
   
-//   std::vector<Relation> newSurfaceRelations;
-//   for(int i = 0; i < surfaceRelations.size(); ++i)
-//   {
-//     if(surfaceRelations.at(i).valid)
-//     {
-//       newSurfaceRelations.push_back(surfaceRelations.at(i));
-//     }
-//   }
-// 
-//   surfaceRelations = newSurfaceRelations;
+  validRelations.clear();
+  for(unsigned int i = 0; i < surfaceRelations.size(); ++i)
+  {
+    if(isValid.at(i))
+      validRelations.push_back(surfaceRelations.at(i));
+  }
   
   // copy relations to view
   for(unsigned int i=0; i<validRelations.size(); i++)
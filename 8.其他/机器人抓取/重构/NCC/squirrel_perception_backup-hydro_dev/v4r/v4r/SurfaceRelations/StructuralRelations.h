@@ -34,15 +34,14 @@
 
 #include <omp.h>
 #include <vector>
+#include <map>
 #include <cstdio>
 #include <opencv2/opencv.hpp>
 
-#include "ColorHistogram.h"
-#include "Texture.h"
+#include "PatchFeatures.h"
 #include "BoundaryRelationsMeanDepth.hpp"
 #include "BoundaryRelationsMeanColor.hpp"
 #include "BoundaryRelationsMeanCurvature.hpp"
-#include "Fourier.h"
 #include "Gabor.h"
 
 #include "v4r/SurfaceUtils/SurfaceModel.hpp"
@@ -107,11 +106,14 @@ private:
   cv::Mat gray_image2;
   cv::Mat edges;
 
-  std::vector<ColorHistogram::Ptr> hist;
-  std::vector<Texture::Ptr> text;
-  std::vector<Fourier::Ptr> fourier;
-  std::vector<Gabor::Ptr> gabor;
+  // color, texture, fourier and gabor features of all surfaces, one row per surface
+  PatchFeatures features;
   Gabor::Ptr permanentGabor;
+
+  // relations between kept surfaces are not computed but taken from keptRelations
+  std::vector<bool> kept;
+  std::map<std::pair<int,int>,Relation> keptRelations;
+  std::vector<bool> needsUpdate;                         ///< surfaces with a relation to compute
   
 public:
   StructuralRelations();
@@ -130,6 +132,8 @@ public:
   void setUsedRelations(int _usedRelations);
   /**Set training mode **/
   void setTrainingMode(bool _trainMode);
+  /** Relations between two kept surfaces are taken from _relations (invalid if missing there) instead of computed, reset by init() **/
+  void setKeptRelations(const std::vector<bool> &_kept, const std::vector<Relation> &_relations);
   
   /** Get surfaces relations **/
 //   inline std::vector<Relation> getRelations();
@@ -43,6 +43,8 @@ Segmenter::Segmenter()
 
   use_planes = false;
 
+  have_svm_model = false;
+
   model_file_name = "./ST-TrainAll.txt.model";
   scaling_file_name = "./ST-TrainAll.txt.scalingparams";
   
@@ -74,33 +76,50 @@ void Segmenter::setSaliencyMaps(std::vector<cv::Mat> _saliencyMaps)
   have_saliencyMaps = true;
 }
 
-void Segmenter::calculateNormals()
+void Segmenter::computeNormals(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &_pcl_cloud, pcl::PointCloud<pcl::Normal>::Ptr &_normals,
+                               const std::vector<int> &mask)
 {
   // calcuate normals
-  normals.reset(new pcl::PointCloud<pcl::Normal>);
+  _normals.reset(new pcl::PointCloud<pcl::Normal>);
   surface::ZAdaptiveNormals<pcl::PointXYZRGB>::Parameter param;
   param.adaptive = true;
   surface::ZAdaptiveNormals<pcl::PointXYZRGB> nor(param);
-  nor.setInputCloud(pcl_cloud);
-  nor.compute();
-  nor.getNormals(normals);
+  nor.setInputCloud(_pcl_cloud);
+  if(mask.size() > 0)
+    nor.compute(mask);
+  else
+    nor.compute();
+  nor.getNormals(_normals);
 }
 
-void Segmenter::calculatePatches()
+void Segmenter::computePatches(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &_pcl_cloud, pcl::PointCloud<pcl::Normal>::Ptr &_normals,
+                               std::vector<surface::SurfaceModel::Ptr> &_surfaces, const std::vector<int> &mask)
 {
   surface::ClusterNormalsToPlanes::Parameter param;
   param.adaptive = true;         // use adaptive thresholds
   param.epsilon_c = 0.58;//0.62;//
   param.omega_c = -0.002;
 
-  clusterNormals = surface::ClusterNormalsToPlanes::Ptr(new surface::ClusterNormalsToPlanes(param));
+  surface::ClusterNormalsToPlanes::Ptr clusterNormals(new surface::ClusterNormalsToPlanes(param));
   // adaptive clustering
-  clusterNormals->setInputCloud(pcl_cloud);
-  clusterNormals->setNormals(normals);
+  clusterNormals->setInputCloud(_pcl_cloud);
+  clusterNormals->setNormals(_normals);
+  if(mask.size() > 0)
+    clusterNormals->setIndices(mask);
   clusterNormals->setPixelCheck(true, 5);
   clusterNormals->compute();
-  normals = clusterNormals->getNormals();
-  surfaces = clusterNormals->getSurfaces();
+  _normals = clusterNormals->getNormals();
+  _surfaces = clusterNormals->getSurfaces();
+}
+
+void Segmenter::calculateNormals()
+{
+  computeNormals(pcl_cloud,normals);
+}
+
+void Segmenter::calculatePatches()
+{
+  computePatches(pcl_cloud,normals,surfaces);
 }
 
 void Segmenter::initModelSurfaces()
@@ -182,6 +201,8 @@ void Segmenter::computeRelations()
   //   structuralRelations.setRelations(relations);
   structuralRelations.setNeighbours2D(ngbr2D_map);
   structuralRelations.setNeighbours3D(ngbr3D_map);
+  if(kept_surfaces.size() == surfaces.size())
+    structuralRelations.setKeptRelations(kept_surfaces,kept_relations);
   structuralRelations.compute();
   validRelations = structuralRelations.getValidRelations();
   
@@ -197,16 +218,61 @@ void Segmenter::computeRelations()
   //   view.relations = relations;
 }
 
-void Segmenter::graphBasedSegmentation()
+void Segmenter::predictRelations()
 {
-  svmPredictorSingle.setPredictProbability(true);
-  svmPredictorSingle.setModelFilename(model_file_name);
+  // model and scaling are loaded once and not for each graph cut
+  if( (!have_svm_model) || (loaded_model_file_name != model_file_name) || (loaded_scaling_file_name != scaling_file_name) )
+  {
+    svmPredictorSingle.setPredictProbability(true);
+    svmPredictorSingle.setModelFilename(model_file_name);
+    svmPredictorSingle.setType(1);
+    svmPredictorSingle.setScaling(true,scaling_file_name);
+    loaded_model_file_name = model_file_name;
+    loaded_scaling_file_name = scaling_file_name;
+    have_svm_model = true;
+    predictedRelations.clear();
+  }
+
+  // relations with the same feature vector as in an earlier call of this frame (or kept from the previous frame) keep their prediction
+  std::vector<surface::Relation> newRelations;
+  std::vector<int> newRelationsIdx;
+  for(size_t i = 0; i < validRelations.size(); ++i)
+  {
+    std::pair<int,int> key(validRelations.at(i).id_0,validRelations.at(i).id_1);
+    std::map<std::pair<int,int>,surface::Relation>::iterator it = predictedRelations.find(key);
+    if( (it != predictedRelations.end()) && (it->second.rel_value == validRelations.at(i).rel_value) )
+    {
+      validRelations.at(i).prediction = it->second.prediction;
+      validRelations.at(i).rel_probability = it->second.rel_probability;
+    }
+    else
+    {
+      newRelations.push_back(validRelations.at(i));
+      newRelationsIdx.push_back(i);
+    }
+  }
+
+  if(newRelations.size() == 0)
+    return;
+
   svmPredictorSingle.setSurfaces(surfaces);
-  svmPredictorSingle.setRelations(validRelations);
-  svmPredictorSingle.setType(1);
-  svmPredictorSingle.setScaling(true,scaling_file_name);
+  svmPredictorSingle.setRelations(newRelations);
   svmPredictorSingle.compute();
-  validRelations = svmPredictorSingle.getRelations();
+  newRelations = svmPredictorSingle.getRelations();
+
+  // the predictor scales the feature vectors in place, the cache keeps the unscaled ones
+  for(size_t i = 0; i < newRelations.size(); ++i)
+  {
+    surface::Relation &r = validRelations.at(newRelationsIdx.at(i));
+    r.prediction = newRelations.at(i).prediction;
+    r.rel_probability = newRelations.at(i).rel_probability;
+    predictedRelations[std::make_pair(r.id_0,r.id_1)] = r;
+  }
+}
+
+void Segmenter::graphBasedSegmentation()
+{
+  predictRelations();
   
   //   svmPredictorSingle.setPredictProbability(true);
   //   svmPredictorSingle.setModelFilename("./AS-TrainALL.model.txt");
@@ -584,6 +650,98 @@ timeEstimationClass_Custom.countingStart();
 timeEstimationClass_Custom.countingEnd();
 timeEstimates.time_patchesCalculation = timeEstimationClass_Custom.getWorkTimeInNanoseconds();
 
+  kept_points.clear();
+  segmentPatches();
+
+timeEstimationClass_All.countingEnd();
+timeEstimates.time_total = timeEstimationClass_All.getWorkTimeInNanoseconds();
+  
+}
+
+void Segmenter::segment(pcl::PointCloud<pcl::PointXYZRGB>::Ptr _pcl_cloud, pcl::PointCloud<pcl::Normal>::Ptr _normals,
+                        std::vector<surface::SurfaceModel::Ptr> _surfaces, const std::vector<bool> &_kept_points)
+{
+  pcl_cloud = _pcl_cloud;
+  have_cloud = true;
+  normals = _normals;
+  surfaces = _surfaces;
+  kept_points = _kept_points;
+
+EPUtils::TimeEstimationClass timeEstimationClass_All(CLOCK_THREAD_CPUTIME_ID);
+timeEstimationClass_All.countingStart();
+
+  timeEstimates.time_normalsCalculation = 0;
+  timeEstimates.time_patchesCalculation = 0;
+  segmentPatches();
+
+timeEstimationClass_All.countingEnd();
+timeEstimates.time_total = timeEstimationClass_All.getWorkTimeInNanoseconds();
+}
+
+/**
+ * A modelled surface is kept if all its points are kept points and a surface of the previous call had exactly
+ * these points. Relations between two kept surfaces are taken over with their prediction.
+ */
+void Segmenter::keepSurfaces()
+{
+  kept_surfaces.assign(surfaces.size(),false);
+  kept_relations.clear();
+
+  if( (kept_points.size() != pcl_cloud->points.size()) || (prev_surface_indices.size() == 0) )
+    return;
+
+  // a point belongs to at most one surface, the first point identifies the candidate
+  std::map<int,int> prev_first;
+  for(size_t i = 0; i < prev_surface_indices.size(); i++)
+  {
+    if(prev_surface_indices.at(i).size() > 0)
+      prev_first[prev_surface_indices.at(i).at(0)] = i;
+  }
+
+  std::vector<int> prev2cur(prev_surface_indices.size(),-1);
+  for(size_t i = 0; i < surfaces.size(); i++)
+  {
+    const std::vector<int> &indices = surfaces.at(i)->indices;
+    if( (!(surfaces.at(i)->selected)) || (!(surfaces.at(i)->valid)) || (indices.size() == 0) )
+      continue;
+
+    bool all_kept = true;
+    for(size_t j = 0; (j < indices.size()) && all_kept; j++)
+      all_kept = kept_points.at(indices.at(j));
+    if(!all_kept)
+      continue;
+
+    std::map<int,int>::iterator it = prev_first.find(indices.at(0));
+    if( (it == prev_first.end()) || (prev_surface_indices.at(it->second) != indices) )
+      continue;
+
+    kept_surfaces.at(i) = true;
+    prev2cur.at(it->second) = i;
+  }
+
+  for(size_t i = 0; i < prev_relations.size(); i++)
+  {
+    surface::Relation r = prev_relations.at(i);
+    if( (r.id_0 >= (int)prev2cur.size()) || (r.id_1 >= (int)prev2cur.size()) )
+      continue;
+    int id_0 = prev2cur.at(r.id_0);
+    int id_1 = prev2cur.at(r.id_1);
+    if( (id_0 < 0) || (id_1 < 0) )
+      continue;
+
+    r.id_0 = std::min(id_0,id_1);
+    r.id_1 = std::max(id_0,id_1);
+    kept_relations.push_back(r);
+    predictedRelations[std::make_pair(r.id_0,r.id_1)] = r;
+  }
+}
+
+void Segmenter::segmentPatches()
+{
+EPUtils::TimeEstimationClass timeEstimationClass_Custom(CLOCK_THREAD_CPUTIME_ID);
+
+  predictedRelations.clear();
+
 timeEstimationClass_Custom.countingStart();
 //   surface::View view;
   view.Reset();
@@ -626,6 +784,9 @@ timeEstimates.times_surfaceModelling.clear();
 timeEstimates.times_surfaceModelling.push_back(timeEstimationClass_Custom.getWorkTimeInNanoseconds());
 
 timeEstimationClass_Custom.countingStart();
+  keepSurfaces();
+  // an exception from here on must not leave the previous call as reference
+  clearPreviousFrame();
   computeRelations();
 timeEstimationClass_Custom.countingEnd();
 timeEstimates.times_relationsComputation.clear();
@@ -637,15 +798,24 @@ timeEstimationClass_Custom.countingEnd();
 timeEstimates.times_graphBasedSegmentation.clear();
 timeEstimates.times_graphBasedSegmentation.push_back(timeEstimationClass_Custom.getWorkTimeInNanoseconds());
 
+  // reference for the next call, the other segmentation modes do not use kept surfaces
+  kept_surfaces.clear();
+  kept_relations.clear();
+  prev_surface_indices.resize(surfaces.size());
+  for(size_t i = 0; i < surfaces.size(); i++)
+  {
+    if( (surfaces.at(i)->selected) && (surfaces.at(i)->valid) )
+      prev_surface_indices.at(i) = surfaces.at(i)->indices;
+    else
+      prev_surface_indices.at(i).clear();
+  }
+  prev_relations = validRelations;
+
 timeEstimationClass_Custom.countingStart();
   createMasks();
 timeEstimationClass_Custom.countingEnd();
 timeEstimates.times_maskCreation.clear();
 timeEstimates.times_maskCreation.push_back(timeEstimationClass_Custom.getWorkTimeInNanoseconds());
-
-timeEstimationClass_All.countingEnd();
-timeEstimates.time_total = timeEstimationClass_All.getWorkTimeInNanoseconds();
-  
 }
 
 void Segmenter::attentionSegmentInit()
@@ -663,6 +833,8 @@ EPUtils::TimeEstimationClass timeEstimationClass_All(CLOCK_THREAD_CPUTIME_ID);//
 EPUtils::TimeEstimationClass timeEstimationClass_Custom(CLOCK_THREAD_CPUTIME_ID);
 
 timeEstimationClass_All.countingStart();
+
+  predictedRelations.clear();
   
 timeEstimationClass_Custom.countingStart();
   calculateNormals();
@@ -786,6 +958,17 @@ timeEstimates.times_neigboursUpdate.at(0) = 0;
   }
   else
   {
+    // surfaces of already segmented objects are not part of the graph any more,
+    // relations and predictions of the remaining surfaces are reused
+    for(size_t j = 0; j < surfaces.size(); j++)
+    {
+      if(surfaces.at(j)->segmented_number != -1)
+      {
+        surfaces.at(j)->selected = false;
+        surfaces.at(j)->isNew = false;
+      }
+    }
+
     surfaces.at(originalIndex)->selected = true;
     surfaces.at(originalIndex)->isNew = true;
     view.surfaces = surfaces;
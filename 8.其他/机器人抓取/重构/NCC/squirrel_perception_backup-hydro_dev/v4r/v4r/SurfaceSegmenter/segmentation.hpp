@@ -98,7 +98,6 @@ private:
   pcl::PointCloud<pcl::PointXYZRGB>::Ptr pcl_cloud;                 ///< original pcl point cloud
   pcl::PointCloud<pcl::PointXYZRGBL>::Ptr pcl_cloud_l;              ///< labeled pcl point cloud
   pcl::PointCloud<pcl::Normal>::Ptr normals;
-  surface::ClusterNormalsToPlanes::Ptr clusterNormals;
   std::vector<surface::SurfaceModel::Ptr> surfaces;
   surface::SurfaceModeling::Ptr surfModeling;
   std::map<surface::borderIdentification,std::vector<surface::neighboringPair> > ngbr2D_map;
@@ -106,6 +105,15 @@ private:
   std::vector<surface::Relation> validRelations;
   surface::StructuralRelations structuralRelations;
   svm::SVMPredictorSingle svmPredictorSingle;
+  std::map<std::pair<int,int>,surface::Relation> predictedRelations;  ///< relations classified in the current frame
+
+  // reuse of the surfaces of the previous segment() call
+  std::vector<bool> kept_points;                                      ///< points that did not change since the previous call
+  std::vector<std::vector<int> > prev_surface_indices;                ///< points of the modelled surfaces of the previous call
+  std::vector<surface::Relation> prev_relations;                      ///< classified relations of the previous call
+  std::vector<bool> kept_surfaces;                                    ///< surfaces identical to one of the previous call
+  std::vector<surface::Relation> kept_relations;                      ///< relations of the previous call between kept surfaces
+
   gc::GraphCut graphCut;
   std::vector<cv::Mat> saliencyMaps;
   
@@ -122,6 +130,8 @@ private:
   bool use_planes;
 
   std::string model_file_name, scaling_file_name;
+  bool have_svm_model;
+  std::string loaded_model_file_name, loaded_scaling_file_name;
   
   std::string ClassName;
 
@@ -142,7 +152,10 @@ private:
   void modelSurfaces();
   void preComputeRelations();
   void computeRelations();
+  void predictRelations();
   void graphBasedSegmentation();
+  void keepSurfaces();
+  void segmentPatches();
   bool checkSegmentation(cv::Mat &mask, int originalIndex, int salMapNumber);
   int attentionSegment(cv::Mat &object_mask, int originalIndex, int salMapNumber);
   void createMasks();
@@ -153,6 +166,19 @@ public:
   
   /** Run the pre-segmenter **/
   void segment();
+  /** Run the segmenter on patches computed with computeNormals() and computePatches(). Surfaces that consist of the same
+   *  _kept_points as a surface of the previous call keep the relations and predictions among each other. **/
+  void segment(pcl::PointCloud<pcl::PointXYZRGB>::Ptr _pcl_cloud, pcl::PointCloud<pcl::Normal>::Ptr _normals,
+               std::vector<surface::SurfaceModel::Ptr> _surfaces, const std::vector<bool> &_kept_points = std::vector<bool>());
+  /** Forget the surfaces and relations of the previous call **/
+  inline void clearPreviousFrame();
+  
+  /** Normals of the cloud (only of the points in mask if not empty), invalid points of the cloud are set to NaN **/
+  static void computeNormals(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &_pcl_cloud, pcl::PointCloud<pcl::Normal>::Ptr &_normals,
+                             const std::vector<int> &mask = std::vector<int>());
+  /** Planar patches of the cloud (only of the points in mask if not empty), normals are updated **/
+  static void computePatches(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &_pcl_cloud, pcl::PointCloud<pcl::Normal>::Ptr &_normals,
+                             std::vector<surface::SurfaceModel::Ptr> &_surfaces, const std::vector<int> &mask = std::vector<int>());
   void attentionSegment();
   //void attentionSegment(int &objNumber);
   
@@ -208,6 +234,12 @@ inline void Segmenter::setScaling(std::string _scaling_file_name)
   scaling_file_name = _scaling_file_name;
 }
 
+inline void Segmenter::clearPreviousFrame()
+{
+  prev_surface_indices.clear();
+  prev_relations.clear();
+}
+
 inline std::vector<surface::SurfaceModel::Ptr> Segmenter::getSurfaces()
 {
   return(surfaces);
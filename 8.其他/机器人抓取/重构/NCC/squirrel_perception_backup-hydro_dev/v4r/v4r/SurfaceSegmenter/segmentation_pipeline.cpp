@@ -0,0 +1,444 @@
+/**
+ *  Copyright (C) 2012
+ *    Ekaterina Potapova, Andreas Richtsfeld, Johann Prankl, Thomas Mörwald, Michael Zillich
+ *    Automation and Control Institute
+ *    Vienna University of Technology
+ *    Gusshausstraße 25-29
+ *    1170 Vienna, Austria
+ *    ari(at)acin.tuwien.ac.at
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @file segmentation_pipeline.cpp
+ * @date October 2026
+ * @version 0.1
+ * @brief Streaming segmentation of RGB-D frames with reuse of unchanged image regions
+ */
+
+
+#include <limits>
+#include <boost/bind.hpp>
+
+#include "segmentation_pipeline.hpp"
+
+namespace segmentation
+{
+
+SegmenterPipeline::SegmenterPipeline(Parameter p)
+{
+  running = false;
+  frame_counter = 0;
+  prev_width = prev_height = 0;
+  setParameter(p);
+}
+
+SegmenterPipeline::~SegmenterPipeline()
+{
+  if(running)
+    stop();
+}
+
+void SegmenterPipeline::setParameter(Parameter p)
+{
+  if(running)
+    throw std::runtime_error("[SegmenterPipeline::setParameter] Pipeline is running, call stop() first.");
+
+  param = p;
+  if(param.tile_size < 1)
+    param.tile_size = 1;
+
+  input_queue.setMaxSize(param.queue_size);
+  patches_queue.setMaxSize(param.queue_size);
+  // results stay available after stop(), so the segmentation thread never waits for the caller
+  output_queue.setMaxSize(std::numeric_limits<size_t>::max());
+}
+
+void SegmenterPipeline::start()
+{
+  if(running)
+    return;
+
+  input_queue.reopen();
+  patches_queue.reopen();
+  output_queue.reopen();
+
+  prev_width = prev_height = 0;
+  prev_depth.clear();
+  prev_color.clear();
+  prev_normals.reset();
+  prev_patches.clear();
+  prev_result.reset();
+  segmenter.clearPreviousFrame();
+
+  preSegmentThread = boost::thread(boost::bind(&SegmenterPipeline::preSegmentLoop, this));
+  segmentThread = boost::thread(boost::bind(&SegmenterPipeline::segmentLoop, this));
+  running = true;
+}
+
+void SegmenterPipeline::stop()
+{
+  if(!running)
+    return;
+
+  input_queue.close();
+  preSegmentThread.join();
+  segmentThread.join();
+  running = false;
+}
+
+bool SegmenterPipeline::push(pcl::PointCloud<pcl::PointXYZRGB>::Ptr _pcl_cloud)
+{
+  if(!running)
+  {
+    printf("[SegmenterPipeline::push] Error: Pipeline is not running.\n");
+    return false;
+  }
+
+  if( (_pcl_cloud.get() == 0) || (!_pcl_cloud->isOrganized()) )
+    throw std::runtime_error("[SegmenterPipeline::push] Need an organized point cloud!");
+
+  SegmentationFrame::Ptr frame(new SegmentationFrame);
+  frame->id = frame_counter++;
+  frame->pcl_cloud = _pcl_cloud;
+  frame->nr_tiles = 0;
+  frame->nr_changed_tiles = 0;
+  frame->unchanged = false;
+  frame->nr_kept_patches = 0;
+
+  return input_queue.push(frame);
+}
+
+bool SegmenterPipeline::pop(SegmentationFrame::Ptr &frame)
+{
+  return output_queue.pop(frame);
+}
+
+void SegmenterPipeline::preSegmentLoop()
+{
+  SegmentationFrame::Ptr frame;
+  while(input_queue.pop(frame))
+  {
+    try
+    {
+      preSegment(frame);
+    }
+    catch(const std::exception &e)
+    {
+      printf("[SegmenterPipeline::preSegment] Error: frame %llu: %s\n", frame->id, e.what());
+      frame->surfaces.clear();
+      frame->kept_points.clear();
+      frame->unchanged = false;
+      // the next frame is processed from scratch
+      prev_depth.clear();
+      prev_normals.reset();
+      prev_patches.clear();
+    }
+
+    if(!patches_queue.push(frame))
+      break;
+  }
+
+  patches_queue.close();
+}
+
+void SegmenterPipeline::segmentLoop()
+{
+  SegmentationFrame::Ptr frame;
+  while(patches_queue.pop(frame))
+  {
+    if(frame->unchanged)
+    {
+      if(prev_result.get() != 0)
+      {
+        frame->surfaces = prev_result->surfaces;
+        frame->masks = prev_result->masks;
+        frame->segmentedObjectsIndices = prev_result->segmentedObjectsIndices;
+      }
+      frame->timeEstimates = TimeEstimates();
+    }
+    else if(frame->surfaces.size() > 0)
+    {
+      try
+      {
+        segmenter.segment(frame->pcl_cloud,frame->normals,frame->surfaces,frame->kept_points);
+        frame->surfaces = segmenter.getSurfaces();
+        frame->masks = segmenter.getMasks();
+        frame->segmentedObjectsIndices = segmenter.getSegmentedObjectsIndices();
+        frame->timeEstimates = segmenter.getTimeEstimates();
+        prev_result = frame;
+      }
+      catch(const std::exception &e)
+      {
+        printf("[SegmenterPipeline::segment] Error: frame %llu: %s\n", frame->id, e.what());
+        segmenter.clearPreviousFrame();
+        prev_result.reset();
+      }
+    }
+    else
+    {
+      // nothing to segment, but the following frames are compared with this one
+      segmenter.clearPreviousFrame();
+      prev_result = frame;
+    }
+
+    if(!output_queue.push(frame))
+      break;
+  }
+
+  output_queue.close();
+}
+
+void SegmenterPipeline::detectChangedTiles(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, std::vector<bool> &changed,
+                                           int &tiles_x, int &tiles_y)
+{
+  int width = cloud.width;
+  int height = cloud.height;
+  int ts = param.tile_size;
+  tiles_x = (width + ts - 1) / ts;
+  tiles_y = (height + ts - 1) / ts;
+  changed.assign(tiles_x*tiles_y, true);
+
+  if( (prev_depth.size() == 0) || (width != prev_width) || (height != prev_height) )
+    return;
+
+  std::vector<int> nr_changed(tiles_x*tiles_y, 0);
+
+  // each thread works on whole tile rows
+  #pragma omp parallel for
+  for(int ty = 0; ty < tiles_y; ty++)
+  {
+    for(int v = ty*ts; v < std::min((ty+1)*ts,height); v++)
+    {
+      for(int u = 0; u < width; u++)
+      {
+        int idx = v*width + u;
+        const pcl::PointXYZRGB &pt = cloud.points[idx];
+        bool valid = !std::isnan(pt.z);
+        bool prev_valid = !std::isnan(prev_depth[idx]);
+
+        bool diff = false;
+        if(valid != prev_valid)
+        {
+          diff = true;
+        }
+        else if(valid)
+        {
+          diff = (fabs(pt.z - prev_depth[idx]) > param.depth_threshold * pt.z * pt.z);
+          if(!diff)
+          {
+            int dc = abs((int)pt.r - (int)prev_color[3*idx]) + abs((int)pt.g - (int)prev_color[3*idx+1]) +
+                     abs((int)pt.b - (int)prev_color[3*idx+2]);
+            diff = (dc > param.color_threshold);
+          }
+        }
+
+        if(diff)
+          nr_changed[ty*tiles_x + u/ts]++;
+      }
+    }
+  }
+
+  for(int ty = 0; ty < tiles_y; ty++)
+  {
+    for(int tx = 0; tx < tiles_x; tx++)
+    {
+      int area = (std::min((tx+1)*ts,width) - tx*ts) * (std::min((ty+1)*ts,height) - ty*ts);
+      changed[ty*tiles_x + tx] = (nr_changed[ty*tiles_x + tx] > param.changed_points * area);
+    }
+  }
+}
+
+void SegmenterPipeline::storeFrame(const pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+{
+  prev_width = cloud.width;
+  prev_height = cloud.height;
+  prev_depth.resize(cloud.points.size());
+  prev_color.resize(3*cloud.points.size());
+  for(size_t i = 0; i < cloud.points.size(); i++)
+  {
+    prev_depth[i] = cloud.points[i].z;
+    prev_color[3*i] = cloud.points[i].r;
+    prev_color[3*i+1] = cloud.points[i].g;
+    prev_color[3*i+2] = cloud.points[i].b;
+  }
+}
+
+void SegmenterPipeline::storePatches(const std::vector<surface::SurfaceModel::Ptr> &patches)
+{
+  // the segmenter modifies the surfaces it gets
+  prev_patches.resize(patches.size());
+  for(size_t i = 0; i < patches.size(); i++)
+    prev_patches[i].reset(new surface::SurfaceModel(*(patches[i])));
+}
+
+void SegmenterPipeline::preSegment(SegmentationFrame::Ptr &frame)
+{
+  pcl::PointCloud<pcl::PointXYZRGB> &cloud = *(frame->pcl_cloud);
+
+  std::vector<bool> changed;
+  int tiles_x, tiles_y;
+  detectChangedTiles(cloud,changed,tiles_x,tiles_y);
+
+  frame->nr_tiles = changed.size();
+  frame->nr_changed_tiles = 0;
+  for(size_t i = 0; i < changed.size(); i++)
+  {
+    if(changed[i])
+      frame->nr_changed_tiles++;
+  }
+
+  if(frame->nr_changed_tiles == 0)
+  {
+    frame->unchanged = true;
+    return;
+  }
+
+  frame->unchanged = false;
+  // the reference for the next frames, before invalid points are set to NaN by the normals
+  storeFrame(cloud);
+
+  frame->kept_points.clear();
+  if( (frame->nr_changed_tiles == frame->nr_tiles) || (prev_normals.get() == 0) )
+  {
+    Segmenter::computeNormals(frame->pcl_cloud,frame->normals);
+  }
+  else
+  {
+    // normals of a point depend on its neighbourhood, so tiles next to a changed tile are recomputed as well
+    int ts = param.tile_size;
+    int width = cloud.width;
+    int height = cloud.height;
+    std::vector<bool> recompute(changed.size(),false);
+    for(int ty = 0; ty < tiles_y; ty++)
+    {
+      for(int tx = 0; tx < tiles_x; tx++)
+      {
+        if(!changed[ty*tiles_x + tx])
+          continue;
+        for(int y = std::max(ty-1,0); y <= std::min(ty+1,tiles_y-1); y++)
+          for(int x = std::max(tx-1,0); x <= std::min(tx+1,tiles_x-1); x++)
+            recompute[y*tiles_x + x] = true;
+      }
+    }
+
+    std::vector<int> mask;
+    frame->kept_points.assign(cloud.points.size(),false);
+    for(int v = 0; v < height; v++)
+    {
+      for(int u = 0; u < width; u++)
+      {
+        if(recompute[(v/ts)*tiles_x + u/ts])
+          mask.push_back(v*width + u);
+        else
+          frame->kept_points[v*width + u] = true;
+      }
+    }
+
+    Segmenter::computeNormals(frame->pcl_cloud,frame->normals,mask);
+
+    // copy the normals of the last processed frame, points without normal there are invalid here as well
+    bool havenan = false;
+    float NaN = std::numeric_limits<float>::quiet_NaN();
+    for(int v = 0; v < height; v++)
+    {
+      for(int u = 0; u < width; u++)
+      {
+        if(recompute[(v/ts)*tiles_x + u/ts])
+          continue;
+
+        int idx = v*width + u;
+        const pcl::Normal &n = prev_normals->points[idx];
+        frame->normals->points[idx] = n;
+        if(std::isnan(n.normal[0]))
+        {
+          pcl::PointXYZRGB &pt = cloud.points[idx];
+          pt.x = pt.y = pt.z = NaN;
+          havenan = true;
+        }
+      }
+    }
+
+    if(havenan)
+    {
+      cloud.is_dense = false;
+      frame->normals->is_dense = false;
+    }
+  }
+
+  // clustering may change the normals
+  prev_normals.reset(new pcl::PointCloud<pcl::Normal>(*(frame->normals)));
+
+  frame->nr_kept_patches = 0;
+  if( (frame->kept_points.size() == 0) || (prev_patches.size() == 0) )
+  {
+    Segmenter::computePatches(frame->pcl_cloud,frame->normals,frame->surfaces);
+    storePatches(frame->surfaces);
+    return;
+  }
+
+  // patches of the last processed frame without a point in a recomputed tile are kept, the other points are clustered
+  std::vector<surface::SurfaceModel::Ptr> patches;
+  std::vector<bool> covered(cloud.points.size(),false);
+  for(size_t i = 0; i < prev_patches.size(); i++)
+  {
+    const std::vector<int> &indices = prev_patches[i]->indices;
+    bool all_kept = true;
+    for(size_t j = 0; (j < indices.size()) && all_kept; j++)
+      all_kept = frame->kept_points[indices[j]];
+    if( (!all_kept) || (indices.size() == 0) )
+      continue;
+
+    patches.push_back(surface::SurfaceModel::Ptr(new surface::SurfaceModel(*(prev_patches[i]))));
+    for(size_t j = 0; j < indices.size(); j++)
+      covered[indices[j]] = true;
+  }
+  frame->nr_kept_patches = patches.size();
+
+  std::vector<int> remainder;
+  for(size_t idx = 0; idx < covered.size(); idx++)
+  {
+    if(!covered[idx])
+      remainder.push_back(idx);
+  }
+
+  if(remainder.size() > 0)
+  {
+    std::vector<surface::SurfaceModel::Ptr> new_patches;
+    Segmenter::computePatches(frame->pcl_cloud,frame->normals,new_patches,remainder);
+    patches.insert(patches.end(),new_patches.begin(),new_patches.end());
+  }
+
+  // clustering sets the normals of plane points to the plane normal, kept patches carry theirs
+  for(int i = 0; i < frame->nr_kept_patches; i++)
+  {
+    const surface::SurfaceModel &patch = *(patches[i]);
+    for(size_t j = 0; j < patch.indices.size(); j++)
+    {
+      pcl::Normal &n = frame->normals->points[patch.indices[j]];
+      n.normal_x = patch.normals[j][0];
+      n.normal_y = patch.normals[j][1];
+      n.normal_z = patch.normals[j][2];
+    }
+  }
+
+  for(size_t i = 0; i < patches.size(); i++)
+    patches[i]->idx = i;
+
+  frame->surfaces = patches;
+  storePatches(frame->surfaces);
+}
+
+} // end segmentation
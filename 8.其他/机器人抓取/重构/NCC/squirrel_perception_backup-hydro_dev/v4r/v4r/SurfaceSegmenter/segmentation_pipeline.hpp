@@ -0,0 +1,230 @@
+/**
+ *  Copyright (C) 2012
+ *    Ekaterina Potapova, Andreas Richtsfeld, Johann Prankl, Thomas Mörwald, Michael Zillich
+ *    Automation and Control Institute
+ *    Vienna University of Technology
+ *    Gusshausstraße 25-29
+ *    1170 Vienna, Austria
+ *    ari(at)acin.tuwien.ac.at
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @file segmentation_pipeline.hpp
+ * @date October 2026
+ * @version 0.1
+ * @brief Streaming segmentation of RGB-D frames with reuse of unchanged image regions
+ */
+
+
+#ifndef SEGMENTATION_PIPELINE
+#define SEGMENTATION_PIPELINE
+
+#include <deque>
+
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "segmentation.hpp"
+
+namespace segmentation
+{
+
+/**
+ * @brief One frame passing through the pipeline
+ */
+struct SegmentationFrame
+{
+  typedef boost::shared_ptr<SegmentationFrame> Ptr;
+
+  unsigned long long id;                                   ///< running frame number
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr pcl_cloud;
+  pcl::PointCloud<pcl::Normal>::Ptr normals;
+  std::vector<surface::SurfaceModel::Ptr> surfaces;       ///< patches, after segmentation the labeled surfaces
+  int nr_tiles;
+  int nr_changed_tiles;                                    ///< tiles that differ from the last processed frame
+  bool unchanged;                                          ///< no tile changed, results of the previous frame are used
+  int nr_kept_patches;                                     ///< patches of the last processed frame taken over unchanged
+  std::vector<bool> kept_points;                           ///< points of tiles that were not recomputed
+
+  std::vector<cv::Mat> masks;
+  std::vector<std::vector<int> > segmentedObjectsIndices;
+  TimeEstimates timeEstimates;
+};
+
+/**
+ * @brief Blocking queue with a maximum size, close() wakes up all waiting threads
+ */
+template<typename T>
+class BoundedQueue
+{
+private:
+  std::deque<T> queue;
+  size_t max_size;
+  bool closed;
+  boost::mutex mutex;
+  boost::condition_variable not_empty, not_full;
+
+public:
+  BoundedQueue(size_t _max_size = 2) : max_size(_max_size), closed(false) {}
+
+  void setMaxSize(size_t _max_size) { max_size = (_max_size > 0 ? _max_size : 1); }
+
+  /** Waits while the queue is full, returns false if the queue was closed **/
+  bool push(const T &t)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while( (queue.size() >= max_size) && (!closed) )
+      not_full.wait(lock);
+    if(closed)
+      return false;
+    queue.push_back(t);
+    not_empty.notify_one();
+    return true;
+  }
+
+  /** Waits while the queue is empty, returns false if the queue is closed and empty **/
+  bool pop(T &t)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while( queue.empty() && (!closed) )
+      not_empty.wait(lock);
+    if(queue.empty())
+      return false;
+    t = queue.front();
+    queue.pop_front();
+    not_full.notify_one();
+    return true;
+  }
+
+  /** No more pushes, pending elements can still be popped **/
+  void close()
+  {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    closed = true;
+    not_empty.notify_all();
+    not_full.notify_all();
+  }
+
+  void reopen()
+  {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    queue.clear();
+    closed = false;
+  }
+};
+
+/**
+ * @class SegmenterPipeline
+ * Streaming mode of the Segmenter for a continuous sequence of clouds of a mostly static camera.
+ * The pre-segmentation (normals and planar patches) and the segmentation (surface modelling,
+ * relations, SVM and graph cut) of consecutive frames run in two threads, connected by bounded
+ * queues, so pre-segmentation of frame n+1 overlaps with segmentation of frame n.
+ * Frames are compared tile by tile with the last processed frame (depth and colour differences).
+ * Normals are only recomputed in changed tiles (dilated by one tile) and copied elsewhere. Patches
+ * of the last processed frame that lie completely outside of the recomputed tiles are kept, only the
+ * remaining points are clustered. Relations between surfaces that are identical to the last processed
+ * frame are taken over with their prediction, relations involving any other surface are recomputed.
+ * If no tile changed at all the surfaces and masks of the last processed frame are reused.
+ * Segmenter settings have to be set before start().
+ */
+class SegmenterPipeline
+{
+public:
+  class Parameter
+  {
+    public:
+      int tile_size;                 // tile size [px], should be at least the normal kernel radius
+      float depth_threshold;         // depth change of a point: |dz| > depth_threshold * z^2 [1/m]
+      int color_threshold;           // colour change of a point: |dr|+|dg|+|db| > color_threshold
+      float changed_points;          // tile changed if more than this fraction of its points changed
+      int queue_size;                // maximum number of frames waiting in front of each stage
+      Parameter(int _tile_size=16, float _depth_threshold=0.01, int _color_threshold=30, float _changed_points=0.05,
+                int _queue_size=2)
+       : tile_size(_tile_size), depth_threshold(_depth_threshold), color_threshold(_color_threshold),
+         changed_points(_changed_points), queue_size(_queue_size) {}
+  };
+
+private:
+  Parameter param;
+
+  Segmenter segmenter;
+
+  BoundedQueue<SegmentationFrame::Ptr> input_queue;
+  BoundedQueue<SegmentationFrame::Ptr> patches_queue;
+  BoundedQueue<SegmentationFrame::Ptr> output_queue;
+
+  boost::thread preSegmentThread;
+  boost::thread segmentThread;
+  bool running;
+  unsigned long long frame_counter;
+
+  // last processed frame of the pre-segmentation stage (raw depth and colour, normals)
+  int prev_width, prev_height;
+  std::vector<float> prev_depth;
+  std::vector<unsigned char> prev_color;
+  pcl::PointCloud<pcl::Normal>::Ptr prev_normals;
+  std::vector<surface::SurfaceModel::Ptr> prev_patches;
+
+  // previous frame of the segmentation stage
+  SegmentationFrame::Ptr prev_result;
+
+  void preSegmentLoop();
+  void segmentLoop();
+
+  void preSegment(SegmentationFrame::Ptr &frame);
+  void detectChangedTiles(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, std::vector<bool> &changed, int &tiles_x, int &tiles_y);
+  void storeFrame(const pcl::PointCloud<pcl::PointXYZRGB> &cloud);
+  void storePatches(const std::vector<surface::SurfaceModel::Ptr> &patches);
+
+public:
+  SegmenterPipeline(Parameter p=Parameter());
+  virtual ~SegmenterPipeline();
+
+  void setParameter(Parameter p);
+
+  inline void setUsePlanesNotNurbs(bool _use_planes);
+  inline void setModelFilename(std::string _model_file_name);
+  inline void setScaling(std::string _scaling_file_name);
+
+  /** Start the pipeline threads **/
+  void start();
+  /** Process all pending frames and stop the threads **/
+  void stop();
+
+  /** Queue a cloud for segmentation, waits while the pipeline is full. The cloud is modified (invalid points are set to NaN). **/
+  bool push(pcl::PointCloud<pcl::PointXYZRGB>::Ptr _pcl_cloud);
+  /** Next segmented frame in input order, waits until one is available. False after stop() when all frames were returned. **/
+  bool pop(SegmentationFrame::Ptr &frame);
+};
+
+inline void SegmenterPipeline::setUsePlanesNotNurbs(bool _use_planes)
+{
+  segmenter.setUsePlanesNotNurbs(_use_planes);
+}
+
+inline void SegmenterPipeline::setModelFilename(std::string _model_file_name)
+{
+  segmenter.setModelFilename(_model_file_name);
+}
+
+inline void SegmenterPipeline::setScaling(std::string _scaling_file_name)
+{
+  segmenter.setScaling(_scaling_file_name);
+}
+
+} //namespace segmentation
+
+#endif //SEGMENTATION_PIPELINE
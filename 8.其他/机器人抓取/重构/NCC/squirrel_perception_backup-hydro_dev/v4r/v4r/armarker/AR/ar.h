@@ -767,6 +767,162 @@ typedef struct {
     int     count;
 } arPrevInfo;
 
+/*------------------------------------*/
+
+/** \struct ARPattTable
+* \brief table of loaded patterns used by the template matching.
+*
+* Opaque, created with arPattTableCreate(). A table can be shared by several
+* contexts as long as no pattern is loaded or freed while they detect.
+*/
+typedef struct ARPattTable ARPattTable;
+
+/** \struct ARContext
+* \brief working state of one marker detector.
+*
+* Holds everything the detection writes to: the camera parameters, the label
+* image and labeling buffers (allocated for the image size), the marker candidates,
+* the tracking history of arContextDetectMarker and the pattern table.
+* Different contexts can be used concurrently from different threads, one
+* context must not be used by two threads at the same time.
+* The mode settings are copied from arImageProcMode, arTemplateMatchingMode and
+* arMatchingPCAMode when the context is created and can be changed afterwards.
+* The global functions (arDetectMarker, arLoadPatt, ...) work on the contexts
+* returned by arGetGlobalContext().
+* \param param camera parameters
+* \param xsize image width
+* \param ysize image height
+* \param buffer_size number of pixels of the allocated label image
+* \param work_size maximum number of labels of the allocated labeling buffers
+*/
+typedef struct {
+    ARParam         param;
+    int             xsize, ysize;
+    int             image_proc_mode;
+    int             template_matching_mode;
+    int             matching_pca_mode;
+
+    int             buffer_size;
+    int             work_size;
+    ARInt16        *l_image;
+    int            *work;
+    int            *work2;
+    int            *warea;
+    int            *wclip;
+    double         *wpos;
+    int             wlabel_num;
+
+    int             wx[AR_CHAIN_MAX];
+    int             wy[AR_CHAIN_MAX];
+    ARMarkerInfo2   marker_info2[AR_SQUARE_MAX];
+    ARMarkerInfo    marker_info[AR_SQUARE_MAX];
+    int             marker_num;
+    arPrevInfo      prev_info[AR_SQUARE_MAX];
+    int             prev_num;
+
+    ARPattTable    *patt;
+    int             own_patt;
+} ARContext;
+
+/**
+* \brief create an empty pattern table.
+* \return the table, release it with arPattTableDelete()
+*/
+ARPattTable  *arPattTableCreate( void );
+
+/**
+* \brief release a pattern table created with arPattTableCreate().
+* \param patt the pattern table
+*/
+void          arPattTableDelete( ARPattTable *patt );
+
+/**
+* \brief load a pattern file into a pattern table (see arLoadPatt).
+* \param patt the pattern table
+* \param filename name of the file containing the pattern bitmap to be loaded
+* \return the identity number of the pattern loaded or -1 if the pattern load failed.
+*/
+int           arPattTableLoad( ARPattTable *patt, const char *filename );
+
+/**
+* \brief remove a pattern from a pattern table (see arFreePatt).
+* \param patt the pattern table
+* \param patno the identity number of the pattern
+* \return 1 in success, -1 if the pattern was not loaded
+*/
+int           arPattTableFree( ARPattTable *patt, int patno );
+
+/**
+* \brief activate (1) or deactivate (0) a pattern of a pattern table (see arActivatePatt).
+* \param patt the pattern table
+* \param patno the identity number of the pattern
+* \param active 1 to activate, 0 to deactivate
+* \return 1 in success, -1 if the pattern was not loaded
+*/
+int           arPattTableActivate( ARPattTable *patt, int patno, int active );
+
+/**
+* \brief create a detection context.
+*
+* The buffers are allocated for the image size of the camera parameters.
+* \param param the camera parameters, NULL to set them later with arContextInitCparam()
+* \param patt pattern table used by the context, NULL creates a table owned by the context
+* \return the context, release it with arDeleteContext()
+*/
+ARContext    *arCreateContext( ARParam *param, ARPattTable *patt );
+
+/**
+* \brief release a context created with arCreateContext() (and its own pattern table).
+* \param ctx the context
+*/
+void          arDeleteContext( ARContext *ctx );
+
+/**
+* \brief set the camera parameters of a context.
+*
+* The buffers are reallocated if the image is larger than before and the tracking
+* history is cleared if the image size changed.
+* \param ctx the context
+* \param param the camera parameters
+* \return always 0
+*/
+int           arContextInitCparam( ARContext *ctx, ARParam *param );
+
+/**
+* \brief context used by the global functions.
+*
+* The context shares the global pattern table (arLoadPatt) and is synchronized with
+* arParam, arImXsize, arImYsize and the global modes each time it is requested.
+* \param LorR 1 for the monocular and the left stereo camera, 0 for the right stereo camera
+* \return the context
+*/
+ARContext    *arGetGlobalContext( int LorR );
+
+int           arContextLoadPatt      ( ARContext *ctx, const char *filename );
+int           arContextDetectMarker  ( ARContext *ctx, ARUint8 *dataPtr, int thresh,
+                                       ARMarkerInfo **marker_info, int *marker_num );
+int           arContextDetectMarkerLite( ARContext *ctx, ARUint8 *dataPtr, int thresh,
+                                       ARMarkerInfo **marker_info, int *marker_num, ARMarkerInfo2 **m_info2 );
+int           arContextSavePatt      ( ARContext *ctx, ARUint8 *image,
+                                       ARMarkerInfo *marker_info, char *filename );
+ARInt16      *arContextLabeling      ( ARContext *ctx, ARUint8 *image, int thresh,
+                                       int *label_num, int **area, double **pos, int **clip,
+                                       int **label_ref );
+ARMarkerInfo2 *arContextDetectMarker2( ARContext *ctx, ARInt16 *limage,
+                                       int label_num, int *label_ref,
+                                       int *warea, double *wpos, int *wclip,
+                                       int area_max, int area_min, double factor, int *marker_num );
+int           arContextGetContour    ( ARContext *ctx, ARInt16 *limage, int *label_ref,
+                                       int label, int clip[4], ARMarkerInfo2 *marker_info2 );
+ARMarkerInfo *arContextGetMarkerInfo ( ARContext *ctx, ARUint8 *image,
+                                       ARMarkerInfo2 *marker_info2, int *marker_num );
+int           arContextGetCode       ( ARContext *ctx, ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
+                                       int *code, int *dir, double *cf );
+int           arContextGetPatt       ( ARContext *ctx, ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
+                                       ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] );
+int           arContextGetLine       ( ARContext *ctx, int x_coord[], int y_coord[], int coord_num,
+                                       int vertex[], double line[4][3], double v[4][2] );
+
 
 /*------------------------------------*/
 
@@ -0,0 +1,145 @@
+/*******************************************************
+ *
+ * Detection context: working state of one marker detector,
+ * allocated for the image size instead of static buffers.
+ *
+*******************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <AR/ar.h>
+
+#define WORK_SIZE   1024*32
+
+static void arContextFreeBuffers( ARContext *ctx );
+static void arContextAllocBuffers( ARContext *ctx, int xsize, int ysize );
+
+ARContext *arCreateContext( ARParam *param, ARPattTable *patt )
+{
+    ARContext   *ctx;
+
+    arMalloc( ctx, ARContext, 1 );
+    memset( ctx, 0, sizeof(ARContext) );
+
+    ctx->image_proc_mode        = arImageProcMode;
+    ctx->template_matching_mode = arTemplateMatchingMode;
+    ctx->matching_pca_mode      = arMatchingPCAMode;
+
+    if( patt == NULL ) {
+        ctx->patt     = arPattTableCreate();
+        ctx->own_patt = 1;
+    }
+    else {
+        ctx->patt     = patt;
+        ctx->own_patt = 0;
+    }
+
+    if( param != NULL ) arContextInitCparam( ctx, param );
+
+    return ctx;
+}
+
+void arDeleteContext( ARContext *ctx )
+{
+    if( ctx == NULL ) return;
+
+    arContextFreeBuffers( ctx );
+    if( ctx->own_patt ) arPattTableDelete( ctx->patt );
+    free( ctx );
+}
+
+int arContextInitCparam( ARContext *ctx, ARParam *param )
+{
+    if( param->xsize != ctx->xsize || param->ysize != ctx->ysize ) {
+        ctx->prev_num   = 0;
+        ctx->marker_num = 0;
+    }
+    ctx->param = *param;
+    arContextAllocBuffers( ctx, param->xsize, param->ysize );
+
+    return(0);
+}
+
+int arContextLoadPatt( ARContext *ctx, const char *filename )
+{
+    return arPattTableLoad( ctx->patt, filename );
+}
+
+ARContext *arGetGlobalContext( int LorR )
+{
+    static ARContext     *global_ctx[2] = { NULL, NULL };
+    static ARPattTable   *global_patt = NULL;
+    ARContext            *ctx;
+
+    if( global_patt == NULL ) global_patt = arPattTableCreate();
+
+    ctx = global_ctx[LorR? 0: 1];
+    if( ctx == NULL ) {
+        ctx = global_ctx[LorR? 0: 1] = arCreateContext( NULL, global_patt );
+    }
+
+    ctx->param                  = arParam;
+    ctx->image_proc_mode        = arImageProcMode;
+    ctx->template_matching_mode = arTemplateMatchingMode;
+    ctx->matching_pca_mode      = arMatchingPCAMode;
+    arContextAllocBuffers( ctx, arImXsize, arImYsize );
+
+    return ctx;
+}
+
+/*
+ * The label image covers the full image (also large enough for AR_IMAGE_PROC_IN_HALF),
+ * the labeling buffers keep at least WORK_SIZE labels and grow with the image area
+ * beyond 1024x1024, the size of the former static buffers.
+ */
+static void arContextAllocBuffers( ARContext *ctx, int xsize, int ysize )
+{
+    int     size, work_size;
+
+    ctx->xsize = xsize;
+    ctx->ysize = ysize;
+
+    size = xsize * ysize;
+    if( size <= 0 ) return;
+
+    if( size > ctx->buffer_size ) {
+        free( ctx->l_image );
+        arMalloc( ctx->l_image, ARInt16, size );
+        /* the unrolled border clearing of labeling2 relies on a zeroed buffer */
+        memset( ctx->l_image, 0, size*sizeof(ARInt16) );
+        ctx->buffer_size = size;
+    }
+
+    work_size = size / 32;
+    if( work_size < WORK_SIZE ) work_size = WORK_SIZE;
+    if( work_size > ctx->work_size ) {
+        free( ctx->work );
+        free( ctx->work2 );
+        free( ctx->warea );
+        free( ctx->wclip );
+        free( ctx->wpos );
+        arMalloc( ctx->work,  int,    work_size );
+        arMalloc( ctx->work2, int,    work_size*7 );
+        arMalloc( ctx->warea, int,    work_size );
+        arMalloc( ctx->wclip, int,    work_size*4 );
+        arMalloc( ctx->wpos,  double, work_size*2 );
+        ctx->work_size  = work_size;
+        ctx->wlabel_num = 0;
+    }
+}
+
+static void arContextFreeBuffers( ARContext *ctx )
+{
+    free( ctx->l_image );
+    free( ctx->work );
+    free( ctx->work2 );
+    free( ctx->warea );
+    free( ctx->wclip );
+    free( ctx->wpos );
+    ctx->l_image = NULL;
+    ctx->work = ctx->work2 = ctx->warea = ctx->wclip = NULL;
+    ctx->wpos = NULL;
+    ctx->buffer_size = 0;
+    ctx->work_size   = 0;
+    ctx->wlabel_num  = 0;
+}
@@ -1,18 +1,25 @@
 #include <stdio.h>
 #include <AR/ar.h>
 
-static ARMarkerInfo2          *marker_info2;
-static ARMarkerInfo           *wmarker_info;
-static int                    wmarker_num = 0;
-
-static arPrevInfo             prev_info[AR_SQUARE_MAX];
-static int                    prev_num = 0;
-
 static arPrevInfo             sprev_info[2][AR_SQUARE_MAX];
 static int                    sprev_num[2] = {0,0};
 
+static int detect_marker( ARContext *ctx, ARUint8 *dataPtr, ARInt16 *limage,
+                          int label_num, int *area, double *pos, int *clip, int *label_ref,
+                          ARMarkerInfo **marker_info, int *marker_num );
+static int detect_marker_lite( ARContext *ctx, ARUint8 *dataPtr, ARInt16 *limage,
+                               int label_num, int *area, double *pos, int *clip, int *label_ref,
+                               ARMarkerInfo **marker_info, int *marker_num, ARMarkerInfo2 **m_info2 );
+
 int arSavePatt( ARUint8 *image, ARMarkerInfo *marker_info, char *filename )
 {
+    return arContextSavePatt( arGetGlobalContext(1), image, marker_info, filename );
+}
+
+int arContextSavePatt( ARContext *ctx, ARUint8 *image, ARMarkerInfo *marker_info, char *filename )
+{
+    ARMarkerInfo2 *marker_info2 = ctx->marker_info2;
+    int        wmarker_num = ctx->marker_num;
     FILE      *fp;
     ARUint8   ext_pat[4][AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
     int       vertex[4];
@@ -30,7 +37,7 @@ int arSavePatt( ARUint8 *image, ARMarkerInfo *marker_info, char *filename )
         for( k = 0; k < 4; k++ ) {
             vertex[k] = marker_info2[i].vertex[(k+j+2)%4];
         }
-        arGetPatt( image, marker_info2[i].x_coord,
+        arContextGetPatt( ctx, image, marker_info2[i].x_coord,
                    marker_info2[i].y_coord, vertex, ext_pat[j] );
     }
 
@@ -58,14 +65,11 @@ int arSavePatt( ARUint8 *image, ARMarkerInfo *marker_info, char *filename )
 int arDetectMarker( ARUint8 *dataPtr, int thresh,
                     ARMarkerInfo **marker_info, int *marker_num )
 {
+    ARContext              *ctx = arGetGlobalContext( 1 );
     ARInt16                *limage;
     int                    label_num;
     int                    *area, *clip, *label_ref;
     double                 *pos;
-    double                 rarea, rlen, rlenmin;
-    double                 diff, diffmin;
-    int                    cid, cdir;
-    int                    i, j, k;
 
     *marker_num = 0;
 
@@ -73,15 +77,52 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
                          &label_num, &area, &pos, &clip, &label_ref );
     if( limage == 0 )    return -1;
 
-    marker_info2 = arDetectMarker2( limage, label_num, label_ref,
-                                    area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
-                                    1.0, &wmarker_num);
+    return detect_marker( ctx, dataPtr, limage, label_num, area, pos, clip, label_ref,
+                          marker_info, marker_num );
+}
+
+int arContextDetectMarker( ARContext *ctx, ARUint8 *dataPtr, int thresh,
+                           ARMarkerInfo **marker_info, int *marker_num )
+{
+    ARInt16                *limage;
+    int                    label_num;
+    int                    *area, *clip, *label_ref;
+    double                 *pos;
+
+    *marker_num = 0;
+
+    limage = arContextLabeling( ctx, dataPtr, thresh,
+                                &label_num, &area, &pos, &clip, &label_ref );
+    if( limage == 0 )    return -1;
+
+    return detect_marker( ctx, dataPtr, limage, label_num, area, pos, clip, label_ref,
+                          marker_info, marker_num );
+}
+
+static int detect_marker( ARContext *ctx, ARUint8 *dataPtr, ARInt16 *limage,
+                          int label_num, int *area, double *pos, int *clip, int *label_ref,
+                          ARMarkerInfo **marker_info, int *marker_num )
+{
+    ARMarkerInfo2          *marker_info2;
+    ARMarkerInfo           *wmarker_info;
+    int                    wmarker_num;
+    arPrevInfo             *prev_info = ctx->prev_info;
+    double                 rarea, rlen, rlenmin;
+    double                 diff, diffmin;
+    int                    cid, cdir;
+    int                    i, j, k;
+
+    ctx->marker_num = 0;
+
+    marker_info2 = arContextDetectMarker2( ctx, limage, label_num, label_ref,
+                                           area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                           1.0, &wmarker_num);
     if( marker_info2 == 0 ) return -1;
 
-    wmarker_info = arGetMarkerInfo( dataPtr, marker_info2, &wmarker_num );
+    wmarker_info = arContextGetMarkerInfo( ctx, dataPtr, marker_info2, &wmarker_num );
     if( wmarker_info == 0 ) return -1;
 
-    for( i = 0; i < prev_num; i++ ) {
+    for( i = 0; i < ctx->prev_num; i++ ) {
         rlenmin = 10.0;
         cid = -1;
         for( j = 0; j < wmarker_num; j++ ) {
@@ -128,27 +169,27 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
 
 /*------------------------------------------------------------*/
 
-    for( i = j = 0; i < prev_num; i++ ) {
+    for( i = j = 0; i < ctx->prev_num; i++ ) {
         prev_info[i].count++;
         if( prev_info[i].count < 4 ) {
             prev_info[j] = prev_info[i];
             j++;
         }
     }
-    prev_num = j;
+    ctx->prev_num = j;
 
     for( i = 0; i < wmarker_num; i++ ) {
         if( wmarker_info[i].id < 0 ) continue;
 
-        for( j = 0; j < prev_num; j++ ) {
+        for( j = 0; j < ctx->prev_num; j++ ) {
             if( prev_info[j].marker.id == wmarker_info[i].id ) break;
         }
         prev_info[j].marker = wmarker_info[i];
         prev_info[j].count  = 1;
-        if( j == prev_num ) prev_num++;
+        if( j == ctx->prev_num ) ctx->prev_num++;
     }
 
-    for( i = 0; i < prev_num; i++ ) {
+    for( i = 0; i < ctx->prev_num; i++ ) {
         for( j = 0; j < wmarker_num; j++ ) {
             rarea = (double)prev_info[i].marker.area / (double)wmarker_info[j].area;
             if( rarea < 0.7 || rarea > 1.43 ) continue;
@@ -165,6 +206,7 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
     }
 
 
+    ctx->marker_num = wmarker_num;
     *marker_num  = wmarker_num;
     *marker_info = wmarker_info;
 
@@ -175,11 +217,11 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
 int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                         ARMarkerInfo **marker_info, int *marker_num, ARMarkerInfo2 **m_info2)
 {
+    ARContext              *ctx = arGetGlobalContext( 1 );
     ARInt16                *limage;
     int                    label_num;
     int                    *area, *clip, *label_ref;
     double                 *pos;
-    int                    i;
 
     *marker_num = 0;
 
@@ -187,12 +229,45 @@ int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                          &label_num, &area, &pos, &clip, &label_ref );
     if( limage == 0 )    return -1;
 
-    marker_info2 = arDetectMarker2( limage, label_num, label_ref,
-                                    area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
-                                    1.0, &wmarker_num);
+    return detect_marker_lite( ctx, dataPtr, limage, label_num, area, pos, clip, label_ref,
+                               marker_info, marker_num, m_info2 );
+}
+
+int arContextDetectMarkerLite( ARContext *ctx, ARUint8 *dataPtr, int thresh,
+                               ARMarkerInfo **marker_info, int *marker_num, ARMarkerInfo2 **m_info2)
+{
+    ARInt16                *limage;
+    int                    label_num;
+    int                    *area, *clip, *label_ref;
+    double                 *pos;
+
+    *marker_num = 0;
+
+    limage = arContextLabeling( ctx, dataPtr, thresh,
+                                &label_num, &area, &pos, &clip, &label_ref );
+    if( limage == 0 )    return -1;
+
+    return detect_marker_lite( ctx, dataPtr, limage, label_num, area, pos, clip, label_ref,
+                               marker_info, marker_num, m_info2 );
+}
+
+static int detect_marker_lite( ARContext *ctx, ARUint8 *dataPtr, ARInt16 *limage,
+                               int label_num, int *area, double *pos, int *clip, int *label_ref,
+                               ARMarkerInfo **marker_info, int *marker_num, ARMarkerInfo2 **m_info2 )
+{
+    ARMarkerInfo2          *marker_info2;
+    ARMarkerInfo           *wmarker_info;
+    int                    wmarker_num;
+    int                    i;
+
+    ctx->marker_num = 0;
+
+    marker_info2 = arContextDetectMarker2( ctx, limage, label_num, label_ref,
+                                           area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                           1.0, &wmarker_num);
     if( marker_info2 == 0 ) return -1;
 
-    wmarker_info = arGetMarkerInfo( dataPtr, marker_info2, &wmarker_num );
+    wmarker_info = arContextGetMarkerInfo( ctx, dataPtr, marker_info2, &wmarker_num );
     if( wmarker_info == 0 ) return -1;
 
     for( i = 0; i < wmarker_num; i++ ) {
@@ -200,6 +275,7 @@ int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
     }
 
 
+    ctx->marker_num = wmarker_num;
     *marker_num  = wmarker_num;
     *marker_info = wmarker_info;
 		if(m_info2 != NULL){
@@ -211,6 +287,10 @@ int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
 int arsDetectMarker( ARUint8 *dataPtr, int thresh,
                      ARMarkerInfo **marker_info, int *marker_num, int LorR )
 {
+    ARContext              *ctx;
+    ARMarkerInfo2          *marker_info2;
+    ARMarkerInfo           *wmarker_info;
+    int                    wmarker_num;
     ARInt16                *limage;
     int                    label_num;
     int                    *area, *clip, *label_ref;
@@ -226,9 +306,11 @@ int arsDetectMarker( ARUint8 *dataPtr, int thresh,
                           &label_num, &area, &pos, &clip, &label_ref, LorR );
     if( limage == 0 )    return -1;
 
-    marker_info2 = arDetectMarker2( limage, label_num, label_ref,
-                                    area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
-                                    1.0, &wmarker_num);
+    ctx = arGetGlobalContext( LorR );
+    ctx->marker_num = 0;
+    marker_info2 = arContextDetectMarker2( ctx, limage, label_num, label_ref,
+                                           area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                           1.0, &wmarker_num);
     if( marker_info2 == 0 ) return -1;
 
     wmarker_info = arsGetMarkerInfo( dataPtr, marker_info2, &wmarker_num, LorR );
@@ -284,6 +366,7 @@ int arsDetectMarker( ARUint8 *dataPtr, int thresh,
     }
     sprev_num[LorR] = j;
 
+    ctx->marker_num = wmarker_num;
     *marker_num  = wmarker_num;
     *marker_info = wmarker_info;
 
@@ -293,6 +376,10 @@ int arsDetectMarker( ARUint8 *dataPtr, int thresh,
 int arsDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                          ARMarkerInfo **marker_info, int *marker_num, int LorR )
 {
+    ARContext              *ctx;
+    ARMarkerInfo2          *marker_info2;
+    ARMarkerInfo           *wmarker_info;
+    int                    wmarker_num;
     ARInt16                *limage;
     int                    label_num;
     int                    *area, *clip, *label_ref;
@@ -305,9 +392,11 @@ int arsDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                           &label_num, &area, &pos, &clip, &label_ref, LorR );
     if( limage == 0 )    return -1;
 
-    marker_info2 = arDetectMarker2( limage, label_num, label_ref,
-                                    area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
-                                    1.0, &wmarker_num);
+    ctx = arGetGlobalContext( LorR );
+    ctx->marker_num = 0;
+    marker_info2 = arContextDetectMarker2( ctx, limage, label_num, label_ref,
+                                           area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                           1.0, &wmarker_num);
     if( marker_info2 == 0 ) return -1;
 
     wmarker_info = arsGetMarkerInfo( dataPtr, marker_info2, &wmarker_num, LorR );
@@ -318,6 +407,7 @@ int arsDetectMarkerLite( ARUint8 *dataPtr, int thresh,
     }
 
 
+    ctx->marker_num = wmarker_num;
     *marker_num  = wmarker_num;
     *marker_info = wmarker_info;
 
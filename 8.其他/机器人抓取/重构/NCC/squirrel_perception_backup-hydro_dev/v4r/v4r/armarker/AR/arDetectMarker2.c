@@ -16,27 +16,34 @@ static int check_square( int area, ARMarkerInfo2 *marker_info2, double factor );
 static int get_vertex( int x_coord[], int y_coord[], int st, int ed,
                        double thresh, int vertex[], int *vnum );
 
-static ARMarkerInfo2    marker_info2[AR_SQUARE_MAX];
-
 ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
                                 int *warea, double *wpos, int *wclip,
                                 int area_max, int area_min, double factor, int *marker_num )
 {
+    return arContextDetectMarker2( arGetGlobalContext(1), limage, label_num, label_ref,
+                                   warea, wpos, wclip, area_max, area_min, factor, marker_num );
+}
+
+ARMarkerInfo2 *arContextDetectMarker2( ARContext *ctx, ARInt16 *limage, int label_num, int *label_ref,
+                                       int *warea, double *wpos, int *wclip,
+                                       int area_max, int area_min, double factor, int *marker_num )
+{
+    ARMarkerInfo2     *marker_info2 = ctx->marker_info2;
     ARMarkerInfo2     *pm;
     int               xsize, ysize;
     int               marker_num2;
     int               i, j, ret;
     double            d;
 
-    if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
+    if( ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF ) {
         area_min /= 4;
         area_max /= 4;
-        xsize = arImXsize / 2;
-        ysize = arImYsize / 2;
+        xsize = ctx->xsize / 2;
+        ysize = ctx->ysize / 2;
     }
     else {
-        xsize = arImXsize;
-        ysize = arImYsize;
+        xsize = ctx->xsize;
+        ysize = ctx->ysize;
     }
     marker_num2 = 0;
     for(i=0; i<label_num; i++ ) {
@@ -44,7 +51,7 @@ ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
         if( wclip[i*4+0] == 1 || wclip[i*4+1] == xsize-2 ) continue;
         if( wclip[i*4+2] == 1 || wclip[i*4+3] == ysize-2 ) continue;
 
-        ret = arGetContour( limage, label_ref, i+1,
+        ret = arContextGetContour( ctx, limage, label_ref, i+1,
                             &(wclip[i*4]), &(marker_info2[marker_num2]));
         if( ret < 0 ) continue;
 
@@ -85,7 +92,7 @@ ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
         }
     }
 
-    if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
+    if( ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF ) {
         pm = &(marker_info2[0]);
         for( i = 0; i < marker_num2; i++ ) {
             pm->area *= 4;
@@ -106,23 +113,29 @@ ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
 int arGetContour( ARInt16 *limage, int *label_ref,
                   int label, int clip[4], ARMarkerInfo2 *marker_info2 )
 {
-    static int      xdir[8] = { 0, 1, 1, 1, 0,-1,-1,-1};
-    static int      ydir[8] = {-1,-1, 0, 1, 1, 1, 0,-1};
-    static int      wx[AR_CHAIN_MAX];
-    static int      wy[AR_CHAIN_MAX];
+    return arContextGetContour( arGetGlobalContext(1), limage, label_ref, label, clip, marker_info2 );
+}
+
+int arContextGetContour( ARContext *ctx, ARInt16 *limage, int *label_ref,
+                         int label, int clip[4], ARMarkerInfo2 *marker_info2 )
+{
+    static const int xdir[8] = { 0, 1, 1, 1, 0,-1,-1,-1};
+    static const int ydir[8] = {-1,-1, 0, 1, 1, 1, 0,-1};
+    int             *wx = ctx->wx;
+    int             *wy = ctx->wy;
     ARInt16         *p1;
     int             xsize, ysize;
     int             sx, sy, dir;
     int             dmax, d, v1;
     int             i, j;
 
-    if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
-        xsize = arImXsize / 2;
-        ysize = arImYsize / 2;
+    if( ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF ) {
+        xsize = ctx->xsize / 2;
+        ysize = ctx->ysize / 2;
     }
     else {
-        xsize = arImXsize;
-        ysize = arImYsize;
+        xsize = ctx->xsize;
+        ysize = ctx->ysize;
     }
     j = clip[2];
     p1 = &(limage[j*xsize+clip[0]]);
@@ -10,6 +10,7 @@
 *******************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <AR/ar.h>
 #include <AR/matrix.h>
@@ -17,43 +18,60 @@
 #define   DEBUG        0
 #define   EVEC_MAX     10
 
-static int    pattern_num = -1;
-static int    patf[AR_PATT_NUM_MAX] = { 0 };
-static int    pat[AR_PATT_NUM_MAX][4][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
-static double patpow[AR_PATT_NUM_MAX][4];
-static int    patBW[AR_PATT_NUM_MAX][4][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
-static double patpowBW[AR_PATT_NUM_MAX][4];
-
-static double evec[EVEC_MAX][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
-static double epat[AR_PATT_NUM_MAX][4][EVEC_MAX];
-static int    evec_dim;
-static int    evecf = 0;
-//static double evecBW[EVEC_MAX][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
-//static double epatBW[AR_PATT_NUM_MAX][4][EVEC_MAX];
-//static int    evec_dimBW;
-static int    evecBWf = 0;
+struct ARPattTable {
+    int    pattern_num;
+    int    patf[AR_PATT_NUM_MAX];
+    int    pat[AR_PATT_NUM_MAX][4][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
+    double patpow[AR_PATT_NUM_MAX][4];
+    int    patBW[AR_PATT_NUM_MAX][4][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
+    double patpowBW[AR_PATT_NUM_MAX][4];
+
+    double evec[EVEC_MAX][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
+    double epat[AR_PATT_NUM_MAX][4][EVEC_MAX];
+    int    evec_dim;
+    int    evecf;
+//  double evecBW[EVEC_MAX][AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
+//  double epatBW[AR_PATT_NUM_MAX][4][EVEC_MAX];
+//  int    evec_dimBW;
+    int    evecBWf;
+};
 
 static void   get_cpara( double world[4][2], double vertex[4][2],
                          double para[3][3] );
-static int    pattern_match( ARUint8 *data, int *code, int *dir, double *cf );
+static int    pattern_match( ARContext *ctx, ARUint8 *data, int *code, int *dir, double *cf );
 static void   put_zero( ARUint8 *p, int size );
-static void   gen_evec(void);
+static void   gen_evec( ARPattTable *ph );
 
 
+ARPattTable *arPattTableCreate( void )
+{
+    ARPattTable *ph;
+
+    arMalloc( ph, ARPattTable, 1 );
+    put_zero( (ARUint8 *)ph, sizeof(ARPattTable) );
+
+    return ph;
+}
+
+void arPattTableDelete( ARPattTable *ph )
+{
+    free( ph );
+}
+
 int arLoadPatt( const char *filename )
+{
+    return arPattTableLoad( arGetGlobalContext(1)->patt, filename );
+}
+
+int arPattTableLoad( ARPattTable *ph, const char *filename )
 {
     FILE    *fp;
     int     patno;
     int     h, i, j, l, m;
     int     i1, i2, i3;
 
-    if(pattern_num == -1 ) {
-        for( i = 0; i < AR_PATT_NUM_MAX; i++ ) patf[i] = 0;
-        pattern_num = 0;
-    }
-
     for( i = 0; i < AR_PATT_NUM_MAX; i++ ) {
-        if(patf[i] == 0) break;
+        if(ph->patf[i] == 0) break;
     }
     if( i == AR_PATT_NUM_MAX ) return -1;
     patno = i;
@@ -73,10 +91,10 @@ int arLoadPatt( const char *filename )
                         return -1;
                     }
                     j = 255-j;
-                    pat[patno][h][(i2*AR_PATT_SIZE_X+i1)*3+i3] = j;
-                    if( i3 == 0 ) patBW[patno][h][i2*AR_PATT_SIZE_X+i1]  = j;
-                    else          patBW[patno][h][i2*AR_PATT_SIZE_X+i1] += j;
-                    if( i3 == 2 ) patBW[patno][h][i2*AR_PATT_SIZE_X+i1] /= 3;
+                    ph->pat[patno][h][(i2*AR_PATT_SIZE_X+i1)*3+i3] = j;
+                    if( i3 == 0 ) ph->patBW[patno][h][i2*AR_PATT_SIZE_X+i1]  = j;
+                    else          ph->patBW[patno][h][i2*AR_PATT_SIZE_X+i1] += j;
+                    if( i3 == 2 ) ph->patBW[patno][h][i2*AR_PATT_SIZE_X+i1] /= 3;
                     l += j;
                 }
             }
@@ -85,27 +103,27 @@ int arLoadPatt( const char *filename )
 
         m = 0;
         for( i = 0; i < AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3; i++ ) {
-            pat[patno][h][i] -= l;
-            m += (pat[patno][h][i]*pat[patno][h][i]);
+            ph->pat[patno][h][i] -= l;
+            m += (ph->pat[patno][h][i]*ph->pat[patno][h][i]);
         }
-        patpow[patno][h] = sqrt((double)m);
-        if( patpow[patno][h] == 0.0 ) patpow[patno][h] = 0.0000001;
+        ph->patpow[patno][h] = sqrt((double)m);
+        if( ph->patpow[patno][h] == 0.0 ) ph->patpow[patno][h] = 0.0000001;
 
         m = 0;
         for( i = 0; i < AR_PATT_SIZE_Y*AR_PATT_SIZE_X; i++ ) {
-            patBW[patno][h][i] -= l;
-            m += (patBW[patno][h][i]*patBW[patno][h][i]);
+            ph->patBW[patno][h][i] -= l;
+            m += (ph->patBW[patno][h][i]*ph->patBW[patno][h][i]);
         }
-        patpowBW[patno][h] = sqrt((double)m);
-        if( patpowBW[patno][h] == 0.0 ) patpowBW[patno][h] = 0.0000001;
+        ph->patpowBW[patno][h] = sqrt((double)m);
+        if( ph->patpowBW[patno][h] == 0.0 ) ph->patpowBW[patno][h] = 0.0000001;
     }
     fclose(fp);
 
-    patf[patno] = 1;
-    pattern_num++;
+    ph->patf[patno] = 1;
+    ph->pattern_num++;
 
 /*
-    gen_evec();
+    gen_evec( ph );
 */
 
     return( patno );
@@ -113,36 +131,48 @@ int arLoadPatt( const char *filename )
 
 int arFreePatt( int patno )
 {
-    if( patf[patno] == 0 ) return -1;
-
-    patf[patno] = 0;
-    pattern_num--;
+    return arPattTableFree( arGetGlobalContext(1)->patt, patno );
+}
 
-    gen_evec();
+int arActivatePatt( int patno )
+{
+    return arPattTableActivate( arGetGlobalContext(1)->patt, patno, 1 );
+}
 
-    return 1;
+int arDeactivatePatt( int patno )
+{
+    return arPattTableActivate( arGetGlobalContext(1)->patt, patno, 0 );
 }
 
-int arActivatePatt( int patno )
+int arPattTableFree( ARPattTable *ph, int patno )
 {
-    if( patf[patno] == 0 ) return -1;
+    if( ph->patf[patno] == 0 ) return -1;
 
-    patf[patno] = 1;
+    ph->patf[patno] = 0;
+    ph->pattern_num--;
+
+    gen_evec( ph );
 
     return 1;
 }
 
-int arDeactivatePatt( int patno )
+int arPattTableActivate( ARPattTable *ph, int patno, int active )
 {
-    if( patf[patno] == 0 ) return -1;
+    if( ph->patf[patno] == 0 ) return -1;
 
-    patf[patno] = 2;
+    ph->patf[patno] = active? 1: 2;
 
     return 1;
 }
 
 int arGetCode( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
                int *code, int *dir, double *cf )
+{
+    return arContextGetCode( arGetGlobalContext(1), image, x_coord, y_coord, vertex, code, dir, cf );
+}
+
+int arContextGetCode( ARContext *ctx, ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
+                      int *code, int *dir, double *cf )
 {
 #if DEBUG
 static int count = 0;
@@ -155,12 +185,12 @@ double b1, b2, b3;
 #if DEBUG
 b1 = arUtilTimer();
 #endif
-    arGetPatt(image, x_coord, y_coord, vertex, ext_pat);
+    arContextGetPatt(ctx, image, x_coord, y_coord, vertex, ext_pat);
 #if DEBUG
 b2 = arUtilTimer();
 #endif
 
-    pattern_match((ARUint8 *)ext_pat, code, dir, cf);
+    pattern_match(ctx, (ARUint8 *)ext_pat, code, dir, cf);
 #if DEBUG
 b3 = arUtilTimer();
 #endif
@@ -179,9 +209,15 @@ if( count == 60 ) {
     return(0);
 }
 
-#if 1
 int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
                ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
+{
+    return arContextGetPatt( arGetGlobalContext(1), image, x_coord, y_coord, vertex, ext_pat );
+}
+
+#if 1
+int arContextGetPatt( ARContext *ctx, ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
+                      ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
 {
     ARUint32  ext_pat2[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
     double    world[4][2];
@@ -226,7 +262,7 @@ int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
     if( ly2 > ly1 ) ly1 = ly2;
     xdiv2 = AR_PATT_SIZE_X;
     ydiv2 = AR_PATT_SIZE_Y;
-    if( arImageProcMode == AR_IMAGE_PROC_IN_FULL ) {
+    if( ctx->image_proc_mode == AR_IMAGE_PROC_IN_FULL ) {
         while( xdiv2*xdiv2 < lx1/4 ) xdiv2*=2;
         while( ydiv2*ydiv2 < ly1/4 ) ydiv2*=2;
     }
@@ -255,14 +291,14 @@ printf("%3d(%f), %3d(%f)\n", xdiv2, sqrt(lx1), ydiv2, sqrt(ly1));
             if( d == 0 ) return(-1);
             xc = (int)((para[0][0]*xw + para[0][1]*yw + para[0][2])/d);
             yc = (int)((para[1][0]*xw + para[1][1]*yw + para[1][2])/d);
-            if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
+            if( ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF ) {
                 xc = ((xc+1)/2)*2;
                 yc = ((yc+1)/2)*2;
             }
-            if( xc >= 0 && xc < arImXsize && yc >= 0 && yc < arImYsize ) {
+            if( xc >= 0 && xc < ctx->xsize && yc >= 0 && yc < ctx->ysize ) {
 				ext_pat2_y_index = j/ydiv;
 				ext_pat2_x_index = i/xdiv;
-				image_index = (yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT;
+				image_index = (yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT;
 #if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
                 ext_pat2[ext_pat2_y_index][ext_pat2_x_index][0] += image[image_index+3];
                 ext_pat2[ext_pat2_y_index][ext_pat2_x_index][1] += image[image_index+2];
@@ -317,8 +353,8 @@ printf("%3d(%f), %3d(%f)\n", xdiv2, sqrt(lx1), ydiv2, sqrt(ly1));
     return(0);
 }
 #else
-int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
-               ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
+int arContextGetPatt( ARContext *ctx, ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
+                      ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
 {
     double  world[4][2];
     double  local[4][2];
@@ -351,125 +387,125 @@ int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
             if( d == 0 ) return(-1);
             xc = (int)((para[0][0]*xw + para[0][1]*yw + para[0][2])/d);
             yc = (int)((para[1][0]*xw + para[1][1]*yw + para[1][2])/d);
-            if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
+            if( ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF ) {
                 xc = ((xc+1)/2)*2;
                 yc = ((yc+1)/2)*2;
             }
-            if( xc >= 0 && xc < arImXsize && yc >= 0 && yc < arImYsize ) {
+            if( xc >= 0 && xc < ctx->xsize && yc >= 0 && yc < ctx->ysize ) {
 #if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+3];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+3];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
 					+ k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+2];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+2];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
 					+ k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
 					+ k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
                    + k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+2];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+2];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
                    + k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+3];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+3];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
                    + k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
                    + k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
                    + k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+2];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+2];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
                    + k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
                    + k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
                    + k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+2];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+2];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
                    + k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+2];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+2];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
                    + k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
                    + k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
                    + k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+2];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+2];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
                    + k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
                    + k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
                    + k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
 					+ k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
 					+ k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
 					+ k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
 					+ k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
 					+ k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+1];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+1];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
 					+ k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
-                k1 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k1 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k1 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0]
 					+ k1*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][0] = (k1 > 255)? 255: k1;
-                k2 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k2 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k2 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1]
 					+ k2*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][1] = (k2 > 255)? 255: k2;
-                k3 = image[(yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT+0];
+                k3 = image[(yc*ctx->xsize+xc)*AR_PIX_SIZE_DEFAULT+0];
                 k3 = ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2]
 					+ k3*(AR_PATT_SIZE_Y*AR_PATT_SIZE_X)/(AR_PATT_SAMPLE_NUM*AR_PATT_SAMPLE_NUM);
                 ext_pat[j*AR_PATT_SIZE_Y/AR_PATT_SAMPLE_NUM][i*AR_PATT_SIZE_X/AR_PATT_SAMPLE_NUM][2] = (k3 > 255)? 255: k3;
@@ -528,8 +564,9 @@ static void get_cpara( double world[4][2], double vertex[4][2],
     arMatrixFree( c );
 }
 
-static int pattern_match( ARUint8 *data, int *code, int *dir, double *cf )
+static int pattern_match( ARContext *ctx, ARUint8 *data, int *code, int *dir, double *cf )
 {
+    ARPattTable *ph = ctx->patt;
     double invec[EVEC_MAX];
     int    input[AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3];
     int    i, j, l;
@@ -544,7 +581,7 @@ static int pattern_match( ARUint8 *data, int *code, int *dir, double *cf )
     }
     ave /= (AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3);
 
-    if( arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR ) {
+    if( ctx->template_matching_mode == AR_TEMPLATE_MATCHING_COLOR ) {
         for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;i++) {
             input[i] = (255-data[i]) - ave;
             sum += input[i]*input[i];
@@ -566,30 +603,30 @@ static int pattern_match( ARUint8 *data, int *code, int *dir, double *cf )
     }
 
     res = res2 = -1;
-    if( arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR ) {
-        if( arMatchingPCAMode == AR_MATCHING_WITH_PCA && evecf ) {
+    if( ctx->template_matching_mode == AR_TEMPLATE_MATCHING_COLOR ) {
+        if( ctx->matching_pca_mode == AR_MATCHING_WITH_PCA && ph->evecf ) {
 
-            for( i = 0; i < evec_dim; i++ ) {
+            for( i = 0; i < ph->evec_dim; i++ ) {
                 invec[i] = 0.0;
                 for( j = 0; j < AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3; j++ ) {
-                    invec[i] += evec[i][j] * input[j];
+                    invec[i] += ph->evec[i][j] * input[j];
                 }
                 invec[i] /= datapow;
             }
 
             min = 10000.0;
             k = -1;
-            for( l = 0; l < pattern_num; l++ ) {
+            for( l = 0; l < ph->pattern_num; l++ ) {
                 k++;
-                while( patf[k] == 0 ) k++;
-                if( patf[k] == 2 ) continue;
+                while( ph->patf[k] == 0 ) k++;
+                if( ph->patf[k] == 2 ) continue;
 #if DEBUG
                 printf("%3d: ", k);
 #endif
                 for( j = 0; j < 4; j++ ) {
                     sum2 = 0;
-                    for(i = 0; i < evec_dim; i++ ) {
-                        sum2 += (invec[i] - epat[k][j][i]) * (invec[i] - epat[k][j][i]);
+                    for(i = 0; i < ph->evec_dim; i++ ) {
+                        sum2 += (invec[i] - ph->epat[k][j][i]) * (invec[i] - ph->epat[k][j][i]);
                     }
 #if DEBUG
                     printf("%10.7f ", sum2);
@@ -601,34 +638,34 @@ static int pattern_match( ARUint8 *data, int *code, int *dir, double *cf )
 #endif
             }
             sum = 0;
-            for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;i++) sum += input[i]*pat[res2][res][i];
-            max = sum / patpow[res2][res] / datapow;
+            for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;i++) sum += input[i]*ph->pat[res2][res][i];
+            max = sum / ph->patpow[res2][res] / datapow;
         }
         else {
             k = -1;
             max = 0.0;
-            for( l = 0; l < pattern_num; l++ ) {
+            for( l = 0; l < ph->pattern_num; l++ ) {
                 k++;
-                while( patf[k] == 0 ) k++;
-                if( patf[k] == 2 ) continue;
+                while( ph->patf[k] == 0 ) k++;
+                if( ph->patf[k] == 2 ) continue;
                 for( j = 0; j < 4; j++ ) {
                     sum = 0;
-                    for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;i++) sum += input[i]*pat[k][j][i];
-                    sum2 = sum / patpow[k][j] / datapow;
+                    for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;i++) sum += input[i]*ph->pat[k][j][i];
+                    sum2 = sum / ph->patpow[k][j] / datapow;
                     if( sum2 > max ) { max = sum2; res = j; res2 = k; }
                 }
             }
         }
     }
     else {
-        for( l = 0; l < pattern_num; l++ ) {
+        for( l = 0; l < ph->pattern_num; l++ ) {
             k++;
-            while( patf[k] == 0 ) k++;
-            if( patf[k] == 2 ) continue;
+            while( ph->patf[k] == 0 ) k++;
+            if( ph->patf[k] == 2 ) continue;
             for( j = 0; j < 4; j++ ) {
                 sum = 0;
-                for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X;i++) sum += input[i]*patBW[k][j][i];
-                sum2 = sum / patpowBW[k][j] / datapow;
+                for(i=0;i<AR_PATT_SIZE_Y*AR_PATT_SIZE_X;i++) sum += input[i]*ph->patBW[k][j][i];
+                sum2 = sum / ph->patpowBW[k][j] / datapow;
                 if( sum2 > max ) { max = sum2; res = j; res2 = k; }
             }
         }
@@ -650,7 +687,7 @@ static void   put_zero( ARUint8 *p, int size )
     while( (size--) > 0 ) *(p++) = 0;
 }
 
-static void gen_evec(void)
+static void gen_evec( ARPattTable *ph )
 {
     int    i, j, k, ii, jj;
     ARMat  *input, *wevec;
@@ -658,9 +695,9 @@ static void gen_evec(void)
     double sum, sum2;
     int    dim;
 
-    if( pattern_num < 4 ) {
-        evecf   = 0;
-        evecBWf = 0;
+    if( ph->pattern_num < 4 ) {
+        ph->evecf   = 0;
+        ph->evecBWf = 0;
         return;
     }
 
@@ -668,16 +705,16 @@ static void gen_evec(void)
     printf("------------------------------------------\n");
 #endif
 
-    dim = (pattern_num*4 < AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3)? pattern_num*4: AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;
-    input  = arMatrixAlloc( pattern_num*4, AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3 );
+    dim = (ph->pattern_num*4 < AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3)? ph->pattern_num*4: AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;
+    input  = arMatrixAlloc( ph->pattern_num*4, AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3 );
     wevec   = arMatrixAlloc( dim, AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3 );
     wev     = arVecAlloc( dim );
 
     for( j = jj = 0; jj < AR_PATT_NUM_MAX; jj++ ) {
-        if( patf[jj] == 0 ) continue;
+        if( ph->patf[jj] == 0 ) continue;
         for( k = 0; k < 4; k++ ) {
             for( i = 0; i < AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3; i++ ) {
-                input->m[(j*4+k)*AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3+i] = pat[j][k][i] / patpow[j][k];
+                input->m[(j*4+k)*AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3+i] = ph->pat[j][k][i] / ph->patpow[j][k];
             }
         }
         j++;
@@ -687,8 +724,8 @@ static void gen_evec(void)
         arMatrixFree( input );
         arMatrixFree( wevec );
         arVecFree( wev );
-        evecf   = 0;
-        evecBWf = 0;
+        ph->evecf   = 0;
+        ph->evecBWf = 0;
         return;
     }
 
@@ -701,30 +738,30 @@ static void gen_evec(void)
         if( sum > 0.90 ) break;
         if( i == EVEC_MAX-1 ) break;
     }
-    evec_dim = i+1;
+    ph->evec_dim = i+1;
 
-    for( j = 0; j < evec_dim; j++ ) {
+    for( j = 0; j < ph->evec_dim; j++ ) {
         for( i = 0; i < AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3; i++ ) {
-            evec[j][i] = wevec->m[j*AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3+i];
+            ph->evec[j][i] = wevec->m[j*AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3+i];
         }
     }
     
     for( i = 0; i < AR_PATT_NUM_MAX; i++ ) {
-        if(patf[i] == 0) continue;
+        if(ph->patf[i] == 0) continue;
         for( j = 0; j < 4; j++ ) {
 #if DEBUG
             printf("%2d[%d]: ", i+1, j+1);
 #endif
             sum2 = 0.0;
-            for( k = 0; k < evec_dim; k++ ) {
+            for( k = 0; k < ph->evec_dim; k++ ) {
                 sum = 0.0;
                 for(ii=0;ii<AR_PATT_SIZE_Y*AR_PATT_SIZE_X*3;ii++) {
-                    sum += evec[k][ii] * pat[i][j][ii] / patpow[i][j];
+                    sum += ph->evec[k][ii] * ph->pat[i][j][ii] / ph->patpow[i][j];
                 }
 #if DEBUG
                 printf("%10.7f ", sum);
 #endif
-                epat[i][j][k] = sum;
+                ph->epat[i][j][k] = sum;
                 sum2 += sum*sum;
             }
 #if DEBUG
@@ -737,8 +774,8 @@ static void gen_evec(void)
     arMatrixFree( wevec );
     arVecFree( wev );
 
-    evecf   = 1;
-    evecBWf = 0;
+    ph->evecf   = 1;
+    ph->evecBWf = 0;
 
     return;
 }
@@ -11,12 +11,16 @@
 
 #include <AR/ar.h>
 
-static ARMarkerInfo    marker_infoL[AR_SQUARE_MAX];
-static ARMarkerInfo    marker_infoR[AR_SQUARE_MAX];
-
 ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
                                ARMarkerInfo2 *marker_info2, int *marker_num )
 {
+    return arContextGetMarkerInfo( arGetGlobalContext(1), image, marker_info2, marker_num );
+}
+
+ARMarkerInfo *arContextGetMarkerInfo( ARContext *ctx, ARUint8 *image,
+                                      ARMarkerInfo2 *marker_info2, int *marker_num )
+{
+    ARMarkerInfo   *marker_infoL = ctx->marker_info;
     int            id, dir;
     double         cf;
     int            i, j;
@@ -26,11 +30,11 @@ ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
         marker_infoL[j].pos[0] = marker_info2[i].pos[0];
         marker_infoL[j].pos[1] = marker_info2[i].pos[1];
 
-        if (arGetLine(marker_info2[i].x_coord, marker_info2[i].y_coord,
-                      marker_info2[i].coord_num, marker_info2[i].vertex,
-                      marker_infoL[j].line, marker_infoL[j].vertex) < 0 ) continue;
+        if (arContextGetLine(ctx, marker_info2[i].x_coord, marker_info2[i].y_coord,
+                             marker_info2[i].coord_num, marker_info2[i].vertex,
+                             marker_infoL[j].line, marker_infoL[j].vertex) < 0 ) continue;
 
-        arGetCode(image,
+        arContextGetCode(ctx, image,
                   marker_info2[i].x_coord, marker_info2[i].y_coord,
                   marker_info2[i].vertex, &id, &dir, &cf );
 
@@ -48,14 +52,12 @@ ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
 ARMarkerInfo *arsGetMarkerInfo( ARUint8 *image,
                                 ARMarkerInfo2 *marker_info2, int *marker_num, int LorR )
 {
-    ARMarkerInfo   *info;
+    ARContext      *ctx = arGetGlobalContext( LorR );
+    ARMarkerInfo   *info = ctx->marker_info;
     int            id, dir;
     double         cf;
     int            i, j;
 
-    if (LorR) info = &marker_infoL[0];
-	else      info = &marker_infoR[0];
-
     for (i = j = 0; i < *marker_num; i++) {
         info[j].area   = marker_info2[i].area;
         info[j].pos[0] = marker_info2[i].pos[0];
@@ -65,7 +67,7 @@ ARMarkerInfo *arsGetMarkerInfo( ARUint8 *image,
                        marker_info2[i].coord_num, marker_info2[i].vertex,
                        info[j].line, info[j].vertex, LorR) < 0 ) continue;
 
-        arGetCode(image,
+        arContextGetCode(ctx, image,
                   marker_info2[i].x_coord, marker_info2[i].y_coord,
                   marker_info2[i].vertex, &id, &dir, &cf );
 
@@ -24,52 +24,28 @@
 #endif
 
 #define USE_OPTIMIZATIONS
-#define WORK_SIZE   1024*32
 
 /*****************************************************************************/
-// BUG in ARToolkit 2.65
-// Hardcoded buffer (600*500) is too small for full-size DV-PAL/NTSC resolutions of
-// 720x576 and 720x480, respectively. Results in segment faults.
-/*
-static ARInt16      l_imageL[640*500];
-static ARInt16      l_imageR[640*500];
-*/
-
-#define HARDCODED_BUFFER_WIDTH  1024
-#define HARDCODED_BUFFER_HEIGHT 1024
-
-static ARInt16      l_imageL[HARDCODED_BUFFER_WIDTH*HARDCODED_BUFFER_HEIGHT];
-static ARInt16      l_imageR[HARDCODED_BUFFER_WIDTH*HARDCODED_BUFFER_HEIGHT];
+// The label image and the labeling buffers were static arrays of a hardcoded
+// size (640*500 in ARToolkit 2.65, later 1024*1024) shared by all callers.
+// They are now part of the ARContext and allocated for the image size.
 /*****************************************************************************/
 
-
-static int          workL[WORK_SIZE];
-static int          workR[WORK_SIZE];
-static int          work2L[WORK_SIZE*7];
-static int          work2R[WORK_SIZE*7];
-
-static int          wlabel_numL;
-static int          wlabel_numR;
-static int          wareaL[WORK_SIZE];
-static int          wareaR[WORK_SIZE];
-static int          wclipL[WORK_SIZE*4];
-static int          wclipR[WORK_SIZE*4];
-static double       wposL[WORK_SIZE*2];
-static double       wposR[WORK_SIZE*2];
-
-static ARInt16 *labeling2( ARUint8 *image, int thresh,
+static ARInt16 *labeling2( ARContext *ctx, ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
-                           int **label_ref, int LorR );
-static ARInt16 *labeling3( ARUint8 *image, int thresh,
+                           int **label_ref );
+static ARInt16 *labeling3( ARContext *ctx, ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
                            int **label_ref, int LorR );
 
 void arGetImgFeature( int *num, int **area, int **clip, double **pos )
 {
-    *num  = wlabel_numL;
-    *area = wareaL;
-    *clip = wclipL;
-    *pos  = wposL;
+    ARContext *ctx = arGetGlobalContext( 1 );
+
+    *num  = ctx->wlabel_num;
+    *area = ctx->warea;
+    *clip = ctx->wclip;
+    *pos  = ctx->wpos;
 
     return;
 }
@@ -78,28 +54,33 @@ ARInt16 *arLabeling( ARUint8 *image, int thresh,
                      int *label_num, int **area, double **pos, int **clip,
                      int **label_ref )
 {
+    ARContext *ctx = arGetGlobalContext( 1 );
+
     if( arDebug ) {
-        return( labeling3(image, thresh, label_num,
+        return( labeling3(ctx, image, thresh, label_num,
                           area, pos, clip, label_ref, 1) );
     } else {
-        return( labeling2(image, thresh, label_num,
-                          area, pos, clip, label_ref, 1) );
+        return( labeling2(ctx, image, thresh, label_num,
+                          area, pos, clip, label_ref) );
     }
 }
 
+ARInt16 *arContextLabeling( ARContext *ctx, ARUint8 *image, int thresh,
+                            int *label_num, int **area, double **pos, int **clip,
+                            int **label_ref )
+{
+    return( labeling2(ctx, image, thresh, label_num,
+                      area, pos, clip, label_ref) );
+}
+
 void arsGetImgFeature( int *num, int **area, int **clip, double **pos, int LorR )
 {
-    if (LorR) {
-        *num  = wlabel_numL;
-        *area = wareaL;
-        *clip = wclipL;
-        *pos  = wposL;
-    } else {
-        *num  = wlabel_numR;
-        *area = wareaR;
-        *clip = wclipR;
-        *pos  = wposR;
-    }
+    ARContext *ctx = arGetGlobalContext( LorR );
+
+    *num  = ctx->wlabel_num;
+    *area = ctx->warea;
+    *clip = ctx->wclip;
+    *pos  = ctx->wpos;
 
     return;
 }
@@ -108,18 +89,20 @@ ARInt16 *arsLabeling( ARUint8 *image, int thresh,
                       int *label_num, int **area, double **pos, int **clip,
                       int **label_ref, int LorR )
 {
+    ARContext *ctx = arGetGlobalContext( LorR );
+
     if( arDebug ) {
-        return( labeling3(image, thresh, label_num,
+        return( labeling3(ctx, image, thresh, label_num,
                           area, pos, clip, label_ref, LorR) );
     } else {
-        return( labeling2(image, thresh, label_num,
-                          area, pos, clip, label_ref, LorR) );
+        return( labeling2(ctx, image, thresh, label_num,
+                          area, pos, clip, label_ref) );
     }
 }
 
-static ARInt16 *labeling2( ARUint8 *image, int thresh,
+static ARInt16 *labeling2( ARContext *ctx, ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
-                           int **label_ref, int LorR )
+                           int **label_ref )
 {
     ARUint8   *pnt;                     /*  image pointer       */
     ARInt16   *pnt1, *pnt2;             /*  image pointer       */
@@ -140,30 +123,21 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
 #endif
 	int		  thresht3 = thresh * 3;
 
-	if (LorR) {
-        l_image = &l_imageL[0];
-        work    = &workL[0];
-        work2   = &work2L[0];
-        wlabel_num = &wlabel_numL;
-        warea   = &wareaL[0];
-        wclip   = &wclipL[0];
-        wpos    = &wposL[0];
+    if (ctx->l_image == NULL) return(0);
+    l_image = ctx->l_image;
+    work    = ctx->work;
+    work2   = ctx->work2;
+    wlabel_num = &(ctx->wlabel_num);
+    warea   = ctx->warea;
+    wclip   = ctx->wclip;
+    wpos    = ctx->wpos;
+
+    if (ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF) {
+        lxsize = ctx->xsize / 2;
+        lysize = ctx->ysize / 2;
     } else {
-        l_image = &l_imageR[0];
-        work    = &workR[0];
-        work2   = &work2R[0];
-        wlabel_num = &wlabel_numR;
-        warea   = &wareaR[0];
-        wclip   = &wclipR[0];
-        wpos    = &wposR[0];
-    }
-
-    if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) {
-        lxsize = arImXsize / 2;
-        lysize = arImYsize / 2;
-    } else {
-        lxsize = arImXsize;
-        lysize = arImYsize;
+        lxsize = ctx->xsize;
+        lysize = ctx->ysize;
     }
 
     pnt1 = &l_image[0]; // Leftmost pixel of top row of image.
@@ -214,11 +188,11 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
 
     wk_max = 0;
     pnt2 = &(l_image[lxsize+1]);
-    if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) {
-        pnt = &(image[(arImXsize*2+2)*AR_PIX_SIZE_DEFAULT]);
+    if (ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF) {
+        pnt = &(image[(ctx->xsize*2+2)*AR_PIX_SIZE_DEFAULT]);
         poff = AR_PIX_SIZE_DEFAULT*2;
     } else {
-        pnt = &(image[(arImXsize+1)*AR_PIX_SIZE_DEFAULT]);
+        pnt = &(image[(ctx->xsize+1)*AR_PIX_SIZE_DEFAULT]);
         poff = AR_PIX_SIZE_DEFAULT;
     }
     for (j = 1; j < lysize - 1; j++, pnt += poff*2, pnt2 += 2) {
@@ -401,7 +375,7 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
 				}
                 else {
                     wk_max++;
-                    if( wk_max > WORK_SIZE ) {
+                    if( wk_max > ctx->work_size ) {
                         return(0);
                     }
                     work[wk_max-1] = *pnt2 = wk_max;
@@ -418,7 +392,7 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
                 *pnt2 = 0;
             }
         }
-        if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) pnt += arImXsize*AR_PIX_SIZE_DEFAULT;
+        if (ctx->image_proc_mode == AR_IMAGE_PROC_IN_HALF) pnt += ctx->xsize*AR_PIX_SIZE_DEFAULT;
     }
 
     j = 1;
@@ -462,7 +436,7 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
     return (l_image);
 }
 
-static ARInt16 *labeling3( ARUint8 *image, int thresh,
+static ARInt16 *labeling3( ARContext *ctx, ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
                            int **label_ref, int LorR )
 {
@@ -504,14 +478,16 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
         lysize = arImYsize;
     }
 
+    if( ctx->l_image == NULL ) return(0);
+    l_image = ctx->l_image;
+    work    = ctx->work;
+    work2   = ctx->work2;
+    wlabel_num = &(ctx->wlabel_num);
+    warea   = ctx->warea;
+    wclip   = ctx->wclip;
+    wpos    = ctx->wpos;
+
     if( LorR ) {
-        l_image = &l_imageL[0];
-        work    = &workL[0];
-        work2   = &work2L[0];
-        wlabel_num = &wlabel_numL;
-        warea   = &wareaL[0];
-        wclip   = &wclipL[0];
-        wpos    = &wposL[0];
         if( arImageL == NULL ) {
 #if 0
             int texXsize = 1;
@@ -528,13 +504,6 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
         }
     }
     else {
-        l_image = &l_imageR[0];
-        work    = &workR[0];
-        work2   = &work2R[0];
-        wlabel_num = &wlabel_numR;
-        warea   = &wareaR[0];
-        wclip   = &wclipR[0];
-        wpos    = &wposR[0];
         if( arImageR == NULL ) {
 #if 0
             int texXsize = 1;
@@ -692,7 +661,7 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
                 }
                 else {
                     wk_max++;
-                    if( wk_max > WORK_SIZE ) {
+                    if( wk_max > ctx->work_size ) {
                         return(0);
                     }
                     work[wk_max-1] = *pnt2 = wk_max;
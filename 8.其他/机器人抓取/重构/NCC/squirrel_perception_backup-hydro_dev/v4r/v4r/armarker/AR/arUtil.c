@@ -89,6 +89,12 @@ int arGetLine(int x_coord[], int y_coord[], int coord_num,
     return arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arParam.dist_factor );
 }
 
+int arContextGetLine(ARContext *ctx, int x_coord[], int y_coord[], int coord_num,
+                     int vertex[], double line[4][3], double v[4][2])
+{
+    return arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, ctx->param.dist_factor );
+}
+
 int arsGetLine(int x_coord[], int y_coord[], int coord_num,
                int vertex[], double line[4][3], double v[4][2], int LorR)
 {   
@@ -251,6 +251,8 @@ private:
 /**
  * @class ARMarkerDetection
  * @author Markus Bader
+ * @brief Each detector owns its ARToolKit context (label buffers sized from the image, patterns,
+ * tracking history), so detectors for different cameras can run concurrently.
  **/
 class MarkerDetection {
 public:
@@ -355,7 +357,7 @@ public:
     
 protected:
 
-    void *mpARCParam;
+    void *mpARContext; /// ARContext of this detector
     unsigned int mFrameCount;
     std::vector<Marker> mMarker;
     std::vector<MarkerPattern> mMarkerPatterns;
@@ -37,15 +37,16 @@ std::string expandName ( const std::string &fileString ) {
 }
 
 MarkerDetection::MarkerDetection ( )
-        : mpARCParam ( NULL )
+        : mpARContext ( arCreateContext ( NULL, NULL ) )
         , mFrameCount ( 0 ) {
 }
 MarkerDetection::~MarkerDetection() {
-    if ( mpARCParam != NULL ) delete ( ( ARParam* ) mpARCParam );
+    arDeleteContext ( ( ARContext* ) mpARContext );
 }
 
 const std::vector<Marker>  &MarkerDetection::detectMarker ( const cv::Mat &img, int thresh ) {
-    if ( mpARCParam == NULL )  init(img.cols, img.rows);
+    ARContext *pContext = ( ARContext* ) mpARContext;
+    if ( ( pContext->xsize != img.cols ) || ( pContext->ysize != img.rows ) )  init(img.cols, img.rows);
 
     ARUint8         *pSrc;
     ARMarkerInfo    *marker_info;
@@ -53,7 +54,7 @@ const std::vector<Marker>  &MarkerDetection::detectMarker ( const cv::Mat &img,
     MarkerHdl       markerHdl;
     pSrc = ( ARUint8* ) img.data;
     mMarker. clear();
-    if ( arDetectMarker ( pSrc, thresh, &marker_info, &marker_num ) < 0 ) {
+    if ( arContextDetectMarker ( pContext, pSrc, thresh, &marker_info, &marker_num ) < 0 ) {
         exit ( 0 );
     }
     mMarker.resize ( marker_num );
@@ -66,15 +67,12 @@ const std::vector<Marker>  &MarkerDetection::detectMarker ( const cv::Mat &img,
 }
 
 void MarkerDetection::init ( int imgWidht, int imgHeight ) {
-    if ( mpARCParam == NULL ) {
-        mpARCParam = new ARParam;
-    }
-    ARParam *pCParam = ( ARParam* ) mpARCParam;
-    memset ( pCParam, 0, sizeof ( ARParam ) );
-    pCParam->dist_factor[3] = 1;
-    pCParam->xsize = imgWidht;
-    pCParam->ysize = imgHeight;
-    arInitCparam ( pCParam );
+    ARParam cParam;
+    memset ( &cParam, 0, sizeof ( ARParam ) );
+    cParam.dist_factor[3] = 1;
+    cParam.xsize = imgWidht;
+    cParam.ysize = imgHeight;
+    arContextInitCparam ( ( ARContext* ) mpARContext, &cParam );
     arUtilTimerReset();
     mFrameCount = 0;
 
@@ -84,7 +82,7 @@ int MarkerDetection::loadMarker ( const std::string &rFile, double size ) {
     std::string file = expandName(rFile);
     int patt_id;
     MarkerPattern pattern (file, file, cv::Size_<double>(size,size), cv::Vec6d());
-    if ( ( patt_id=arLoadPatt ( pattern.patternFile().c_str() ) ) < 0 ) {
+    if ( ( patt_id=arContextLoadPatt ( ( ARContext* ) mpARContext, pattern.patternFile().c_str() ) ) < 0 ) {
             std::cerr << "pattern load error: " << file << std::endl;
         return -1;
     }
@@ -98,7 +96,7 @@ int MarkerDetection::loadMarkerList(const std::string &rFile) {
     mMarkerPatterns = MarkerPattern::loadList(file);
     for (int i = 0; i < (int) mMarkerPatterns.size(); i++) {
       std::string patternFile = expandName(mMarkerPatterns[i].patternFile());
-        int patt_id = arLoadPatt ( patternFile.c_str() );
+        int patt_id = arContextLoadPatt ( ( ARContext* ) mpARContext, patternFile.c_str() );
         if ((patt_id < 0 ) || (patt_id != i)) {
             std::cerr << "pattern load error: " << patternFile << std::endl;
             return -1;
@@ -170,6 +170,15 @@ FittingCurve2d::solve (double damp)
 {
   double cps_diff (0.0);
 
+  // current control points as initial guess for the iterative solver
+  for (int j = 0; j < m_nurbs.CVCount (); j++)
+  {
+    ON_3dPoint cp;
+    m_nurbs.GetCV (j, cp);
+    m_solver.x (j, 0, cp.x);
+    m_solver.x (j, 1, cp.y);
+  }
+
   if (m_solver.solve ())
     cps_diff = updateCurve (damp);
 
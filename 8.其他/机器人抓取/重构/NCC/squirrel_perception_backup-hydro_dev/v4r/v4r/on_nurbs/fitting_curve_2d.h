@@ -199,6 +199,13 @@ namespace pcl
           m_solver.setQuiet (val);
         }
 
+        /** \brief Solver for the normal equations (sparse Cholesky by default, dense SVD for validation). */
+        inline void
+        setSolverType (NurbsSolve::SolverType type)
+        {
+          m_solver.setSolverType (type);
+        }
+
         /** \brief Set parameters for inverse mapping. */
         inline void
         setInverseParams (int max_steps = 200, double accuracy = 1e-6)
@@ -204,6 +204,17 @@ FittingSurface::init ()
 void
 FittingSurface::solve (double damp)
 {
+  // current control points as initial guess for the iterative solver
+  int ncp = m_nurbs.m_cv_count[0] * m_nurbs.m_cv_count[1];
+  for (int A = 0; A < ncp; A++)
+  {
+    ON_3dPoint cp;
+    m_nurbs.GetCV (gl2gr (A), gl2gc (A), cp);
+    m_solver.x (A, 0, cp.x);
+    m_solver.x (A, 1, cp.y);
+    m_solver.x (A, 2, cp.z);
+  }
+
   if (m_solver.solve ())
     updateSurf (damp);
 }
@@ -232,6 +232,13 @@ namespace pcl
         m_solver.setQuiet (val);
       }
 
+      /** \brief Solver for the normal equations (sparse Cholesky by default, dense SVD for validation). */
+      inline void
+      setSolverType (NurbsSolve::SolverType type)
+      {
+        m_solver.setSolverType (type);
+      }
+
     protected:
 
       /** \brief Initialisation of member variables */
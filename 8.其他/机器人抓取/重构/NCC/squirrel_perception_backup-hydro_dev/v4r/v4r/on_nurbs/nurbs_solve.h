@@ -41,6 +41,9 @@
 #undef Success
 #include <Eigen/Dense>
 
+#include <vector>
+#include <utility>
+
 #include "sparse_mat.h"
 
 namespace pcl
@@ -53,10 +56,34 @@ namespace pcl
     class NurbsSolve
     {
     public:
+      /** \brief Methods for solving the (least squares) system of equations, honoured by both builds.
+       *  - SOLVER_DENSE_SVD: SVD of the dense system matrix, slow but robust, kept for validation.
+       *  - SOLVER_SPARSE_CHOLESKY: sparse Cholesky of the normal equations K^T K x = K^T f
+       *    (Eigen: SimplicialLDLT, SuiteSparse: CHOLMOD, falling back to the UmfPack LU).
+       *  - SOLVER_SPARSE_CG: conjugate gradient on the normal equations, starting from the current x
+       *    (set x to the previous control points to warm-start). Both builds use Eigen's solver. */
+      enum SolverType
+      {
+        SOLVER_DENSE_SVD, SOLVER_SPARSE_CHOLESKY, SOLVER_SPARSE_CG
+      };
+
       /** \brief Empty constructor */
       NurbsSolve () :
-        m_quiet (true)
+        m_quiet (true), m_solver_type (SOLVER_SPARSE_CHOLESKY)
+      {
+      }
+
+      /** \brief Select the solver, call before assign (the dense solver needs a dense system matrix). */
+      inline void
+      setSolverType (SolverType type)
+      {
+        m_solver_type = type;
+      }
+
+      inline SolverType
+      getSolverType () const
       {
+        return m_solver_type;
       }
 
       /** \brief Assign size and dimension (2D, 3D) of system of equations. */
@@ -123,7 +150,14 @@ namespace pcl
       }
 
     private:
+      /** \brief Sparse least squares solution of the system stored in m_Krows (Eigen backends) */
+      bool
+      solveSparse ();
+
       bool m_quiet;
+      SolverType m_solver_type;
+      /** \brief Non-zero entries (column, value) of each row of K, used by the sparse solvers of the Eigen backends */
+      std::vector<std::vector<std::pair<unsigned, double> > > m_Krows;
       SparseMat m_Ksparse;
       Eigen::MatrixXd m_Keig;
       Eigen::MatrixXd m_xeig;
@@ -47,15 +47,43 @@ using namespace on_nurbs;
 void
 NurbsSolve::assign (unsigned rows, unsigned cols, unsigned dims)
 {
-  m_Keig = Eigen::MatrixXd::Zero (rows, cols);
   m_xeig = Eigen::MatrixXd::Zero (cols, dims);
   m_feig = Eigen::MatrixXd::Zero (rows, dims);
+
+  if (m_solver_type == SOLVER_DENSE_SVD)
+  {
+    m_Keig = Eigen::MatrixXd::Zero (rows, cols);
+    m_Krows.clear ();
+  }
+  else
+  {
+    m_Keig.resize (0, 0);
+    m_Krows.assign (rows, std::vector<std::pair<unsigned, double> > ());
+  }
 }
 
 void
 NurbsSolve::K (unsigned i, unsigned j, double v)
 {
-  m_Keig (i, j) = v;
+  if (m_solver_type == SOLVER_DENSE_SVD)
+  {
+    m_Keig (i, j) = v;
+    return;
+  }
+
+  std::vector<std::pair<unsigned, double> > &row = m_Krows[i];
+  for (size_t k = 0; k < row.size (); k++)
+  {
+    if (row[k].first == j)
+    {
+      row[k].second = v;
+      return;
+    }
+  }
+
+  // assemblers clear whole rows with zeros, those must not fill in the sparse structure
+  if (v != 0.0)
+    row.push_back (std::make_pair (j, v));
 }
 void
 NurbsSolve::x (unsigned i, unsigned j, double v)
@@ -71,7 +99,16 @@ NurbsSolve::f (unsigned i, unsigned j, double v)
 double
 NurbsSolve::K (unsigned i, unsigned j)
 {
-  return m_Keig (i, j);
+  if (m_solver_type == SOLVER_DENSE_SVD)
+    return m_Keig (i, j);
+
+  const std::vector<std::pair<unsigned, double> > &row = m_Krows[i];
+  for (size_t k = 0; k < row.size (); k++)
+  {
+    if (row[k].first == j)
+      return row[k].second;
+  }
+  return 0.0;
 }
 double
 NurbsSolve::x (unsigned i, unsigned j)
@@ -88,17 +125,20 @@ void
 NurbsSolve::resize (unsigned rows)
 {
   m_feig.conservativeResize (rows, m_feig.cols ());
-  m_Keig.conservativeResize (rows, m_Keig.cols ());
+  if (m_solver_type == SOLVER_DENSE_SVD)
+    m_Keig.conservativeResize (rows, m_Keig.cols ());
+  else
+    m_Krows.resize (rows);
 }
 
 void
 NurbsSolve::printK ()
 {
-  for (unsigned r = 0; r < m_Keig.rows (); r++)
+  for (unsigned r = 0; r < m_feig.rows (); r++)
   {
-    for (unsigned c = 0; c < m_Keig.cols (); c++)
+    for (unsigned c = 0; c < m_xeig.rows (); c++)
     {
-      printf (" %f", m_Keig (r, c));
+      printf (" %f", K (r, c));
     }
     printf ("\n");
   }
@@ -133,6 +173,9 @@ NurbsSolve::printF ()
 bool
 NurbsSolve::solve ()
 {
+  if (m_solver_type != SOLVER_DENSE_SVD)
+    return solveSparse ();
+
   //  m_xeig = m_Keig.colPivHouseholderQr().solve(m_feig);
   //  Eigen::MatrixXd x = A.householderQr().solve(b);
   m_xeig = m_Keig.jacobiSvd (Eigen::ComputeThinU | Eigen::ComputeThinV).solve (m_feig);
@@ -143,7 +186,17 @@ NurbsSolve::solve ()
 Eigen::MatrixXd
 NurbsSolve::diff ()
 {
-  Eigen::MatrixXd f (m_Keig * m_xeig);
+  if (m_solver_type == SOLVER_DENSE_SVD)
+  {
+    Eigen::MatrixXd f (m_Keig * m_xeig);
+    return (f - m_feig);
+  }
+
+  Eigen::MatrixXd f = Eigen::MatrixXd::Zero (m_feig.rows (), m_feig.cols ());
+  for (size_t r = 0; r < m_Krows.size (); r++)
+  {
+    for (size_t k = 0; k < m_Krows[r].size (); k++)
+      f.row (r) += m_Krows[r][k].second * m_xeig.row (m_Krows[r][k].first);
+  }
   return (f - m_feig);
 }
-
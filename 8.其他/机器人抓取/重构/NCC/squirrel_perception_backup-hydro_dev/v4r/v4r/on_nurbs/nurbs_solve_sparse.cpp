@@ -0,0 +1,138 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * 
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+
+#include <v4r/on_nurbs/nurbs_solve.h>
+
+using namespace std;
+using namespace pcl;
+using namespace on_nurbs;
+
+namespace
+{
+  inline bool
+  isFinite (const Eigen::MatrixXd &m)
+  {
+    // NaN and inf do not survive x - x == 0
+    return ((m - m).array () == (m - m).array ()).all ();
+  }
+}
+
+bool
+NurbsSolve::solveSparse ()
+{
+  clock_t time_start, time_end;
+  time_start = clock ();
+
+  const int n_rows = static_cast<int> (m_Krows.size ());
+  const int n_cols = static_cast<int> (m_xeig.rows ());
+
+  std::vector<Eigen::Triplet<double> > triplets;
+  size_t n_nz (0);
+  for (int r = 0; r < n_rows; r++)
+    n_nz += m_Krows[r].size ();
+  triplets.reserve (n_nz);
+
+  for (int r = 0; r < n_rows; r++)
+  {
+    for (size_t k = 0; k < m_Krows[r].size (); k++)
+      triplets.push_back (Eigen::Triplet<double> (r, m_Krows[r][k].first, m_Krows[r][k].second));
+  }
+
+  Eigen::SparseMatrix<double> K (n_rows, n_cols);
+  K.setFromTriplets (triplets.begin (), triplets.end ());
+
+  // normal equations: the fitting rows only couple control points with overlapping support,
+  // so KtK stays banded/sparse
+  Eigen::SparseMatrix<double> Kt (K.transpose ());
+  Eigen::SparseMatrix<double> KtK (Kt * K);
+  Eigen::MatrixXd Ktf (Kt * m_feig);
+
+  bool success (false);
+  Eigen::MatrixXd x (n_cols, m_feig.cols ());
+
+  if (m_solver_type == SOLVER_SPARSE_CG)
+  {
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double> > cg;
+    cg.compute (KtK);
+    success = (cg.info () == Eigen::Success);
+
+    // warm start from the solution stored in x (e.g. the current control points)
+    for (int d = 0; d < Ktf.cols () && success; d++)
+    {
+      x.col (d) = cg.solveWithGuess (Ktf.col (d), m_xeig.col (d));
+      success = (cg.info () == Eigen::Success);
+    }
+  }
+  else
+  {
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > ldlt (KtK);
+    if (ldlt.info () == Eigen::Success)
+    {
+      x = ldlt.solve (Ktf);
+      success = (ldlt.info () == Eigen::Success);
+    }
+  }
+
+  if (!success || !isFinite (x))
+  {
+    // rank deficient system (e.g. no regularisation and unsupported control points)
+    if (!m_quiet)
+      printf ("[NurbsSolve::solveSparse] Warning: sparse solver failed, falling back to SVD\n");
+
+    Eigen::MatrixXd Kd (K.toDense ());
+    x = Kd.jacobiSvd (Eigen::ComputeThinU | Eigen::ComputeThinV).solve (m_feig);
+  }
+
+  m_xeig = x;
+
+  time_end = clock ();
+
+  if (!m_quiet)
+  {
+    double solve_time = (double)(time_end - time_start) / (double)(CLOCKS_PER_SEC);
+    printf ("[NurbsSolve::solveSparse()] solution found! (%f sec)\n", solve_time);
+  }
+
+  return true;
+}
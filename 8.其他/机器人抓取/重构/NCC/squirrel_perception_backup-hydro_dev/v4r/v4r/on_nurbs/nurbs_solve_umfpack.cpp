@@ -41,6 +41,9 @@
 #include <stdio.h>
 #include <stdexcept>
 
+#include <Eigen/Sparse>
+#include <Eigen/IterativeLinearSolvers>
+
 #include <v4r/on_nurbs/nurbs_solve.h>
 
 using namespace std;
@@ -197,13 +200,42 @@ namespace pcl
     }
 
     bool
-    solveSparseLinearSystemLQ (cholmod_sparse* A, cholmod_dense* b, cholmod_dense* x)
+    solveSparseLinearSystemCholesky (cholmod_sparse* A, cholmod_dense* b, cholmod_dense* x, cholmod_common* c)
+    {
+      // A is symmetric (upper triangle stored), a failed factorization means it is not positive definite
+      cholmod_factor* L = cholmod_analyze (A, c);
+      if (L == NULL)
+        return false;
+
+      if (!cholmod_factorize (A, L, c) || c->status != CHOLMOD_OK)
+      {
+        cholmod_free_factor (&L, c);
+        return false;
+      }
+
+      cholmod_dense* sol = cholmod_solve (CHOLMOD_A, L, b, c);
+      cholmod_free_factor (&L, c);
+      if (sol == NULL)
+        return false;
+
+      double* src = (double*)sol->x;
+      double* dst = (double*)x->x;
+      for (size_t i = 0; i < x->nrow * x->ncol; i++)
+        dst[i] = src[i];
+
+      cholmod_free_dense (&sol, c);
+      return true;
+    }
+
+    bool
+    solveSparseLinearSystemLQ (cholmod_sparse* A, cholmod_dense* b, cholmod_dense* x, bool cholesky)
     {
       cholmod_common c;
       cholmod_start (&c);
       c.print = 4;
 
-      cholmod_sparse* At = cholmod_allocate_sparse (A->ncol, A->nrow, A->ncol * A->nrow, 0, 1, 0, CHOLMOD_REAL, &c);
+      // the transpose has exactly the non-zeros of A
+      cholmod_sparse* At = cholmod_allocate_sparse (A->ncol, A->nrow, A->nzmax, 0, 1, 0, CHOLMOD_REAL, &c);
       //  cholmod_dense* Atb = cholmod_allocate_dense(b->nrow, b->ncol, b->nrow, CHOLMOD_REAL, &c);
       cholmod_dense* Atb = cholmod_allocate_dense (A->ncol, b->ncol, A->ncol, CHOLMOD_REAL, &c);
 
@@ -222,7 +254,7 @@ namespace pcl
         cholmod_free_sparse (&At, &c);
         cholmod_free_dense (&Atb, &c);
 
-        At = cholmod_allocate_sparse (A->ncol, A->nrow, (i + 2) * A->ncol * A->nrow, 0, 1, 0, CHOLMOD_REAL, &c);
+        At = cholmod_allocate_sparse (A->ncol, A->nrow, (i + 2) * A->nzmax, 0, 1, 0, CHOLMOD_REAL, &c);
         Atb = cholmod_allocate_dense (A->ncol, b->ncol, A->ncol, CHOLMOD_REAL, &c);
 
         double one[2] = {1, 0};
@@ -240,20 +272,73 @@ namespace pcl
         return false;
       }
 
-      cholmod_sparse* AtA = cholmod_ssmult (At, A, 0, 1, 1, &c);
+      bool success (false);
+      if (cholesky)
+      {
+        cholmod_sparse* AtA = cholmod_ssmult (At, A, 1, 1, 1, &c);
+        success = solveSparseLinearSystemCholesky (AtA, Atb, x, &c);
+        cholmod_free_sparse (&AtA, &c);
+
+        if (!success)
+          printf ("[NurbsSolveUmfpack::solveSparseLinearSystemLQ] Warning: Cholesky factorization failed, using LU\n");
+      }
+
+      if (!success)
+      {
+        cholmod_sparse* AtA = cholmod_ssmult (At, A, 0, 1, 1, &c);
 
-      //  cholmod_print_sparse(AtA,"A: ", &c);
+        //  cholmod_print_sparse(AtA,"A: ", &c);
 
-      bool success = solveSparseLinearSystem (AtA, Atb, x, false);
+        success = solveSparseLinearSystem (AtA, Atb, x, false);
+        cholmod_free_sparse (&AtA, &c);
+      }
 
       cholmod_free_sparse (&At, &c);
-      cholmod_free_sparse (&AtA, &c);
       cholmod_free_dense (&Atb, &c);
 
       cholmod_finish (&c);
 
       return success;
     }
+
+    bool
+    solveSparseLinearSystemCG (int n_rows, int n_cols, const std::vector<int> &rowinds,
+                               const std::vector<int> &colinds, const std::vector<double> &values,
+                               const Eigen::MatrixXd &f, Eigen::MatrixXd &x)
+    {
+      std::vector<Eigen::Triplet<double> > triplets;
+      triplets.reserve (values.size ());
+      for (size_t i = 0; i < values.size (); i++)
+        triplets.push_back (Eigen::Triplet<double> (rowinds[i], colinds[i], values[i]));
+
+      Eigen::SparseMatrix<double> K (n_rows, n_cols);
+      K.setFromTriplets (triplets.begin (), triplets.end ());
+
+      Eigen::SparseMatrix<double> Kt (K.transpose ());
+      Eigen::SparseMatrix<double> KtK (Kt * K);
+      Eigen::MatrixXd Ktf (Kt * f);
+
+      Eigen::ConjugateGradient<Eigen::SparseMatrix<double> > cg;
+      cg.compute (KtK);
+      if (cg.info () != Eigen::Success)
+        return false;
+
+      // warm start from the solution stored in x (e.g. the current control points)
+      Eigen::MatrixXd sol (n_cols, f.cols ());
+      for (int d = 0; d < Ktf.cols (); d++)
+      {
+        sol.col (d) = cg.solveWithGuess (Ktf.col (d), x.col (d));
+        if (cg.info () != Eigen::Success)
+          return false;
+      }
+
+      // NaN and inf do not survive sol - sol == 0
+      if (!((sol - sol).array () == (sol - sol).array ()).all ())
+        return false;
+
+      x = sol;
+      return true;
+    }
   }
 }
 
@@ -273,7 +358,43 @@ NurbsSolve::solve ()
 
   //  m_Ksparse.printLong();
 
-  cholmod_sparse* K = cholmod_allocate_sparse (n_rows, n_cols, n_rows * n_cols, 0, 1, 0, CHOLMOD_REAL, &c);
+  if (m_solver_type == SOLVER_DENSE_SVD)
+  {
+    cholmod_finish (&c);
+
+    // reference solution for validating the sparse path
+    Eigen::MatrixXd Kd = Eigen::MatrixXd::Zero (m_feig.rows (), m_xeig.rows ());
+    std::vector<int> rowinds;
+    std::vector<int> colinds;
+    std::vector<double> values;
+    m_Ksparse.get (rowinds, colinds, values);
+    for (size_t i = 0; i < values.size (); i++)
+      Kd (rowinds[i], colinds[i]) = values[i];
+
+    m_xeig = Kd.jacobiSvd (Eigen::ComputeThinU | Eigen::ComputeThinV).solve (m_feig);
+    return true;
+  }
+
+  if (m_solver_type == SOLVER_SPARSE_CG)
+  {
+    std::vector<int> rowinds;
+    std::vector<int> colinds;
+    std::vector<double> values;
+    m_Ksparse.get (rowinds, colinds, values);
+
+    if (solveSparseLinearSystemCG (n_rows, n_cols, rowinds, colinds, values, m_feig, m_xeig))
+    {
+      cholmod_finish (&c);
+      return true;
+    }
+
+    // e.g. a rank deficient system, solved by the direct solver below
+    if (!m_quiet)
+      printf ("[NurbsSolve[UMFPACK]::solve()] Warning: conjugate gradient failed, using the direct solver\n");
+  }
+
+  // only the non-zeros are stored, a dense sized allocation exhausts memory for fine control grids
+  cholmod_sparse* K = cholmod_allocate_sparse (n_rows, n_cols, n_nz, 0, 1, 0, CHOLMOD_REAL, &c);
   cholmod_dense* f = cholmod_allocate_dense (n_rows, n_dims, n_rows, CHOLMOD_REAL, &c);
   cholmod_dense* d = cholmod_allocate_dense (n_cols, n_dims, n_cols, CHOLMOD_REAL, &c);
 
@@ -300,7 +421,7 @@ NurbsSolve::solve ()
     }
   }
 
-  bool success = solveSparseLinearSystemLQ (K, f, d);
+  bool success = solveSparseLinearSystemLQ (K, f, d, m_solver_type == SOLVER_SPARSE_CHOLESKY);
 
   temp = (double*)d->x;
 
@@ -50,6 +50,6 @@ IF(USE_UMFPACK)
 	set(ON_NURBS_SOURCES ${ON_NURBS_SOURCES} src/on_nurbs/nurbs_solve_umfpack.cpp)
 	set(ON_NURBS_LIBRARIES ${ON_NURBS_LIBRARIES} cholmod umfpack)
 ELSE(USE_UMFPACK)
-	set(ON_NURBS_SOURCES ${ON_NURBS_SOURCES} src/on_nurbs/nurbs_solve_eigen.cpp)
+	set(ON_NURBS_SOURCES ${ON_NURBS_SOURCES} src/on_nurbs/nurbs_solve_eigen.cpp src/on_nurbs/nurbs_solve_sparse.cpp)
 ENDIF(USE_UMFPACK)
 